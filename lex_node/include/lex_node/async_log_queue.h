@@ -0,0 +1,179 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * A log line waiting to be forwarded.
+ */
+struct LogRecord
+{
+  int level = 0;
+  std::string tag;
+  std::string message;
+};
+
+/**
+ * Moves log lines off the threads logging them. Lines are copied into a bounded ring buffer many
+ * threads push to without taking a lock, and a background thread forwards them in batches.
+ *
+ * When the buffer is full the oldest line is dropped and counted, or the logging thread waits for
+ * the background thread, as the overflow policy says. Lines logged by the background thread itself
+ * are dropped rather than waited for.
+ */
+class AsyncLogQueue
+{
+public:
+  /**
+   * Forwards a batch of lines, in the order they were pushed.
+   *
+   * @param records lines to forward, owned by the queue
+   * @param count of records, 0 when only reporting drops
+   * @param dropped lines dropped since the previous batch
+   */
+  using Forward =
+    std::function<void(const LogRecord * records, std::size_t count, uint64_t dropped)>;
+
+  /**
+   * Queue counters.
+   */
+  struct Stats
+  {
+    /**
+     * Lines copied into the buffer, dropped ones included.
+     */
+    uint64_t pushed = 0;
+    /**
+     * Lines dropped because the buffer was full.
+     */
+    uint64_t dropped = 0;
+    /**
+     * Pushes that waited for room in the buffer.
+     */
+    uint64_t blocked = 0;
+    /**
+     * Lines forwarded.
+     */
+    uint64_t forwarded = 0;
+    /**
+     * Batches forwarded.
+     */
+    uint64_t batches = 0;
+  };
+
+  /**
+   * Start the background thread.
+   *
+   * @param configuration buffer capacity, overflow policy and flush interval
+   * @param forward called on the background thread with each batch
+   */
+  AsyncLogQueue(const LoggingConfiguration & configuration, Forward forward);
+
+  /**
+   * Forward the lines left and stop the background thread.
+   */
+  ~AsyncLogQueue();
+
+  AsyncLogQueue(const AsyncLogQueue &) = delete;
+  AsyncLogQueue & operator=(const AsyncLogQueue &) = delete;
+
+  /**
+   * Copy a line into the buffer.
+   *
+   * @param level of the line
+   * @param tag of the line
+   * @param message text of the line
+   * @param size of message
+   */
+  void Push(int level, const char * tag, const char * message, std::size_t size);
+
+  /**
+   * Wait until the lines pushed before the call are forwarded or dropped.
+   */
+  void Flush();
+
+  Stats GetStats() const;
+
+  /**
+   * @return the capacity of the buffer, the configured capacity rounded up to a power of two
+   */
+  std::size_t Capacity() const { return mask_ + 1; }
+
+private:
+  struct Slot
+  {
+    /**
+     * Position the slot can be written at, or position + 1 once written and readable.
+     */
+    std::atomic<std::size_t> sequence;
+    LogRecord record;
+  };
+
+  bool TryPush(int level, const char * tag, const char * message, std::size_t size);
+  bool TryPop(LogRecord & record);
+  void Run();
+
+  const std::size_t mask_;
+  const bool is_blocking_;
+  const std::chrono::milliseconds flush_interval_;
+  const Forward forward_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // the positions are padded apart, the queue may be allocated without its cache line alignment
+  char enqueue_padding_[64];
+  std::atomic<std::size_t> enqueue_position_{0};
+  char dequeue_padding_[64];
+  std::atomic<std::size_t> dequeue_position_{0};
+  char counters_padding_[64];
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> blocked_{0};
+  std::atomic<uint64_t> forwarded_{0};
+  std::atomic<uint64_t> batches_{0};
+
+  /**
+   * Wakes the background thread for waiting pushes, flushes and shutdown, and wakes them back.
+   */
+  std::mutex mutex_;
+  std::condition_variable work_;
+  std::condition_variable done_;
+  int waiting_pushes_ = 0;
+  int waiting_flushes_ = 0;
+  /**
+   * Dequeue position the background thread drained the buffer to.
+   */
+  std::size_t drained_position_ = 0;
+  bool is_stopping_ = false;
+  std::thread thread_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
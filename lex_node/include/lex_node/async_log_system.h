@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/core/utils/logging/LogSystemInterface.h>
+#include <aws/core/utils/memory/stl/AWSStringStream.h>
+#include <lex_node/async_log_queue.h>
+#include <lex_node/lex_configuration.h>
+
+#include <memory>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Log system for the aws sdk and the node handing each line to a background thread, which
+ * forwards it to another log system. The logging thread only formats the line and copies it into
+ * a ring buffer, the other log system, AWSROSLogger publishing to rosout, runs off the lex calls.
+ *
+ * Lines are forwarded up to the flush interval after they are logged. Install it with
+ * Aws::Utils::Logging::InitializeAWSLogging, ShutdownAWSLogging forwards the lines left.
+ */
+class AsyncLogSystem : public Aws::Utils::Logging::LogSystemInterface
+{
+public:
+  /**
+   * @param configuration buffer capacity, overflow policy and flush interval
+   * @param log_system to forward the lines to, its log level is the level of this log system
+   */
+  AsyncLogSystem(const LoggingConfiguration & configuration,
+                 std::shared_ptr<Aws::Utils::Logging::LogSystemInterface> log_system);
+
+  ~AsyncLogSystem() override = default;
+
+  Aws::Utils::Logging::LogLevel GetLogLevel() const override;
+
+  void Log(Aws::Utils::Logging::LogLevel log_level, const char * tag, const char * format,
+           ...) override;
+
+  void LogStream(Aws::Utils::Logging::LogLevel log_level, const char * tag,
+                 const Aws::OStringStream & message_stream) override;
+
+  /**
+   * Wait until the lines logged before the call are forwarded.
+   */
+  void Flush();
+
+  /**
+   * @return the counters of the ring buffer
+   */
+  AsyncLogQueue::Stats GetStats() const;
+
+private:
+  /**
+   * Forward a batch of lines from the background thread.
+   */
+  void Forward(const LogRecord * records, std::size_t count, uint64_t dropped);
+
+  std::shared_ptr<Aws::Utils::Logging::LogSystemInterface> log_system_;
+  /**
+   * Reused for each forwarded line, only used by the background thread.
+   */
+  Aws::OStringStream stream_;
+  /**
+   * Declared last, its background thread is stopped before the other members are destroyed.
+   */
+  AsyncLogQueue queue_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Pool of audio buffers sorted in power of two size classes. Released buffers keep their memory and
+ * are handed out again by Acquire(), instead of being returned to malloc after every call.
+ */
+class AudioBufferPool
+{
+public:
+  /**
+   * Smallest size class, smaller buffers are not pooled.
+   */
+  static constexpr std::size_t kMinBufferSize = 4096;
+
+  /**
+   * Pool usage counters.
+   */
+  struct Stats
+  {
+    /**
+     * Acquire() calls served from the pool.
+     */
+    uint64_t hits = 0;
+    /**
+     * Acquire() calls that allocated a new buffer.
+     */
+    uint64_t misses = 0;
+    /**
+     * Bytes held by the buffers waiting in the pool.
+     */
+    std::size_t pooled_bytes = 0;
+  };
+
+  /**
+   * @param max_buffer_size largest buffer capacity kept by the pool
+   * @param buffers_per_size number of buffers kept per size class
+   */
+  AudioBufferPool(std::size_t max_buffer_size, std::size_t buffers_per_size);
+
+  /**
+   * Get an empty buffer able to hold at least min_capacity bytes without reallocating.
+   *
+   * @param min_capacity the capacity needed
+   * @return the buffer, release it when done
+   */
+  std::vector<uint8_t> Acquire(std::size_t min_capacity);
+
+  /**
+   * Give a buffer back to the pool. Buffers outside of the size classes or in excess of
+   * buffers_per_size are freed.
+   *
+   * @param buffer to release, left empty
+   */
+  void Release(std::vector<uint8_t> && buffer);
+
+  /**
+   * @return the pool usage counters
+   */
+  Stats GetStats();
+
+private:
+  std::size_t max_buffer_size_;
+  std::size_t buffers_per_size_;
+  std::mutex mutex_;
+  std::vector<std::vector<std::vector<uint8_t>>> free_buffers_;
+  Stats stats_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Layout of raw pcm audio, as declared by a request content type.
+ */
+struct PcmFormat
+{
+  int sample_rate = 16000;
+  int sample_bits = 16;
+  int channels = 1;
+  bool big_endian = false;
+  /**
+   * Samples are 32 bit floats, declared with "sample-format=float".
+   */
+  bool is_float = false;
+
+  /**
+   * @return the size of one sample of every channel, in bytes
+   */
+  int FrameBytes() const { return channels * sample_bits / 8; }
+};
+
+/**
+ * Parse the pcm layout of a lex audio content type, either "audio/l16; rate=16000; channels=1" or
+ * "audio/lpcm; sample-rate=8000; sample-size-bits=16; channel-count=1; is-big-endian=false".
+ * Parameters that are not given keep their defaults. Besides the lex parameters, lpcm input may
+ * declare "sample-format=float" for 32 bit float samples.
+ *
+ * @param content_type to parse
+ * @param format [out] the declared layout
+ * @return false if the content type is not raw pcm or a parameter is invalid
+ */
+bool ParsePcmContentType(const std::string & content_type, PcmFormat & format);
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/audio_format.h>
+#include <lex_node/lex_configuration.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Convert interleaved pcm to mono float samples in [-1, 1), averaging the channels.
+ *
+ * @param data interleaved samples in the given format
+ * @param frame_count number of samples per channel
+ * @param format of data
+ * @param output [out] frame_count mono samples
+ */
+void DownmixToFloat(const uint8_t * data, std::size_t frame_count, const PcmFormat & format,
+                    float * output);
+
+/**
+ * Convert float samples to 16 bit, rounding half to even and saturating. On 32 bit arm halves are
+ * rounded away from zero.
+ */
+void FloatToInt16(const float * samples, std::size_t count, int16_t * output);
+
+/**
+ * Scalar versions of the vectorized kernels, reference for their tests and benchmarks.
+ */
+void DownmixToFloatScalar(const uint8_t * data, std::size_t frame_count, const PcmFormat & format,
+                          float * output);
+void FloatToInt16Scalar(const float * samples, std::size_t count, int16_t * output);
+float DotProduct(const float * a, const float * b, std::size_t count);
+float DotProductScalar(const float * a, const float * b, std::size_t count);
+
+/**
+ * Rational rate converter: a windowed sinc low pass filter split into one polyphase branch per
+ * output phase, so each output sample costs a single short dot product.
+ */
+class PolyphaseResampler
+{
+public:
+  /**
+   * @param input_rate in hertz
+   * @param output_rate in hertz
+   * @param zero_crossings of the sinc kept on each side, longer filters have a sharper cutoff
+   */
+  PolyphaseResampler(int input_rate, int output_rate, int zero_crossings = 12);
+
+  /**
+   * @return the number of output samples for an input clip
+   */
+  std::size_t OutputCount(std::size_t input_count) const;
+
+  /**
+   * Resample a whole clip, reading zeros around it.
+   *
+   * @param input samples
+   * @param input_count number of input samples
+   * @param output [out] OutputCount(input_count) samples
+   */
+  void Process(const float * input, std::size_t input_count, float * output) const;
+
+private:
+  /**
+   * Upsampling factor.
+   */
+  std::size_t interpolation_;
+  /**
+   * Downsampling factor.
+   */
+  std::size_t decimation_;
+  /**
+   * Taps of each branch, a multiple of the vector width.
+   */
+  std::size_t taps_;
+  /**
+   * Filter delay in upsampled samples.
+   */
+  std::size_t delay_;
+  /**
+   * Branch coefficients, taps_ per phase, reversed to run along the input.
+   */
+  std::vector<float> coefficients_;
+};
+
+/**
+ * Converts request audio of any declared pcm layout to the 16 bit mono little endian audio lex
+ * expects. Resamplers are built once per rate and shared by the calls.
+ */
+class AudioNormalizer
+{
+public:
+  explicit AudioNormalizer(const NormalizationConfiguration & configuration)
+  : configuration_(configuration)
+  {
+  }
+
+  /**
+   * @return true if lex does not accept audio in this layout as it is
+   */
+  bool NeedsNormalization(const PcmFormat & format) const;
+
+  /**
+   * @param data request audio
+   * @param size of data in bytes
+   * @param format of data
+   * @param output [out] the 16 bit mono samples at the configured rate
+   * @return the layout of output
+   */
+  PcmFormat Normalize(const uint8_t * data, std::size_t size, const PcmFormat & format,
+                      std::vector<uint8_t> & output);
+
+private:
+  std::shared_ptr<const PolyphaseResampler> GetResampler(int input_rate);
+
+  NormalizationConfiguration configuration_;
+  std::mutex mutex_;
+  std::map<int, std::shared_ptr<const PolyphaseResampler>> resamplers_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/audio_normalizer.h>
+#include <lex_node/lex_configuration.h>
+#include <lex_node/opus_encoding.h>
+#include <lex_node/voice_activity.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Request audio as it is uploaded to lex.
+ */
+struct ProcessedAudio
+{
+  /**
+   * Bytes to upload, may point into the request audio or into normalized.
+   */
+  const uint8_t * data = nullptr;
+  std::size_t size = 0;
+
+  /**
+   * The request audio converted to the format lex expects, null if it was not converted.
+   */
+  std::shared_ptr<std::vector<uint8_t>> normalized;
+
+  /**
+   * Content type to send the bytes with.
+   */
+  std::string content_type;
+
+  /**
+   * Bytes of silence left out of the upload.
+   */
+  std::size_t trimmed_bytes = 0;
+
+  /**
+   * Duration of the silence left out of the upload, in milliseconds.
+   */
+  double trimmed_ms = 0.0;
+
+  /**
+   * Encoding of data in progress, its output is uploaded instead of data. Null when data is
+   * uploaded as it is.
+   */
+  std::shared_ptr<OpusEncodeJob> encode_job;
+};
+
+/**
+ * Stages preparing request audio before it is uploaded to lex: conversion to 16 bit mono pcm,
+ * silence trimming, then opus encoding.
+ */
+class AudioPipeline
+{
+public:
+  /**
+   * @param voice_activity_configuration of the stage trimming silence
+   * @param opus_configuration of the stage encoding to opus
+   * @param normalization_configuration of the stage converting to 16 bit mono pcm
+   */
+  explicit AudioPipeline(
+    const VoiceActivityConfiguration & voice_activity_configuration,
+    const OpusConfiguration & opus_configuration = OpusConfiguration(),
+    const NormalizationConfiguration & normalization_configuration = NormalizationConfiguration());
+
+  /**
+   * Run the enabled stages over request audio. Audio the stages do not support is uploaded as
+   * it is. Encoding starts on the encoder worker, an encode job must be cancelled before the
+   * request audio is released.
+   *
+   * @param content_type declared by the request
+   * @param audio of the request, must outlive the result
+   * @return the audio to upload
+   */
+  ProcessedAudio Process(const std::string & content_type,
+                         const std::vector<uint8_t> & audio) const;
+
+private:
+  /**
+   * Converts request audio to 16 bit mono pcm, null when normalization is disabled.
+   */
+  std::unique_ptr<AudioNormalizer> normalizer_;
+
+  VoiceActivityConfiguration voice_activity_configuration_;
+  VoiceActivityDetector voice_activity_detector_;
+
+  /**
+   * Encodes request audio to opus, null when encoding is disabled.
+   */
+  std::unique_ptr<OpusEncoderWorker> opus_encoder_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
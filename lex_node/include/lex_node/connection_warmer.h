@@ -0,0 +1,171 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/lex/LexRuntimeServiceClient.h>
+#include <lex_node/lex_configuration.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Whether calls to lex can reuse open connections.
+ */
+enum class ConnectionState
+{
+  /**
+   * No call in the idle timeout, the next call likely pays for dns, connect and tls handshake.
+   */
+  kCold,
+  /**
+   * Warm up calls are in flight.
+   */
+  kWarming,
+  /**
+   * Connections were used within the idle timeout.
+   */
+  kWarm,
+};
+
+/**
+ * @return the name of a connection state, for logs
+ */
+const char * GetNameForConnectionState(ConnectionState state);
+
+/**
+ * Keeps connections to the lex endpoint open so the first utterance does not pay for opening one.
+ * Once started, it opens the configured number of pooled connections with concurrent GetSession
+ * calls, which read the session and change nothing, then repeats them whenever lex has not been
+ * called for the keepalive interval.
+ */
+class ConnectionWarmer
+{
+public:
+  /**
+   * Warm up counters.
+   */
+  struct Stats
+  {
+    ConnectionState state = ConnectionState::kCold;
+    /**
+     * Rounds of calls run while the connections were cold.
+     */
+    uint64_t warm_ups = 0;
+    /**
+     * Rounds of calls run to keep idle connections open.
+     */
+    uint64_t keepalives = 0;
+    /**
+     * Warm up calls that got no reply from lex.
+     */
+    uint64_t failures = 0;
+    /**
+     * Duration of the slowest call of the last cold round, which opened a connection.
+     */
+    double cold_call_ms = 0.0;
+    /**
+     * Duration of the last call made on an open connection.
+     */
+    double warm_call_ms = 0.0;
+    /**
+     * Time spent opening a connection, dns, tcp connect and tls handshake: the difference between
+     * cold and warm calls of the last cold round.
+     */
+    double handshake_ms = 0.0;
+  };
+
+  /**
+   * @param configuration number of connections and intervals
+   * @param lex_configuration bot and user the GetSession calls are made for
+   * @param lex_runtime_client whose connection pool is kept warm
+   */
+  ConnectionWarmer(
+    const ConnectionConfiguration & configuration, const LexConfiguration & lex_configuration,
+    std::shared_ptr<const Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client);
+
+  /**
+   * Stops the background thread, waiting for calls in flight.
+   */
+  ~ConnectionWarmer();
+
+  ConnectionWarmer(const ConnectionWarmer &) = delete;
+  ConnectionWarmer & operator=(const ConnectionWarmer &) = delete;
+
+  /**
+   * Start warming up in the background, then keep the connections alive.
+   */
+  void Start();
+
+  /**
+   * Note a lex call made by the node, the connections it used stay open for the idle timeout.
+   */
+  void RecordActivity();
+
+  /**
+   * Wait for the first warm up round to finish.
+   *
+   * @param timeout longest wait
+   * @return true if the connections are warm
+   */
+  bool WaitUntilWarm(std::chrono::milliseconds timeout);
+
+  /**
+   * @return the warm up counters
+   */
+  Stats GetStats();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void Run();
+
+  /**
+   * Make one GetSession call per connection, concurrently.
+   *
+   * @param is_cold true if the connections are expected to be closed
+   */
+  void CallRound(bool is_cold);
+
+  /**
+   * @return the duration of a GetSession call in milliseconds, negative if lex did not reply
+   */
+  double TimedCall() const;
+
+  ConnectionState StateLocked(Clock::time_point now) const;
+
+  ConnectionConfiguration configuration_;
+  LexConfiguration lex_configuration_;
+  std::shared_ptr<const Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_up_;
+  bool is_stopping_ = false;
+  bool is_warming_ = false;
+  bool has_warmed_up_ = false;
+  Clock::time_point last_activity_;
+  Stats stats_;
+  std::thread thread_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
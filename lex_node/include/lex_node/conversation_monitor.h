@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/latency_stats.h>
+
+#include <functional>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Progress of a single lex call.
+ */
+enum class ConversationStage
+{
+  /**
+   * The request is built and handed to the lex runtime client.
+   */
+  kCallStarted,
+  /**
+   * The whole request body has been sent.
+   */
+  kUploadComplete,
+  /**
+   * The first bytes of the lex response have been received.
+   */
+  kFirstBytesReceived,
+};
+
+/**
+ * Hooks observing and controlling a single lex call. All are optional and are called from the
+ * thread making the call.
+ */
+struct ConversationMonitor
+{
+  /**
+   * Polled while the call is in flight, returning true aborts the call and closes its connection.
+   */
+  std::function<bool()> is_cancelled;
+
+  /**
+   * Called once per stage reached by the call.
+   */
+  std::function<void(ConversationStage)> on_stage;
+
+  /**
+   * Marks the stages of the call, null when the call is not timed.
+   */
+  StageTimer * stage_timer = nullptr;
+
+  /**
+   * Mark a point of the call when it is timed.
+   */
+  void Mark(StageMark mark) const
+  {
+    if (stage_timer) {
+      stage_timer->Mark(mark);
+    }
+  }
+};
+
+}  // namespace Lex
+}  // namespace Aws
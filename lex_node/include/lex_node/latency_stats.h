@@ -0,0 +1,252 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Points in time of a lex call, marked as the call goes.
+ */
+enum class StageMark
+{
+  /**
+   * The request was received by the node.
+   */
+  kStart,
+  /**
+   * The lex request is built and handed to the lex runtime client.
+   */
+  kCallStarted,
+  /**
+   * The whole request body has been sent.
+   */
+  kUploadComplete,
+  /**
+   * The first bytes of the lex response have been received.
+   */
+  kFirstBytesReceived,
+  /**
+   * The lex runtime client returned, the whole body is received.
+   */
+  kCallReturned,
+  /**
+   * The result is copied into the ros response.
+   */
+  kDecoded,
+  kCount,
+};
+
+/**
+ * Stages of a lex call, the time between two marks.
+ */
+enum class LatencyStage
+{
+  /**
+   * Building the request, audio processing included.
+   */
+  kBuild,
+  kUpload,
+  /**
+   * From the end of the upload to the first response bytes, the time lex spends on the turn.
+   */
+  kLex,
+  kDownload,
+  /**
+   * Copying the result into the ros response, slots and audio included.
+   */
+  kDecode,
+  /**
+   * The whole call, from kStart to kDecoded.
+   */
+  kTotal,
+  kCount,
+};
+
+/**
+ * @return the lower case name of a stage
+ */
+const char * GetLatencyStageName(LatencyStage stage);
+
+/**
+ * Timestamps of the stages of one lex call. Used by the thread making the call.
+ */
+class StageTimer
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Mark a point of the call, the first mark of each point is kept.
+   */
+  void Mark(StageMark mark)
+  {
+    auto & time = marks_[static_cast<std::size_t>(mark)];
+    if (Clock::time_point() == time) {
+      time = Clock::now();
+    }
+  }
+
+  /**
+   * @return true if the point was reached
+   */
+  bool IsMarked(StageMark mark) const
+  {
+    return Clock::time_point() != marks_[static_cast<std::size_t>(mark)];
+  }
+
+  /**
+   * @param[out] micros time spent in the stage
+   * @return false if the call did not go through the stage
+   */
+  bool GetStageMicros(LatencyStage stage, uint64_t & micros) const;
+
+private:
+  std::array<Clock::time_point, static_cast<std::size_t>(StageMark::kCount)> marks_{};
+};
+
+/**
+ * Log-linear histogram of latencies in microseconds: each power of two is split into 8 linear
+ * buckets, bounding the error of a percentile to 1/16th of its value. Recording is lock free.
+ */
+class LatencyHistogram
+{
+public:
+  /**
+   * Linear buckets per power of two, as a power of two.
+   */
+  static constexpr int kSubBucketBits = 3;
+  /**
+   * Latencies of 2^kMaxBits microseconds, about 35 minutes, or more share the last buckets.
+   */
+  static constexpr int kMaxBits = 31;
+  static constexpr std::size_t kBucketCount =
+    (kMaxBits - kSubBucketBits + 1) << kSubBucketBits;
+
+  using Counts = std::array<uint64_t, kBucketCount>;
+
+  /**
+   * Count a latency.
+   */
+  void Record(uint64_t micros)
+  {
+    buckets_[GetBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Read the counts, the counts of latencies recorded meanwhile may be missing.
+   *
+   * @param[out] counts per bucket
+   */
+  void Load(Counts & counts) const;
+
+  /**
+   * @return the bucket of a latency
+   */
+  static std::size_t GetBucket(uint64_t micros);
+
+  /**
+   * @return the middle of a bucket in microseconds
+   */
+  static double GetBucketValue(std::size_t bucket);
+
+  /**
+   * @param counts per bucket
+   * @param percentile in [0, 100]
+   * @return the latency in microseconds below which the percentile of the counts fall, 0 if the
+   *         counts are all zero
+   */
+  static double GetPercentile(const Counts & counts, double percentile);
+
+private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+};
+
+/**
+ * Percentiles of one stage over the calls of a bot, or of one of its intents.
+ */
+struct StageLatencySummary
+{
+  std::string bot_name;
+  /**
+   * Empty for all the calls of the bot.
+   */
+  std::string intent_name;
+  LatencyStage stage = LatencyStage::kTotal;
+  uint64_t count = 0;
+  double p50_ms = 0.0;
+  double p90_ms = 0.0;
+  double p99_ms = 0.0;
+};
+
+/**
+ * Latency histograms of each stage of the lex calls, per bot and per intent. Record() is lock free
+ * and may be called from any thread, Collect() is called by one thread at a time.
+ */
+class LatencyStats
+{
+public:
+  /**
+   * Most bot and intent pairs tracked, the calls of further intents count towards the bot only.
+   */
+  static constexpr std::size_t kMaxSeries = 128;
+
+  LatencyStats();
+  ~LatencyStats();
+
+  LatencyStats(const LatencyStats &) = delete;
+  LatencyStats & operator=(const LatencyStats &) = delete;
+
+  /**
+   * Count the stages of a successful call towards its bot and its intent.
+   *
+   * @param bot_name lex was called with
+   * @param intent_name lex replied with, may be empty
+   * @param timer marks of the call
+   */
+  void Record(const std::string & bot_name, const std::string & intent_name,
+              const StageTimer & timer);
+
+  /**
+   * Summarize the calls recorded since the previous collection.
+   *
+   * @return the percentiles of each stage with calls, bots first then their intents
+   */
+  std::vector<StageLatencySummary> Collect();
+
+private:
+  struct Series;
+
+  /**
+   * Find the series of a bot and intent, adding it if there is room.
+   *
+   * @return the series, null if the table is full
+   */
+  Series * FindSeries(const std::string & bot_name, const std::string & intent_name);
+
+  std::array<std::atomic<Series *>, kMaxSeries> series_{};
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace Aws {
 namespace Lex {
@@ -29,6 +30,183 @@ namespace Lex {
 constexpr char kUserIdKey[] = LEX_CONFIGURATION_PATH "user_id";
 constexpr char kBotNameKey[] = LEX_CONFIGURATION_PATH "bot_name";
 constexpr char kBotAliasKey[] = LEX_CONFIGURATION_PATH "bot_alias";
+constexpr char kCacheableIntentsKey[] = LEX_CONFIGURATION_PATH "cacheable_intents";
+constexpr char kBotProfilesKey[] = LEX_CONFIGURATION_PATH "bot_profiles";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys of a bot profile, under lex_configuration/bots/<profile name>/.
+ */
+/**@{*/
+#define LEX_BOTS_PATH LEX_CONFIGURATION_PATH "bots/"
+
+constexpr char kBotProfileUserIdKey[] = "user_id";
+constexpr char kBotProfileBotNameKey[] = "bot_name";
+constexpr char kBotProfileBotAliasKey[] = "bot_alias";
+constexpr char kBotProfileMaxConnectionsKey[] = "max_connections";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the lex service dispatch.
+ */
+/**@{*/
+#define LEX_DISPATCH_PATH "dispatch/"
+
+constexpr char kDispatchThreadsKey[] = LEX_DISPATCH_PATH "threads";
+constexpr char kDispatchMaxSessionsKey[] = LEX_DISPATCH_PATH "max_sessions";
+constexpr char kDispatchSessionShardsKey[] = LEX_DISPATCH_PATH "session_shards";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the message and audio buffer pools.
+ */
+/**@{*/
+#define LEX_BUFFER_POOL_PATH "buffer_pool/"
+
+constexpr char kBufferPoolEnabledKey[] = LEX_BUFFER_POOL_PATH "enabled";
+constexpr char kBufferPoolMaxBufferBytesKey[] = LEX_BUFFER_POOL_PATH "max_buffer_bytes";
+constexpr char kBufferPoolBuffersPerSizeKey[] = LEX_BUFFER_POOL_PATH "buffers_per_size";
+constexpr char kBufferPoolMessagesKey[] = LEX_BUFFER_POOL_PATH "messages";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the text response cache.
+ */
+/**@{*/
+#define LEX_RESPONSE_CACHE_PATH "response_cache/"
+
+constexpr char kResponseCacheEnabledKey[] = LEX_RESPONSE_CACHE_PATH "enabled";
+constexpr char kResponseCacheMaxEntriesKey[] = LEX_RESPONSE_CACHE_PATH "max_entries";
+constexpr char kResponseCacheMaxBytesKey[] = LEX_RESPONSE_CACHE_PATH "max_bytes";
+constexpr char kResponseCacheTtlKey[] = LEX_RESPONSE_CACHE_PATH "ttl_s";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the persistent prompt audio cache.
+ */
+/**@{*/
+#define LEX_PROMPT_AUDIO_CACHE_PATH "prompt_audio_cache/"
+
+constexpr char kPromptAudioCacheEnabledKey[] = LEX_PROMPT_AUDIO_CACHE_PATH "enabled";
+constexpr char kPromptAudioCacheDirectoryKey[] = LEX_PROMPT_AUDIO_CACHE_PATH "directory";
+constexpr char kPromptAudioCacheMaxBytesKey[] = LEX_PROMPT_AUDIO_CACHE_PATH "max_bytes";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for keeping connections to lex open.
+ */
+/**@{*/
+#define LEX_CONNECTION_PATH "connection/"
+
+constexpr char kConnectionWarmUpKey[] = LEX_CONNECTION_PATH "warm_up";
+constexpr char kConnectionCountKey[] = LEX_CONNECTION_PATH "connections";
+constexpr char kConnectionKeepaliveIntervalKey[] = LEX_CONNECTION_PATH "keepalive_interval_s";
+constexpr char kConnectionIdleTimeoutKey[] = LEX_CONNECTION_PATH "idle_timeout_s";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for keeping tls sessions across node restarts.
+ */
+/**@{*/
+#define LEX_TLS_SESSION_CACHE_PATH "tls_session_cache/"
+
+constexpr char kTlsSessionCacheEnabledKey[] = LEX_TLS_SESSION_CACHE_PATH "enabled";
+constexpr char kTlsSessionCacheFileKey[] = LEX_TLS_SESSION_CACHE_PATH "file";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for hedging slow text turns.
+ */
+/**@{*/
+#define LEX_HEDGING_PATH "hedging/"
+
+constexpr char kHedgingEnabledKey[] = LEX_HEDGING_PATH "enabled";
+constexpr char kHedgingDelayMsKey[] = LEX_HEDGING_PATH "delay_ms";
+constexpr char kHedgingPercentileKey[] = LEX_HEDGING_PATH "percentile";
+constexpr char kHedgingMinDelayMsKey[] = LEX_HEDGING_PATH "min_delay_ms";
+constexpr char kHedgingBudgetPercentKey[] = LEX_HEDGING_PATH "budget_percent";
+constexpr char kHedgingIntentsKey[] = LEX_HEDGING_PATH "intents";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the latency histograms of the lex call stages.
+ */
+/**@{*/
+#define LEX_LATENCY_STATS_PATH "latency_stats/"
+
+constexpr char kLatencyStatsEnabledKey[] = LEX_LATENCY_STATS_PATH "enabled";
+constexpr char kLatencyStatsPublishIntervalKey[] = LEX_LATENCY_STATS_PATH "publish_interval_s";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for converting request audio to the format lex expects.
+ */
+/**@{*/
+#define LEX_NORMALIZATION_PATH "normalization/"
+
+constexpr char kNormalizationEnabledKey[] = LEX_NORMALIZATION_PATH "enabled";
+constexpr char kNormalizationSampleRateKey[] = LEX_NORMALIZATION_PATH "sample_rate";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for trimming silence from request audio.
+ */
+/**@{*/
+#define LEX_VOICE_ACTIVITY_PATH "voice_activity/"
+
+constexpr char kVoiceActivityEnabledKey[] = LEX_VOICE_ACTIVITY_PATH "enabled";
+constexpr char kVoiceActivityPadMsKey[] = LEX_VOICE_ACTIVITY_PATH "pad_ms";
+constexpr char kVoiceActivityFrameMsKey[] = LEX_VOICE_ACTIVITY_PATH "frame_ms";
+constexpr char kVoiceActivityMinSpeechMsKey[] = LEX_VOICE_ACTIVITY_PATH "min_speech_ms";
+constexpr char kVoiceActivityEnergyRatioKey[] = LEX_VOICE_ACTIVITY_PATH "energy_ratio";
+constexpr char kVoiceActivityMinRmsKey[] = LEX_VOICE_ACTIVITY_PATH "min_rms";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for encoding request audio to opus.
+ */
+/**@{*/
+#define LEX_OPUS_PATH "opus/"
+
+constexpr char kOpusEnabledKey[] = LEX_OPUS_PATH "enabled";
+constexpr char kOpusBitRateKey[] = LEX_OPUS_PATH "bit_rate";
+constexpr char kOpusFrameMsKey[] = LEX_OPUS_PATH "frame_ms";
+constexpr char kOpusComplexityKey[] = LEX_OPUS_PATH "complexity";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the aws sdk memory system.
+ */
+/**@{*/
+#define LEX_AWS_MEMORY_PATH "aws_memory/"
+
+constexpr char kAwsMemoryEnabledKey[] = LEX_AWS_MEMORY_PATH "enabled";
+constexpr char kAwsMemoryReportIntervalKey[] = LEX_AWS_MEMORY_PATH "report_interval_s";
+constexpr char kAwsMemoryThreadCacheBlocksKey[] = LEX_AWS_MEMORY_PATH "thread_cache_blocks";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for tracing lex requests.
+ */
+/**@{*/
+#define LEX_TRACE_PATH "trace/"
+
+constexpr char kTraceSamplePayloadsKey[] = LEX_TRACE_PATH "sample_payloads";
+constexpr char kTracePayloadFileKey[] = LEX_TRACE_PATH "payload_file";
+constexpr char kTraceSamplesPerMinuteKey[] = LEX_TRACE_PATH "samples_per_minute";
+constexpr char kTraceMaxFileBytesKey[] = LEX_TRACE_PATH "max_file_bytes";
+/** @}*/
+
+/**
+ * \defgroup ROS parameter keys for the log system of the aws sdk and the node.
+ */
+/**@{*/
+#define LEX_LOGGING_PATH "logging/"
+
+constexpr char kLoggingAsyncKey[] = LEX_LOGGING_PATH "async";
+constexpr char kLoggingCapacityKey[] = LEX_LOGGING_PATH "capacity";
+constexpr char kLoggingOverflowPolicyKey[] = LEX_LOGGING_PATH "overflow_policy";
+constexpr char kLoggingFlushIntervalMsKey[] = LEX_LOGGING_PATH "flush_interval_ms";
 /** @}*/
 
 /**
@@ -50,6 +228,376 @@ struct LexConfiguration
    * The lex alias of the bot to use.
    */
   std::string bot_alias;
+
+  /**
+   * Size of the connection pool of the bot's lex runtime client, 0 for the size of the client
+   * configuration.
+   */
+  int max_connections = 0;
+};
+
+/**
+ * A named lex bot the node serves besides its default bot, picked by the bot field of requests.
+ */
+struct BotProfile
+{
+  std::string name;
+
+  /**
+   * The bot, its user id defaults to the user id of the default bot.
+   */
+  LexConfiguration lex_configuration;
+};
+
+/**
+ * Configuration of the threads serving lex requests.
+ */
+struct DispatchConfiguration
+{
+  /**
+   * Number of threads serving lex requests from a dedicated callback queue. Requests for the same
+   * lex session are always handled in order. 0 serves requests from the global callback queue,
+   * conversation goals then run on a thread of their own so they can still be preempted.
+   */
+  int threads = 1;
+
+  /**
+   * Number of lex sessions the session table keeps, the least recently used idle ones are evicted
+   * first. Sessions with requests in flight are always kept.
+   */
+  int max_sessions = 1024;
+
+  /**
+   * Number of independently locked shards of the session table.
+   */
+  int session_shards = 16;
+};
+
+/**
+ * Configuration of the pools recycling service messages and audio buffers across calls.
+ */
+struct BufferPoolConfiguration
+{
+  /**
+   * Recycle messages and audio buffers instead of freeing them after every call.
+   */
+  bool enabled = true;
+
+  /**
+   * Largest audio buffer kept in the pool, in bytes.
+   */
+  int max_buffer_bytes = 1024 * 1024;
+
+  /**
+   * Number of audio buffers kept per power of two size class.
+   */
+  int buffers_per_size = 2;
+
+  /**
+   * Number of idle request and response messages kept, each.
+   */
+  int messages = 4;
+};
+
+/**
+ * Configuration of the cache answering repeated text commands without calling lex.
+ */
+struct ResponseCacheConfiguration
+{
+  /**
+   * Answer text turns of the cacheable intents from the cache.
+   */
+  bool enabled = false;
+
+  /**
+   * Number of replies kept.
+   */
+  int max_entries = 256;
+
+  /**
+   * Bytes of replies kept, audio replies included.
+   */
+  int max_bytes = 4 * 1024 * 1024;
+
+  /**
+   * Seconds a reply is served for.
+   */
+  double ttl_s = 300.0;
+
+  /**
+   * Intents whose replies are cached. Only intents that neither depend on nor change the state of
+   * the lex session should be listed.
+   */
+  std::vector<std::string> intents;
+};
+
+/**
+ * Configuration of the on disk cache of the audio of repeated prompts.
+ */
+struct PromptAudioCacheConfiguration
+{
+  /**
+   * Serve the audio of known prompts from the cache instead of keeping the audio lex sends.
+   */
+  bool enabled = false;
+
+  /**
+   * Directory of the cache files, kept across node restarts.
+   */
+  std::string directory;
+
+  /**
+   * Largest size of the cache data file, in bytes.
+   */
+  int max_bytes = 64 * 1024 * 1024;
+};
+
+/**
+ * Configuration of the warm up and keepalive of the connections to lex.
+ */
+struct ConnectionConfiguration
+{
+  /**
+   * Open connections to lex when the node starts, and keep them open while idle.
+   */
+  bool warm_up = false;
+
+  /**
+   * Number of pooled connections to keep open.
+   */
+  int connections = 1;
+
+  /**
+   * Idle time after which the connections are used again to keep them open, in seconds.
+   * 0 only warms up when the node starts.
+   */
+  double keepalive_interval_s = 30.0;
+
+  /**
+   * Idle time after which the connections are assumed closed by the endpoint, in seconds.
+   */
+  double idle_timeout_s = 60.0;
+};
+
+/**
+ * Configuration of the file tls sessions are kept in across node restarts.
+ */
+struct TlsSessionCacheConfiguration
+{
+  /**
+   * Resume the tls sessions of earlier connections and node runs.
+   */
+  bool enabled = false;
+
+  /**
+   * File the sessions are saved to, readable by its owner only.
+   */
+  std::string file;
+};
+
+/**
+ * Configuration of the duplicate calls sent for slow text turns.
+ */
+struct HedgingConfiguration
+{
+  /**
+   * Send a duplicate call when a text turn is slow.
+   */
+  bool enabled = false;
+
+  /**
+   * Fixed delay before the duplicate call, in milliseconds. 0 waits for the rolling percentile of
+   * the call latencies.
+   */
+  int delay_ms = 0;
+
+  /**
+   * Percentile of the latencies of recent calls after which a call is hedged.
+   */
+  double percentile = 95.0;
+
+  /**
+   * Shortest delay before the duplicate call, in milliseconds.
+   */
+  int min_delay_ms = 20;
+
+  /**
+   * Most duplicate calls, as a percentage of the hedgeable calls.
+   */
+  double budget_percent = 5.0;
+
+  /**
+   * Read only intents whose text turns may be hedged, their fulfillment may run twice. A text is
+   * hedged once lex answered it with one of them.
+   */
+  std::vector<std::string> intents;
+};
+
+/**
+ * Configuration of the latency histograms of the lex call stages.
+ */
+struct LatencyStatsConfiguration
+{
+  /**
+   * Time the stages of the lex calls and publish their percentiles.
+   */
+  bool enabled = true;
+
+  /**
+   * Seconds between publications, each covering the calls since the previous one.
+   */
+  double publish_interval_s = 10.0;
+};
+
+/**
+ * Configuration of the stage converting request audio to 16 bit mono pcm.
+ */
+struct NormalizationConfiguration
+{
+  /**
+   * Downmix, convert and resample pcm requests lex does not accept as they are.
+   */
+  bool enabled = false;
+
+  /**
+   * Sample rate of the converted audio, 8000 or 16000 hertz.
+   */
+  int sample_rate = 16000;
+};
+
+/**
+ * Configuration of the stage trimming leading and trailing silence from request audio.
+ */
+struct VoiceActivityConfiguration
+{
+  /**
+   * Upload only the voiced span of 16 bit pcm requests.
+   */
+  bool enabled = false;
+
+  /**
+   * Audio kept before the first and after the last voiced frame, in milliseconds.
+   */
+  int pad_ms = 200;
+
+  /**
+   * Length of the frames speech is detected on, in milliseconds.
+   */
+  int frame_ms = 10;
+
+  /**
+   * Shortest run of voiced frames taken for speech, in milliseconds.
+   */
+  int min_speech_ms = 30;
+
+  /**
+   * Energy of a voiced frame over the noise floor of the clip.
+   */
+  double energy_ratio = 4.0;
+
+  /**
+   * Lowest rms sample value of a voiced frame, whatever the noise floor.
+   */
+  double min_rms = 100.0;
+};
+
+/**
+ * Configuration of the stage encoding request audio to constant bit rate opus.
+ */
+struct OpusConfiguration
+{
+  /**
+   * Upload 16 bit mono pcm requests as audio/x-cbr-opus-with-preamble.
+   */
+  bool enabled = false;
+
+  /**
+   * Bit rate of the encoded audio, in bits per second.
+   */
+  int bit_rate = 32000;
+
+  /**
+   * Duration of an opus frame, in milliseconds: 5, 10, 20, 40 or 60.
+   */
+  int frame_ms = 20;
+
+  /**
+   * Encoder complexity, from 0 for the fastest to 10 for the best quality.
+   */
+  int complexity = 5;
+};
+
+/**
+ * Configuration of the memory system the aws sdk allocates from.
+ */
+struct AwsMemoryConfiguration
+{
+  /**
+   * Allocate sdk memory through a TaggedMemorySystem instead of the global heap.
+   */
+  bool enabled = false;
+
+  /**
+   * Seconds between two reports of the per tag memory counters, 0 disables the reports.
+   */
+  double report_interval_s = 60.0;
+
+  /**
+   * Number of free blocks each thread keeps per size class.
+   */
+  int thread_cache_blocks = 64;
+};
+
+/**
+ * Configuration of the sampling of request payloads to a side file.
+ */
+struct TraceConfiguration
+{
+  /**
+   * Append the text or audio of a few requests to the payload file.
+   */
+  bool sample_payloads = false;
+
+  /**
+   * File the payloads are appended to.
+   */
+  std::string payload_file;
+
+  /**
+   * Most payloads sampled per minute.
+   */
+  double samples_per_minute = 6.0;
+
+  /**
+   * Size of the payload file at which sampling stops.
+   */
+  int max_file_bytes = 64 * 1024 * 1024;
+};
+
+/**
+ * Configuration of the log system of the aws sdk and the node.
+ */
+struct LoggingConfiguration
+{
+  /**
+   * Forward log lines to rosout from a background thread instead of the thread logging them.
+   */
+  bool async = false;
+
+  /**
+   * Number of lines the buffer holds, rounded up to a power of two.
+   */
+  int capacity = 4096;
+
+  /**
+   * What a full buffer does to a new line: drop_oldest drops the oldest line, block waits for room.
+   */
+  std::string overflow_policy = "drop_oldest";
+
+  /**
+   * Longest time a line waits in the buffer before it is forwarded, in milliseconds.
+   */
+  int flush_interval_ms = 20;
 };
 
 }  // namespace Lex
@@ -15,14 +15,31 @@
 
 #pragma once
 
+#include <actionlib/server/action_server.h>
 #include <aws/lex/LexRuntimeServiceClient.h>
 #include <lex_common_msgs/AudioTextConversation.h>
 #include <lex_common_msgs/AudioTextConversationRequest.h>
 #include <lex_common_msgs/AudioTextConversationResponse.h>
+#include <lex_common_msgs/LexConversationAction.h>
+#include <lex_node/audio_buffer_pool.h>
+#include <lex_node/audio_pipeline.h>
+#include <lex_node/connection_warmer.h>
+#include <lex_node/conversation_monitor.h>
+#include <lex_node/latency_stats.h>
 #include <lex_node/lex_param_helper.h>
+#include <lex_node/message_pool.h>
+#include <lex_node/prompt_audio_cache.h>
+#include <lex_node/request_hedger.h>
+#include <lex_node/request_trace.h>
+#include <lex_node/response_cache.h>
+#include <lex_node/session_serializer.h>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <ros/spinner.h>
 
+#include <atomic>
+#include <map>
+
 namespace Aws {
 namespace Lex {
 
@@ -31,6 +48,11 @@ namespace Lex {
  */
 static const char * kAllocationTag = "lex";
 
+/**
+ * Action server for lex conversations.
+ */
+using LexConversationServer = actionlib::ActionServer<lex_common_msgs::LexConversationAction>;
+
 class LexNode;
 
 /**
@@ -42,33 +64,219 @@ LexNode BuildLexNode(std::shared_ptr<Client::ParameterReaderInterface> params =
 
 /**
  * LexNode is responsible for providing ROS API's and configuration for Amazon Lex.
- * The lex node will work on each incoming message serially and respond with the lex info.
- * @todo decide how the lex node will handle multiple requests.
+ * Requests are served by the dispatch threads, requests of the same lex session are handled
+ * serially in the order they arrived.
  */
 class LexNode
 {
 private:
+  /**
+   * The callback queue lex requests are served from, null when using the global queue.
+   * Declared before the servers using it.
+   */
+  std::shared_ptr<ros::CallbackQueue> dispatch_queue_;
+
+  /**
+   * The callback queue conversation goals run on when lex requests use the global queue, which
+   * ros::spin serves on one thread: a goal running there would hold off the goals and cancels
+   * preempting it. Null when goals run on the dispatch queue.
+   */
+  std::shared_ptr<ros::CallbackQueue> goal_queue_;
+
   /**
    * The ros server for lex requests.
    */
   ros::ServiceServer lex_server_;
 
   /**
-   * The Lex specific configuration for the amazon bot.
+   * The action server for cancellable lex requests.
    */
-  LexConfiguration lex_configuration_;
+  std::shared_ptr<LexConversationServer> conversation_server_;
+
+  struct Bot;
 
   /**
-   * The lex runtime client to use for lex api calls.
+   * The bots served by profile name, each with its lex runtime client. The default bot has an
+   * empty name, profiles of the same bot share it.
    */
-  std::shared_ptr<Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client_;
+  std::map<std::string, std::shared_ptr<Bot>> bots_;
 
   /**
    * The ros node handle.
    */
   ros::NodeHandle node_handle_;
 
+  /**
+   * Configuration of the threads serving lex requests.
+   */
+  DispatchConfiguration dispatch_configuration_;
+
+  /**
+   * Orders the requests of each lex session and keeps their last dialog state.
+   */
+  std::shared_ptr<SessionSerializer> session_serializer_;
+
+  /**
+   * Configuration of the message and audio buffer pools.
+   */
+  BufferPoolConfiguration buffer_pool_configuration_;
+
+  /**
+   * Recycles the audio buffers lex responses are received into, null when pooling is disabled.
+   */
+  std::shared_ptr<AudioBufferPool> audio_buffer_pool_;
+
+  /**
+   * Recycles the service requests, null when pooling is disabled.
+   */
+  std::shared_ptr<MessagePool<lex_common_msgs::AudioTextConversationRequest>> request_pool_;
+
+  /**
+   * Recycles the service responses, null when pooling is disabled.
+   */
+  std::shared_ptr<MessagePool<lex_common_msgs::AudioTextConversationResponse>> response_pool_;
+
+  /**
+   * Prepares request audio before it is uploaded, null to upload it as it is.
+   */
+  std::shared_ptr<const AudioPipeline> audio_pipeline_;
+
+  /**
+   * Answers repeated text commands without calling lex, null when caching is disabled.
+   */
+  std::shared_ptr<ResponseCache> response_cache_;
+
+  /**
+   * Keeps the audio of repeated prompts on disk, null when caching is disabled.
+   */
+  std::shared_ptr<PromptAudioCache> prompt_audio_cache_;
+
+  /**
+   * Configuration of the warm up and keepalive of the connections to lex.
+   */
+  ConnectionConfiguration connection_configuration_;
+
+  /**
+   * Sends duplicate calls for slow text turns, null when hedging is disabled.
+   */
+  std::shared_ptr<RequestHedger> request_hedger_;
+
+  /**
+   * Appends a few request payloads to a side file, null when sampling is disabled.
+   */
+  std::shared_ptr<PayloadSampler> payload_sampler_;
+
+  /**
+   * Configuration of the latency histograms of the lex call stages.
+   */
+  LatencyStatsConfiguration latency_stats_configuration_;
+
+  /**
+   * Latency histograms of the lex call stages, null when timing is disabled.
+   */
+  std::shared_ptr<LatencyStats> latency_stats_;
+
+  /**
+   * Publishers of the stage latency percentiles, on /diagnostics and on lex_latency_stats.
+   */
+  ros::Publisher diagnostics_publisher_;
+  ros::Publisher latency_stats_publisher_;
+  ros::WallTimer latency_stats_timer_;
+
+  struct PendingGoals;
+
+  /**
+   * The conversation goals that have not finished yet, by lex session and by goal id.
+   */
+  std::shared_ptr<PendingGoals> pending_goals_;
+
+  /**
+   * The threads serving the dispatch queue and the thread serving the goal queue. The spinners are
+   * declared after everything their callbacks use, so they are stopped before any of it is
+   * destroyed.
+   */
+  std::shared_ptr<ros::AsyncSpinner> dispatch_spinner_;
+  std::shared_ptr<ros::AsyncSpinner> goal_spinner_;
+
+  /**
+   * Find the bot a request selects.
+   *
+   * @param bot profile name, empty for the default bot
+   * @return the bot, null if there is no such profile
+   */
+  std::shared_ptr<Bot> FindBot(const std::string & bot) const;
+
+  /**
+   * Advertise the lex_conversation service, with pooled messages when enabled.
+   *
+   * @param node_handle to advertise the service with
+   * @return the service server
+   */
+  ros::ServiceServer AdvertiseLexService(ros::NodeHandle & node_handle);
+
+  /**
+   * Accept a conversation goal, supersede the earlier goals of its lex session and queue it on the
+   * dispatch queue.
+   *
+   * @param goal_handle of the new goal
+   */
+  void ConversationGoalCallback(LexConversationServer::GoalHandle goal_handle);
+
+  /**
+   * Cancel a conversation goal, aborting its lex call if it is in flight.
+   *
+   * @param goal_handle of the goal to cancel
+   */
+  void ConversationCancelCallback(LexConversationServer::GoalHandle goal_handle);
+
+  /**
+   * Call lex for a conversation goal once the earlier requests of its session are done.
+   *
+   * @param goal_handle of the goal to execute
+   * @param bot the goal selects
+   * @param session_key lex session of the goal
+   * @param cancel_reason set when the goal is cancelled or superseded
+   */
+  void ExecuteConversationGoal(LexConversationServer::GoalHandle & goal_handle, Bot & bot,
+                               const std::string & session_key,
+                               const std::atomic<int> & cancel_reason);
+
+  /**
+   * Count the stages of a lex call towards the latency histograms, calls answered without calling
+   * lex and failed calls are not counted.
+   *
+   * @param stage_timer marks of the call
+   * @param bot called
+   * @param intent_name lex replied with
+   */
+  void RecordLatency(const StageTimer & stage_timer, const Bot & bot,
+                     const std::string & intent_name);
+
+  /**
+   * Publish the stage latency percentiles and the failed calls of each bot since the previous
+   * publication.
+   */
+  void PublishLatencyStats();
+
 public:
+  /**
+   * Call counters of a bot.
+   */
+  struct BotStats
+  {
+    /**
+     * Names of the profiles of the bot, empty for the default bot.
+     */
+    std::vector<std::string> profiles;
+    std::string bot_name;
+    std::string bot_alias;
+    uint64_t calls = 0;
+    /**
+     * Calls that failed, lex errors and cancelled calls included.
+     */
+    uint64_t errors = 0;
+  };
+
   /**
    * Constructor.
    */
@@ -90,12 +298,14 @@ public:
   bool IsServiceValid() { return (nullptr != static_cast<void *>(lex_server_)); }
 
   /**
-   * Service callback for lex. Only allow one interaction with Lex at a time. If a new request comes
-   * in, fail the last request, then make a new request.
+   * Service callback for lex. Calls the bot the request selects, waiting for the earlier requests
+   * of the same lex session to finish before calling lex. Service requests cannot be cancelled,
+   * use the lex_conversation_action action server for requests a newer request should supersede.
    *
    * @param request to handle
    * @param response to fill
-   * @return true if the service request was successful
+   * @return true if the service request was successful, false if it failed or selects an unknown
+   *         bot
    */
   bool LexServerCallback(lex_common_msgs::AudioTextConversationRequest & request,
                          lex_common_msgs::AudioTextConversationResponse & response);
@@ -111,14 +321,136 @@ public:
     std::shared_ptr<Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client);
 
   /**
-   * Return pointer to the Lex runtime client instance of this node
+   * Serve a named bot profile besides the default bot. Must be called before Init(). A profile of
+   * an already served bot, alias and user id shares its client and counters.
+   *
+   * @param bot_profile name the requests select the bot with, and the bot
+   * @param lex_runtime_client to call the bot with, with its own connection pool
+   */
+  void ConfigureBotProfile(
+    const BotProfile & bot_profile,
+    std::shared_ptr<Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client);
+
+  /**
+   * @return the call counters of each bot, the default bot first
+   */
+  std::vector<BotStats> GetBotStats() const;
+
+  /**
+   * Look up a lex session of the session table.
+   *
+   * @param session_key of the session, see MakeSessionKey()
+   * @param[out] info of the session
+   * @return false if the session is not in the table
+   */
+  bool GetSession(const std::string & session_key, SessionInfo & info) const;
+
+  /**
+   * Configure the threads serving lex requests and the table of lex sessions. Must be called
+   * before Init().
+   *
+   * @param dispatch_configuration thread and session table configuration
+   */
+  void ConfigureDispatch(const DispatchConfiguration & dispatch_configuration);
+
+  /**
+   * Configure the pools recycling messages and audio buffers. Must be called before Init().
+   *
+   * @param buffer_pool_configuration pool configuration
+   */
+  void ConfigureBufferPool(const BufferPoolConfiguration & buffer_pool_configuration);
+
+  /**
+   * Configure the cache answering repeated text commands.
+   *
+   * @param response_cache_configuration cache limits and cacheable intents
+   */
+  void ConfigureResponseCache(const ResponseCacheConfiguration & response_cache_configuration);
+
+  /**
+   * @return the hit and miss counters of the response cache, all zero when caching is disabled
+   */
+  ResponseCache::Stats GetResponseCacheStats() const;
+
+  /**
+   * Configure the on disk cache of the audio of repeated prompts.
+   *
+   * @param prompt_audio_cache_configuration cache directory and size cap
+   */
+  void ConfigurePromptAudioCache(
+    const PromptAudioCacheConfiguration & prompt_audio_cache_configuration);
+
+  /**
+   * @return the hit and miss counters of the prompt audio cache, all zero when caching is disabled
+   */
+  PromptAudioCache::Stats GetPromptAudioCacheStats() const;
+
+  /**
+   * Configure the warm up and keepalive of the connections to lex. Must be called before Init().
+   *
+   * @param connection_configuration number of connections and intervals
+   */
+  void ConfigureConnection(const ConnectionConfiguration & connection_configuration);
+
+  /**
+   * @return the warm or cold state of the connections of the default bot's client and the time
+   * spent opening one, all zero when warming up is disabled
+   */
+  ConnectionWarmer::Stats GetConnectionStats() const;
+
+  /**
+   * Configure the duplicate calls sent for slow text turns.
+   *
+   * @param hedging_configuration delay, budget and the turns to hedge
+   */
+  void ConfigureHedging(const HedgingConfiguration & hedging_configuration);
+
+  /**
+   * @return the hedging counters, all zero when hedging is disabled
+   */
+  RequestHedger::Stats GetHedgingStats() const;
+
+  /**
+   * Configure the sampling of request payloads to a side file.
+   *
+   * @param trace_configuration file, rate and cap of the samples
+   */
+  void ConfigureTrace(const TraceConfiguration & trace_configuration);
+
+  /**
+   * @return the payload sampling counters, all zero when sampling is disabled
+   */
+  PayloadSampler::Stats GetTraceStats() const;
+
+  /**
+   * Configure the latency histograms of the lex call stages. Must be called before Init().
+   *
+   * @param latency_stats_configuration whether to time the calls and the publish interval
+   */
+  void ConfigureLatencyStats(const LatencyStatsConfiguration & latency_stats_configuration);
+
+  /**
+   * Summarize the stage latencies of the calls since the previous collection, the periodic
+   * publication collects them too.
+   *
+   * @return the percentiles of each stage per bot and intent, empty when timing is disabled
+   */
+  std::vector<StageLatencySummary> CollectLatencyStats();
+
+  /**
+   * Configure the stages preparing request audio before it is uploaded. Must be called before
+   * Init().
+   *
+   * @param audio_pipeline stages to run, null to upload request audio as it is
+   */
+  void ConfigureAudioPipeline(std::shared_ptr<const AudioPipeline> audio_pipeline);
+
+  /**
+   * Return pointer to the Lex runtime client instance of this node's default bot
    *
    * @return pointer this node's Lex runtime client instance
    */
-  std::weak_ptr<const Aws::LexRuntimeService::LexRuntimeServiceClient> GetLexRuntimeClient() const
-  {
-    return lex_runtime_client_;
-  }
+  std::weak_ptr<const Aws::LexRuntimeService::LexRuntimeServiceClient> GetLexRuntimeClient() const;
 
   /**
    * Conversion function since in ROS2, this class will inherit from Node.
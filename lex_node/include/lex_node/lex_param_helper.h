@@ -22,11 +22,142 @@ namespace Aws {
 namespace Lex {
 
 /**
- * Load lex parameters from ros param server.
+ * Load lex parameters from ros param server. Without a bot name and alias, the first bot profile
+ * is the default bot.
  *
  * @param parameter_interface to retrieve the parameters from.
  */
 LexConfiguration LoadLexParameters(const Client::ParameterReaderInterface & parameter_interface);
 
+/**
+ * Load the named bot profiles from ros param server, the profiles listed in
+ * lex_configuration/bot_profiles with their keys under lex_configuration/bots/<profile name>/.
+ * Profiles missing their bot name or alias are skipped.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ * @param lex_configuration of the default bot, the profiles' user id defaults to its own
+ */
+std::vector<BotProfile> LoadBotProfiles(
+  const Client::ParameterReaderInterface & parameter_interface,
+  const LexConfiguration & lex_configuration);
+
+/**
+ * Load the dispatch parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+DispatchConfiguration LoadDispatchParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the buffer pool parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+BufferPoolConfiguration LoadBufferPoolParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the response cache parameters from ros param server, with the cacheable intents from the
+ * lex configuration. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+ResponseCacheConfiguration LoadResponseCacheParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the prompt audio cache parameters from ros param server. Missing parameters keep their
+ * defaults, the cache directory defaults to lex_prompt_audio in the ros home directory.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+PromptAudioCacheConfiguration LoadPromptAudioCacheParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the connection warm up parameters from ros param server. Missing parameters keep their
+ * defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+ConnectionConfiguration LoadConnectionParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the tls session cache parameters from ros param server. Missing parameters keep their
+ * defaults, the session file defaults to lex_tls_sessions in the ros home directory.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+TlsSessionCacheConfiguration LoadTlsSessionCacheParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the hedging parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+HedgingConfiguration LoadHedgingParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the latency stats parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+LatencyStatsConfiguration LoadLatencyStatsParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the audio normalization parameters from ros param server. Missing parameters keep their
+ * defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+NormalizationConfiguration LoadNormalizationParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the voice activity parameters from ros param server. Missing parameters keep their
+ * defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+VoiceActivityConfiguration LoadVoiceActivityParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the opus encoding parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+OpusConfiguration LoadOpusParameters(const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the aws sdk memory system parameters from ros param server. Missing parameters keep their
+ * defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+AwsMemoryConfiguration LoadAwsMemoryParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the request trace parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+TraceConfiguration LoadTraceParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
+/**
+ * Load the log system parameters from ros param server. Missing parameters keep their defaults.
+ *
+ * @param parameter_interface to retrieve the parameters from.
+ */
+LoggingConfiguration LoadLoggingParameters(
+  const Client::ParameterReaderInterface & parameter_interface);
+
 }  // namespace Lex
 }  // namespace Aws
\ No newline at end of file
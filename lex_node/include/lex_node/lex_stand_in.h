@@ -0,0 +1,223 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * A reply of the stand-in, sent to the turns it matches.
+ */
+struct StandInReply
+{
+  /**
+   * Text the input text must contain, case sensitive. Empty matches every turn, audio turns
+   * included.
+   */
+  std::string match;
+
+  std::string intent_name = "StandIn";
+  std::string dialog_state = "Fulfilled";
+  std::string message = "ok";
+  std::string slot_to_elicit;
+  std::vector<std::pair<std::string, std::string>> slots;
+};
+
+/**
+ * Configuration of the lex runtime stand-in.
+ */
+struct LexStandInConfiguration
+{
+  /**
+   * Address to listen on, loopback by default.
+   */
+  std::string address = "127.0.0.1";
+
+  /**
+   * Port to listen on, 0 picks a free port.
+   */
+  int port = 0;
+
+  /**
+   * Time lex takes to reply, in milliseconds, plus a uniform jitter of up to jitter_ms.
+   */
+  int latency_ms = 0;
+  int jitter_ms = 0;
+
+  /**
+   * Percentage of the calls failing with a 500 InternalFailureException.
+   */
+  double error_percent = 0.0;
+
+  /**
+   * Percentage of the calls failing with a 429 LimitExceededException.
+   */
+  double throttle_percent = 0.0;
+
+  /**
+   * Percentage of the replies whose body is sent slowly, over slow_body_ms.
+   */
+  double slow_body_percent = 0.0;
+  int slow_body_ms = 1000;
+
+  /**
+   * Bytes of silence in the audio replies of PostContent.
+   */
+  std::size_t audio_bytes = 16000;
+
+  /**
+   * Replies tried in order, the first matching one is sent. Turns no reply matches get the
+   * default StandInReply.
+   */
+  std::vector<StandInReply> replies;
+};
+
+/**
+ * Load replies from a script. Each line is a reply, tab separated: the match text, the dialog
+ * state, the intent name, the message, then optional slots as name=value pairs separated by ';'
+ * and the slot to elicit. Empty lines and lines starting with '#' are skipped.
+ *
+ * @param path of the script
+ * @param[out] replies read from the script, appended
+ * @return false if the script cannot be read
+ */
+bool LoadStandInScript(const std::string & path, std::vector<StandInReply> & replies);
+
+/**
+ * HTTP server standing in for the lex runtime service: it answers the PostContent, PostText and
+ * GetSession calls of the lex runtime client with scripted replies, after a configurable latency,
+ * and injects server errors, throttling and slow bodies. The node reaches it through
+ * aws_client_configuration/endpoint_override, so load tests go through the http client,
+ * connection pool and serialization of the sdk without an aws account.
+ *
+ * Plain http only, one thread per connection.
+ */
+class LexStandIn
+{
+public:
+  /**
+   * Request and fault counters.
+   */
+  struct Stats
+  {
+    uint64_t post_content = 0;
+    uint64_t post_text = 0;
+    uint64_t get_session = 0;
+    /**
+     * Requests no lex call matched, answered with 404.
+     */
+    uint64_t unknown = 0;
+    uint64_t errors = 0;
+    uint64_t throttles = 0;
+    uint64_t slow_bodies = 0;
+    uint64_t connections = 0;
+  };
+
+  /**
+   * @param configuration address, latency, faults and replies
+   */
+  explicit LexStandIn(const LexStandInConfiguration & configuration);
+
+  /**
+   * Stops the server.
+   */
+  ~LexStandIn();
+
+  LexStandIn(const LexStandIn &) = delete;
+  LexStandIn & operator=(const LexStandIn &) = delete;
+
+  /**
+   * Listen and serve from a background thread.
+   *
+   * @return false if the address cannot be listened on
+   */
+  bool Start();
+
+  /**
+   * Close the connections and wait for their threads.
+   */
+  void Stop();
+
+  /**
+   * @return the port listened on, once started
+   */
+  int GetPort() const { return port_; }
+
+  /**
+   * @return the request and fault counters
+   */
+  Stats GetStats();
+
+private:
+  struct HttpRequest;
+
+  void Accept();
+  void Serve(int fd);
+
+  /**
+   * Read a request, its body included.
+   *
+   * @param buffer bytes read from the connection and not used yet
+   * @return false on end of stream or on a malformed request
+   */
+  static bool ReadRequest(int fd, std::string & buffer, HttpRequest & request);
+
+  /**
+   * Answer one request.
+   *
+   * @return false if the connection must be closed
+   */
+  bool Reply(int fd, const HttpRequest & request, std::mt19937 & random);
+
+  /**
+   * @return the first reply matching the input text, the default reply if none does
+   */
+  const StandInReply & FindReply(const std::string & input_text) const;
+
+  /**
+   * Sleep unless the server stops.
+   *
+   * @return false if the server stopped
+   */
+  bool Sleep(int ms);
+
+  LexStandInConfiguration configuration_;
+  StandInReply default_reply_;
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::thread accept_thread_;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  bool is_stopping_ = false;
+  std::set<int> connection_fds_;
+  Stats stats_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
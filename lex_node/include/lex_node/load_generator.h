@@ -0,0 +1,156 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/latency_stats.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * A lex_conversation request replayed by the load generator.
+ */
+struct LoadTurn
+{
+  std::string content_type;
+  std::string accept_type;
+  std::string text_request;
+  std::vector<uint8_t> audio_request;
+};
+
+/**
+ * Append a turn per line of a text file, empty lines skipped.
+ *
+ * @param path of the corpus
+ * @param[out] turns read, appended
+ * @return false if the corpus cannot be read
+ */
+bool LoadTextCorpus(const std::string & path, std::vector<LoadTurn> & turns);
+
+/**
+ * Append a turn per line of a file listing raw 16 kHz, 16 bit, mono pcm files. Relative paths are
+ * relative to the directory of the list.
+ *
+ * @param path of the list
+ * @param accept_type the audio turns are sent with
+ * @param[out] turns read, appended
+ * @return false if the list or one of its files cannot be read
+ */
+bool LoadAudioCorpus(const std::string & path, const std::string & accept_type,
+                     std::vector<LoadTurn> & turns);
+
+/**
+ * Configuration of a load run.
+ */
+struct LoadGeneratorConfiguration
+{
+  /**
+   * Calls in flight at most. In a closed loop each caller sends its next call when the previous
+   * one returns.
+   */
+  int concurrency = 1;
+
+  /**
+   * Calls started per second for an open loop, the calls are started on a fixed schedule whatever
+   * the latency. 0 for a closed loop.
+   */
+  double rate_per_s = 0.0;
+
+  /**
+   * Seconds the calls are measured for, after the warmup seconds which are not measured.
+   */
+  double duration_s = 10.0;
+  double warmup_s = 0.0;
+
+  /**
+   * Interval between two calls of a closed loop caller the latencies are corrected with, in
+   * milliseconds. 0 uses the mean latency.
+   */
+  double expected_interval_ms = 0.0;
+};
+
+/**
+ * Measurements of a load run.
+ */
+struct LoadReport
+{
+  uint64_t calls = 0;
+  uint64_t errors = 0;
+  /**
+   * Failed calls per error.
+   */
+  std::map<std::string, uint64_t> error_counts;
+  double elapsed_s = 0.0;
+
+  /**
+   * Latencies from the time each call was sent.
+   */
+  LatencyHistogram::Counts service_time{};
+
+  /**
+   * Latencies corrected for coordinated omission: from the time each call was scheduled for an
+   * open loop, with the calls a stalled caller did not send added back for a closed loop.
+   */
+  LatencyHistogram::Counts response_time{};
+};
+
+/**
+ * @return the report as text: throughput, errors, percentiles and histogram
+ */
+std::string FormatLoadReport(const LoadReport & report);
+
+/**
+ * Replays a corpus of turns at a concurrency or at a rate, timing each call.
+ */
+class LoadGenerator
+{
+public:
+  /**
+   * Make a call.
+   *
+   * @return empty on success, the name of the error on failure
+   */
+  using Call = std::function<std::string(int caller, const LoadTurn & turn)>;
+
+  /**
+   * @param configuration of the run
+   * @param turns replayed in order, round robin
+   * @param call made for each turn, from configuration.concurrency threads numbered from 0
+   */
+  LoadGenerator(const LoadGeneratorConfiguration & configuration, std::vector<LoadTurn> turns,
+                Call call);
+
+  /**
+   * Run the load until the warmup and the duration are over.
+   *
+   * @return the measurements of the calls started after the warmup
+   */
+  LoadReport Run();
+
+private:
+  LoadGeneratorConfiguration configuration_;
+  std::vector<LoadTurn> turns_;
+  Call call_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
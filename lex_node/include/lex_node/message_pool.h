@@ -0,0 +1,106 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Recycles ros message instances. The messages handed out by Acquire() return to the pool when
+ * their last reference is dropped, keeping the capacity of their strings and vectors for the next
+ * call.
+ *
+ * @tparam Message ros message type
+ */
+template <typename Message>
+class MessagePool
+{
+public:
+  /**
+   * Prepares a message for reuse, typically clearing its fields without freeing their capacity.
+   */
+  using Reset = std::function<void(Message &)>;
+
+  /**
+   * @param capacity number of idle messages kept
+   * @param reset applied to every message returned to the pool
+   */
+  MessagePool(std::size_t capacity, Reset reset) : state_(std::make_shared<State>())
+  {
+    state_->capacity = capacity;
+    state_->reset = std::move(reset);
+  }
+
+  /**
+   * @return a pooled message, or a new one when the pool is empty
+   */
+  boost::shared_ptr<Message> Acquire()
+  {
+    std::unique_ptr<Message> message;
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      if (!state_->idle.empty()) {
+        message = std::move(state_->idle.back());
+        state_->idle.pop_back();
+      }
+    }
+    if (!message) {
+      message.reset(new Message());
+    }
+    // the deleter keeps the pool state alive for messages outliving the pool
+    std::shared_ptr<State> state = state_;
+    return boost::shared_ptr<Message>(message.release(), [state](Message * released) {
+      std::unique_ptr<Message> owned(released);
+      if (state->reset) {
+        state->reset(*owned);
+      }
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->idle.size() < state->capacity) {
+        state->idle.push_back(std::move(owned));
+      }
+    });
+  }
+
+  /**
+   * @return the number of idle messages in the pool
+   */
+  std::size_t IdleCount()
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->idle.size();
+  }
+
+private:
+  struct State
+  {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Message>> idle;
+    std::size_t capacity = 0;
+    Reset reset;
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+#include <lex_node/lex_configuration.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct OpusEncoder;
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Opus encoding of the audio of one request. The worker encodes it frame by frame while the http
+ * client reads what is ready. Constant bit rate frames make the encoded size known up front, so
+ * the request can be sent before encoding is done.
+ */
+class OpusEncodeJob
+{
+public:
+  /**
+   * @param samples mono 16 bit samples, must outlive the job
+   * @param sample_count number of samples
+   * @param sample_rate in hertz, one of the opus rates
+   * @param configuration of the encoder
+   */
+  OpusEncodeJob(const int16_t * samples, std::size_t sample_count, int sample_rate,
+                const OpusConfiguration & configuration);
+
+  /**
+   * @return the size of the whole encoded audio, in bytes
+   */
+  std::size_t EncodedSize() const { return encoded_.size(); }
+
+  /**
+   * @return the encoded bytes, valid up to the count returned by WaitForBytes()
+   */
+  const uint8_t * Data() const { return encoded_.data(); }
+
+  /**
+   * Block until enough bytes are encoded or the job ended.
+   *
+   * @param size number of bytes needed
+   * @return the number of bytes encoded, less than size only if the job failed or was cancelled
+   */
+  std::size_t WaitForBytes(std::size_t size);
+
+  /**
+   * Stop encoding at the next frame and wait until the worker no longer reads the samples.
+   */
+  void Cancel();
+
+  /**
+   * @return the lex content type of the encoded audio
+   */
+  std::string ContentType() const;
+
+  /**
+   * @return the size of the pcm audio, in bytes
+   */
+  std::size_t PcmSize() const { return sample_count_ * sizeof(int16_t); }
+
+  /**
+   * @return the time spent encoding, in milliseconds
+   */
+  double EncodeMs() const { return encode_ms_; }
+
+  /**
+   * @return true if every frame was encoded
+   */
+  bool Succeeded() const;
+
+  /**
+   * @return the sample rate of the audio, in hertz
+   */
+  int SampleRate() const { return sample_rate_; }
+
+private:
+  friend class OpusEncoderWorker;
+
+  /**
+   * Encode the audio, called by the worker.
+   *
+   * @param encoder opus encoder for the sample rate of the job, null if it could not be created
+   */
+  void Run(::OpusEncoder * encoder);
+
+  /**
+   * Mark the job ended, waking up the readers.
+   */
+  void Finish(bool succeeded);
+
+  const int16_t * samples_;
+  std::size_t sample_count_;
+  int sample_rate_;
+  OpusConfiguration configuration_;
+  std::size_t frame_samples_;
+  std::size_t frame_bytes_;
+  std::vector<uint8_t> encoded_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::size_t encoded_bytes_ = 0;
+  bool started_ = false;
+  bool done_ = false;
+  bool succeeded_ = false;
+  std::atomic<bool> cancelled_;
+  std::atomic<double> encode_ms_;
+};
+
+/**
+ * Stream buffer reading an opus encode job, blocking until the bytes asked for are encoded.
+ */
+class OpusEncodedBuffer : public std::streambuf
+{
+public:
+  explicit OpusEncodedBuffer(std::shared_ptr<OpusEncodeJob> job) : job_(std::move(job)) {}
+
+protected:
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+  std::streamsize showmanyc() override;
+
+private:
+  std::size_t ReadOffset() const;
+
+  std::shared_ptr<OpusEncodeJob> job_;
+  std::size_t position_ = 0;
+};
+
+/**
+ * Request body streaming the output of an opus encode job.
+ */
+class OpusEncodedStream : public Aws::IOStream
+{
+public:
+  explicit OpusEncodedStream(std::shared_ptr<OpusEncodeJob> job);
+
+private:
+  OpusEncodedBuffer buffer_;
+};
+
+/**
+ * Thread encoding request audio to opus, one job at a time.
+ */
+class OpusEncoderWorker
+{
+public:
+  explicit OpusEncoderWorker(const OpusConfiguration & configuration);
+
+  /**
+   * Cancel the queued jobs and stop the thread.
+   */
+  ~OpusEncoderWorker();
+
+  /**
+   * @return true if the node was built with opus
+   */
+  static bool IsAvailable();
+
+  /**
+   * @return true if audio at this sample rate can be encoded
+   */
+  static bool IsSupportedRate(int sample_rate);
+
+  /**
+   * Queue the encoding of request audio.
+   *
+   * @param samples mono 16 bit samples, must outlive the job or its cancellation
+   * @param sample_count number of samples
+   * @param sample_rate in hertz, one of the opus rates
+   * @return the queued job
+   */
+  std::shared_ptr<OpusEncodeJob> Start(const int16_t * samples, std::size_t sample_count,
+                                       int sample_rate);
+
+private:
+  void Run();
+
+  OpusConfiguration configuration_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::shared_ptr<OpusEncodeJob>> jobs_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
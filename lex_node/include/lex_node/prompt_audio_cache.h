@@ -0,0 +1,222 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Build the key of a prompt in the PromptAudioCache.
+ *
+ * @param bot_name of the bot that replied
+ * @param bot_alias of the bot that replied
+ * @param text_response text of the prompt
+ * @param message_format_type format of the prompt text
+ * @param accept_type audio format asked for
+ * @return the cache key
+ */
+std::string MakePromptAudioKey(const std::string & bot_name, const std::string & bot_alias,
+                               const std::string & text_response,
+                               const std::string & message_format_type,
+                               const std::string & accept_type);
+
+class PromptAudioMapping;
+
+/**
+ * Audio of a cached prompt, read in place from the memory mapped data file. Stays valid while the
+ * object lives, even if the cache evicts the prompt in the meantime.
+ */
+class PromptAudio
+{
+public:
+  PromptAudio(std::shared_ptr<const PromptAudioMapping> mapping, const uint8_t * data,
+              std::size_t size)
+  : mapping_(std::move(mapping)), data_(data), size_(size)
+  {
+  }
+
+  const uint8_t * Data() const { return data_; }
+  std::size_t Size() const { return size_; }
+
+private:
+  std::shared_ptr<const PromptAudioMapping> mapping_;
+  const uint8_t * data_;
+  std::size_t size_;
+};
+
+/**
+ * Persistent cache of the audio of the prompts a bot repeats, kept in a directory across node
+ * restarts. Prompts are appended to a data file which is memory mapped for reading, a compact
+ * index file lists the records so opening the cache does not read the audio. When the data file
+ * outgrows its cap the least recently used prompts are dropped by rewriting it.
+ *
+ * Only one process may use a directory at a time, a second cache on the same directory stays
+ * closed.
+ */
+class PromptAudioCache
+{
+public:
+  /**
+   * Cache usage counters.
+   */
+  struct Stats
+  {
+    /**
+     * Lookups answered from the cache.
+     */
+    uint64_t hits = 0;
+    /**
+     * Lookups of prompts not in the cache.
+     */
+    uint64_t misses = 0;
+    /**
+     * Prompts added.
+     */
+    uint64_t insertions = 0;
+    /**
+     * Prompts dropped to stay under the size cap.
+     */
+    uint64_t evictions = 0;
+    /**
+     * Prompts currently cached.
+     */
+    std::size_t entries = 0;
+    /**
+     * Size of the data file, in bytes.
+     */
+    std::size_t data_bytes = 0;
+  };
+
+  /**
+   * Open the cache, creating its directory and files if needed. Records left incomplete by a
+   * crash are dropped.
+   *
+   * @param configuration directory and size cap
+   */
+  explicit PromptAudioCache(const PromptAudioCacheConfiguration & configuration);
+
+  ~PromptAudioCache();
+
+  PromptAudioCache(const PromptAudioCache &) = delete;
+  PromptAudioCache & operator=(const PromptAudioCache &) = delete;
+
+  /**
+   * @return true if the cache files could be opened, a closed cache misses every lookup
+   */
+  bool IsOpen() const { return data_fd_ >= 0; }
+
+  /**
+   * Find the audio of a prompt.
+   *
+   * @param key of the prompt, see MakePromptAudioKey()
+   * @return the audio, null if the prompt is not cached
+   */
+  std::shared_ptr<const PromptAudio> Lookup(const std::string & key);
+
+  /**
+   * Add the audio of a prompt, dropping the least recently used prompts if the data file would
+   * outgrow its cap. A prompt already cached is kept as it is.
+   *
+   * @param key of the prompt, see MakePromptAudioKey()
+   * @param data audio of the prompt
+   * @param size number of audio bytes
+   * @return true if the prompt is cached
+   */
+  bool Insert(const std::string & key, const uint8_t * data, std::size_t size);
+
+  /**
+   * @return the cache usage counters
+   */
+  Stats GetStats();
+
+private:
+  /**
+   * A record of the data file.
+   */
+  struct Entry
+  {
+    uint64_t offset;
+    uint64_t size;
+    /**
+     * Use count of the cache when the prompt was last looked up or added.
+     */
+    uint64_t last_used;
+  };
+
+  bool Open();
+  void Close();
+
+  /**
+   * Load the index, then recover the records appended after it was last written.
+   */
+  bool LoadIndex();
+
+  /**
+   * Read the records of the data file from an offset on, truncating the file at the first
+   * incomplete one.
+   *
+   * @param offset of the first record to read
+   */
+  bool ScanRecords(uint64_t offset);
+
+  /**
+   * Replace the index file with one listing the current records.
+   */
+  bool WriteIndex();
+
+  bool AppendIndexEntry(uint64_t key_hash, const Entry & entry);
+
+  /**
+   * Map the whole data file if it grew since it was last mapped.
+   */
+  bool RefreshMapping();
+
+  /**
+   * Rewrite the data file with the most recently used records fitting in target_bytes.
+   */
+  bool Compact(uint64_t target_bytes);
+
+  std::string directory_;
+  std::string data_path_;
+  std::string index_path_;
+  uint64_t max_bytes_;
+
+  std::mutex mutex_;
+  int data_fd_ = -1;
+  int index_fd_ = -1;
+  uint64_t generation_ = 0;
+  uint64_t data_size_ = 0;
+  uint64_t use_count_ = 0;
+  std::shared_ptr<const PromptAudioMapping> mapping_;
+  /**
+   * Records by key hash, the key itself is checked against the record.
+   */
+  std::unordered_map<uint64_t, Entry> entries_;
+  Stats stats_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Read only, seekable stream buffer over memory owned by the caller.
+ */
+class ReadOnlyStreamBuf : public std::streambuf
+{
+public:
+  /**
+   * @param data first byte of the buffer, must outlive the stream buffer
+   * @param size of the buffer in bytes
+   */
+  ReadOnlyStreamBuf(const char * data, std::size_t size);
+
+protected:
+  pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+  std::streamsize showmanyc() override;
+};
+
+/**
+ * Request body reading the caller's buffer in place, so PostContent does not copy the request data
+ * before sending it. The buffer must stay alive and unchanged until the lex runtime client call
+ * using the body returns.
+ */
+class RequestBodyStream : public Aws::IOStream
+{
+public:
+  /**
+   * @param data first byte of the body
+   * @param size of the body in bytes
+   */
+  RequestBodyStream(const uint8_t * data, std::size_t size);
+
+  /**
+   * @param text the body
+   */
+  explicit RequestBodyStream(const std::string & text);
+
+private:
+  ReadOnlyStreamBuf buffer_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
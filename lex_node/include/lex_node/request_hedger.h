@@ -0,0 +1,285 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Appended to the user id of a turn to name the lex session its duplicate is sent to.
+ */
+constexpr char kHedgeUserIdSuffix[] = "-hedge";
+
+/**
+ * Cuts the tail latency of lex calls by hedging: when a call has not replied after a delay, the
+ * rolling percentile of recent call latencies, a duplicate call is sent on another connection.
+ * The first call to succeed is used and the other is cancelled. Hedges are limited to a budget of
+ * extra calls, a percentage of the hedgeable calls.
+ *
+ * Lex rejects a call to a session that has one in flight, the duplicate is sent to a session of
+ * its own. Its turn is only the same if it does not depend on the session, and running it twice
+ * only harmless if it changes nothing: only texts lex last answered with one of the configured
+ * read only intents are hedged, and only when they do not answer a slot or confirmation prompt.
+ *
+ * The duplicates are sent by a few hedge threads living as long as the hedger, which wait for the
+ * hedge delay of the calls in flight. When all of them are busy with a duplicate, the next one
+ * waits for a hedge thread and is dropped if its call replied meanwhile.
+ */
+class RequestHedger
+{
+public:
+  /**
+   * Hedging counters.
+   */
+  struct Stats
+  {
+    /**
+     * Calls made through the hedger.
+     */
+    uint64_t calls = 0;
+    /**
+     * Duplicate calls sent.
+     */
+    uint64_t hedges = 0;
+    /**
+     * Duplicate calls that replied first.
+     */
+    uint64_t hedge_wins = 0;
+    /**
+     * Duplicate calls not sent because the budget was spent.
+     */
+    uint64_t budget_denials = 0;
+    /**
+     * Current hedge delay in milliseconds, 0 until enough calls were timed.
+     */
+    double delay_ms = 0.0;
+  };
+
+  /**
+   * @param configuration delay, budget and the turns to hedge
+   */
+  explicit RequestHedger(const HedgingConfiguration & configuration);
+
+  /**
+   * Waits for the duplicate calls still in flight and stops the hedge threads.
+   */
+  ~RequestHedger();
+
+  RequestHedger(const RequestHedger &) = delete;
+  RequestHedger & operator=(const RequestHedger &) = delete;
+
+  /**
+   * @param text_key of the turn, see MakeResponseCacheKey()
+   * @param is_dialog_open true if the session of the turn waits for a slot value or a
+   *        confirmation, see IsDialogOpen()
+   * @return true if the turn may be hedged
+   */
+  bool IsHedgeable(const std::string & text_key, bool is_dialog_open);
+
+  /**
+   * Learn the intent lex answered a text with. The text is hedgeable while lex answers it with one
+   * of the configured intents in a single turn.
+   *
+   * @param text_key of the turn, see MakeResponseCacheKey()
+   * @param intent_name lex answered the turn with
+   * @param is_dialog_open true if the reply waits for a slot value or a confirmation, which the
+   *        session of a duplicate would wait for instead
+   */
+  void RecordIntent(const std::string & text_key, const std::string & intent_name,
+                    bool is_dialog_open);
+
+  /**
+   * Make a call, hedging it if it has not replied after the hedge delay.
+   *
+   * The primary call runs on the calling thread and may use its stack. The duplicate runs on a
+   * hedge thread and may outlive this call until it notices it was cancelled, it must only use what
+   * it owns.
+   *
+   * @param primary makes the call, given a function returning true once the call should give up
+   * @param hedge makes the duplicate call, same as primary
+   * @param is_cancelled checked while waiting for the duplicate, true if the caller gave up
+   * @param is_hedge_used [out] set to true if the outcome is the duplicate's, null to not tell
+   * @return the outcome of the first call to succeed, else the outcome of the primary call
+   */
+  template <typename Outcome>
+  Outcome Call(const std::function<Outcome(const std::function<bool()> &)> & primary,
+               std::function<Outcome(const std::function<bool()> &)> hedge,
+               const std::function<bool()> & is_cancelled = nullptr,
+               bool * is_hedge_used = nullptr);
+
+  /**
+   * @return the hedging counters
+   */
+  Stats GetStats();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @return the delay before hedging a call, zero if calls should not be hedged yet
+   */
+  Clock::duration HedgeDelay();
+
+  /**
+   * Spend a hedge from the budget.
+   *
+   * @return false if the budget is spent
+   */
+  bool AcquireHedge();
+
+  /**
+   * Time a call that succeeded.
+   */
+  void RecordLatency(Clock::duration latency, bool is_hedge_win);
+
+  /**
+   * Have a hedge thread run a duplicate call once it is due.
+   *
+   * @param due time of the duplicate, the start of its call plus the hedge delay
+   * @param hedge sends the duplicate unless its call replied
+   */
+  void ScheduleHedge(Clock::time_point due, std::function<void()> hedge);
+
+  /**
+   * Body of the hedge threads, running the scheduled duplicates as they are due.
+   */
+  void RunHedges();
+
+  template <typename Outcome>
+  struct CallState
+  {
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool is_primary_done = false;
+    bool is_hedge_sent = false;
+    bool is_hedge_done = false;
+    bool is_hedge_won = false;
+    std::atomic<bool> is_primary_cancelled{false};
+    std::atomic<bool> is_hedge_cancelled{false};
+    Outcome hedge_outcome;
+  };
+
+  HedgingConfiguration configuration_;
+  std::unordered_set<std::string> hedgeable_intents_;
+
+  std::mutex mutex_;
+  /**
+   * Texts answered with a hedgeable intent, most recently used first, bounded.
+   */
+  std::list<std::string> hedgeable_texts_;
+  std::unordered_map<std::string, std::list<std::string>::iterator> by_text_;
+  /**
+   * Latencies of the last successful calls, a ring.
+   */
+  std::vector<Clock::duration> latencies_;
+  std::size_t next_latency_ = 0;
+  double budget_ = 1.0;
+  Stats stats_;
+
+  std::mutex hedge_mutex_;
+  std::condition_variable hedge_scheduled_;
+  /**
+   * Duplicates waiting for a hedge thread, by the time they are due.
+   */
+  std::multimap<Clock::time_point, std::function<void()>> pending_hedges_;
+  bool is_stopping_ = false;
+  /**
+   * Declared after what the duplicates use, they are stopped first.
+   */
+  std::vector<std::thread> hedge_threads_;
+};
+
+template <typename Outcome>
+Outcome RequestHedger::Call(
+  const std::function<Outcome(const std::function<bool()> &)> & primary,
+  std::function<Outcome(const std::function<bool()> &)> hedge,
+  const std::function<bool()> & is_cancelled, bool * is_hedge_used)
+{
+  auto start = Clock::now();
+  auto delay = HedgeDelay();
+  if (Clock::duration::zero() == delay) {
+    Outcome outcome = primary([] { return false; });
+    if (outcome.IsSuccess()) {
+      RecordLatency(Clock::now() - start, false);
+    }
+    return outcome;
+  }
+
+  auto state = std::make_shared<CallState<Outcome>>();
+  ScheduleHedge(start + delay, [this, state, hedge]() {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (state->is_primary_done || !AcquireHedge()) {
+      return;
+    }
+    state->is_hedge_sent = true;
+    lock.unlock();
+    Outcome outcome = hedge([&state] { return state->is_hedge_cancelled.load(); });
+    lock.lock();
+    state->hedge_outcome = std::move(outcome);
+    if (state->hedge_outcome.IsSuccess() && !state->is_primary_done) {
+      state->is_hedge_won = true;
+      state->is_primary_cancelled = true;
+    }
+    state->is_hedge_done = true;
+    state->changed.notify_all();
+  });
+
+  Outcome outcome = primary([&state] { return state->is_primary_cancelled.load(); });
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->is_primary_done = true;
+  state->changed.notify_all();
+  if (!outcome.IsSuccess() && state->is_hedge_sent && !state->is_hedge_won) {
+    // the primary call failed on its own, the duplicate may still succeed
+    while (!state->is_hedge_done && !(is_cancelled && is_cancelled())) {
+      state->changed.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+  if (state->is_hedge_won || (!outcome.IsSuccess() && state->is_hedge_done &&
+                              state->hedge_outcome.IsSuccess())) {
+    RecordLatency(Clock::now() - start, true);
+    if (is_hedge_used) {
+      *is_hedge_used = true;
+    }
+    return std::move(state->hedge_outcome);
+  }
+  state->is_hedge_cancelled = true;
+  if (outcome.IsSuccess()) {
+    RecordLatency(Clock::now() - start, false);
+  }
+  return outcome;
+}
+
+}  // namespace Lex
+}  // namespace Aws
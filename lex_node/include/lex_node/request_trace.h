@@ -0,0 +1,133 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * What a lex call is made with, to log before the call. It points at the request the call is
+ * built from and never reads the body stream the sdk sends.
+ */
+struct RequestTrace
+{
+  const char * bot_name = "";
+  const char * bot_alias = "";
+  const char * user_id = "";
+  const char * content_type = "";
+  const char * accept_type = "";
+
+  /**
+   * Text or audio of the request, as the caller sent it.
+   */
+  const uint8_t * payload = nullptr;
+  std::size_t payload_size = 0;
+
+  /**
+   * Bytes uploaded to lex, after trimming and encoding the audio.
+   */
+  long long body_size = 0;
+};
+
+/**
+ * @return the 32 bit fnv-1a hash of the data, telling payloads apart in the logs
+ */
+uint32_t HashPayload(const uint8_t * data, std::size_t size);
+
+/**
+ * Write the trace on one line. The payload is hashed here, the AWS_LOGSTREAM macros only stream
+ * the trace when their level is enabled.
+ */
+std::ostream & operator<<(std::ostream & os, const RequestTrace & trace);
+
+/**
+ * Appends the payloads of a few calls to a side file, to replay or listen to them while debugging.
+ * Each record is a line with the time in unix milliseconds and the trace, the payload bytes and a
+ * newline. Sampling is rate limited and stops when the file reaches its cap. The file is created
+ * readable by the user only, the payloads are what the user said.
+ */
+class PayloadSampler
+{
+public:
+  /**
+   * Sampling counters.
+   */
+  struct Stats
+  {
+    /**
+     * Payloads written to the file.
+     */
+    uint64_t samples = 0;
+    /**
+     * Payloads not written because of the rate limit or the file cap.
+     */
+    uint64_t skipped = 0;
+    /**
+     * Size of the file.
+     */
+    uint64_t file_bytes = 0;
+  };
+
+  /**
+   * @param configuration file, rate and cap of the samples
+   */
+  explicit PayloadSampler(const TraceConfiguration & configuration);
+
+  ~PayloadSampler();
+
+  PayloadSampler(const PayloadSampler &) = delete;
+  PayloadSampler & operator=(const PayloadSampler &) = delete;
+
+  /**
+   * Append the payload of the trace to the file if the rate limit and the cap allow it.
+   *
+   * @param trace of the call
+   * @return true if the payload was written
+   */
+  bool Sample(const RequestTrace & trace);
+
+  Stats GetStats() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  const double samples_per_s_;
+  const uint64_t max_file_bytes_;
+
+  mutable std::mutex mutex_;
+  /**
+   * Descriptor of the file opened for appending, -1 if it could not be opened or written.
+   */
+  int fd_;
+  /**
+   * Token bucket holding up to one sample, refilled at the sample rate.
+   */
+  double tokens_ = 1.0;
+  Clock::time_point refilled_;
+  Stats stats_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+#include <lex_node/audio_buffer_pool.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Growable stream buffer the http client writes the lex response body into. The bytes are kept in
+ * a std::vector so they can be moved into the response message instead of copied. The buffer is
+ * readable as well, the sdk parses error responses from it.
+ */
+class ResponseAudioBuffer : public std::streambuf
+{
+public:
+  /**
+   * @param pool to take the buffer from and give it back to, null to allocate it
+   */
+  explicit ResponseAudioBuffer(AudioBufferPool * pool = nullptr) : pool_(pool) {}
+
+  /**
+   * Returns the buffer to the pool.
+   */
+  ~ResponseAudioBuffer() override;
+
+  /**
+   * Make room for the whole body up front, avoiding reallocations while it is received.
+   *
+   * @param size expected body size in bytes
+   */
+  void Reserve(std::size_t size);
+
+  /**
+   * Move the received bytes out of the buffer. The previous content of destination is kept by the
+   * buffer and returned to the pool with it.
+   *
+   * @param destination [out] replaced by the received bytes
+   */
+  void MoveTo(std::vector<uint8_t> & destination);
+
+  /**
+   * Drop the bytes received so far and ignore the rest of the body, for a reply whose audio is
+   * already known. The buffer reads as empty afterwards.
+   */
+  void Discard();
+
+  /**
+   * @return the number of bytes received
+   */
+  std::size_t Size() const { return data_.size(); }
+
+  /**
+   * @return the number of bytes dropped since Discard() was called, the ones received before
+   *         included
+   */
+  std::size_t BytesDiscarded() const { return bytes_discarded_; }
+
+  /**
+   * @return the number of bytes copied into the buffer, including the copies made when it grew
+   */
+  std::size_t BytesCopied() const { return bytes_copied_; }
+
+protected:
+  std::streamsize xsputn(const char * data, std::streamsize size) override;
+  int_type overflow(int_type character) override;
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+
+private:
+  /**
+   * Point the get area at the current data, keeping the read offset.
+   */
+  void ResetGetArea(std::size_t read_offset);
+
+  std::size_t ReadOffset() const;
+
+  /**
+   * Grow the buffer to hold at least capacity bytes.
+   */
+  void Grow(std::size_t capacity);
+
+  AudioBufferPool * pool_;
+  std::vector<uint8_t> data_;
+  std::size_t bytes_copied_ = 0;
+  bool is_discarding_ = false;
+  std::size_t bytes_discarded_ = 0;
+};
+
+/**
+ * Response stream handed to the sdk through PostContentRequest::SetResponseStreamFactory.
+ */
+class ResponseAudioStream : public Aws::IOStream
+{
+public:
+  /**
+   * @param pool to take the buffer from, null to allocate it
+   */
+  explicit ResponseAudioStream(AudioBufferPool * pool = nullptr);
+
+  /**
+   * @return the buffer the response is written to
+   */
+  ResponseAudioBuffer & GetBuffer() { return buffer_; }
+
+private:
+  ResponseAudioBuffer buffer_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
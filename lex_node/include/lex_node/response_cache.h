@@ -0,0 +1,188 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * A lex reply kept by the ResponseCache.
+ */
+struct CachedResponse
+{
+  std::string text_response;
+  std::string message_format_type;
+  std::string intent_name;
+  std::string dialog_state;
+  std::vector<std::pair<std::string, std::string>> slots;
+  std::vector<uint8_t> audio_response;
+
+  /**
+   * @return the approximate memory held by the reply, in bytes
+   */
+  std::size_t ByteSize() const;
+};
+
+/**
+ * Normalize the text of a request so trivially different spellings of a command share a cache
+ * entry: ascii letters are lower cased, runs of white space collapsed and leading and trailing
+ * white space and punctuation removed.
+ *
+ * @param text to normalize
+ * @return the normalized text
+ */
+std::string NormalizeCacheText(const std::string & text);
+
+/**
+ * Build the key of a text turn in the ResponseCache.
+ *
+ * @param bot_name of the bot being called
+ * @param bot_alias of the bot being called
+ * @param text_request input text of the turn
+ * @param accept_type reply format asked for
+ * @return the cache key
+ */
+std::string MakeResponseCacheKey(const std::string & bot_name, const std::string & bot_alias,
+                                 const std::string & text_request, const std::string & accept_type);
+
+/**
+ * Least recently used cache of lex replies to text turns that end a dialog. Stateless one shot
+ * commands are then answered without a lex round trip.
+ *
+ * Only replies of opted in intents, in the ReadyForFulfillment or Fulfilled dialog state and
+ * without session attributes are stored. A reply is only served to a session that is not in the
+ * middle of a dialog, where the text might be a slot value rather than a command.
+ */
+class ResponseCache
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Cache usage counters.
+   */
+  struct Stats
+  {
+    /**
+     * Lookups answered from the cache.
+     */
+    uint64_t hits = 0;
+    /**
+     * Lookups that had to call lex.
+     */
+    uint64_t misses = 0;
+    /**
+     * Replies stored.
+     */
+    uint64_t insertions = 0;
+    /**
+     * Replies dropped to make room for newer ones.
+     */
+    uint64_t evictions = 0;
+    /**
+     * Replies dropped because they outlived the time to live.
+     */
+    uint64_t expirations = 0;
+    /**
+     * Replies currently stored.
+     */
+    std::size_t entries = 0;
+    /**
+     * Bytes held by the stored replies.
+     */
+    std::size_t bytes = 0;
+  };
+
+  /**
+   * @param configuration limits and cacheable intents
+   */
+  explicit ResponseCache(const ResponseCacheConfiguration & configuration);
+
+  /**
+   * Find the reply to a text turn.
+   *
+   * @param key of the turn, see MakeResponseCacheKey()
+   * @param is_dialog_open true if the session of the turn waits for a slot value or a confirmation,
+   *        see IsDialogOpen()
+   * @param now current time
+   * @return the reply, null when lex has to be called
+   */
+  std::shared_ptr<const CachedResponse> Lookup(const std::string & key, bool is_dialog_open,
+                                               Clock::time_point now = Clock::now());
+
+  /**
+   * Store the reply to a text turn if it is cacheable.
+   *
+   * @param key of the turn, see MakeResponseCacheKey()
+   * @param response lex reply
+   * @param has_session_attributes true if lex replied with session attributes
+   * @param now current time
+   * @return true if the reply was stored
+   */
+  bool Insert(const std::string & key, CachedResponse response, bool has_session_attributes,
+              Clock::time_point now = Clock::now());
+
+  /**
+   * @return the cache usage counters
+   */
+  Stats GetStats();
+
+private:
+  struct Entry
+  {
+    std::string key;
+    std::shared_ptr<const CachedResponse> response;
+    std::size_t bytes;
+    Clock::time_point expiry;
+  };
+
+  /**
+   * Drop the least recently used entries until the limits are met. Called with the mutex held.
+   */
+  void EvictLocked();
+
+  void EraseLocked(std::list<Entry>::iterator entry);
+
+  std::size_t max_entries_;
+  std::size_t max_bytes_;
+  Clock::duration ttl_;
+  std::unordered_set<std::string> cacheable_intents_;
+
+  std::mutex mutex_;
+  /**
+   * Most recently used first.
+   */
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> by_key_;
+  Stats stats_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
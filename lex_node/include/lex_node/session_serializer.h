@@ -0,0 +1,236 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Build the key identifying a single Lex session.
+ *
+ * @param bot_name of the bot being called
+ * @param bot_alias of the bot being called
+ * @param user_id lex user id of the conversation
+ * @return the session key
+ */
+std::string MakeSessionKey(const std::string & bot_name, const std::string & bot_alias,
+                           const std::string & user_id);
+
+/**
+ * Session attributes of a Lex session, kept across its turns.
+ */
+struct SessionAttributes
+{
+  std::map<std::string, std::string> attributes;
+
+  /**
+   * The attributes as the base64 encoded json object PostContent exchanges them in, empty until
+   * they are sent with PostContent or received from it.
+   */
+  std::string encoded;
+};
+
+/**
+ * What the session table knows of a Lex session.
+ */
+struct SessionInfo
+{
+  /**
+   * Turns running or waiting.
+   */
+  uint64_t turns_in_flight = 0;
+
+  /**
+   * Turns finished.
+   */
+  uint64_t turns = 0;
+
+  /**
+   * Dialog state lex replied with to the last turn that recorded one, empty before.
+   */
+  std::string dialog_state;
+
+  /**
+   * Session attributes lex replied with to the last turn, null before.
+   */
+  std::shared_ptr<const SessionAttributes> session_attributes;
+
+  std::chrono::steady_clock::time_point created;
+
+  /**
+   * When the last turn entered or finished.
+   */
+  std::chrono::steady_clock::time_point last_used;
+};
+
+/**
+ * @param dialog_state lex replied with
+ * @return true if lex waits for a slot value or a yes or no answer in the dialog state, the next
+ *         text of the session may answer it rather than be a command
+ */
+bool IsDialogOpen(const std::string & dialog_state);
+
+/**
+ * Serializes conversation turns per Lex session, in a bounded table of the sessions.
+ *
+ * Turns for different sessions proceed in parallel, turns for the same session are executed one at
+ * a time in the order they called Enter(). The table is split in shards locked independently so
+ * that sessions of different shards do not contend. Idle sessions are kept until the table is full,
+ * then the least recently used idle session of the shard is evicted. Sessions with turns in flight
+ * are never evicted, a shard may hold more of them than its share of the bound.
+ */
+class SessionSerializer
+{
+private:
+  struct Session
+  {
+    std::condition_variable turn_done;
+    uint64_t next_ticket = 0;
+    uint64_t now_serving = 0;
+    SessionInfo info;
+
+    /**
+     * Position in the idle list of the shard, valid while no turn is in flight.
+     */
+    std::list<std::string>::iterator idle_position;
+  };
+
+  struct Shard
+  {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+
+    /**
+     * Keys of the idle sessions, most recently used first.
+     */
+    std::list<std::string> idle_sessions;
+    uint64_t evictions = 0;
+  };
+
+  std::size_t max_sessions_per_shard_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  Shard & GetShard(const std::string & session_key);
+  void Leave(Shard & shard, const std::string & session_key, Session & session);
+
+  /**
+   * Evict the least recently used idle sessions of a full shard, its mutex held.
+   *
+   * @param shard to evict from
+   * @param max_sessions the shard keeps
+   */
+  static void Evict(Shard & shard, std::size_t max_sessions);
+
+public:
+  /**
+   * Scoped ownership of a session. The next turn of the session may start once it is destroyed.
+   */
+  class Turn
+  {
+  private:
+    SessionSerializer * serializer_;
+    Shard * shard_;
+    std::string session_key_;
+    std::shared_ptr<Session> session_;
+
+    friend class SessionSerializer;
+    Turn(SessionSerializer * serializer, Shard * shard, std::string session_key,
+         std::shared_ptr<Session> session);
+
+  public:
+    Turn(Turn && other);
+    Turn(const Turn &) = delete;
+    Turn & operator=(const Turn &) = delete;
+    ~Turn();
+
+    /**
+     * @return the dialog state lex replied with to the previous turn, empty if none did or the
+     *         session was evicted since
+     */
+    std::string GetDialogState() const;
+
+    /**
+     * Record the dialog state lex replied with to this turn.
+     *
+     * @param dialog_state of the reply
+     */
+    void SetDialogState(const std::string & dialog_state);
+
+    /**
+     * @return the session attributes lex replied with to the previous turn, null if none did
+     */
+    std::shared_ptr<const SessionAttributes> GetSessionAttributes() const;
+
+    /**
+     * Record the session attributes lex replied with to this turn.
+     *
+     * @param session_attributes of the reply
+     */
+    void SetSessionAttributes(std::shared_ptr<const SessionAttributes> session_attributes);
+  };
+
+  /**
+   * @param max_sessions kept in the table, idle or not, at least one per shard
+   * @param shards the table is split in, locked independently
+   */
+  explicit SessionSerializer(std::size_t max_sessions = 1024, std::size_t shards = 16);
+
+  /**
+   * Block until every earlier turn of the session has finished.
+   *
+   * @param session_key identifying the session, see MakeSessionKey()
+   * @return the turn, hold it for the duration of the lex interaction
+   */
+  Turn Enter(const std::string & session_key);
+
+  /**
+   * Look up a session of the table.
+   *
+   * @param session_key identifying the session, see MakeSessionKey()
+   * @param[out] info of the session, if it is in the table
+   * @return false if the session is not in the table, never used or evicted
+   */
+  bool GetSession(const std::string & session_key, SessionInfo & info);
+
+  /**
+   * @return the number of sessions with a turn running or waiting
+   */
+  size_t ActiveSessions();
+
+  /**
+   * @return the number of sessions in the table, idle ones included
+   */
+  size_t Sessions();
+
+  /**
+   * @return the number of idle sessions evicted to make room for new ones
+   */
+  uint64_t Evictions();
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * A member of a flat json object, pointing into the buffer of the decoding thread.
+ */
+struct SlotView
+{
+  const char * key;
+  std::size_t key_size;
+  const char * value;
+  std::size_t value_size;
+};
+
+/**
+ * Decode a base64 encoded flat json object, as lex sends the slots and the session attributes of
+ * PostContent replies, in a single pass over buffers the calling thread reuses.
+ *
+ * String values are unescaped, null values are empty, numbers, booleans and nested objects or
+ * arrays keep their json text.
+ *
+ * @param encoded base64 encoded json object, trailing NUL bytes of the json ignored
+ * @param size of encoded
+ * @return the members in order, valid until the next call on the same thread, null if the input
+ *         is not valid base64 or not a json object
+ */
+const std::vector<SlotView> * DecodeSlotViews(const char * encoded, std::size_t size);
+
+/**
+ * Decode the slots of a PostContent reply into key value messages, reusing their strings.
+ *
+ * @param encoded base64 encoded json object
+ * @param size of encoded
+ * @param slots [out] keys and values, left unchanged when the slots cannot be decoded
+ * @return false if the slots cannot be decoded
+ */
+template <typename KeyValue>
+bool DecodeSlots(const char * encoded, std::size_t size, std::vector<KeyValue> & slots)
+{
+  auto views = DecodeSlotViews(encoded, size);
+  if (!views) {
+    return false;
+  }
+  slots.resize(views->size());
+  for (std::size_t index = 0; index < views->size(); index++) {
+    const auto & view = (*views)[index];
+    slots[index].key.assign(view.key, view.key_size);
+    slots[index].value.assign(view.value, view.value_size);
+  }
+  return true;
+}
+
+/**
+ * Empty the keys and values of slots for a message going back to its pool. The elements are kept
+ * with the capacity of their strings, DecodeSlots assigns the next reply into them and resizes
+ * the vector down to it.
+ *
+ * @param slots to empty
+ */
+template <typename KeyValue>
+void ClearSlots(std::vector<KeyValue> & slots)
+{
+  for (auto & slot : slots) {
+    slot.key.clear();
+    slot.value.clear();
+  }
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/core/utils/memory/MemorySystemInterface.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Memory system for the aws sdk keeping per allocation tag counters. Small blocks are recycled
+ * through per thread caches so concurrent lex calls do not contend on the global heap.
+ *
+ * Only effective with an sdk built with custom memory management (USE_AWS_MEMORY_MANAGEMENT),
+ * otherwise the sdk never calls it. Install it through SDKOptions::memoryManagementOptions before
+ * Aws::InitAPI and keep it alive until after Aws::ShutdownAPI.
+ */
+class TaggedMemorySystem : public Aws::Utils::Memory::MemorySystemInterface
+{
+public:
+  /**
+   * Counters of one allocation tag.
+   */
+  struct TagStats
+  {
+    std::string tag;
+    /**
+     * Bytes currently allocated.
+     */
+    int64_t live_bytes = 0;
+    /**
+     * Highest live_bytes seen.
+     */
+    int64_t peak_bytes = 0;
+    /**
+     * Number of allocations made.
+     */
+    uint64_t allocations = 0;
+  };
+
+  /**
+   * @param thread_cache_blocks number of free blocks each thread keeps per size class
+   */
+  explicit TaggedMemorySystem(std::size_t thread_cache_blocks = 64);
+
+  ~TaggedMemorySystem() override = default;
+
+  void Begin() override {}
+  void End() override {}
+
+  void * AllocateMemory(std::size_t block_size, std::size_t alignment,
+                        const char * allocation_tag = nullptr) override;
+  void FreeMemory(void * memory_ptr) override;
+
+  /**
+   * @return the counters of every allocation tag seen, largest live bytes first
+   */
+  std::vector<TagStats> GetTagStats() const;
+
+  /**
+   * @return the counters of all allocations, peak_bytes the highest total live bytes seen
+   */
+  TagStats GetTotalStats() const;
+
+private:
+  static constexpr std::size_t kTagSlotCount = 256;
+
+  /**
+   * Longest tag name kept, including its terminating null, longer names are truncated.
+   */
+  static constexpr std::size_t kTagNameSize = 64;
+
+  /**
+   * An allocation tag address and the counters of its tag, on its own cache line. The address
+   * identifies the tag when allocating but is never read through after the slot is claimed, the
+   * name is copied to tag_names_: a tag that is not a string literal may be freed. If another tag
+   * reuses its address, it is counted with it.
+   */
+  struct alignas(64) TagSlot
+  {
+    std::atomic<const char *> tag;
+    /**
+     * Slot counting the tag: this one, or the slot of another address of the same tag string
+     * seen first. Set before tag is published and never changed after.
+     */
+    uint32_t counter_slot;
+    std::atomic<int64_t> live_bytes;
+    std::atomic<int64_t> peak_bytes;
+    std::atomic<uint64_t> allocations;
+  };
+
+  /**
+   * Bytes live over all tags and their highest value, on their own cache line.
+   */
+  struct alignas(64) TotalBytes
+  {
+    std::atomic<int64_t> live_bytes{0};
+    std::atomic<int64_t> peak_bytes{0};
+  };
+
+  /**
+   * @return the slot counting the given tag, claiming a free one the first time a tag is seen
+   */
+  uint32_t FindTagSlot(const char * allocation_tag);
+
+  /**
+   * Claim a slot for a tag address not seen before.
+   *
+   * @return the slot counting the tag, 0 when the table is full
+   */
+  uint32_t ClaimTagSlot(const char * allocation_tag);
+
+  std::size_t thread_cache_blocks_;
+  TagSlot tag_slots_[kTagSlotCount];
+  TotalBytes total_bytes_;
+
+  /**
+   * Copies of the tag names of the slots, written once when the slot is claimed, before its tag is
+   * published.
+   */
+  char tag_names_[kTagSlotCount][kTagNameSize];
+
+  /**
+   * Serializes claiming slots, which only happens the first time a tag address is seen.
+   */
+  std::mutex claim_mutex_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
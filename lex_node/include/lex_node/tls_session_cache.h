@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Aws {
+namespace Http {
+class HttpClientFactory;
+}  // namespace Http
+
+namespace Lex {
+
+/**
+ * The tls sessions of the hosts lex is called on, kept in a file across node restarts so the
+ * first connections after a restart resume a session with an abbreviated handshake instead of
+ * paying for a full one. Sessions are stored serialized, the tls library reads them back.
+ *
+ * The file holds session secrets: it is written readable by its owner only, and a file anyone
+ * else may read or write is ignored.
+ */
+class TlsSessionCache
+{
+public:
+  /**
+   * Handshake and session counters.
+   */
+  struct Stats
+  {
+    /**
+     * Handshakes resuming a cached session.
+     */
+    uint64_t resumed_handshakes = 0;
+    /**
+     * Handshakes negotiating a new session.
+     */
+    uint64_t full_handshakes = 0;
+    /**
+     * Sessions read from the file at startup.
+     */
+    uint64_t sessions_loaded = 0;
+    /**
+     * Sessions received from the hosts.
+     */
+    uint64_t sessions_stored = 0;
+    /**
+     * Hosts with a cached session.
+     */
+    std::size_t entries = 0;
+  };
+
+  /**
+   * @param configuration file the sessions are kept in
+   */
+  explicit TlsSessionCache(const TlsSessionCacheConfiguration & configuration);
+
+  TlsSessionCache(const TlsSessionCache &) = delete;
+  TlsSessionCache & operator=(const TlsSessionCache &) = delete;
+
+  /**
+   * Read the sessions saved by an earlier run, dropping the expired ones.
+   *
+   * @param now current time, in seconds since the epoch
+   * @return the number of sessions loaded
+   */
+  std::size_t Load(std::time_t now = std::time(nullptr));
+
+  /**
+   * Find the session to resume on a host.
+   *
+   * @param host name the connection is made to
+   * @param now current time, in seconds since the epoch
+   * @return the serialized session, empty if there is none or it expired
+   */
+  std::string Find(const std::string & host, std::time_t now = std::time(nullptr));
+
+  /**
+   * Keep the newest session of a host. Called from the tls library while a connection is set up,
+   * the sessions are saved later by Save().
+   *
+   * @param host name the session was negotiated with
+   * @param session serialized session
+   * @param expires_at end of the session lifetime, in seconds since the epoch
+   */
+  void Store(const std::string & host, std::string session, std::time_t expires_at);
+
+  /**
+   * Save the sessions to the file if they changed since the last save. Call it off the request
+   * threads, periodically and at shutdown.
+   *
+   * @return false if the sessions changed and could not be saved
+   */
+  bool Save();
+
+  /**
+   * Count a completed handshake.
+   *
+   * @param is_resumed true if a cached session was resumed
+   */
+  void RecordHandshake(bool is_resumed);
+
+  /**
+   * @return the handshake and session counters
+   */
+  Stats GetStats();
+
+private:
+  struct Entry
+  {
+    std::string session;
+    std::time_t expires_at;
+  };
+
+  std::string path_;
+
+  /**
+   * Serializes the file writes, held without mutex_ so the tls library never waits for the disk.
+   */
+  std::mutex save_mutex_;
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> entries_;
+  /**
+   * Sessions changed since the last save.
+   */
+  bool is_dirty_ = false;
+  Stats stats_;
+};
+
+/**
+ * @return true if lex_node was built with curl and openssl and curl uses openssl, tls sessions are
+ * cached through them
+ */
+bool IsTlsSessionCacheAvailable();
+
+/**
+ * Make an http client factory whose curl clients resume the tls sessions of a cache. Install it
+ * with SDKOptions::httpOptions::httpClientFactory_create_fn before Aws::InitAPI().
+ *
+ * @param tls_session_cache cache shared by every client of the factory
+ * @return the factory, null if IsTlsSessionCacheAvailable() is false
+ */
+std::shared_ptr<Aws::Http::HttpClientFactory> MakeTlsSessionHttpClientFactory(
+  std::shared_ptr<TlsSessionCache> tls_session_cache);
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <lex_node/lex_configuration.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Features of one frame of 16 bit pcm samples.
+ */
+struct FrameFeatures
+{
+  /**
+   * Sum of the squared samples.
+   */
+  uint64_t energy = 0;
+  /**
+   * Number of sign changes between consecutive samples.
+   */
+  uint32_t zero_crossings = 0;
+};
+
+/**
+ * Compute the energy and zero crossings of a frame, with SSE2 or NEON when available.
+ *
+ * @param samples of the frame
+ * @param count number of samples
+ * @return the frame features
+ */
+FrameFeatures ComputeFrameFeatures(const int16_t * samples, std::size_t count);
+
+/**
+ * Scalar version of ComputeFrameFeatures, reference for the vectorized kernels.
+ */
+FrameFeatures ComputeFrameFeaturesScalar(const int16_t * samples, std::size_t count);
+
+/**
+ * Range of samples holding speech.
+ */
+struct SpeechSpan
+{
+  /**
+   * First sample to keep.
+   */
+  std::size_t begin = 0;
+  /**
+   * One past the last sample to keep.
+   */
+  std::size_t end = 0;
+  /**
+   * False if no speech was found, the span then covers all samples.
+   */
+  bool has_speech = false;
+};
+
+/**
+ * Finds where speech starts and ends in a clip, from the energy and zero crossing rate of short
+ * frames. A frame is voiced if its energy is well above the noise floor of the clip, or somewhat
+ * above it with the high zero crossing rate of unvoiced consonants.
+ */
+class VoiceActivityDetector
+{
+public:
+  explicit VoiceActivityDetector(const VoiceActivityConfiguration & configuration)
+  : configuration_(configuration)
+  {
+  }
+
+  /**
+   * @param samples interleaved 16 bit samples
+   * @param count number of samples, of all channels
+   * @param channels number of interleaved channels
+   * @param sample_rate in hertz
+   * @return the voiced span, padded, on channel frame boundaries
+   */
+  SpeechSpan FindSpeech(const int16_t * samples, std::size_t count, int channels,
+                        int sample_rate) const;
+
+private:
+  VoiceActivityConfiguration configuration_;
+};
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/async_log_queue.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Most lines forwarded in one batch.
+ */
+constexpr std::size_t kBatchSize = 64;
+
+/**
+ * Longest wait of a blocked push before it retries, in case its wake up was missed.
+ */
+constexpr std::chrono::milliseconds kBlockedRetry(1);
+
+/**
+ * Set on the background thread, which drops lines it logs rather than waiting for itself.
+ */
+thread_local bool is_forwarding_thread = false;
+
+std::size_t RoundUpToPowerOfTwo(std::size_t value)
+{
+  std::size_t power = 2;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+}  // namespace
+
+AsyncLogQueue::AsyncLogQueue(const LoggingConfiguration & configuration, Forward forward)
+: mask_(RoundUpToPowerOfTwo(std::max(configuration.capacity, 2)) - 1),
+  is_blocking_("block" == configuration.overflow_policy),
+  flush_interval_(std::max(configuration.flush_interval_ms, 1)),
+  forward_(std::move(forward)),
+  slots_(new Slot[mask_ + 1])
+{
+  for (std::size_t position = 0; position <= mask_; position++) {
+    slots_[position].sequence.store(position, std::memory_order_relaxed);
+  }
+  thread_ = std::thread(&AsyncLogQueue::Run, this);
+}
+
+AsyncLogQueue::~AsyncLogQueue()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  work_.notify_one();
+  thread_.join();
+}
+
+bool AsyncLogQueue::TryPush(int level, const char * tag, const char * message, std::size_t size)
+{
+  std::size_t position = enqueue_position_.load(std::memory_order_relaxed);
+  Slot * slot;
+  for (;;) {
+    slot = &slots_[position & mask_];
+    std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+    if (0 == difference) {
+      if (enqueue_position_.compare_exchange_weak(position, position + 1,
+                                                  std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      return false;
+    } else {
+      position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+  }
+  // the strings keep their capacity from the lines the slot held before
+  slot->record.level = level;
+  slot->record.tag.assign(tag ? tag : "");
+  slot->record.message.assign(message, size);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool AsyncLogQueue::TryPop(LogRecord & record)
+{
+  std::size_t position = dequeue_position_.load(std::memory_order_relaxed);
+  Slot * slot;
+  for (;;) {
+    slot = &slots_[position & mask_];
+    std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+    if (0 == difference) {
+      if (dequeue_position_.compare_exchange_weak(position, position + 1,
+                                                  std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      return false;
+    } else {
+      position = dequeue_position_.load(std::memory_order_relaxed);
+    }
+  }
+  // the slot takes the strings of the record in exchange, their capacity circulates
+  record.level = slot->record.level;
+  record.tag.swap(slot->record.tag);
+  record.message.swap(slot->record.message);
+  slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+  return true;
+}
+
+void AsyncLogQueue::Push(int level, const char * tag, const char * message, std::size_t size)
+{
+  if (TryPush(level, tag, message, size)) {
+    return;
+  }
+  if (!is_blocking_ || is_forwarding_thread) {
+    // drop the oldest line to make room, producers pop from the buffer only when it is full
+    LogRecord oldest;
+    do {
+      if (TryPop(oldest)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+    } while (!TryPush(level, tag, message, size));
+    return;
+  }
+  blocked_.fetch_add(1, std::memory_order_relaxed);
+  while (!TryPush(level, tag, message, size)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (is_stopping_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    waiting_pushes_++;
+    work_.notify_one();
+    done_.wait_for(lock, kBlockedRetry);
+    waiting_pushes_--;
+  }
+}
+
+void AsyncLogQueue::Flush()
+{
+  if (is_forwarding_thread) {
+    return;
+  }
+  std::size_t position = enqueue_position_.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiting_flushes_++;
+  work_.notify_one();
+  done_.wait(lock, [this, position]() { return drained_position_ >= position || is_stopping_; });
+  waiting_flushes_--;
+}
+
+AsyncLogQueue::Stats AsyncLogQueue::GetStats() const
+{
+  Stats stats;
+  stats.pushed = enqueue_position_.load(std::memory_order_relaxed);
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  stats.blocked = blocked_.load(std::memory_order_relaxed);
+  stats.forwarded = forwarded_.load(std::memory_order_relaxed);
+  stats.batches = batches_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void AsyncLogQueue::Run()
+{
+  is_forwarding_thread = true;
+  std::vector<LogRecord> batch(kBatchSize);
+  uint64_t reported_drops = 0;
+  bool is_last_drain = false;
+  while (!is_last_drain) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_.wait_for(lock, flush_interval_, [this]() {
+        return is_stopping_ || waiting_pushes_ > 0 || waiting_flushes_ > 0;
+      });
+      is_last_drain = is_stopping_;
+    }
+    for (;;) {
+      std::size_t size = 0;
+      while (size < kBatchSize && TryPop(batch[size])) {
+        size++;
+      }
+      uint64_t drops = dropped_.load(std::memory_order_relaxed);
+      if (0 == size && drops == reported_drops) {
+        break;
+      }
+      forward_(batch.data(), size, drops - reported_drops);
+      reported_drops = drops;
+      if (size > 0) {
+        forwarded_.fetch_add(size, std::memory_order_relaxed);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (waiting_pushes_ > 0) {
+          done_.notify_all();
+        }
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    drained_position_ = dequeue_position_.load(std::memory_order_relaxed);
+    done_.notify_all();
+  }
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/async_log_system.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+constexpr char kLogTag[] = "AsyncLogSystem";
+
+}  // namespace
+
+AsyncLogSystem::AsyncLogSystem(const LoggingConfiguration & configuration,
+                               std::shared_ptr<Aws::Utils::Logging::LogSystemInterface> log_system)
+: log_system_(std::move(log_system)),
+  queue_(configuration, [this](const LogRecord * records, std::size_t count, uint64_t dropped) {
+    Forward(records, count, dropped);
+  })
+{
+}
+
+Aws::Utils::Logging::LogLevel AsyncLogSystem::GetLogLevel() const
+{
+  return log_system_->GetLogLevel();
+}
+
+void AsyncLogSystem::Log(Aws::Utils::Logging::LogLevel log_level, const char * tag,
+                         const char * format, ...)
+{
+  // formatted here, the arguments may not outlive the call
+  thread_local std::vector<char> buffer(1024);
+  va_list arguments;
+  va_start(arguments, format);
+  va_list retry_arguments;
+  va_copy(retry_arguments, arguments);
+  int size = std::vsnprintf(buffer.data(), buffer.size(), format, arguments);
+  if (size >= static_cast<int>(buffer.size())) {
+    buffer.resize(size + 1);
+    std::vsnprintf(buffer.data(), buffer.size(), format, retry_arguments);
+  }
+  va_end(retry_arguments);
+  va_end(arguments);
+  if (size > 0) {
+    queue_.Push(static_cast<int>(log_level), tag, buffer.data(), size);
+  }
+}
+
+void AsyncLogSystem::LogStream(Aws::Utils::Logging::LogLevel log_level, const char * tag,
+                               const Aws::OStringStream & message_stream)
+{
+  auto message = message_stream.str();
+  queue_.Push(static_cast<int>(log_level), tag, message.data(), message.size());
+}
+
+void AsyncLogSystem::Flush() { queue_.Flush(); }
+
+AsyncLogQueue::Stats AsyncLogSystem::GetStats() const { return queue_.GetStats(); }
+
+void AsyncLogSystem::Forward(const LogRecord * records, std::size_t count, uint64_t dropped)
+{
+  if (dropped > 0) {
+    log_system_->Log(Aws::Utils::Logging::LogLevel::Warn, kLogTag,
+                     "Dropped %llu log lines, the log buffer was full",
+                     static_cast<unsigned long long>(dropped));
+  }
+  for (std::size_t index = 0; index < count; index++) {
+    stream_.str(Aws::String());
+    stream_.write(records[index].message.data(), records[index].message.size());
+    log_system_->LogStream(static_cast<Aws::Utils::Logging::LogLevel>(records[index].level),
+                           records[index].tag.c_str(), stream_);
+  }
+}
+
+}  // namespace Lex
+}  // namespace Aws
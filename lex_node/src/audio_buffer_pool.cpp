@@ -0,0 +1,106 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/audio_buffer_pool.h>
+
+#include <utility>
+
+namespace Aws {
+namespace Lex {
+
+constexpr std::size_t AudioBufferPool::kMinBufferSize;
+
+/**
+ * @return the smallest size class holding at least size bytes
+ */
+static std::size_t SizeClassAtLeast(std::size_t size)
+{
+  std::size_t size_class = 0;
+  while ((AudioBufferPool::kMinBufferSize << size_class) < size) {
+    size_class++;
+  }
+  return size_class;
+}
+
+/**
+ * @return the largest size class a buffer of the given capacity can serve
+ */
+static std::size_t SizeClassAtMost(std::size_t capacity)
+{
+  std::size_t size_class = 0;
+  while ((AudioBufferPool::kMinBufferSize << (size_class + 1)) <= capacity) {
+    size_class++;
+  }
+  return size_class;
+}
+
+AudioBufferPool::AudioBufferPool(std::size_t max_buffer_size, std::size_t buffers_per_size)
+: max_buffer_size_(max_buffer_size), buffers_per_size_(buffers_per_size)
+{
+  if (max_buffer_size_ >= kMinBufferSize) {
+    free_buffers_.resize(SizeClassAtMost(max_buffer_size_) + 1);
+  }
+}
+
+std::vector<uint8_t> AudioBufferPool::Acquire(std::size_t min_capacity)
+{
+  std::size_t size_class = SizeClassAtLeast(min_capacity);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i = size_class; i < free_buffers_.size(); i++) {
+      if (!free_buffers_[i].empty()) {
+        std::vector<uint8_t> buffer = std::move(free_buffers_[i].back());
+        free_buffers_[i].pop_back();
+        stats_.hits++;
+        stats_.pooled_bytes -= buffer.capacity();
+        return buffer;
+      }
+    }
+    stats_.misses++;
+  }
+  // allocate the whole size class so the buffer can be pooled for its class once released
+  std::vector<uint8_t> buffer;
+  if (size_class < free_buffers_.size()) {
+    buffer.reserve(kMinBufferSize << size_class);
+  } else {
+    buffer.reserve(min_capacity);
+  }
+  return buffer;
+}
+
+void AudioBufferPool::Release(std::vector<uint8_t> && buffer)
+{
+  std::vector<uint8_t> released;
+  released.swap(buffer);
+  if (released.capacity() < kMinBufferSize || released.capacity() > max_buffer_size_) {
+    return;
+  }
+  std::size_t size_class = SizeClassAtMost(released.capacity());
+  released.clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (size_class < free_buffers_.size() && free_buffers_[size_class].size() < buffers_per_size_) {
+    stats_.pooled_bytes += released.capacity();
+    free_buffers_[size_class].push_back(std::move(released));
+  }
+}
+
+AudioBufferPool::Stats AudioBufferPool::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace Lex
+}  // namespace Aws
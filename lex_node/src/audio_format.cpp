@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/audio_format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+std::string Trim(const std::string & text)
+{
+  auto begin = text.find_first_not_of(" \t");
+  if (std::string::npos == begin) {
+    return std::string();
+  }
+  auto end = text.find_last_not_of(" \t");
+  return text.substr(begin, end - begin + 1);
+}
+
+std::string ToLower(std::string text)
+{
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char character) { return std::tolower(character); });
+  return text;
+}
+
+bool ParsePositive(const std::string & text, int & value)
+{
+  char * end = nullptr;
+  long parsed = std::strtol(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || parsed <= 0 || parsed > 1000000) {
+    return false;
+  }
+  value = static_cast<int>(parsed);
+  return true;
+}
+
+}  // namespace
+
+bool ParsePcmContentType(const std::string & content_type, PcmFormat & format)
+{
+  std::string lowered = ToLower(content_type);
+  auto separator = lowered.find(';');
+  std::string media_type = Trim(lowered.substr(0, separator));
+  bool is_l16 = media_type == "audio/l16";
+  if (!is_l16 && media_type != "audio/lpcm") {
+    return false;
+  }
+  PcmFormat parsed;
+  // l16 is big endian in its rfc, lex reads it little endian like lpcm
+  while (std::string::npos != separator) {
+    auto next = lowered.find(';', separator + 1);
+    std::string parameter = lowered.substr(separator + 1, next - separator - 1);
+    separator = next;
+    auto equals = parameter.find('=');
+    if (std::string::npos == equals) {
+      continue;
+    }
+    std::string name = Trim(parameter.substr(0, equals));
+    std::string value = Trim(parameter.substr(equals + 1));
+    bool is_valid = true;
+    if (name == "rate" || name == "sample-rate") {
+      is_valid = ParsePositive(value, parsed.sample_rate);
+    } else if (name == "channels" || name == "channel-count") {
+      is_valid = ParsePositive(value, parsed.channels);
+    } else if (name == "sample-size-bits") {
+      is_valid = ParsePositive(value, parsed.sample_bits) && 0 == parsed.sample_bits % 8 &&
+                 parsed.sample_bits <= 32;
+    } else if (name == "is-big-endian") {
+      parsed.big_endian = value == "true";
+    } else if (name == "sample-format") {
+      parsed.is_float = value == "float";
+      is_valid = parsed.is_float || value == "signed";
+    }
+    if (!is_valid) {
+      return false;
+    }
+  }
+  if (parsed.is_float && 32 != parsed.sample_bits) {
+    return false;
+  }
+  format = parsed;
+  return true;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,419 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/audio_normalizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Kaiser window shape, trading transition width for stop band attenuation (about 80 dB).
+ */
+constexpr double kKaiserBeta = 8.0;
+
+/**
+ * Cutoff of the low pass filter relative to the lower Nyquist frequency, leaving room for the
+ * transition band.
+ */
+constexpr double kCutoffRatio = 0.94;
+
+constexpr float kInt16Scale = 1.0f / 32768.0f;
+
+/**
+ * Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+ */
+double BesselI0(double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 50; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+/**
+ * Decode one sample to [-1, 1).
+ */
+float DecodeSample(const uint8_t * bytes, const PcmFormat & format)
+{
+  int size = format.sample_bits / 8;
+  uint32_t value = 0;
+  for (int index = 0; index < size; index++) {
+    int shift = format.big_endian ? 8 * (size - 1 - index) : 8 * index;
+    value |= static_cast<uint32_t>(bytes[index]) << shift;
+  }
+  if (format.is_float) {
+    float sample;
+    std::memcpy(&sample, &value, sizeof(sample));
+    return sample;
+  }
+  switch (size) {
+    case 1:
+      // 8 bit pcm is unsigned
+      return (static_cast<int>(value) - 128) / 128.0f;
+    case 2:
+      return static_cast<int16_t>(value) * kInt16Scale;
+    case 3:
+      return static_cast<int32_t>(value << 8) / 2147483648.0f;
+    default:
+      return static_cast<int32_t>(value) / 2147483648.0f;
+  }
+}
+
+}  // namespace
+
+void DownmixToFloatScalar(const uint8_t * data, std::size_t frame_count, const PcmFormat & format,
+                          float * output)
+{
+  std::size_t sample_bytes = format.sample_bits / 8;
+  float channel_scale = 1.0f / format.channels;
+  for (std::size_t frame = 0; frame < frame_count; frame++) {
+    float sum = 0.0f;
+    for (int channel = 0; channel < format.channels; channel++) {
+      sum += DecodeSample(data, format);
+      data += sample_bytes;
+    }
+    output[frame] = sum * channel_scale;
+  }
+}
+
+void FloatToInt16Scalar(const float * samples, std::size_t count, int16_t * output)
+{
+  for (std::size_t index = 0; index < count; index++) {
+    float scaled = std::min(32767.0f, std::max(-32768.0f, samples[index] * 32768.0f));
+    output[index] = static_cast<int16_t>(std::lrint(scaled));
+  }
+}
+
+float DotProductScalar(const float * a, const float * b, std::size_t count)
+{
+  float sum = 0.0f;
+  for (std::size_t index = 0; index < count; index++) {
+    sum += a[index] * b[index];
+  }
+  return sum;
+}
+
+#if defined(__SSE2__)
+
+void DownmixToFloat(const uint8_t * data, std::size_t frame_count, const PcmFormat & format,
+                    float * output)
+{
+  std::size_t frame = 0;
+  if (16 == format.sample_bits && !format.big_endian && !format.is_float) {
+    auto samples = reinterpret_cast<const int16_t *>(data);
+    if (1 == format.channels) {
+      const __m128 scale = _mm_set1_ps(kInt16Scale);
+      for (; frame + 8 <= frame_count; frame += 8) {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + frame));
+        // sign extend by unpacking each sample into the high half and shifting it down
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        _mm_storeu_ps(output + frame, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(output + frame + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+      }
+    } else if (2 == format.channels) {
+      const __m128 scale = _mm_set1_ps(kInt16Scale * 0.5f);
+      const __m128i ones = _mm_set1_epi16(1);
+      for (; frame + 4 <= frame_count; frame += 4) {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + 2 * frame));
+        // left + right of each frame
+        __m128i sums = _mm_madd_epi16(packed, ones);
+        _mm_storeu_ps(output + frame, _mm_mul_ps(_mm_cvtepi32_ps(sums), scale));
+      }
+    }
+  } else if (format.is_float && !format.big_endian && 2 == format.channels) {
+    auto samples = reinterpret_cast<const float *>(data);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; frame + 4 <= frame_count; frame += 4) {
+      __m128 first = _mm_loadu_ps(samples + 2 * frame);
+      __m128 second = _mm_loadu_ps(samples + 2 * frame + 4);
+      __m128 left = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 right = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(output + frame, _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+  }
+  DownmixToFloatScalar(data + frame * format.FrameBytes(), frame_count - frame, format,
+                       output + frame);
+}
+
+void FloatToInt16(const float * samples, std::size_t count, int16_t * output)
+{
+  std::size_t index = 0;
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  const __m128 lowest = _mm_set1_ps(-32768.0f);
+  const __m128 highest = _mm_set1_ps(32767.0f);
+  for (; index + 8 <= count; index += 8) {
+    __m128 low = _mm_mul_ps(_mm_loadu_ps(samples + index), scale);
+    __m128 high = _mm_mul_ps(_mm_loadu_ps(samples + index + 4), scale);
+    // clamp first, out of range conversions do not saturate
+    low = _mm_min_ps(_mm_max_ps(low, lowest), highest);
+    high = _mm_min_ps(_mm_max_ps(high, lowest), highest);
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + index), packed);
+  }
+  FloatToInt16Scalar(samples + index, count - index, output + index);
+}
+
+float DotProduct(const float * a, const float * b, std::size_t count)
+{
+  __m128 first = _mm_setzero_ps();
+  __m128 second = _mm_setzero_ps();
+  std::size_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    first = _mm_add_ps(first, _mm_mul_ps(_mm_loadu_ps(a + index), _mm_loadu_ps(b + index)));
+    second =
+      _mm_add_ps(second, _mm_mul_ps(_mm_loadu_ps(a + index + 4), _mm_loadu_ps(b + index + 4)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(first, second));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         DotProductScalar(a + index, b + index, count - index);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+void DownmixToFloat(const uint8_t * data, std::size_t frame_count, const PcmFormat & format,
+                    float * output)
+{
+  std::size_t frame = 0;
+  if (16 == format.sample_bits && !format.big_endian && !format.is_float) {
+    auto samples = reinterpret_cast<const int16_t *>(data);
+    if (1 == format.channels) {
+      for (; frame + 8 <= frame_count; frame += 8) {
+        int16x8_t packed = vld1q_s16(samples + frame);
+        float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(packed)));
+        float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(packed)));
+        vst1q_f32(output + frame, vmulq_n_f32(low, kInt16Scale));
+        vst1q_f32(output + frame + 4, vmulq_n_f32(high, kInt16Scale));
+      }
+    } else if (2 == format.channels) {
+      for (; frame + 8 <= frame_count; frame += 8) {
+        // deinterleave left and right
+        int16x8x2_t channels = vld2q_s16(samples + 2 * frame);
+        int32x4_t low = vaddl_s16(vget_low_s16(channels.val[0]), vget_low_s16(channels.val[1]));
+        int32x4_t high =
+          vaddl_s16(vget_high_s16(channels.val[0]), vget_high_s16(channels.val[1]));
+        vst1q_f32(output + frame, vmulq_n_f32(vcvtq_f32_s32(low), kInt16Scale * 0.5f));
+        vst1q_f32(output + frame + 4, vmulq_n_f32(vcvtq_f32_s32(high), kInt16Scale * 0.5f));
+      }
+    }
+  } else if (format.is_float && !format.big_endian && 2 == format.channels) {
+    auto samples = reinterpret_cast<const float *>(data);
+    for (; frame + 4 <= frame_count; frame += 4) {
+      float32x4x2_t channels = vld2q_f32(samples + 2 * frame);
+      vst1q_f32(output + frame, vmulq_n_f32(vaddq_f32(channels.val[0], channels.val[1]), 0.5f));
+    }
+  }
+  DownmixToFloatScalar(data + frame * format.FrameBytes(), frame_count - frame, format,
+                       output + frame);
+}
+
+void FloatToInt16(const float * samples, std::size_t count, int16_t * output)
+{
+  std::size_t index = 0;
+  const float32x4_t lowest = vdupq_n_f32(-32768.0f);
+  const float32x4_t highest = vdupq_n_f32(32767.0f);
+#if !defined(__aarch64__)
+  const uint32x4_t sign_mask = vdupq_n_u32(0x80000000u);
+  const uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+#endif
+  for (; index + 4 <= count; index += 4) {
+    float32x4_t scaled = vmulq_n_f32(vld1q_f32(samples + index), 32768.0f);
+    scaled = vminq_f32(vmaxq_f32(scaled, lowest), highest);
+#if defined(__aarch64__)
+    // rounds half to even, like lrint and the sse2 conversion
+    int32x4_t rounded = vcvtnq_s32_f32(scaled);
+#else
+    // armv7 conversion only truncates, add half a step away from zero to round. Halves round away
+    // from zero here rather than to even, one step apart from the other kernels
+    float32x4_t offset =
+      vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(scaled), sign_mask), half));
+    int32x4_t rounded = vcvtq_s32_f32(vaddq_f32(scaled, offset));
+#endif
+    vst1_s16(output + index, vqmovn_s32(rounded));
+  }
+  FloatToInt16Scalar(samples + index, count - index, output + index);
+}
+
+float DotProduct(const float * a, const float * b, std::size_t count)
+{
+  float32x4_t first = vdupq_n_f32(0.0f);
+  float32x4_t second = vdupq_n_f32(0.0f);
+  std::size_t index = 0;
+  for (; index + 8 <= count; index += 8) {
+    first = vmlaq_f32(first, vld1q_f32(a + index), vld1q_f32(b + index));
+    second = vmlaq_f32(second, vld1q_f32(a + index + 4), vld1q_f32(b + index + 4));
+  }
+  float32x4_t sum = vaddq_f32(first, second);
+  float lanes[4];
+  vst1q_f32(lanes, sum);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         DotProductScalar(a + index, b + index, count - index);
+}
+
+#else
+
+void DownmixToFloat(const uint8_t * data, std::size_t frame_count, const PcmFormat & format,
+                    float * output)
+{
+  DownmixToFloatScalar(data, frame_count, format, output);
+}
+
+void FloatToInt16(const float * samples, std::size_t count, int16_t * output)
+{
+  FloatToInt16Scalar(samples, count, output);
+}
+
+float DotProduct(const float * a, const float * b, std::size_t count)
+{
+  return DotProductScalar(a, b, count);
+}
+
+#endif
+
+PolyphaseResampler::PolyphaseResampler(int input_rate, int output_rate, int zero_crossings)
+{
+  std::size_t divisor = input_rate;
+  std::size_t remainder = output_rate;
+  while (remainder) {
+    std::size_t next = divisor % remainder;
+    divisor = remainder;
+    remainder = next;
+  }
+  interpolation_ = output_rate / divisor;
+  decimation_ = input_rate / divisor;
+
+  // when decimating, the filter spans more input samples to keep its cutoff sharp
+  double stretch = std::max(1.0, static_cast<double>(decimation_) / interpolation_);
+  taps_ = static_cast<std::size_t>(std::ceil(2.0 * zero_crossings * stretch));
+  taps_ = (taps_ + 7) / 8 * 8;
+  std::size_t length = taps_ * interpolation_;
+  delay_ = length / 2;
+
+  double cutoff = kCutoffRatio * 0.5 / std::max(interpolation_, decimation_);
+  // centered on delay_, so the output is not shifted by a fraction of a sample
+  double center = static_cast<double>(delay_);
+  double window_norm = BesselI0(kKaiserBeta);
+  std::vector<double> filter(length);
+  for (std::size_t index = 0; index < length; index++) {
+    double x = index - center;
+    double sinc = 0.0 == x ? 1.0 : std::sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+    double position = x / center;
+    double window = BesselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - position * position))) /
+                    window_norm;
+    // interpolation spreads each input sample over interpolation_ outputs, restore the gain
+    filter[index] = 2.0 * cutoff * sinc * window * interpolation_;
+  }
+
+  coefficients_.resize(length);
+  for (std::size_t phase = 0; phase < interpolation_; phase++) {
+    for (std::size_t tap = 0; tap < taps_; tap++) {
+      coefficients_[phase * taps_ + tap] =
+        static_cast<float>(filter[phase + (taps_ - 1 - tap) * interpolation_]);
+    }
+  }
+}
+
+std::size_t PolyphaseResampler::OutputCount(std::size_t input_count) const
+{
+  return (input_count * interpolation_ + decimation_ - 1) / decimation_;
+}
+
+void PolyphaseResampler::Process(const float * input, std::size_t input_count,
+                                 float * output) const
+{
+  std::vector<float> window(taps_);
+  std::size_t output_count = OutputCount(input_count);
+  for (std::size_t index = 0; index < output_count; index++) {
+    std::size_t position = index * decimation_ + delay_;
+    const float * coefficients = coefficients_.data() + (position % interpolation_) * taps_;
+    // the branch runs over input samples [newest - taps_ + 1, newest]
+    std::ptrdiff_t first = static_cast<std::ptrdiff_t>(position / interpolation_) -
+                           static_cast<std::ptrdiff_t>(taps_) + 1;
+    if (first >= 0 && first + taps_ <= input_count) {
+      output[index] = DotProduct(coefficients, input + first, taps_);
+      continue;
+    }
+    // at the edges of the clip, read zeros outside of it
+    for (std::size_t tap = 0; tap < taps_; tap++) {
+      std::ptrdiff_t sample = first + static_cast<std::ptrdiff_t>(tap);
+      window[tap] = sample >= 0 && sample < static_cast<std::ptrdiff_t>(input_count)
+                      ? input[sample]
+                      : 0.0f;
+    }
+    output[index] = DotProduct(coefficients, window.data(), taps_);
+  }
+}
+
+bool AudioNormalizer::NeedsNormalization(const PcmFormat & format) const
+{
+  bool is_lex_format = 16 == format.sample_bits && !format.is_float && !format.big_endian &&
+                       1 == format.channels &&
+                       (8000 == format.sample_rate || 16000 == format.sample_rate);
+  return !is_lex_format;
+}
+
+PcmFormat AudioNormalizer::Normalize(const uint8_t * data, std::size_t size,
+                                     const PcmFormat & format, std::vector<uint8_t> & output)
+{
+  std::size_t frame_count = size / format.FrameBytes();
+  std::vector<float> mono(frame_count);
+  DownmixToFloat(data, frame_count, format, mono.data());
+
+  PcmFormat normalized;
+  normalized.sample_rate = configuration_.sample_rate;
+  std::vector<float> resampled;
+  const std::vector<float> * samples = &mono;
+  if (format.sample_rate != configuration_.sample_rate) {
+    auto resampler = GetResampler(format.sample_rate);
+    resampled.resize(resampler->OutputCount(frame_count));
+    resampler->Process(mono.data(), frame_count, resampled.data());
+    samples = &resampled;
+  }
+  output.resize(samples->size() * sizeof(int16_t));
+  FloatToInt16(samples->data(), samples->size(), reinterpret_cast<int16_t *>(output.data()));
+  return normalized;
+}
+
+std::shared_ptr<const PolyphaseResampler> AudioNormalizer::GetResampler(int input_rate)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto & resampler = resamplers_[input_rate];
+  if (!resampler) {
+    resampler = std::make_shared<PolyphaseResampler>(input_rate, configuration_.sample_rate);
+  }
+  return resampler;
+}
+
+}  // namespace Lex
+}  // namespace Aws
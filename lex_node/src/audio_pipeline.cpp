@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/core/utils/logging/LogMacros.h>
+#include <lex_node/audio_format.h>
+#include <lex_node/audio_pipeline.h>
+
+namespace Aws {
+namespace Lex {
+
+AudioPipeline::AudioPipeline(const VoiceActivityConfiguration & voice_activity_configuration,
+                             const OpusConfiguration & opus_configuration,
+                             const NormalizationConfiguration & normalization_configuration)
+: voice_activity_configuration_(voice_activity_configuration),
+  voice_activity_detector_(voice_activity_configuration)
+{
+  if (normalization_configuration.enabled) {
+    normalizer_.reset(new AudioNormalizer(normalization_configuration));
+  }
+  if (opus_configuration.enabled) {
+    if (OpusEncoderWorker::IsAvailable()) {
+      opus_encoder_.reset(new OpusEncoderWorker(opus_configuration));
+    } else {
+      AWS_LOG_WARN(__func__, "lex_node was built without opus, request audio is not encoded");
+    }
+  }
+}
+
+ProcessedAudio AudioPipeline::Process(const std::string & content_type,
+                                      const std::vector<uint8_t> & audio) const
+{
+  ProcessedAudio processed;
+  processed.data = audio.data();
+  processed.size = audio.size();
+  processed.content_type = content_type;
+
+  PcmFormat format;
+  if (!ParsePcmContentType(content_type, format)) {
+    return processed;
+  }
+  if (normalizer_ && normalizer_->NeedsNormalization(format)) {
+    processed.normalized = std::make_shared<std::vector<uint8_t>>();
+    format = normalizer_->Normalize(audio.data(), audio.size(), format, *processed.normalized);
+    processed.data = processed.normalized->data();
+    processed.size = processed.normalized->size();
+    processed.content_type = "audio/l16; rate=" + std::to_string(format.sample_rate) +
+                             "; channels=1";
+  }
+  if (16 != format.sample_bits || format.is_float || format.big_endian) {
+    return processed;
+  }
+  if (voice_activity_configuration_.enabled) {
+    auto samples = reinterpret_cast<const int16_t *>(processed.data);
+    std::size_t size = processed.size;
+    auto span = voice_activity_detector_.FindSpeech(samples, size / sizeof(int16_t),
+                                                    format.channels, format.sample_rate);
+    if (span.has_speech) {
+      processed.data += span.begin * sizeof(int16_t);
+      processed.size = (span.end - span.begin) * sizeof(int16_t);
+      processed.trimmed_bytes = size - processed.size;
+      processed.trimmed_ms = 1000.0 * processed.trimmed_bytes /
+                             (static_cast<double>(format.FrameBytes()) * format.sample_rate);
+    }
+  }
+  if (opus_encoder_ && 1 == format.channels &&
+      OpusEncoderWorker::IsSupportedRate(format.sample_rate) && processed.size > 0) {
+    processed.encode_job =
+      opus_encoder_->Start(reinterpret_cast<const int16_t *>(processed.data),
+                           processed.size / sizeof(int16_t), format.sample_rate);
+    processed.content_type = processed.encode_job->ContentType();
+  }
+  return processed;
+}
+
+}  // namespace Lex
+}  // namespace Aws
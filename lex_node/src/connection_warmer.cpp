@@ -0,0 +1,208 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/core/http/HttpResponse.h>
+#include <aws/core/utils/logging/LogMacros.h>
+#include <aws/lex/model/GetSessionRequest.h>
+#include <lex_node/connection_warmer.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+const char * GetNameForConnectionState(ConnectionState state)
+{
+  switch (state) {
+    case ConnectionState::kCold:
+      return "cold";
+    case ConnectionState::kWarming:
+      return "warming";
+    case ConnectionState::kWarm:
+      return "warm";
+  }
+  return "unknown";
+}
+
+ConnectionWarmer::ConnectionWarmer(
+  const ConnectionConfiguration & configuration, const LexConfiguration & lex_configuration,
+  std::shared_ptr<const Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client)
+: configuration_(configuration),
+  lex_configuration_(lex_configuration),
+  lex_runtime_client_(std::move(lex_runtime_client))
+{
+}
+
+ConnectionWarmer::~ConnectionWarmer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  wake_up_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ConnectionWarmer::Start()
+{
+  if (!thread_.joinable()) {
+    thread_ = std::thread([this]() { Run(); });
+  }
+}
+
+void ConnectionWarmer::RecordActivity()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto now = Clock::now();
+  if (ConnectionState::kCold == StateLocked(now) && Clock::time_point() != last_activity_) {
+    AWS_LOGSTREAM_INFO(__func__, "Lex called on cold connections, "
+                                   << std::chrono::duration<double>(now - last_activity_).count()
+                                   << " s after the previous call");
+  }
+  last_activity_ = now;
+}
+
+bool ConnectionWarmer::WaitUntilWarm(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  wake_up_.wait_for(lock, timeout, [this]() { return has_warmed_up_ || is_stopping_; });
+  return ConnectionState::kWarm == StateLocked(Clock::now());
+}
+
+ConnectionWarmer::Stats ConnectionWarmer::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.state = StateLocked(Clock::now());
+  return stats;
+}
+
+ConnectionState ConnectionWarmer::StateLocked(Clock::time_point now) const
+{
+  if (is_warming_) {
+    return ConnectionState::kWarming;
+  }
+  auto idle_timeout = std::chrono::duration<double>(configuration_.idle_timeout_s);
+  if (Clock::time_point() != last_activity_ && now - last_activity_ < idle_timeout) {
+    return ConnectionState::kWarm;
+  }
+  return ConnectionState::kCold;
+}
+
+void ConnectionWarmer::Run()
+{
+  CallRound(true);
+  if (configuration_.keepalive_interval_s <= 0.0) {
+    return;
+  }
+  auto keepalive_interval = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(configuration_.keepalive_interval_s));
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!is_stopping_) {
+    bool has_activity = Clock::time_point() != last_activity_;
+    // retry after an interval when the warm up failed
+    auto due = (has_activity ? last_activity_ : Clock::now()) + keepalive_interval;
+    if (wake_up_.wait_until(lock, due, [this]() { return is_stopping_; })) {
+      break;
+    }
+    auto now = Clock::now();
+    if (has_activity && now < last_activity_ + keepalive_interval) {
+      // lex was called in the meantime, the connections are in use
+      continue;
+    }
+    bool is_cold = ConnectionState::kCold == StateLocked(now);
+    lock.unlock();
+    CallRound(is_cold);
+    lock.lock();
+  }
+}
+
+void ConnectionWarmer::CallRound(bool is_cold)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_warming_ = is_cold;
+  }
+  // concurrent calls cannot share a connection, each one opens or keeps its own
+  std::vector<double> durations(std::max(1, configuration_.connections));
+  std::vector<std::thread> threads;
+  for (std::size_t index = 1; index < durations.size(); index++) {
+    threads.emplace_back([this, &durations, index]() { durations[index] = TimedCall(); });
+  }
+  durations[0] = TimedCall();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  double slowest_call_ms = *std::max_element(durations.begin(), durations.end());
+  // the connections are open now, a call on one of them shows what opening it cost
+  double warm_call_ms = is_cold ? TimedCall() : slowest_call_ms;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_warming_ = false;
+  auto failures = static_cast<std::size_t>(std::count_if(
+    durations.begin(), durations.end(), [](double duration) { return duration < 0.0; }));
+  stats_.failures += failures;
+  if (failures < durations.size()) {
+    last_activity_ = Clock::now();
+  }
+  if (failures > 0) {
+    AWS_LOGSTREAM_WARN(__func__, failures << " of " << durations.size()
+                                          << " lex warm up calls got no reply");
+  }
+  if (is_cold) {
+    stats_.warm_ups++;
+    stats_.cold_call_ms = slowest_call_ms;
+    if (warm_call_ms >= 0.0 && slowest_call_ms >= 0.0) {
+      stats_.warm_call_ms = warm_call_ms;
+      stats_.handshake_ms = std::max(0.0, slowest_call_ms - warm_call_ms);
+    }
+    const char * state = GetNameForConnectionState(StateLocked(Clock::now()));
+    AWS_LOGSTREAM_INFO(__func__, "Lex connections " << state << ", "
+                                 << durations.size() - failures << " opened: cold call "
+                                 << stats_.cold_call_ms << " ms, warm call "
+                                 << stats_.warm_call_ms << " ms, handshake "
+                                 << stats_.handshake_ms << " ms");
+    has_warmed_up_ = true;
+    wake_up_.notify_all();
+  } else {
+    stats_.keepalives++;
+    if (warm_call_ms >= 0.0) {
+      stats_.warm_call_ms = warm_call_ms;
+    }
+  }
+}
+
+double ConnectionWarmer::TimedCall() const
+{
+  Aws::LexRuntimeService::Model::GetSessionRequest request;
+  request.WithBotName(lex_configuration_.bot_name.c_str())
+    .WithBotAlias(lex_configuration_.bot_alias.c_str())
+    .WithUserId(lex_configuration_.user_id.c_str());
+  auto start = Clock::now();
+  auto outcome = lex_runtime_client_->GetSession(request);
+  double duration_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  // a user without a session gets a not found error, the connection is open all the same
+  if (outcome.IsSuccess() ||
+      Aws::Http::HttpResponseCode::REQUEST_NOT_MADE != outcome.GetError().GetResponseCode()) {
+    return duration_ms;
+  }
+  return -1.0;
+}
+
+}  // namespace Lex
+}  // namespace Aws
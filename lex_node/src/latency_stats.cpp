@@ -0,0 +1,244 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/latency_stats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+constexpr std::size_t kStageCount = static_cast<std::size_t>(LatencyStage::kCount);
+
+/**
+ * First and last mark of each stage.
+ */
+constexpr StageMark kStageMarks[kStageCount][2] = {
+  {StageMark::kStart, StageMark::kCallStarted},
+  {StageMark::kCallStarted, StageMark::kUploadComplete},
+  {StageMark::kUploadComplete, StageMark::kFirstBytesReceived},
+  {StageMark::kFirstBytesReceived, StageMark::kCallReturned},
+  {StageMark::kCallReturned, StageMark::kDecoded},
+  {StageMark::kStart, StageMark::kDecoded},
+};
+
+/**
+ * @return the index of the highest bit set, value must not be zero
+ */
+int HighestBit(uint64_t value) { return 63 - __builtin_clzll(value); }
+
+}  // namespace
+
+const char * GetLatencyStageName(LatencyStage stage)
+{
+  switch (stage) {
+    case LatencyStage::kBuild:
+      return "build";
+    case LatencyStage::kUpload:
+      return "upload";
+    case LatencyStage::kLex:
+      return "lex";
+    case LatencyStage::kDownload:
+      return "download";
+    case LatencyStage::kDecode:
+      return "decode";
+    case LatencyStage::kTotal:
+    case LatencyStage::kCount:
+      break;
+  }
+  return "total";
+}
+
+bool StageTimer::GetStageMicros(LatencyStage stage, uint64_t & micros) const
+{
+  auto first = kStageMarks[static_cast<std::size_t>(stage)][0];
+  auto last = kStageMarks[static_cast<std::size_t>(stage)][1];
+  if (!IsMarked(first) || !IsMarked(last)) {
+    return false;
+  }
+  auto elapsed = marks_[static_cast<std::size_t>(last)] - marks_[static_cast<std::size_t>(first)];
+  micros = std::max<int64_t>(
+    0, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+  return true;
+}
+
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kMaxBits;
+constexpr std::size_t LatencyHistogram::kBucketCount;
+
+void LatencyHistogram::Load(Counts & counts) const
+{
+  for (std::size_t bucket = 0; bucket < kBucketCount; bucket++) {
+    counts[bucket] = buckets_[bucket].load(std::memory_order_relaxed);
+  }
+}
+
+std::size_t LatencyHistogram::GetBucket(uint64_t micros)
+{
+  constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+  micros = std::min<uint64_t>(micros, (uint64_t(1) << kMaxBits) - 1);
+  if (micros < kSubBuckets) {
+    return micros;
+  }
+  // the highest bit picks the power of two, the bits below it the linear bucket
+  int shift = HighestBit(micros) - kSubBucketBits;
+  return ((shift + 1) << kSubBucketBits) + ((micros >> shift) & (kSubBuckets - 1));
+}
+
+double LatencyHistogram::GetBucketValue(std::size_t bucket)
+{
+  constexpr std::size_t kSubBuckets = 1 << kSubBucketBits;
+  if (bucket < 2 * kSubBuckets) {
+    return bucket;
+  }
+  int shift = static_cast<int>(bucket >> kSubBucketBits) - 1;
+  double lower = static_cast<double>((kSubBuckets + (bucket & (kSubBuckets - 1))) << shift);
+  return lower + static_cast<double>(uint64_t(1) << shift) / 2;
+}
+
+double LatencyHistogram::GetPercentile(const Counts & counts, double percentile)
+{
+  uint64_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  if (0 == total) {
+    return 0.0;
+  }
+  auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100 * total)));
+  uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket < kBucketCount; bucket++) {
+    seen += counts[bucket];
+    if (seen >= rank) {
+      return GetBucketValue(bucket);
+    }
+  }
+  return GetBucketValue(kBucketCount - 1);
+}
+
+struct LatencyStats::Series
+{
+  std::string bot_name;
+  std::string intent_name;
+  std::array<LatencyHistogram, kStageCount> histograms;
+  /**
+   * Counts at the previous collection, only used by Collect().
+   */
+  std::array<LatencyHistogram::Counts, kStageCount> collected{};
+};
+
+constexpr std::size_t LatencyStats::kMaxSeries;
+
+LatencyStats::LatencyStats() {}
+
+LatencyStats::~LatencyStats()
+{
+  for (auto & series : series_) {
+    delete series.load();
+  }
+}
+
+void LatencyStats::Record(const std::string & bot_name, const std::string & intent_name,
+                          const StageTimer & timer)
+{
+  Series * bot_series = FindSeries(bot_name, std::string());
+  Series * intent_series = intent_name.empty() ? nullptr : FindSeries(bot_name, intent_name);
+  for (std::size_t stage = 0; stage < kStageCount; stage++) {
+    uint64_t micros = 0;
+    if (!timer.GetStageMicros(static_cast<LatencyStage>(stage), micros)) {
+      continue;
+    }
+    if (bot_series) {
+      bot_series->histograms[stage].Record(micros);
+    }
+    if (intent_series) {
+      intent_series->histograms[stage].Record(micros);
+    }
+  }
+}
+
+std::vector<StageLatencySummary> LatencyStats::Collect()
+{
+  std::vector<Series *> all_series;
+  for (auto & slot : series_) {
+    Series * series = slot.load(std::memory_order_acquire);
+    if (series) {
+      all_series.push_back(series);
+    }
+  }
+  std::sort(all_series.begin(), all_series.end(), [](const Series * a, const Series * b) {
+    return a->bot_name != b->bot_name ? a->bot_name < b->bot_name
+                                      : a->intent_name < b->intent_name;
+  });
+  std::vector<StageLatencySummary> summaries;
+  LatencyHistogram::Counts counts;
+  for (auto * series : all_series) {
+    for (std::size_t stage = 0; stage < kStageCount; stage++) {
+      series->histograms[stage].Load(counts);
+      // only the calls since the previous collection
+      uint64_t total = 0;
+      for (std::size_t bucket = 0; bucket < counts.size(); bucket++) {
+        uint64_t count = counts[bucket];
+        counts[bucket] -= series->collected[stage][bucket];
+        series->collected[stage][bucket] = count;
+        total += counts[bucket];
+      }
+      if (0 == total) {
+        continue;
+      }
+      StageLatencySummary summary;
+      summary.bot_name = series->bot_name;
+      summary.intent_name = series->intent_name;
+      summary.stage = static_cast<LatencyStage>(stage);
+      summary.count = total;
+      summary.p50_ms = LatencyHistogram::GetPercentile(counts, 50) / 1000;
+      summary.p90_ms = LatencyHistogram::GetPercentile(counts, 90) / 1000;
+      summary.p99_ms = LatencyHistogram::GetPercentile(counts, 99) / 1000;
+      summaries.push_back(std::move(summary));
+    }
+  }
+  return summaries;
+}
+
+LatencyStats::Series * LatencyStats::FindSeries(const std::string & bot_name,
+                                                const std::string & intent_name)
+{
+  std::size_t hash = std::hash<std::string>()(bot_name) * 31 + std::hash<std::string>()(intent_name);
+  for (std::size_t probe = 0; probe < kMaxSeries; probe++) {
+    auto & slot = series_[(hash + probe) % kMaxSeries];
+    Series * series = slot.load(std::memory_order_acquire);
+    if (!series) {
+      // first call of the pair, publish its series unless another thread did
+      Series * added = new Series();
+      added->bot_name = bot_name;
+      added->intent_name = intent_name;
+      if (slot.compare_exchange_strong(series, added, std::memory_order_acq_rel)) {
+        return added;
+      }
+      delete added;
+    }
+    if (series->bot_name == bot_name && series->intent_name == intent_name) {
+      return series;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_common_msgs/AudioTextConversation.h>
+#include <lex_node/load_generator.h>
+#include <ros/ros.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Replay the text and audio corpora against the lex_conversation service and print the report.
+ *
+ * Private parameters: service, text_corpus, audio_corpus, accept_type, concurrency, rate_per_s,
+ * duration_s, warmup_s and expected_interval_ms.
+ *
+ * @param argc
+ * @param argv
+ * @return
+ */
+int main(int argc, char * argv[])
+{
+  ros::init(argc, argv, "lex_load_generator", ros::init_options::AnonymousName);
+  ros::NodeHandle private_handle("~");
+
+  std::string service = private_handle.param<std::string>("service", "/lex_node/lex_conversation");
+  std::string text_corpus = private_handle.param<std::string>("text_corpus", "");
+  std::string audio_corpus = private_handle.param<std::string>("audio_corpus", "");
+  std::string accept_type = private_handle.param<std::string>("accept_type", "audio/pcm");
+  Aws::Lex::LoadGeneratorConfiguration configuration;
+  configuration.concurrency = private_handle.param("concurrency", configuration.concurrency);
+  configuration.rate_per_s = private_handle.param("rate_per_s", configuration.rate_per_s);
+  configuration.duration_s = private_handle.param("duration_s", configuration.duration_s);
+  configuration.warmup_s = private_handle.param("warmup_s", configuration.warmup_s);
+  configuration.expected_interval_ms =
+    private_handle.param("expected_interval_ms", configuration.expected_interval_ms);
+
+  std::vector<Aws::Lex::LoadTurn> turns;
+  if (!text_corpus.empty() && !Aws::Lex::LoadTextCorpus(text_corpus, turns)) {
+    ROS_ERROR("Cannot read the text corpus %s", text_corpus.c_str());
+    return 1;
+  }
+  if (!audio_corpus.empty() && !Aws::Lex::LoadAudioCorpus(audio_corpus, accept_type, turns)) {
+    ROS_ERROR("Cannot read the audio corpus %s", audio_corpus.c_str());
+    return 1;
+  }
+  if (turns.empty()) {
+    ROS_ERROR("No turns to replay, set ~text_corpus or ~audio_corpus");
+    return 1;
+  }
+  if (!ros::service::waitForService(service, ros::Duration(10))) {
+    ROS_ERROR("Service %s is not available", service.c_str());
+    return 1;
+  }
+
+  // a persistent connection per caller, as a client of the node would keep
+  ros::NodeHandle node_handle;
+  std::vector<ros::ServiceClient> clients;
+  for (int caller = 0; caller < configuration.concurrency; caller++) {
+    clients.push_back(
+      node_handle.serviceClient<lex_common_msgs::AudioTextConversation>(service, true));
+  }
+  auto call = [&](int caller, const Aws::Lex::LoadTurn & turn) -> std::string {
+    auto & client = clients[caller];
+    if (!client.isValid()) {
+      client = node_handle.serviceClient<lex_common_msgs::AudioTextConversation>(service, true);
+    }
+    lex_common_msgs::AudioTextConversation conversation;
+    conversation.request.content_type = turn.content_type;
+    conversation.request.accept_type = turn.accept_type;
+    conversation.request.text_request = turn.text_request;
+    conversation.request.audio_request.data = turn.audio_request;
+    if (!client.call(conversation)) {
+      return client.isValid() ? "call_failed" : "disconnected";
+    }
+    if ("Failed" == conversation.response.dialog_state) {
+      return "dialog_failed";
+    }
+    return std::string();
+  };
+
+  std::string mode =
+    configuration.rate_per_s > 0
+      ? "open loop at " + std::to_string(configuration.rate_per_s) + " calls/s"
+      : "closed loop at concurrency " + std::to_string(configuration.concurrency);
+  ROS_INFO("Replaying %zu turns for %.1f s after a %.1f s warmup, %s", turns.size(),
+           configuration.duration_s, configuration.warmup_s, mode.c_str());
+  Aws::Lex::LoadGenerator load_generator(configuration, std::move(turns), call);
+  std::cout << Aws::Lex::FormatLoadReport(load_generator.Run());
+  return 0;
+}
@@ -14,6 +14,10 @@
  */
 
 #include <aws/core/Aws.h>
+#include <aws/core/AmazonWebServiceRequest.h>
+#include <aws/core/auth/AWSCredentialsProviderChain.h>
+#include <aws/core/http/HttpRequest.h>
+#include <aws/core/http/HttpResponse.h>
 #include <aws/core/utils/HashingUtils.h>
 #include <aws/core/utils/Outcome.h>
 #include <aws/core/utils/json/JsonSerializer.h>
@@ -25,32 +29,29 @@
 #include <aws/lex/model/PostTextResult.h>
 #include <aws_common/sdk_utils/client_configuration_provider.h>
 #include <aws_ros1_common/sdk_utils/ros1_node_parameter_reader.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <lex_common_msgs/KeyValue.h>
+#include <lex_common_msgs/LexLatencyStats.h>
 #include <lex_node/lex_node.h>
+#include <lex_node/opus_encoding.h>
+#include <lex_node/request_body_stream.h>
+#include <lex_node/request_trace.h>
+#include <lex_node/response_audio_stream.h>
+#include <lex_node/slot_decoder.h>
+
+#include <boost/make_shared.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
-#include <iterator>
+#include <mutex>
 #include <regex>
+#include <unordered_map>
 
 namespace Aws {
 namespace Lex {
 
-std::ostream & operator<<(std::ostream & os,
-                          const Aws::LexRuntimeService::Model::PostContentRequest & request)
-{
-  os << "Request: " << std::endl;
-  os << "Bot Alias: " << request.GetBotAlias() << std::endl;
-  os << "Bot Name : " << request.GetBotName() << std::endl;
-  std::stringstream ss;
-  ss << request.GetBody()->rdbuf();
-  os << "Input data: " << ss.str() << std::endl;
-  os << "User Id: " << request.GetUserId() << std::endl;
-  os << "Accept Type: " << request.GetAccept() << std::endl;
-  os << "Content Type: " << request.GetContentType() << std::endl;
-  return os;
-}
-
 std::ostream & operator<<(std::ostream & os,
                           const Aws::LexRuntimeService::Model::PostContentResult & result)
 {
@@ -69,6 +70,213 @@ std::ostream & operator<<(std::ostream & os,
   return os;
 }
 
+/**
+ * Decode the slots of a PostContent result, a base64 encoded json object, without building a json
+ * document: unfilled slots are empty and non string values keep their json text.
+ *
+ * @param encoded_slots header value lex replied with
+ * @param slots [out] slot names and values, emptied when the slots cannot be parsed
+ * @return false if the slots cannot be parsed
+ */
+bool DecodeSlots(const Aws::String & encoded_slots, std::vector<lex_common_msgs::KeyValue> & slots)
+{
+  if (!DecodeSlots(encoded_slots.data(), encoded_slots.size(), slots)) {
+    AWS_LOGSTREAM_WARN(__func__, "Unable to parse slot string " << encoded_slots);
+    // a pooled response holds the emptied slots of its previous reply
+    slots.clear();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Encode session attributes as the base64 encoded json object PostContent sends them in.
+ *
+ * @param attributes to encode
+ * @return the header value
+ */
+std::string EncodeSessionAttributes(const std::map<std::string, std::string> & attributes)
+{
+  Aws::Utils::Json::JsonValue attributes_json;
+  for (const auto & attribute : attributes) {
+    attributes_json.WithString(attribute.first.c_str(), attribute.second.c_str());
+  }
+  auto attributes_string = attributes_json.WriteCompact();
+  Aws::Utils::ByteBuffer attributes_buffer(
+    reinterpret_cast<const unsigned char *>(attributes_string.data()), attributes_string.size());
+  return Aws::Utils::HashingUtils::Base64Encode(attributes_buffer).c_str();
+}
+
+/**
+ * Decode the session attributes of a PostContent result, a base64 encoded json object.
+ *
+ * @param encoded_attributes header value lex replied with
+ * @param attributes [out] attribute names and values
+ * @return false if the attributes cannot be parsed
+ */
+bool DecodeSessionAttributes(const Aws::String & encoded_attributes,
+                             std::map<std::string, std::string> & attributes)
+{
+  auto views = DecodeSlotViews(encoded_attributes.data(), encoded_attributes.size());
+  if (!views) {
+    AWS_LOGSTREAM_WARN(__func__, "Unable to parse session attributes " << encoded_attributes);
+    return false;
+  }
+  for (const auto & view : *views) {
+    attributes[std::string(view.key, view.key_size)].assign(view.value, view.value_size);
+  }
+  return true;
+}
+
+/**
+ * Apply the session attributes of a request over the attributes of its session.
+ *
+ * @param request setting attributes, an empty value removes its attribute
+ * @param session_attributes of the session, null if it has none
+ * @param is_encoded true to have the attributes encoded for PostContent
+ * @return the attributes to send, those of the session when the request changes none
+ */
+template <typename Request>
+std::shared_ptr<const SessionAttributes> MergeSessionAttributes(
+  const Request & request, std::shared_ptr<const SessionAttributes> session_attributes,
+  bool is_encoded)
+{
+  std::shared_ptr<SessionAttributes> merged;
+  if (!request.session_attributes.empty()) {
+    merged = session_attributes ? std::make_shared<SessionAttributes>(*session_attributes)
+                                : std::make_shared<SessionAttributes>();
+    for (const auto & attribute : request.session_attributes) {
+      if (attribute.value.empty()) {
+        merged->attributes.erase(attribute.key);
+      } else {
+        merged->attributes[attribute.key] = attribute.value;
+      }
+    }
+  } else if (is_encoded && session_attributes && session_attributes->encoded.empty() &&
+             !session_attributes->attributes.empty()) {
+    // received from PostText, encoded once for the PostContent turns that follow
+    merged = std::make_shared<SessionAttributes>(*session_attributes);
+  } else {
+    return session_attributes;
+  }
+  merged->encoded = is_encoded && !merged->attributes.empty()
+                      ? EncodeSessionAttributes(merged->attributes)
+                      : std::string();
+  return merged;
+}
+
+/**
+ * Take the session attributes of a PostContent reply. Attributes lex replies with unchanged are
+ * not decoded again.
+ *
+ * @param encoded_attributes header value lex replied with, empty when the session has none
+ * @param sent attributes sent with the call, null if none were
+ * @return the attributes of the session after the call, null if it has none
+ */
+std::shared_ptr<const SessionAttributes> ReceiveSessionAttributes(
+  const Aws::String & encoded_attributes, std::shared_ptr<const SessionAttributes> sent)
+{
+  if (encoded_attributes.empty()) {
+    return nullptr;
+  }
+  if (sent && sent->encoded == encoded_attributes.c_str()) {
+    return sent;
+  }
+  auto received = std::make_shared<SessionAttributes>();
+  if (!DecodeSessionAttributes(encoded_attributes, received->attributes)) {
+    return sent;
+  }
+  received->encoded = encoded_attributes.c_str();
+  return received;
+}
+
+/**
+ * Take the session attributes of a PostText reply, keeping those sent when lex replies with them
+ * unchanged.
+ *
+ * @param attributes lex replied with
+ * @param sent attributes sent with the call, null if none were
+ * @return the attributes of the session after the call, null if it has none
+ */
+std::shared_ptr<const SessionAttributes> ReceiveSessionAttributes(
+  const Aws::Map<Aws::String, Aws::String> & attributes,
+  std::shared_ptr<const SessionAttributes> sent)
+{
+  if (attributes.empty()) {
+    return nullptr;
+  }
+  if (sent && sent->attributes.size() == attributes.size() &&
+      std::equal(attributes.begin(), attributes.end(), sent->attributes.begin(),
+                 [](const std::pair<const Aws::String, Aws::String> & received,
+                    const std::pair<const std::string, std::string> & kept) {
+                   return kept.first == received.first.c_str() &&
+                          kept.second == received.second.c_str();
+                 })) {
+    return sent;
+  }
+  auto received = std::make_shared<SessionAttributes>();
+  for (const auto & attribute : attributes) {
+    received->attributes.emplace(attribute.first.c_str(), attribute.second.c_str());
+  }
+  return received;
+}
+
+/**
+ * Copy session attributes into an AudioTextConversionResponse or a LexConversationResult.
+ *
+ * @param session_attributes to copy, null if the session has none
+ * @param response [out] attributes copy
+ */
+template <typename Response>
+void CopySessionAttributes(const std::shared_ptr<const SessionAttributes> & session_attributes,
+                           Response & response)
+{
+  response.session_attributes.clear();
+  if (!session_attributes) {
+    return;
+  }
+  response.session_attributes.resize(session_attributes->attributes.size());
+  auto attribute_it = response.session_attributes.begin();
+  for (const auto & attribute : session_attributes->attributes) {
+    attribute_it->key = attribute.first;
+    attribute_it->value = attribute.second;
+    attribute_it++;
+  }
+}
+
+/**
+ * Copy a result into an AudioTextConversionResponse or a LexConversationResult.
+ *
+ * @param result to copy to the response
+ * @param response [out] result copy
+ * @return error code
+ */
+template <typename Response>
+int CopyResult(Aws::LexRuntimeService::Model::PostContentResult & result, Response & response)
+{
+  using Aws::LexRuntimeService::Model::MessageFormatTypeMapper::GetNameForMessageFormatType;
+  response.message_format_type = GetNameForMessageFormatType(result.GetMessageFormat()).c_str();
+  response.text_response = result.GetMessage().c_str();
+
+  auto * audio_buffer = dynamic_cast<ResponseAudioBuffer *>(result.GetAudioStream().rdbuf());
+  if (audio_buffer) {
+    // the body was received by PostContent's response stream, take its bytes as they are
+    audio_buffer->MoveTo(response.audio_response.data);
+  } else {
+    std::streampos audio_size = result.GetAudioStream().seekg(0, std::ios_base::end).tellg();
+    response.audio_response.data = std::vector<uint8_t>(audio_size);
+    result.GetAudioStream().seekg(0, std::ios_base::beg);
+    result.GetAudioStream().read(reinterpret_cast<char *>(&response.audio_response.data[0]),
+                                 audio_size);
+  }
+
+  response.intent_name = result.GetIntentName().c_str();
+  using Aws::LexRuntimeService::Model::DialogStateMapper::GetNameForDialogState;
+  response.dialog_state = GetNameForDialogState(result.GetDialogState()).c_str();
+  DecodeSlots(result.GetSlots(), response.slots);
+  return 0;
+}
+
 /**
  * Copy a result into an AudioTextConversionResponse.
  *
@@ -78,76 +286,531 @@ std::ostream & operator<<(std::ostream & os,
  */
 int CopyResult(Aws::LexRuntimeService::Model::PostContentResult & result,
                lex_common_msgs::AudioTextConversationResponse & response)
+{
+  return CopyResult<lex_common_msgs::AudioTextConversationResponse>(result, response);
+}
+
+/**
+ * Copy a PostText result into an AudioTextConversionResponse or a LexConversationResult. PostText
+ * returns the slots already structured and no audio.
+ *
+ * @param result to copy to the response
+ * @param response [out] result copy
+ * @return error code
+ */
+template <typename Response>
+int CopyResult(const Aws::LexRuntimeService::Model::PostTextResult & result, Response & response)
 {
   using Aws::LexRuntimeService::Model::MessageFormatTypeMapper::GetNameForMessageFormatType;
   response.message_format_type = GetNameForMessageFormatType(result.GetMessageFormat()).c_str();
   response.text_response = result.GetMessage().c_str();
-
-  std::streampos audio_size = result.GetAudioStream().seekg(0, std::ios_base::end).tellg();
-  response.audio_response.data = std::vector<uint8_t>(audio_size);
-  result.GetAudioStream().seekg(0, std::ios_base::beg);
-  result.GetAudioStream().read(reinterpret_cast<char *>(&response.audio_response.data[0]),
-                               audio_size);
-
+  response.audio_response.data.clear();
   response.intent_name = result.GetIntentName().c_str();
   using Aws::LexRuntimeService::Model::DialogStateMapper::GetNameForDialogState;
   response.dialog_state = GetNameForDialogState(result.GetDialogState()).c_str();
-  std::string session_attributes = result.GetSessionAttributes().c_str();
-  auto slot_byte_buffer = Aws::Utils::HashingUtils::Base64Decode(result.GetSlots().c_str());
-  Aws::String slot_string(reinterpret_cast<char *>(slot_byte_buffer.GetUnderlyingData()),
-                          slot_byte_buffer.GetLength());
-  auto slot_json = Aws::Utils::Json::JsonValue(slot_string);
-  if (slot_json.WasParseSuccessful()) {
-    AWS_LOGSTREAM_DEBUG(__func__, "slot_json: " << slot_string);
-
-    auto view = slot_json.GetAllObjects();
-    response.slots = std::vector<lex_common_msgs::KeyValue>(view.size());
-    auto response_it = response.slots.begin();
-    for (auto & element : view) {
-      response_it->key = element.first.c_str();
-      response_it->value = element.second.AsString().c_str();
-      response_it++;
+  response.slots.resize(result.GetSlots().size());
+  std::size_t index = 0;
+  for (auto & slot : result.GetSlots()) {
+    response.slots[index].key.assign(slot.first.data(), slot.first.size());
+    response.slots[index].value.assign(slot.second.data(), slot.second.size());
+    index++;
+  }
+  return 0;
+}
+
+/**
+ * Reports the progress of a lex call to its monitor and cancels the call when the monitor asks to.
+ * Must outlive the lex runtime client call it is attached to.
+ */
+class CallStageReporter
+{
+public:
+  /**
+   * @param monitor to report to
+   * @param body_length number of request body bytes to send before the upload is complete
+   */
+  CallStageReporter(const ConversationMonitor & monitor, long long body_length)
+  : monitor_(monitor), body_length_(body_length)
+  {
+  }
+
+  /**
+   * Install the cancellation and progress handlers on a lex request and report the call started.
+   */
+  void Attach(Aws::AmazonWebServiceRequest & request)
+  {
+    if (monitor_.is_cancelled) {
+      request.SetContinueRequestHandler(
+        [this](const Aws::Http::HttpRequest *) { return !monitor_.is_cancelled(); });
+    }
+    request.SetDataReceivedEventHandler(
+      [this](const Aws::Http::HttpRequest *, Aws::Http::HttpResponse *, long long) {
+        OnDataReceived();
+      });
+    if (monitor_.on_stage || monitor_.stage_timer) {
+      request.SetDataSentEventHandler([this](const Aws::Http::HttpRequest *, long long length) {
+        bytes_sent_ += length;
+        if (!upload_reported_ && bytes_sent_ >= body_length_) {
+          upload_reported_ = true;
+          monitor_.Mark(StageMark::kUploadComplete);
+          if (monitor_.on_stage) {
+            monitor_.on_stage(ConversationStage::kUploadComplete);
+          }
+        }
+      });
+    }
+    monitor_.Mark(StageMark::kCallStarted);
+    if (monitor_.on_stage) {
+      monitor_.on_stage(ConversationStage::kCallStarted);
+    }
+  }
+
+  /**
+   * Report the first response bytes, once.
+   */
+  void OnDataReceived()
+  {
+    if (!first_bytes_reported_) {
+      first_bytes_reported_ = true;
+      monitor_.Mark(StageMark::kFirstBytesReceived);
+      if (monitor_.on_stage) {
+        monitor_.on_stage(ConversationStage::kFirstBytesReceived);
+      }
     }
+  }
+
+private:
+  const ConversationMonitor & monitor_;
+  long long body_length_;
+  long long bytes_sent_ = 0;
+  bool upload_reported_ = false;
+  bool first_bytes_reported_ = false;
+};
+
+/**
+ * @return true if the request only carries text and expects a text reply, so it can be sent with
+ *         PostText instead of PostContent
+ */
+template <typename Request>
+bool IsTextOnly(const Request & request)
+{
+  return request.audio_request.data.empty() && !request.text_request.empty() &&
+         0 == request.content_type.compare(0, 5, "text/") &&
+         0 == request.accept_type.compare(0, 5, "text/");
+}
+
+/**
+ * @return true if the request is a text turn the response cache may answer
+ */
+template <typename Request>
+bool IsTextTurn(const Request & request)
+{
+  return request.audio_request.data.empty() && !request.text_request.empty();
+}
+
+/**
+ * Log the trace of a lex call at debug level and sample its payload. The trace is only formatted
+ * when debug logging is enabled.
+ *
+ * @param function logging the trace
+ * @param request the call is built from
+ * @param lex_configuration of the bot and user called
+ * @param content_type of the uploaded body
+ * @param body_size of the uploaded body
+ * @param payload_sampler appending payloads to a side file, null to not sample
+ */
+template <typename Request>
+void TraceRequest(const char * function, const Request & request,
+                  const LexConfiguration & lex_configuration, const char * content_type,
+                  long long body_size, PayloadSampler * payload_sampler)
+{
+  RequestTrace trace;
+  trace.bot_name = lex_configuration.bot_name.c_str();
+  trace.bot_alias = lex_configuration.bot_alias.c_str();
+  trace.user_id = lex_configuration.user_id.c_str();
+  trace.content_type = content_type;
+  trace.accept_type = request.accept_type.c_str();
+  if (request.audio_request.data.empty()) {
+    trace.payload = reinterpret_cast<const uint8_t *>(request.text_request.data());
+    trace.payload_size = request.text_request.size();
   } else {
-    AWS_LOGSTREAM_WARN(__func__, "Unable to parse slot string " << slot_string);
+    trace.payload = request.audio_request.data.data();
+    trace.payload_size = request.audio_request.data.size();
   }
-  return 0;
+  trace.body_size = body_size;
+  AWS_LOGSTREAM_DEBUG(function, "Request " << trace);
+  if (payload_sampler) {
+    payload_sampler->Sample(trace);
+  }
+}
+
+/**
+ * Copy a cached reply into an AudioTextConversionResponse or a LexConversationResult.
+ *
+ * @param cached reply to copy
+ * @param response [out] reply copy
+ */
+template <typename Response>
+void CopyCachedResponse(const CachedResponse & cached, Response & response)
+{
+  response.text_response = cached.text_response;
+  response.message_format_type = cached.message_format_type;
+  response.intent_name = cached.intent_name;
+  response.dialog_state = cached.dialog_state;
+  response.audio_response.data = cached.audio_response;
+  response.slots.resize(cached.slots.size());
+  for (std::size_t index = 0; index < cached.slots.size(); index++) {
+    response.slots[index].key = cached.slots[index].first;
+    response.slots[index].value = cached.slots[index].second;
+  }
+}
+
+/**
+ * Answer a text turn from the response cache.
+ *
+ * @param request to answer
+ * @param response [out] filled with the cached reply on a hit
+ * @param lex_configuration bot of the turn
+ * @param session_attributes of the session, left to it by a cached reply
+ * @param is_dialog_open true if the session waits for a slot value or a confirmation
+ * @param response_cache to look the reply up in, null when caching is disabled
+ * @param cache_key [out] key of the turn, left empty when the cache does not apply to it
+ * @return true if the response was filled from the cache
+ */
+template <typename Request, typename Response>
+bool AnswerFromCache(const Request & request, Response & response,
+                     const LexConfiguration & lex_configuration,
+                     const std::shared_ptr<const SessionAttributes> & session_attributes,
+                     bool is_dialog_open, ResponseCache * response_cache, std::string & cache_key)
+{
+  // attributes set by the request or stored for the session have to reach lex, a bot may branch
+  // on them
+  if (!response_cache || !IsTextTurn(request) || !request.session_attributes.empty() ||
+      (session_attributes && !session_attributes->attributes.empty())) {
+    return false;
+  }
+  cache_key = MakeResponseCacheKey(lex_configuration.bot_name, lex_configuration.bot_alias,
+                                   request.text_request, request.accept_type);
+  auto cached = response_cache->Lookup(cache_key, is_dialog_open);
+  if (!cached) {
+    return false;
+  }
+  CopyCachedResponse(*cached, response);
+  CopySessionAttributes(session_attributes, response);
+  AWS_LOGSTREAM_DEBUG(__func__, "Answered \"" << request.text_request << "\" from the cache");
+  return true;
+}
+
+/**
+ * Store a lex reply in the response cache when it answers a cacheable text turn.
+ *
+ * @param response lex reply
+ * @param has_session_attributes true if lex replied with session attributes
+ * @param response_cache to update, null when caching is disabled
+ * @param cache_key key of the turn, empty when the cache does not apply to it
+ */
+template <typename Response>
+void UpdateCache(const Response & response, bool has_session_attributes,
+                 ResponseCache * response_cache, const std::string & cache_key)
+{
+  if (!response_cache || cache_key.empty()) {
+    return;
+  }
+  CachedResponse cached;
+  cached.text_response = response.text_response;
+  cached.message_format_type = response.message_format_type;
+  cached.intent_name = response.intent_name;
+  cached.dialog_state = response.dialog_state;
+  cached.audio_response = response.audio_response.data;
+  cached.slots.reserve(response.slots.size());
+  for (auto & slot : response.slots) {
+    cached.slots.emplace_back(slot.key, slot.value);
+  }
+  response_cache->Insert(cache_key, std::move(cached), has_session_attributes);
+}
+
+/**
+ * Find the audio of a lex reply in the prompt audio cache from the reply headers, before its body
+ * is received.
+ *
+ * @param http_response lex reply, its headers received
+ * @param accept_type audio format asked for
+ * @param lex_configuration bot of the call
+ * @param prompt_audio_cache to look the prompt up in, null when caching is disabled
+ * @return the audio of the prompt, null if it is not cached
+ */
+std::shared_ptr<const PromptAudio> LookupPromptAudio(const Aws::Http::HttpResponse * http_response,
+                                                     const std::string & accept_type,
+                                                     const LexConfiguration & lex_configuration,
+                                                     PromptAudioCache * prompt_audio_cache)
+{
+  if (!prompt_audio_cache || !http_response ||
+      Aws::Http::HttpResponseCode::OK != http_response->GetResponseCode() ||
+      !http_response->HasHeader("x-amz-lex-message") ||
+      !http_response->HasHeader("x-amz-lex-message-format")) {
+    return nullptr;
+  }
+  return prompt_audio_cache->Lookup(MakePromptAudioKey(
+    lex_configuration.bot_name, lex_configuration.bot_alias,
+    http_response->GetHeader("x-amz-lex-message").c_str(),
+    http_response->GetHeader("x-amz-lex-message-format").c_str(), accept_type));
+}
+
+/**
+ * Post text to lex given a text only conversation request and respond to it. Lex replies with
+ * json, sparing the base64 slot header and the audio stream of PostContent.
+ *
+ * @param request to populate the lex call with, an AudioTextConversationRequest or a
+ *        LexConversationGoal
+ * @param response to fill with data received by lex
+ * @param lex_configuration to specify bot, and response type
+ * @param lex_runtime_client to call lex with
+ * @param monitor observing and cancelling the call
+ * @param session_attributes of the session, in, and after the call, out
+ * @param is_dialog_open true if the previous turn left the session waiting for a slot value or a
+ *        confirmation, see IsDialogOpen()
+ * @param response_cache answering repeated commands, null to always call lex
+ * @param request_hedger sending a duplicate call when lex is slow, null to never hedge
+ * @param payload_sampler appending request payloads to a side file, null to not sample
+ * @return true if the call succeeded, false otherwise
+ */
+template <typename Request, typename Response>
+bool PostText(const Request & request, Response & response,
+              const LexConfiguration & lex_configuration,
+              std::shared_ptr<const LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client,
+              const ConversationMonitor & monitor,
+              std::shared_ptr<const SessionAttributes> & session_attributes,
+              bool is_dialog_open, ResponseCache * response_cache,
+              RequestHedger * request_hedger, PayloadSampler * payload_sampler)
+{
+  std::string cache_key;
+  if (AnswerFromCache(request, response, lex_configuration, session_attributes, is_dialog_open,
+                      response_cache, cache_key)) {
+    return true;
+  }
+  auto sent_attributes = MergeSessionAttributes(request, session_attributes, false);
+  auto make_post_text_request = [&lex_configuration, &request, &sent_attributes]() {
+    Aws::LexRuntimeService::Model::PostTextRequest post_text_request;
+    post_text_request.WithBotAlias(lex_configuration.bot_alias.c_str())
+      .WithBotName(lex_configuration.bot_name.c_str())
+      .WithUserId(lex_configuration.user_id.c_str())
+      .WithInputText(request.text_request.c_str());
+    if (sent_attributes) {
+      for (const auto & attribute : sent_attributes->attributes) {
+        post_text_request.AddSessionAttributes(attribute.first.c_str(), attribute.second.c_str());
+      }
+    }
+    return post_text_request;
+  };
+  auto post_text_request = make_post_text_request();
+
+  // the json body is a little larger than the text, report the upload once the text is sent
+  CallStageReporter stage_reporter(monitor, request.text_request.size());
+  stage_reporter.Attach(post_text_request);
+
+  TraceRequest(__func__, request, lex_configuration, request.content_type.c_str(),
+               static_cast<long long>(request.text_request.size()), payload_sampler);
+  Aws::LexRuntimeService::Model::PostTextOutcome post_text_result;
+  bool is_hedge_used = false;
+  std::string text_key;
+  if (request_hedger) {
+    text_key = MakeResponseCacheKey(lex_configuration.bot_name, lex_configuration.bot_alias,
+                                    request.text_request, request.accept_type);
+  }
+  if (request_hedger && request_hedger->IsHedgeable(text_key, is_dialog_open)) {
+    using Outcome = Aws::LexRuntimeService::Model::PostTextOutcome;
+    // the duplicate may outlive this call, it owns its request and has no stage handlers. Lex
+    // rejects a second call to a session with one in flight, it goes to a session of its own
+    auto hedge_request =
+      std::make_shared<Aws::LexRuntimeService::Model::PostTextRequest>(make_post_text_request());
+    hedge_request->SetUserId((lex_configuration.user_id + kHedgeUserIdSuffix).c_str());
+    post_text_result = request_hedger->Call<Outcome>(
+      [&](const std::function<bool()> & is_hedge_won) {
+        post_text_request.SetContinueRequestHandler(
+          [&monitor, is_hedge_won](const Aws::Http::HttpRequest *) {
+            return !is_hedge_won() && !(monitor.is_cancelled && monitor.is_cancelled());
+          });
+        return lex_runtime_client->PostText(post_text_request);
+      },
+      [lex_runtime_client, hedge_request](const std::function<bool()> & is_cancelled) {
+        hedge_request->SetContinueRequestHandler(
+          [is_cancelled](const Aws::Http::HttpRequest *) { return !is_cancelled(); });
+        return lex_runtime_client->PostText(*hedge_request);
+      },
+      monitor.is_cancelled, &is_hedge_used);
+  } else {
+    post_text_result = lex_runtime_client->PostText(post_text_request);
+  }
+  monitor.Mark(StageMark::kCallReturned);
+  if (!post_text_result.IsSuccess()) {
+    AWS_LOGSTREAM_ERROR(__func__,
+                        "PostTextResult failed: " << post_text_result.GetError().GetMessage());
+    return false;
+  }
+  auto & result = post_text_result.GetResult();
+  AWS_LOGSTREAM_DEBUG(__func__, "PostTextResult succeeded: " << result.GetMessage());
+  CopyResult(result, response);
+  if (is_hedge_used) {
+    // the attributes of the hedge session are not those of the session, which may not have seen
+    // the turn. The sent ones are kept and sent again with the next turn
+    session_attributes = sent_attributes;
+  } else {
+    session_attributes = ReceiveSessionAttributes(result.GetSessionAttributes(), sent_attributes);
+  }
+  CopySessionAttributes(session_attributes, response);
+  UpdateCache(response, !result.GetSessionAttributes().empty(), response_cache, cache_key);
+  if (request_hedger) {
+    request_hedger->RecordIntent(text_key, response.intent_name,
+                                 IsDialogOpen(response.dialog_state));
+  }
+  monitor.Mark(StageMark::kDecoded);
+  return true;
 }
 
 /**
  * Post content to lex given an audio text conversation request and respond to it.
- * Configures the call with the lex configuration and lex_runtime_client.
+ * Configures the call with the lex configuration and lex_runtime_client. Text only requests
+ * expecting a text reply are sent with PostText.
  *
- * @param request to populate the lex call with
+ * @param request to populate the lex call with, an AudioTextConversationRequest or a
+ *        LexConversationGoal
  * @param response to fill with data received by lex
  * @param lex_configuration to specify bot, and response type
  * @param lex_runtime_client to call lex with
+ * @param monitor observing and cancelling the call
+ * @param session_attributes of the session, in, and after the call, out
+ * @param is_dialog_open true if the previous turn left the session waiting for a slot value or a
+ *        confirmation, see IsDialogOpen()
+ * @param audio_pipeline preparing the request audio, null to upload it as it is
+ * @param audio_buffer_pool to receive the response audio in, null to allocate the buffer
+ * @param response_cache answering repeated text commands, null to always call lex
+ * @param prompt_audio_cache keeping the audio of repeated prompts, null to keep the audio lex sends
+ * @param request_hedger sending a duplicate call for slow text only turns, null to never hedge
+ * @param payload_sampler appending request payloads to a side file, null to not sample
  * @return true if the call succeeded, false otherwise
  */
+template <typename Request, typename Response>
 bool PostContent(
-  lex_common_msgs::AudioTextConversationRequest & request,
-  lex_common_msgs::AudioTextConversationResponse & response,
-  const LexConfiguration & lex_configuration,
-  std::shared_ptr<const LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client)
+  const Request & request, Response & response, const LexConfiguration & lex_configuration,
+  std::shared_ptr<const LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client,
+  const ConversationMonitor & monitor,
+  std::shared_ptr<const SessionAttributes> & session_attributes, bool is_dialog_open,
+  const AudioPipeline * audio_pipeline, AudioBufferPool * audio_buffer_pool,
+  ResponseCache * response_cache, PromptAudioCache * prompt_audio_cache,
+  RequestHedger * request_hedger, PayloadSampler * payload_sampler)
 {
+  monitor.Mark(StageMark::kStart);
+  if (IsTextOnly(request)) {
+    return PostText(request, response, lex_configuration, lex_runtime_client, monitor,
+                    session_attributes, is_dialog_open, response_cache, request_hedger,
+                    payload_sampler);
+  }
+  std::string cache_key;
+  if (AnswerFromCache(request, response, lex_configuration, session_attributes, is_dialog_open,
+                      response_cache, cache_key)) {
+    return true;
+  }
   Aws::LexRuntimeService::Model::PostContentRequest post_content_request;
   post_content_request.WithBotAlias(lex_configuration.bot_alias.c_str())
     .WithBotName(lex_configuration.bot_name.c_str())
     .WithAccept(request.accept_type.c_str())
     .WithUserId(lex_configuration.user_id.c_str());
+  // unchanged attributes are sent as the header lex last replied with
+  auto sent_attributes = MergeSessionAttributes(request, session_attributes, true);
+  if (sent_attributes && !sent_attributes->encoded.empty()) {
+    post_content_request.SetSessionAttributes(sent_attributes->encoded.c_str());
+  }
 
-  post_content_request.SetContentType(request.content_type.c_str());
-  auto io_stream = Aws::MakeShared<Aws::StringStream>(kAllocationTag);
-
+  // the body reads the request in place, the request outlives the lex runtime client call below
+  std::shared_ptr<Aws::IOStream> body;
+  long long body_length = 0;
+  ProcessedAudio audio;
+  // the encoder reads the request audio, it has to be done with it when PostContent returns
+  struct EncodeJobGuard
+  {
+    std::shared_ptr<OpusEncodeJob> & job;
+    ~EncodeJobGuard()
+    {
+      if (job) {
+        job->Cancel();
+      }
+    }
+  } encode_job_guard{audio.encode_job};
   if (!request.audio_request.data.empty()) {
-    std::copy(request.audio_request.data.begin(), request.audio_request.data.end(),
-              std::ostream_iterator<unsigned char>(*io_stream));
+    if (audio_pipeline) {
+      audio = audio_pipeline->Process(request.content_type, request.audio_request.data);
+      if (audio.trimmed_bytes > 0) {
+        AWS_LOGSTREAM_INFO(__func__, "Trimmed " << audio.trimmed_bytes << " bytes, "
+                                                << audio.trimmed_ms
+                                                << " ms of silence from the request audio");
+      }
+    } else {
+      audio.data = request.audio_request.data.data();
+      audio.size = request.audio_request.data.size();
+      audio.content_type = request.content_type;
+    }
+    post_content_request.SetContentType(audio.content_type.c_str());
+    if (audio.encode_job) {
+      body = Aws::MakeShared<OpusEncodedStream>(kAllocationTag, audio.encode_job);
+      body_length = audio.encode_job->EncodedSize();
+    } else {
+      body = Aws::MakeShared<RequestBodyStream>(kAllocationTag, audio.data, audio.size);
+      body_length = audio.size;
+    }
   } else {
-    *io_stream << request.text_request;
+    post_content_request.SetContentType(request.content_type.c_str());
+    body = Aws::MakeShared<RequestBodyStream>(kAllocationTag, request.text_request);
+    body_length = request.text_request.size();
   }
-  post_content_request.SetBody(io_stream);
-  AWS_LOGSTREAM_DEBUG(__func__, "PostContentRequest " << post_content_request);
+  post_content_request.SetBody(body);
+
+  // the factory and the handlers only run inside the lex runtime client call below, they may
+  // refer to locals
+  // each attempt of the sdk gets a stream of its own, a retry's may reuse the address of the last
+  ResponseAudioBuffer * audio_buffer = nullptr;
+  int attempt = 0;
+  post_content_request.SetResponseStreamFactory([&audio_buffer, &attempt, audio_buffer_pool]() {
+    auto audio_stream = Aws::New<ResponseAudioStream>(kAllocationTag, audio_buffer_pool);
+    audio_buffer = &audio_stream->GetBuffer();
+    attempt++;
+    return audio_stream;
+  });
+  CallStageReporter stage_reporter(monitor, body_length);
+  stage_reporter.Attach(post_content_request);
+  int reserved_attempt = 0;
+  std::shared_ptr<const PromptAudio> prompt_audio;
+  bool is_audio_reply = 0 == request.accept_type.compare(0, 6, "audio/");
+  post_content_request.SetDataReceivedEventHandler(
+    [&](const Aws::Http::HttpRequest *, Aws::Http::HttpResponse * http_response, long long) {
+      if (attempt != reserved_attempt) {
+        // size the buffer of each attempt once, the body length is known from its headers
+        reserved_attempt = attempt;
+        prompt_audio = is_audio_reply ? LookupPromptAudio(http_response, request.accept_type,
+                                                          lex_configuration, prompt_audio_cache)
+                                      : nullptr;
+        if (prompt_audio) {
+          // the rest of the body is still read, keeping the connection reusable
+          audio_buffer->Discard();
+        } else if (http_response && http_response->HasHeader("content-length")) {
+          audio_buffer->Reserve(
+            std::strtoull(http_response->GetHeader("content-length").c_str(), nullptr, 10));
+        }
+      }
+      stage_reporter.OnDataReceived();
+    });
+
+  TraceRequest(__func__, request, lex_configuration, post_content_request.GetContentType().c_str(),
+               body_length, payload_sampler);
   auto post_content_result = lex_runtime_client->PostContent(post_content_request);
+  monitor.Mark(StageMark::kCallReturned);
+  if (audio.encode_job && audio.encode_job->Succeeded()) {
+    AWS_LOGSTREAM_INFO(__func__, "Encoded " << audio.encode_job->PcmSize() << " bytes of pcm to "
+                                            << audio.encode_job->EncodedSize()
+                                            << " bytes of opus, ratio "
+                                            << static_cast<double>(audio.encode_job->PcmSize()) /
+                                                 audio.encode_job->EncodedSize()
+                                            << ", in " << audio.encode_job->EncodeMs() << " ms");
+  }
   bool is_valid = true;
   if (post_content_result.IsSuccess()) {
     auto & result = post_content_result.GetResult();
@@ -157,6 +820,23 @@ bool PostContent(
     // if (error_code) {
     //    is_valid = false;
     // }
+    session_attributes = ReceiveSessionAttributes(result.GetSessionAttributes(), sent_attributes);
+    CopySessionAttributes(session_attributes, response);
+    if (prompt_audio) {
+      AWS_LOGSTREAM_DEBUG(__func__, "Prompt audio of \"" << response.text_response
+                                                         << "\" read from the cache");
+      response.audio_response.data.assign(prompt_audio->Data(),
+                                          prompt_audio->Data() + prompt_audio->Size());
+    } else if (prompt_audio_cache && is_audio_reply && !response.text_response.empty() &&
+               !response.audio_response.data.empty()) {
+      prompt_audio_cache->Insert(
+        MakePromptAudioKey(lex_configuration.bot_name, lex_configuration.bot_alias,
+                           response.text_response, response.message_format_type,
+                           request.accept_type),
+        response.audio_response.data.data(), response.audio_response.data.size());
+    }
+    UpdateCache(response, !result.GetSessionAttributes().empty(), response_cache, cache_key);
+    monitor.Mark(StageMark::kDecoded);
   } else {
     is_valid = false;
     AWS_LOGSTREAM_ERROR(
@@ -165,6 +845,145 @@ bool PostContent(
   return is_valid;
 }
 
+/**
+ * Post content to lex given an audio text conversation request and respond to it.
+ * Configures the call with the lex configuration and lex_runtime_client.
+ *
+ * @param request to populate the lex call with
+ * @param response to fill with data received by lex
+ * @param lex_configuration to specify bot, and response type
+ * @param lex_runtime_client to call lex with
+ * @return true if the call succeeded, false otherwise
+ */
+bool PostContent(
+  lex_common_msgs::AudioTextConversationRequest & request,
+  lex_common_msgs::AudioTextConversationResponse & response,
+  const LexConfiguration & lex_configuration,
+  std::shared_ptr<const LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client)
+{
+  std::shared_ptr<const SessionAttributes> session_attributes;
+  return PostContent(request, response, lex_configuration, lex_runtime_client,
+                     ConversationMonitor(), session_attributes, false, nullptr, nullptr,
+                     nullptr, nullptr, nullptr, nullptr);
+}
+
+/**
+ * Runs a function from a ros callback queue.
+ */
+class ConversationTask : public ros::CallbackInterface
+{
+public:
+  explicit ConversationTask(std::function<void()> task) : task_(std::move(task)) {}
+
+  CallResult call() override
+  {
+    task_();
+    return Success;
+  }
+
+private:
+  std::function<void()> task_;
+};
+
+/**
+ * Why an action goal stopped waiting for lex.
+ */
+enum GoalCancelReason : int
+{
+  kNotCancelled = 0,
+  kCancelRequested,
+  kSuperseded,
+};
+
+/**
+ * Cancellation flags of the conversation goals that have not finished yet.
+ */
+struct LexNode::PendingGoals
+{
+  std::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<std::atomic<int>>> latest_by_session;
+  std::unordered_map<std::string, std::shared_ptr<std::atomic<int>>> by_goal_id;
+};
+
+/**
+ * A bot the node serves, with its own lex runtime client and connection pool.
+ */
+struct LexNode::Bot
+{
+  LexConfiguration lex_configuration;
+  std::shared_ptr<Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client;
+
+  /**
+   * Keeps the connections of the client open, null when warming up is disabled.
+   */
+  std::shared_ptr<ConnectionWarmer> connection_warmer;
+
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> errors{0};
+
+  /**
+   * Errors at the previous publication, only used by PublishLatencyStats().
+   */
+  uint64_t published_errors = 0;
+
+  /**
+   * Count a call and keep its connections warm.
+   */
+  void RecordCall(bool success)
+  {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    if (!success) {
+      errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (connection_warmer) {
+      connection_warmer->RecordActivity();
+    }
+  }
+};
+
+namespace {
+
+/**
+ * @return a client configuration sized for a bot's connections
+ */
+Client::ClientConfiguration MakeBotClientConfiguration(
+  Client::ClientConfiguration client_configuration, const LexConfiguration & lex_configuration,
+  const ConnectionConfiguration & connection_configuration)
+{
+  if (lex_configuration.max_connections > 0) {
+    client_configuration.maxConnections = lex_configuration.max_connections;
+  }
+  if (connection_configuration.warm_up) {
+    // the pool must hold the connections kept open
+    client_configuration.maxConnections =
+      std::max(client_configuration.maxConnections,
+               static_cast<unsigned>(connection_configuration.connections));
+  }
+  return client_configuration;
+}
+
+/**
+ * Select the lex session of a request.
+ *
+ * @param lex_configuration of the bot called
+ * @param user_id of the request, empty for the user id of the bot
+ * @param user_configuration [out] storage for the configuration of another user
+ * @return the configuration of the bot, or a copy with the user id of the request
+ */
+const LexConfiguration & SelectUser(const LexConfiguration & lex_configuration,
+                                    const std::string & user_id,
+                                    LexConfiguration & user_configuration)
+{
+  if (user_id.empty() || user_id == lex_configuration.user_id) {
+    return lex_configuration;
+  }
+  user_configuration = lex_configuration;
+  user_configuration.user_id = user_id;
+  return user_configuration;
+}
+
+}  // namespace
+
 LexNode BuildLexNode(std::shared_ptr<Client::ParameterReaderInterface> params)
 {
   LexNode lex_node;
@@ -172,39 +991,555 @@ LexNode BuildLexNode(std::shared_ptr<Client::ParameterReaderInterface> params)
     params = std::make_shared<Client::Ros1NodeParameterReader>();
   }
   auto lex_configuration = LoadLexParameters(*params);
+  lex_node.ConfigureDispatch(LoadDispatchParameters(*params));
+  lex_node.ConfigureBufferPool(LoadBufferPoolParameters(*params));
+  lex_node.ConfigureResponseCache(LoadResponseCacheParameters(*params));
+  lex_node.ConfigurePromptAudioCache(LoadPromptAudioCacheParameters(*params));
+  lex_node.ConfigureHedging(LoadHedgingParameters(*params));
+  lex_node.ConfigureTrace(LoadTraceParameters(*params));
+  lex_node.ConfigureLatencyStats(LoadLatencyStatsParameters(*params));
+  lex_node.ConfigureAudioPipeline(std::make_shared<AudioPipeline>(
+    LoadVoiceActivityParameters(*params), LoadOpusParameters(*params),
+    LoadNormalizationParameters(*params)));
+  auto connection_configuration = LoadConnectionParameters(*params);
+  lex_node.ConfigureConnection(connection_configuration);
   Client::ClientConfigurationProvider configuration_provider(params);
+  auto client_configuration = configuration_provider.GetClientConfiguration();
+  // the bots share the sdk and the credentials, each client has its own connection pool
+  auto credentials_provider =
+    Aws::MakeShared<Aws::Auth::DefaultAWSCredentialsProviderChain>(kAllocationTag);
   auto lex_runtime_client = Aws::MakeShared<Aws::LexRuntimeService::LexRuntimeServiceClient>(
-    kAllocationTag, configuration_provider.GetClientConfiguration());
+    kAllocationTag, credentials_provider,
+    MakeBotClientConfiguration(client_configuration, lex_configuration, connection_configuration));
   lex_node.ConfigureAwsLex(lex_configuration, lex_runtime_client);
+  for (const auto & bot_profile : LoadBotProfiles(*params, lex_configuration)) {
+    lex_node.ConfigureBotProfile(
+      bot_profile, Aws::MakeShared<Aws::LexRuntimeService::LexRuntimeServiceClient>(
+                     kAllocationTag, credentials_provider,
+                     MakeBotClientConfiguration(client_configuration,
+                                                bot_profile.lex_configuration,
+                                                connection_configuration)));
+  }
   lex_node.Init();
   return lex_node;
 }
 
-LexNode::LexNode() : node_handle_("~") {}
+LexNode::LexNode()
+: node_handle_("~"),
+  session_serializer_(std::make_shared<SessionSerializer>()),
+  pending_goals_(std::make_shared<PendingGoals>())
+{
+}
 
 void LexNode::Init()
 {
-  lex_server_ =
-    node_handle_.advertiseService<>("lex_conversation", &LexNode::LexServerCallback, this);
+  ros::NodeHandle dispatch_handle(node_handle_);
+  if (dispatch_configuration_.threads > 0) {
+    dispatch_queue_ = std::make_shared<ros::CallbackQueue>();
+    dispatch_handle.setCallbackQueue(dispatch_queue_.get());
+  } else {
+    goal_queue_ = std::make_shared<ros::CallbackQueue>();
+  }
+  lex_server_ = AdvertiseLexService(dispatch_handle);
+  conversation_server_ = std::make_shared<LexConversationServer>(
+    node_handle_, "lex_conversation_action",
+    [this](LexConversationServer::GoalHandle goal_handle) { ConversationGoalCallback(goal_handle); },
+    [this](LexConversationServer::GoalHandle goal_handle) {
+      ConversationCancelCallback(goal_handle);
+    },
+    false);
+  conversation_server_->start();
+  if (dispatch_queue_) {
+    AWS_LOGSTREAM_INFO(__func__, "Serving lex requests with " << dispatch_configuration_.threads
+                                                              << " dispatch threads");
+    dispatch_spinner_ =
+      std::make_shared<ros::AsyncSpinner>(dispatch_configuration_.threads, dispatch_queue_.get());
+    dispatch_spinner_->start();
+  } else {
+    AWS_LOG_INFO(__func__, "Serving conversation goals from a dedicated thread");
+    goal_spinner_ = std::make_shared<ros::AsyncSpinner>(1, goal_queue_.get());
+    goal_spinner_->start();
+  }
+  for (auto & named_bot : bots_) {
+    auto & bot = *named_bot.second;
+    if (connection_configuration_.warm_up && bot.lex_runtime_client && !bot.connection_warmer) {
+      bot.connection_warmer = std::make_shared<ConnectionWarmer>(
+        connection_configuration_, bot.lex_configuration, bot.lex_runtime_client);
+      bot.connection_warmer->Start();
+    }
+  }
+  if (latency_stats_) {
+    diagnostics_publisher_ =
+      node_handle_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    latency_stats_publisher_ =
+      node_handle_.advertise<lex_common_msgs::LexLatencyStats>("lex_latency_stats", 1);
+    latency_stats_timer_ = node_handle_.createWallTimer(
+      ros::WallDuration(latency_stats_configuration_.publish_interval_s),
+      [this](const ros::WallTimerEvent &) { PublishLatencyStats(); });
+  }
+}
+
+ros::ServiceServer LexNode::AdvertiseLexService(ros::NodeHandle & node_handle)
+{
+  using Request = lex_common_msgs::AudioTextConversationRequest;
+  using Response = lex_common_msgs::AudioTextConversationResponse;
+  ros::AdvertiseServiceOptions options;
+  boost::function<bool(Request &, Response &)> callback = [this](Request & request,
+                                                                 Response & response) {
+    return LexServerCallback(request, response);
+  };
+  options.init<Request, Response>("lex_conversation", callback);
+  if (buffer_pool_configuration_.enabled) {
+    auto audio_buffer_pool = std::make_shared<AudioBufferPool>(
+      buffer_pool_configuration_.max_buffer_bytes, buffer_pool_configuration_.buffers_per_size);
+    size_t max_buffer_bytes = buffer_pool_configuration_.max_buffer_bytes;
+    // requests keep their audio capacity, ros deserializes the next request into it
+    request_pool_ = std::make_shared<MessagePool<Request>>(
+      buffer_pool_configuration_.messages, [max_buffer_bytes](Request & request) {
+        request.content_type.clear();
+        request.accept_type.clear();
+        request.text_request.clear();
+        request.audio_request.data.clear();
+        request.bot.clear();
+        request.user_id.clear();
+        request.session_attributes.clear();
+        if (request.audio_request.data.capacity() > max_buffer_bytes) {
+          std::vector<uint8_t>().swap(request.audio_request.data);
+        }
+      });
+    // responses give their audio back to the pool the next response is received into
+    response_pool_ = std::make_shared<MessagePool<Response>>(
+      buffer_pool_configuration_.messages, [audio_buffer_pool](Response & response) {
+        response.text_response.clear();
+        audio_buffer_pool->Release(std::move(response.audio_response.data));
+        response.audio_response.data.clear();
+        ClearSlots(response.slots);
+        response.intent_name.clear();
+        response.message_format_type.clear();
+        response.dialog_state.clear();
+        response.session_attributes.clear();
+      });
+    audio_buffer_pool_ = audio_buffer_pool;
+    auto request_pool = request_pool_;
+    auto response_pool = response_pool_;
+    options.helper =
+      boost::make_shared<ros::ServiceCallbackHelperT<ros::ServiceSpec<Request, Response>>>(
+        callback, [request_pool]() { return request_pool->Acquire(); },
+        [response_pool]() { return response_pool->Acquire(); });
+  }
+  return node_handle.advertiseService(options);
+}
+
+void LexNode::ConfigureBufferPool(const BufferPoolConfiguration & buffer_pool_configuration)
+{
+  buffer_pool_configuration_ = buffer_pool_configuration;
+}
+
+void LexNode::ConfigureResponseCache(
+  const ResponseCacheConfiguration & response_cache_configuration)
+{
+  response_cache_ = response_cache_configuration.enabled
+                      ? std::make_shared<ResponseCache>(response_cache_configuration)
+                      : nullptr;
+}
+
+ResponseCache::Stats LexNode::GetResponseCacheStats() const
+{
+  return response_cache_ ? response_cache_->GetStats() : ResponseCache::Stats();
+}
+
+void LexNode::ConfigurePromptAudioCache(
+  const PromptAudioCacheConfiguration & prompt_audio_cache_configuration)
+{
+  prompt_audio_cache_ = nullptr;
+  if (prompt_audio_cache_configuration.enabled) {
+    auto prompt_audio_cache = std::make_shared<PromptAudioCache>(prompt_audio_cache_configuration);
+    if (prompt_audio_cache->IsOpen()) {
+      prompt_audio_cache_ = prompt_audio_cache;
+    }
+  }
+}
+
+PromptAudioCache::Stats LexNode::GetPromptAudioCacheStats() const
+{
+  return prompt_audio_cache_ ? prompt_audio_cache_->GetStats() : PromptAudioCache::Stats();
+}
+
+void LexNode::ConfigureConnection(const ConnectionConfiguration & connection_configuration)
+{
+  connection_configuration_ = connection_configuration;
+}
+
+ConnectionWarmer::Stats LexNode::GetConnectionStats() const
+{
+  auto bot = FindBot(std::string());
+  return bot && bot->connection_warmer ? bot->connection_warmer->GetStats()
+                                       : ConnectionWarmer::Stats();
+}
+
+void LexNode::ConfigureHedging(const HedgingConfiguration & hedging_configuration)
+{
+  request_hedger_ = hedging_configuration.enabled
+                      ? std::make_shared<RequestHedger>(hedging_configuration)
+                      : nullptr;
+}
+
+RequestHedger::Stats LexNode::GetHedgingStats() const
+{
+  return request_hedger_ ? request_hedger_->GetStats() : RequestHedger::Stats();
+}
+
+void LexNode::ConfigureTrace(const TraceConfiguration & trace_configuration)
+{
+  payload_sampler_ = trace_configuration.sample_payloads
+                       ? std::make_shared<PayloadSampler>(trace_configuration)
+                       : nullptr;
+}
+
+PayloadSampler::Stats LexNode::GetTraceStats() const
+{
+  return payload_sampler_ ? payload_sampler_->GetStats() : PayloadSampler::Stats();
+}
+
+void LexNode::ConfigureLatencyStats(
+  const LatencyStatsConfiguration & latency_stats_configuration)
+{
+  latency_stats_configuration_ = latency_stats_configuration;
+  latency_stats_ =
+    latency_stats_configuration.enabled ? std::make_shared<LatencyStats>() : nullptr;
+}
+
+std::vector<StageLatencySummary> LexNode::CollectLatencyStats()
+{
+  return latency_stats_ ? latency_stats_->Collect() : std::vector<StageLatencySummary>();
+}
+
+void LexNode::RecordLatency(const StageTimer & stage_timer, const Bot & bot,
+                            const std::string & intent_name)
+{
+  if (latency_stats_ && stage_timer.IsMarked(StageMark::kDecoded)) {
+    latency_stats_->Record(bot.lex_configuration.bot_name, intent_name, stage_timer);
+  }
+}
+
+void LexNode::PublishLatencyStats()
+{
+  auto summaries = latency_stats_->Collect();
+  lex_common_msgs::LexLatencyStats stats;
+  stats.header.stamp = ros::Time::now();
+  diagnostic_msgs::DiagnosticArray diagnostics;
+  diagnostics.header.stamp = stats.header.stamp;
+  for (const auto & summary : summaries) {
+    lex_common_msgs::StageLatency latency;
+    latency.bot_name = summary.bot_name;
+    latency.intent_name = summary.intent_name;
+    latency.stage = GetLatencyStageName(summary.stage);
+    latency.count = summary.count;
+    latency.p50_ms = summary.p50_ms;
+    latency.p90_ms = summary.p90_ms;
+    latency.p99_ms = summary.p99_ms;
+    stats.latencies.push_back(latency);
+
+    // one status per bot and per intent, the stages are sorted after their series' first stage
+    std::string name = "lex_node: " + summary.bot_name +
+                       (summary.intent_name.empty() ? "" : "/" + summary.intent_name);
+    if (diagnostics.status.empty() || diagnostics.status.back().name != name) {
+      diagnostic_msgs::DiagnosticStatus status;
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.name = name;
+      status.hardware_id = summary.bot_name;
+      status.message = "Lex call stage latencies";
+      diagnostics.status.push_back(status);
+    }
+    auto & values = diagnostics.status.back().values;
+    for (const auto & percentile : {std::make_pair("p50", summary.p50_ms),
+                                    std::make_pair("p90", summary.p90_ms),
+                                    std::make_pair("p99", summary.p99_ms)}) {
+      diagnostic_msgs::KeyValue value;
+      value.key = latency.stage + " " + percentile.first + " ms";
+      value.value = std::to_string(percentile.second);
+      values.push_back(value);
+    }
+    if (LatencyStage::kTotal == summary.stage) {
+      diagnostic_msgs::KeyValue calls;
+      calls.key = "calls";
+      calls.value = std::to_string(summary.count);
+      values.push_back(calls);
+    }
+  }
+  // the failed calls of each bot, on its status
+  bool has_errors = false;
+  for (auto & named_bot : bots_) {
+    auto & bot = *named_bot.second;
+    uint64_t errors = bot.errors.load(std::memory_order_relaxed);
+    if (errors == bot.published_errors) {
+      continue;
+    }
+    uint64_t new_errors = errors - bot.published_errors;
+    bot.published_errors = errors;
+    has_errors = true;
+    std::string name = "lex_node: " + bot.lex_configuration.bot_name;
+    auto status = std::find_if(
+      diagnostics.status.begin(), diagnostics.status.end(),
+      [&name](const diagnostic_msgs::DiagnosticStatus & status) { return status.name == name; });
+    if (status == diagnostics.status.end()) {
+      diagnostic_msgs::DiagnosticStatus bot_status;
+      bot_status.name = name;
+      bot_status.hardware_id = bot.lex_configuration.bot_name;
+      status = diagnostics.status.insert(diagnostics.status.end(), bot_status);
+    }
+    status->level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status->message = std::to_string(new_errors) + " failed lex calls";
+    diagnostic_msgs::KeyValue value;
+    value.key = "errors";
+    value.value = std::to_string(new_errors);
+    status->values.push_back(value);
+  }
+  if (!stats.latencies.empty()) {
+    latency_stats_publisher_.publish(stats);
+  }
+  if (!stats.latencies.empty() || has_errors) {
+    diagnostics_publisher_.publish(diagnostics);
+  }
+}
+
+void LexNode::ConfigureAudioPipeline(std::shared_ptr<const AudioPipeline> audio_pipeline)
+{
+  audio_pipeline_ = audio_pipeline;
+}
+
+void LexNode::ConfigureDispatch(const DispatchConfiguration & dispatch_configuration)
+{
+  dispatch_configuration_ = dispatch_configuration;
+  session_serializer_ =
+    std::make_shared<SessionSerializer>(dispatch_configuration.max_sessions,
+                                        dispatch_configuration.session_shards);
 }
 
 void LexNode::ConfigureAwsLex(
   LexConfiguration & lex_configuration,
   std::shared_ptr<Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client)
 {
-  lex_configuration_ = lex_configuration;
-  lex_runtime_client_ = lex_runtime_client;
+  auto bot = std::make_shared<Bot>();
+  bot->lex_configuration = lex_configuration;
+  bot->lex_runtime_client = lex_runtime_client;
+  bots_[std::string()] = bot;
+}
+
+void LexNode::ConfigureBotProfile(
+  const BotProfile & bot_profile,
+  std::shared_ptr<Aws::LexRuntimeService::LexRuntimeServiceClient> lex_runtime_client)
+{
+  const auto & lex_configuration = bot_profile.lex_configuration;
+  for (const auto & named_bot : bots_) {
+    const auto & served = named_bot.second->lex_configuration;
+    if (served.bot_name == lex_configuration.bot_name &&
+        served.bot_alias == lex_configuration.bot_alias &&
+        served.user_id == lex_configuration.user_id) {
+      bots_[bot_profile.name] = named_bot.second;
+      return;
+    }
+  }
+  auto bot = std::make_shared<Bot>();
+  bot->lex_configuration = lex_configuration;
+  bot->lex_runtime_client = lex_runtime_client;
+  bots_[bot_profile.name] = bot;
+}
+
+std::vector<LexNode::BotStats> LexNode::GetBotStats() const
+{
+  std::vector<BotStats> bot_stats;
+  std::vector<const Bot *> bots;
+  for (const auto & named_bot : bots_) {
+    auto found = std::find(bots.begin(), bots.end(), named_bot.second.get());
+    if (found != bots.end()) {
+      bot_stats[found - bots.begin()].profiles.push_back(named_bot.first);
+      continue;
+    }
+    const auto & bot = *named_bot.second;
+    bots.push_back(&bot);
+    BotStats stats;
+    stats.profiles.push_back(named_bot.first);
+    stats.bot_name = bot.lex_configuration.bot_name;
+    stats.bot_alias = bot.lex_configuration.bot_alias;
+    stats.calls = bot.calls.load(std::memory_order_relaxed);
+    stats.errors = bot.errors.load(std::memory_order_relaxed);
+    bot_stats.push_back(std::move(stats));
+  }
+  return bot_stats;
+}
+
+bool LexNode::GetSession(const std::string & session_key, SessionInfo & info) const
+{
+  return session_serializer_->GetSession(session_key, info);
+}
+
+std::shared_ptr<LexNode::Bot> LexNode::FindBot(const std::string & bot) const
+{
+  auto named_bot = bots_.find(bot);
+  return named_bot == bots_.end() ? nullptr : named_bot->second;
+}
+
+std::weak_ptr<const Aws::LexRuntimeService::LexRuntimeServiceClient>
+LexNode::GetLexRuntimeClient() const
+{
+  auto bot = FindBot(std::string());
+  return bot ? bot->lex_runtime_client : nullptr;
 }
 
 bool LexNode::LexServerCallback(lex_common_msgs::AudioTextConversationRequest & request,
                                 lex_common_msgs::AudioTextConversationResponse & response)
 {
-  if (!lex_runtime_client_) {
+  auto default_bot = FindBot(std::string());
+  if (!default_bot || !default_bot->lex_runtime_client) {
     // @todo define a new exception
     AWS_LOG_WARN(__func__, "Lex runtime client is not initialized, LoadConfiguration.");
     throw std::invalid_argument("Lex runtime client is not initialized, LoadConfiguration.");
   }
-  return PostContent(request, response, lex_configuration_, lex_runtime_client_);
+  auto bot = FindBot(request.bot);
+  if (!bot) {
+    AWS_LOGSTREAM_WARN(__func__, "Unknown bot profile \"" << request.bot << "\"");
+    return false;
+  }
+  LexConfiguration user_configuration;
+  const auto & lex_configuration =
+    SelectUser(bot->lex_configuration, request.user_id, user_configuration);
+  auto turn = session_serializer_->Enter(MakeSessionKey(
+    lex_configuration.bot_name, lex_configuration.bot_alias, lex_configuration.user_id));
+  StageTimer stage_timer;
+  ConversationMonitor monitor;
+  monitor.stage_timer = latency_stats_ ? &stage_timer : nullptr;
+  auto session_attributes = turn.GetSessionAttributes();
+  bool success = PostContent(request, response, lex_configuration, bot->lex_runtime_client,
+                             monitor, session_attributes, IsDialogOpen(turn.GetDialogState()),
+                             audio_pipeline_.get(), audio_buffer_pool_.get(),
+                             response_cache_.get(), prompt_audio_cache_.get(),
+                             request_hedger_.get(), payload_sampler_.get());
+  if (success) {
+    turn.SetDialogState(response.dialog_state);
+    turn.SetSessionAttributes(std::move(session_attributes));
+  }
+  bot->RecordCall(success);
+  RecordLatency(stage_timer, *bot, response.intent_name);
+  return success;
+}
+
+void LexNode::ConversationGoalCallback(LexConversationServer::GoalHandle goal_handle)
+{
+  auto default_bot = FindBot(std::string());
+  if (!default_bot || !default_bot->lex_runtime_client) {
+    AWS_LOG_WARN(__func__, "Lex runtime client is not initialized, LoadConfiguration.");
+    goal_handle.setRejected(lex_common_msgs::LexConversationResult(),
+                            "Lex runtime client is not initialized");
+    return;
+  }
+  auto bot = FindBot(goal_handle.getGoal()->bot);
+  if (!bot) {
+    AWS_LOGSTREAM_WARN(__func__, "Unknown bot profile \"" << goal_handle.getGoal()->bot << "\"");
+    goal_handle.setRejected(lex_common_msgs::LexConversationResult(), "Unknown bot profile");
+    return;
+  }
+  LexConfiguration user_configuration;
+  const auto & lex_configuration =
+    SelectUser(bot->lex_configuration, goal_handle.getGoal()->user_id, user_configuration);
+  auto session_key = MakeSessionKey(lex_configuration.bot_name, lex_configuration.bot_alias,
+                                    lex_configuration.user_id);
+  auto cancel_reason = std::make_shared<std::atomic<int>>(kNotCancelled);
+  {
+    std::lock_guard<std::mutex> lock(pending_goals_->mutex);
+    auto & latest = pending_goals_->latest_by_session[session_key];
+    if (latest) {
+      int not_cancelled = kNotCancelled;
+      latest->compare_exchange_strong(not_cancelled, kSuperseded);
+    }
+    latest = cancel_reason;
+    pending_goals_->by_goal_id[goal_handle.getGoalID().id] = cancel_reason;
+  }
+  goal_handle.setAccepted();
+
+  ros::CallbackQueueInterface * queue = dispatch_queue_ ? dispatch_queue_.get() : goal_queue_.get();
+  queue->addCallback(boost::make_shared<ConversationTask>([this, goal_handle, bot, session_key,
+                                                            cancel_reason]() mutable {
+    ExecuteConversationGoal(goal_handle, *bot, session_key, *cancel_reason);
+  }));
+}
+
+void LexNode::ConversationCancelCallback(LexConversationServer::GoalHandle goal_handle)
+{
+  std::lock_guard<std::mutex> lock(pending_goals_->mutex);
+  auto goal = pending_goals_->by_goal_id.find(goal_handle.getGoalID().id);
+  if (goal != pending_goals_->by_goal_id.end()) {
+    int not_cancelled = kNotCancelled;
+    goal->second->compare_exchange_strong(not_cancelled, kCancelRequested);
+  }
+}
+
+void LexNode::ExecuteConversationGoal(LexConversationServer::GoalHandle & goal_handle, Bot & bot,
+                                      const std::string & session_key,
+                                      const std::atomic<int> & cancel_reason)
+{
+  lex_common_msgs::LexConversationResult result;
+  bool success = false;
+  {
+    auto turn = session_serializer_->Enter(session_key);
+    if (kNotCancelled == cancel_reason) {
+      StageTimer stage_timer;
+      ConversationMonitor monitor;
+      monitor.stage_timer = latency_stats_ ? &stage_timer : nullptr;
+      monitor.is_cancelled = [&cancel_reason] { return kNotCancelled != cancel_reason; };
+      monitor.on_stage = [&goal_handle](ConversationStage stage) {
+        lex_common_msgs::LexConversationFeedback feedback;
+        switch (stage) {
+          case ConversationStage::kCallStarted:
+            feedback.stage = lex_common_msgs::LexConversationFeedback::CALL_STARTED;
+            break;
+          case ConversationStage::kUploadComplete:
+            feedback.stage = lex_common_msgs::LexConversationFeedback::UPLOAD_COMPLETE;
+            break;
+          case ConversationStage::kFirstBytesReceived:
+            feedback.stage = lex_common_msgs::LexConversationFeedback::FIRST_BYTES_RECEIVED;
+            break;
+        }
+        goal_handle.publishFeedback(feedback);
+      };
+      LexConfiguration user_configuration;
+      const auto & lex_configuration =
+        SelectUser(bot.lex_configuration, goal_handle.getGoal()->user_id, user_configuration);
+      auto session_attributes = turn.GetSessionAttributes();
+      success = PostContent(*goal_handle.getGoal(), result, lex_configuration,
+                            bot.lex_runtime_client, monitor, session_attributes,
+                            IsDialogOpen(turn.GetDialogState()), audio_pipeline_.get(),
+                            audio_buffer_pool_.get(), response_cache_.get(),
+                            prompt_audio_cache_.get(), request_hedger_.get(),
+                            payload_sampler_.get());
+      if (success) {
+        turn.SetDialogState(result.dialog_state);
+        turn.SetSessionAttributes(std::move(session_attributes));
+      }
+      bot.RecordCall(success);
+      RecordLatency(stage_timer, bot, result.intent_name);
+    }
+  }
+
+  if (success) {
+    goal_handle.setSucceeded(result);
+  } else if (kSuperseded == cancel_reason) {
+    goal_handle.setCanceled(result, "Superseded by a newer goal for the same lex session");
+  } else if (kCancelRequested == cancel_reason) {
+    goal_handle.setCanceled(result, "Cancelled");
+  } else {
+    goal_handle.setAborted(result, "Lex request failed");
+  }
+
+  std::lock_guard<std::mutex> lock(pending_goals_->mutex);
+  auto goal = pending_goals_->by_goal_id.find(goal_handle.getGoalID().id);
+  if (goal != pending_goals_->by_goal_id.end()) {
+    auto latest = pending_goals_->latest_by_session.find(session_key);
+    if (latest != pending_goals_->latest_by_session.end() && latest->second == goal->second) {
+      pending_goals_->latest_by_session.erase(latest);
+    }
+    pending_goals_->by_goal_id.erase(goal);
+  }
 }
 
 }  // namespace Lex
@@ -16,16 +16,49 @@
 #include <aws/core/utils/logging/LogMacros.h>
 #include <lex_node/lex_param_helper.h>
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace Aws {
 namespace Lex {
 
+namespace {
+
+/**
+ * @return a path in the directory ros keeps its logs in, ROS_HOME or ~/.ros, empty if neither is
+ * set
+ */
+std::string GetRosHomePath(const std::string & name)
+{
+  const char * ros_home = std::getenv("ROS_HOME");
+  const char * home = std::getenv("HOME");
+  if (ros_home && *ros_home) {
+    return std::string(ros_home) + "/" + name;
+  }
+  if (home && *home) {
+    return std::string(home) + "/.ros/" + name;
+  }
+  return std::string();
+}
+
+}  // namespace
+
 LexConfiguration LoadLexParameters(const Client::ParameterReaderInterface & parameter_interface)
 {
   LexConfiguration lex_configuration;
   bool is_invalid = false;
-  is_invalid |= (bool)parameter_interface.ReadStdString(kBotAliasKey, lex_configuration.bot_alias);
-  is_invalid |= (bool)parameter_interface.ReadStdString(kBotNameKey, lex_configuration.bot_name);
   is_invalid |= (bool)parameter_interface.ReadStdString(kUserIdKey, lex_configuration.user_id);
+  bool has_no_bot = false;
+  has_no_bot |= (bool)parameter_interface.ReadStdString(kBotAliasKey, lex_configuration.bot_alias);
+  has_no_bot |= (bool)parameter_interface.ReadStdString(kBotNameKey, lex_configuration.bot_name);
+  if (has_no_bot) {
+    // a node serving bot profiles only serves the first one by default
+    auto bot_profiles = LoadBotProfiles(parameter_interface, lex_configuration);
+    is_invalid |= bot_profiles.empty();
+    if (!bot_profiles.empty()) {
+      lex_configuration = bot_profiles.front().lex_configuration;
+    }
+  }
   if (is_invalid) {
     AWS_LOG_INFO(__func__, "Lex configuration not fully specified");
     throw std::invalid_argument("Lex configuration not fully specified");
@@ -33,5 +66,320 @@ LexConfiguration LoadLexParameters(const Client::ParameterReaderInterface & para
   return lex_configuration;
 }
 
+std::vector<BotProfile> LoadBotProfiles(
+  const Client::ParameterReaderInterface & parameter_interface,
+  const LexConfiguration & lex_configuration)
+{
+  std::vector<std::string> names;
+  parameter_interface.ReadList(kBotProfilesKey, names);
+  std::vector<BotProfile> bot_profiles;
+  for (const auto & name : names) {
+    BotProfile bot_profile;
+    bot_profile.name = name;
+    bot_profile.lex_configuration.user_id = lex_configuration.user_id;
+    auto path = std::string(LEX_BOTS_PATH) + name + "/";
+    auto & profile_configuration = bot_profile.lex_configuration;
+    parameter_interface.ReadStdString((path + kBotProfileUserIdKey).c_str(),
+                                      profile_configuration.user_id);
+    parameter_interface.ReadInt((path + kBotProfileMaxConnectionsKey).c_str(),
+                                profile_configuration.max_connections);
+    bool is_invalid = false;
+    is_invalid |= (bool)parameter_interface.ReadStdString((path + kBotProfileBotNameKey).c_str(),
+                                                          profile_configuration.bot_name);
+    is_invalid |= (bool)parameter_interface.ReadStdString((path + kBotProfileBotAliasKey).c_str(),
+                                                          profile_configuration.bot_alias);
+    if (is_invalid || name.empty()) {
+      AWS_LOGSTREAM_WARN(__func__, "Bot profile \"" << name << "\" has no bot name or alias, "
+                                                   "skipping it");
+      continue;
+    }
+    if (profile_configuration.max_connections < 0) {
+      AWS_LOGSTREAM_WARN(__func__, "Negative max_connections for bot profile \""
+                                     << name << "\", using the client configuration's");
+      profile_configuration.max_connections = 0;
+    }
+    bot_profiles.push_back(std::move(bot_profile));
+  }
+  return bot_profiles;
+}
+
+DispatchConfiguration LoadDispatchParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  DispatchConfiguration dispatch_configuration;
+  parameter_interface.ReadInt(kDispatchThreadsKey, dispatch_configuration.threads);
+  if (dispatch_configuration.threads < 0) {
+    AWS_LOG_WARN(__func__, "Negative dispatch thread count, serving from the global queue");
+    dispatch_configuration.threads = 0;
+  }
+  parameter_interface.ReadInt(kDispatchMaxSessionsKey, dispatch_configuration.max_sessions);
+  parameter_interface.ReadInt(kDispatchSessionShardsKey, dispatch_configuration.session_shards);
+  if (dispatch_configuration.max_sessions < 1 || dispatch_configuration.session_shards < 1) {
+    AWS_LOG_WARN(__func__, "Session table sizes must be positive, using the defaults");
+    dispatch_configuration.max_sessions = DispatchConfiguration().max_sessions;
+    dispatch_configuration.session_shards = DispatchConfiguration().session_shards;
+  }
+  return dispatch_configuration;
+}
+
+BufferPoolConfiguration LoadBufferPoolParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  BufferPoolConfiguration buffer_pool_configuration;
+  parameter_interface.ReadBool(kBufferPoolEnabledKey, buffer_pool_configuration.enabled);
+  parameter_interface.ReadInt(kBufferPoolMaxBufferBytesKey,
+                              buffer_pool_configuration.max_buffer_bytes);
+  parameter_interface.ReadInt(kBufferPoolBuffersPerSizeKey,
+                              buffer_pool_configuration.buffers_per_size);
+  parameter_interface.ReadInt(kBufferPoolMessagesKey, buffer_pool_configuration.messages);
+  if (buffer_pool_configuration.max_buffer_bytes < 0 ||
+      buffer_pool_configuration.buffers_per_size < 0 || buffer_pool_configuration.messages < 0) {
+    AWS_LOG_WARN(__func__, "Negative buffer pool size, disabling the buffer pools");
+    buffer_pool_configuration.enabled = false;
+  }
+  return buffer_pool_configuration;
+}
+
+ResponseCacheConfiguration LoadResponseCacheParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  ResponseCacheConfiguration response_cache_configuration;
+  parameter_interface.ReadBool(kResponseCacheEnabledKey, response_cache_configuration.enabled);
+  parameter_interface.ReadInt(kResponseCacheMaxEntriesKey,
+                              response_cache_configuration.max_entries);
+  parameter_interface.ReadInt(kResponseCacheMaxBytesKey, response_cache_configuration.max_bytes);
+  parameter_interface.ReadDouble(kResponseCacheTtlKey, response_cache_configuration.ttl_s);
+  parameter_interface.ReadList(kCacheableIntentsKey, response_cache_configuration.intents);
+  if (response_cache_configuration.max_entries <= 0 ||
+      response_cache_configuration.max_bytes <= 0 || response_cache_configuration.ttl_s <= 0.0) {
+    AWS_LOG_WARN(__func__, "Invalid response cache limits, not caching lex replies");
+    response_cache_configuration.enabled = false;
+  }
+  if (response_cache_configuration.enabled && response_cache_configuration.intents.empty()) {
+    AWS_LOG_INFO(__func__, "No cacheable intents configured, not caching lex replies");
+    response_cache_configuration.enabled = false;
+  }
+  return response_cache_configuration;
+}
+
+PromptAudioCacheConfiguration LoadPromptAudioCacheParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  PromptAudioCacheConfiguration prompt_audio_cache_configuration;
+  parameter_interface.ReadBool(kPromptAudioCacheEnabledKey,
+                               prompt_audio_cache_configuration.enabled);
+  parameter_interface.ReadStdString(kPromptAudioCacheDirectoryKey,
+                                    prompt_audio_cache_configuration.directory);
+  parameter_interface.ReadInt(kPromptAudioCacheMaxBytesKey,
+                              prompt_audio_cache_configuration.max_bytes);
+  if (prompt_audio_cache_configuration.directory.empty()) {
+    prompt_audio_cache_configuration.directory = GetRosHomePath("lex_prompt_audio");
+  }
+  if (prompt_audio_cache_configuration.directory.empty() ||
+      prompt_audio_cache_configuration.max_bytes < 64 * 1024) {
+    AWS_LOG_WARN(__func__, "No prompt audio cache directory or cap under 64 KiB, not caching "
+                           "prompt audio");
+    prompt_audio_cache_configuration.enabled = false;
+  }
+  return prompt_audio_cache_configuration;
+}
+
+ConnectionConfiguration LoadConnectionParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  ConnectionConfiguration connection_configuration;
+  parameter_interface.ReadBool(kConnectionWarmUpKey, connection_configuration.warm_up);
+  parameter_interface.ReadInt(kConnectionCountKey, connection_configuration.connections);
+  parameter_interface.ReadDouble(kConnectionKeepaliveIntervalKey,
+                                 connection_configuration.keepalive_interval_s);
+  parameter_interface.ReadDouble(kConnectionIdleTimeoutKey,
+                                 connection_configuration.idle_timeout_s);
+  if (connection_configuration.connections < 1 ||
+      connection_configuration.idle_timeout_s <= 0.0) {
+    AWS_LOG_WARN(__func__, "Connection count under 1 or idle timeout not positive, not warming "
+                           "up lex connections");
+    connection_configuration.warm_up = false;
+  } else if (connection_configuration.keepalive_interval_s >=
+             connection_configuration.idle_timeout_s) {
+    AWS_LOG_WARN(__func__, "Keepalive interval not under the idle timeout, idle lex connections "
+                           "may close before they are used again");
+  }
+  return connection_configuration;
+}
+
+TlsSessionCacheConfiguration LoadTlsSessionCacheParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  TlsSessionCacheConfiguration tls_session_cache_configuration;
+  parameter_interface.ReadBool(kTlsSessionCacheEnabledKey,
+                               tls_session_cache_configuration.enabled);
+  parameter_interface.ReadStdString(kTlsSessionCacheFileKey,
+                                    tls_session_cache_configuration.file);
+  if (tls_session_cache_configuration.file.empty()) {
+    tls_session_cache_configuration.file = GetRosHomePath("lex_tls_sessions");
+  }
+  if (tls_session_cache_configuration.file.empty()) {
+    AWS_LOG_WARN(__func__, "No tls session file, not keeping tls sessions across restarts");
+    tls_session_cache_configuration.enabled = false;
+  }
+  return tls_session_cache_configuration;
+}
+
+HedgingConfiguration LoadHedgingParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  HedgingConfiguration hedging_configuration;
+  parameter_interface.ReadBool(kHedgingEnabledKey, hedging_configuration.enabled);
+  parameter_interface.ReadInt(kHedgingDelayMsKey, hedging_configuration.delay_ms);
+  parameter_interface.ReadDouble(kHedgingPercentileKey, hedging_configuration.percentile);
+  parameter_interface.ReadInt(kHedgingMinDelayMsKey, hedging_configuration.min_delay_ms);
+  parameter_interface.ReadDouble(kHedgingBudgetPercentKey, hedging_configuration.budget_percent);
+  parameter_interface.ReadList(kHedgingIntentsKey, hedging_configuration.intents);
+  if (hedging_configuration.delay_ms < 0 || hedging_configuration.min_delay_ms < 0 ||
+      hedging_configuration.percentile <= 0.0 || hedging_configuration.percentile >= 100.0 ||
+      hedging_configuration.budget_percent <= 0.0 ||
+      hedging_configuration.budget_percent > 100.0) {
+    AWS_LOG_WARN(__func__, "Negative hedging delay, percentile outside 0 to 100 or budget outside "
+                           "0 to 100 percent, not hedging lex calls");
+    hedging_configuration.enabled = false;
+  }
+  if (hedging_configuration.enabled && hedging_configuration.intents.empty()) {
+    AWS_LOG_INFO(__func__, "No hedgeable intents configured, not hedging lex calls");
+    hedging_configuration.enabled = false;
+  }
+  return hedging_configuration;
+}
+
+LatencyStatsConfiguration LoadLatencyStatsParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  LatencyStatsConfiguration latency_stats_configuration;
+  parameter_interface.ReadBool(kLatencyStatsEnabledKey, latency_stats_configuration.enabled);
+  parameter_interface.ReadDouble(kLatencyStatsPublishIntervalKey,
+                                 latency_stats_configuration.publish_interval_s);
+  if (latency_stats_configuration.publish_interval_s <= 0.0) {
+    AWS_LOG_WARN(__func__, "Latency stats publish interval must be positive, not timing lex calls");
+    latency_stats_configuration.enabled = false;
+  }
+  return latency_stats_configuration;
+}
+
+NormalizationConfiguration LoadNormalizationParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  NormalizationConfiguration normalization_configuration;
+  parameter_interface.ReadBool(kNormalizationEnabledKey, normalization_configuration.enabled);
+  parameter_interface.ReadInt(kNormalizationSampleRateKey,
+                              normalization_configuration.sample_rate);
+  if (8000 != normalization_configuration.sample_rate &&
+      16000 != normalization_configuration.sample_rate) {
+    AWS_LOG_WARN(__func__, "Lex takes 8000 or 16000 hertz audio, not normalizing request audio");
+    normalization_configuration.enabled = false;
+  }
+  return normalization_configuration;
+}
+
+VoiceActivityConfiguration LoadVoiceActivityParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  VoiceActivityConfiguration voice_activity_configuration;
+  parameter_interface.ReadBool(kVoiceActivityEnabledKey, voice_activity_configuration.enabled);
+  parameter_interface.ReadInt(kVoiceActivityPadMsKey, voice_activity_configuration.pad_ms);
+  parameter_interface.ReadInt(kVoiceActivityFrameMsKey, voice_activity_configuration.frame_ms);
+  parameter_interface.ReadInt(kVoiceActivityMinSpeechMsKey,
+                              voice_activity_configuration.min_speech_ms);
+  parameter_interface.ReadDouble(kVoiceActivityEnergyRatioKey,
+                                 voice_activity_configuration.energy_ratio);
+  parameter_interface.ReadDouble(kVoiceActivityMinRmsKey, voice_activity_configuration.min_rms);
+  if (voice_activity_configuration.frame_ms <= 0 || voice_activity_configuration.pad_ms < 0 ||
+      voice_activity_configuration.min_speech_ms < 0) {
+    AWS_LOG_WARN(__func__, "Invalid voice activity durations, not trimming request audio");
+    voice_activity_configuration.enabled = false;
+  }
+  return voice_activity_configuration;
+}
+
+OpusConfiguration LoadOpusParameters(const Client::ParameterReaderInterface & parameter_interface)
+{
+  OpusConfiguration opus_configuration;
+  parameter_interface.ReadBool(kOpusEnabledKey, opus_configuration.enabled);
+  parameter_interface.ReadInt(kOpusBitRateKey, opus_configuration.bit_rate);
+  parameter_interface.ReadInt(kOpusFrameMsKey, opus_configuration.frame_ms);
+  parameter_interface.ReadInt(kOpusComplexityKey, opus_configuration.complexity);
+  const int frame_ms = opus_configuration.frame_ms;
+  bool is_valid_frame = 5 == frame_ms || 10 == frame_ms || 20 == frame_ms || 40 == frame_ms ||
+                        60 == frame_ms;
+  // whole bytes per frame keep every constant bit rate frame the same size
+  if (!is_valid_frame || opus_configuration.bit_rate < 6000 ||
+      opus_configuration.bit_rate > 510000 ||
+      0 != (opus_configuration.bit_rate * frame_ms) % 8000) {
+    AWS_LOG_WARN(__func__, "Invalid opus bit rate or frame size, not encoding request audio");
+    opus_configuration.enabled = false;
+  }
+  opus_configuration.complexity = std::min(10, std::max(0, opus_configuration.complexity));
+  return opus_configuration;
+}
+
+AwsMemoryConfiguration LoadAwsMemoryParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  AwsMemoryConfiguration aws_memory_configuration;
+  parameter_interface.ReadBool(kAwsMemoryEnabledKey, aws_memory_configuration.enabled);
+  parameter_interface.ReadDouble(kAwsMemoryReportIntervalKey,
+                                 aws_memory_configuration.report_interval_s);
+  parameter_interface.ReadInt(kAwsMemoryThreadCacheBlocksKey,
+                              aws_memory_configuration.thread_cache_blocks);
+  if (aws_memory_configuration.thread_cache_blocks < 0) {
+    AWS_LOG_WARN(__func__, "Negative thread cache size, not caching sdk memory blocks");
+    aws_memory_configuration.thread_cache_blocks = 0;
+  }
+  return aws_memory_configuration;
+}
+
+TraceConfiguration LoadTraceParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  TraceConfiguration trace_configuration;
+  parameter_interface.ReadBool(kTraceSamplePayloadsKey, trace_configuration.sample_payloads);
+  parameter_interface.ReadStdString(kTracePayloadFileKey, trace_configuration.payload_file);
+  parameter_interface.ReadDouble(kTraceSamplesPerMinuteKey,
+                                 trace_configuration.samples_per_minute);
+  parameter_interface.ReadInt(kTraceMaxFileBytesKey, trace_configuration.max_file_bytes);
+  if (trace_configuration.payload_file.empty()) {
+    trace_configuration.payload_file = GetRosHomePath("lex_payloads");
+  }
+  if (trace_configuration.payload_file.empty() || trace_configuration.samples_per_minute <= 0.0 ||
+      trace_configuration.max_file_bytes <= 0) {
+    AWS_LOG_WARN(__func__, "No payload file, sample rate or file cap not positive, not sampling "
+                           "request payloads");
+    trace_configuration.sample_payloads = false;
+  }
+  return trace_configuration;
+}
+
+LoggingConfiguration LoadLoggingParameters(
+  const Client::ParameterReaderInterface & parameter_interface)
+{
+  LoggingConfiguration logging_configuration;
+  parameter_interface.ReadBool(kLoggingAsyncKey, logging_configuration.async);
+  parameter_interface.ReadInt(kLoggingCapacityKey, logging_configuration.capacity);
+  parameter_interface.ReadStdString(kLoggingOverflowPolicyKey,
+                                    logging_configuration.overflow_policy);
+  parameter_interface.ReadInt(kLoggingFlushIntervalMsKey, logging_configuration.flush_interval_ms);
+  if (logging_configuration.capacity < 2 || logging_configuration.flush_interval_ms < 1) {
+    AWS_LOG_WARN(__func__, "Log buffer capacity under 2 lines or flush interval under 1 ms, "
+                           "logging from the calling threads");
+    logging_configuration.async = false;
+  }
+  if ("drop_oldest" != logging_configuration.overflow_policy &&
+      "block" != logging_configuration.overflow_policy) {
+    AWS_LOGSTREAM_WARN(__func__, "Unknown log overflow policy \""
+                                   << logging_configuration.overflow_policy
+                                   << "\", dropping the oldest lines");
+    logging_configuration.overflow_policy = "drop_oldest";
+  }
+  return logging_configuration;
+}
+
 }  // namespace Lex
 }  // namespace Aws
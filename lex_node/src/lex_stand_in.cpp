@@ -0,0 +1,590 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/lex_stand_in.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Largest request head read, the sdk sends a few hundred bytes.
+ */
+constexpr std::size_t kMaxHeadBytes = 64 * 1024;
+
+/**
+ * Largest request body read, lex takes up to about a minute of 16 kHz audio.
+ */
+constexpr std::size_t kMaxBodyBytes = 16 * 1024 * 1024;
+
+/**
+ * Slices a slow body is sent in.
+ */
+constexpr int kSlowBodySlices = 10;
+
+bool SendAll(int fd, const char * data, std::size_t size)
+{
+  while (size > 0) {
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && EINTR == errno) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+bool SendAll(int fd, const std::string & data) { return SendAll(fd, data.data(), data.size()); }
+
+/**
+ * Read what the peer sent next.
+ *
+ * @return false on end of stream or error
+ */
+bool ReadMore(int fd, std::string & buffer)
+{
+  char chunk[16 * 1024];
+  for (;;) {
+    ssize_t bytes_read = recv(fd, chunk, sizeof(chunk), 0);
+    if (bytes_read < 0 && EINTR == errno) {
+      continue;
+    }
+    if (bytes_read <= 0) {
+      return false;
+    }
+    buffer.append(chunk, bytes_read);
+    return true;
+  }
+}
+
+/**
+ * Wait until the buffer holds a line from an offset.
+ *
+ * @return the offset of the line's \r\n, npos on end of stream
+ */
+std::size_t ReadLine(int fd, std::string & buffer, std::size_t offset)
+{
+  std::size_t line_end;
+  while (std::string::npos == (line_end = buffer.find("\r\n", offset))) {
+    if (buffer.size() > kMaxHeadBytes + kMaxBodyBytes || !ReadMore(fd, buffer)) {
+      return std::string::npos;
+    }
+  }
+  return line_end;
+}
+
+std::string ToLower(std::string text)
+{
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return text;
+}
+
+std::string JsonString(const std::string & text)
+{
+  std::string json = "\"";
+  for (unsigned char c : text) {
+    if ('"' == c || '\\' == c) {
+      json += '\\';
+      json += c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json += escaped;
+    } else {
+      json += c;
+    }
+  }
+  return json + "\"";
+}
+
+/**
+ * Read a json string value from a json object, enough for the inputText of PostText.
+ *
+ * @return the value, empty if the key is missing
+ */
+std::string FindJsonString(const std::string & json, const std::string & key)
+{
+  std::size_t position = json.find("\"" + key + "\"");
+  if (std::string::npos == position) {
+    return std::string();
+  }
+  position = json.find('"', json.find(':', position + key.size() + 2));
+  std::string value;
+  for (position++; position < json.size() && '"' != json[position]; position++) {
+    char c = json[position];
+    if ('\\' == c && position + 1 < json.size()) {
+      char escaped = json[++position];
+      if ('u' == escaped && position + 4 < json.size()) {
+        long code = std::strtol(json.substr(position + 1, 4).c_str(), nullptr, 16);
+        value += code < 0x80 ? static_cast<char>(code) : '?';
+        position += 4;
+      } else {
+        value += 'n' == escaped ? '\n' : 't' == escaped ? '\t' : escaped;
+      }
+    } else {
+      value += c;
+    }
+  }
+  return value;
+}
+
+std::string Base64(const std::string & data)
+{
+  static const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string encoded;
+  std::size_t index = 0;
+  for (; index + 2 < data.size(); index += 3) {
+    uint32_t bits = (uint8_t(data[index]) << 16) | (uint8_t(data[index + 1]) << 8) |
+                    uint8_t(data[index + 2]);
+    encoded += kAlphabet[bits >> 18];
+    encoded += kAlphabet[(bits >> 12) & 63];
+    encoded += kAlphabet[(bits >> 6) & 63];
+    encoded += kAlphabet[bits & 63];
+  }
+  if (index < data.size()) {
+    uint32_t bits = uint8_t(data[index]) << 16;
+    if (index + 1 < data.size()) {
+      bits |= uint8_t(data[index + 1]) << 8;
+    }
+    encoded += kAlphabet[bits >> 18];
+    encoded += kAlphabet[(bits >> 12) & 63];
+    encoded += index + 1 < data.size() ? kAlphabet[(bits >> 6) & 63] : '=';
+    encoded += '=';
+  }
+  return encoded;
+}
+
+/**
+ * @return the text with the characters a header value cannot hold replaced
+ */
+std::string HeaderValue(std::string text)
+{
+  for (auto & c : text) {
+    if (c < 0x20 || c > 0x7e) {
+      c = '?';
+    }
+  }
+  return text;
+}
+
+std::string SlotsJson(const StandInReply & reply)
+{
+  std::string json = "{";
+  for (const auto & slot : reply.slots) {
+    json += (json.size() > 1 ? "," : "") + JsonString(slot.first) + ":" + JsonString(slot.second);
+  }
+  return json + "}";
+}
+
+std::vector<std::string> Split(const std::string & text, char separator)
+{
+  std::vector<std::string> fields;
+  std::stringstream stream(text);
+  std::string field;
+  while (std::getline(stream, field, separator)) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+}  // namespace
+
+struct LexStandIn::HttpRequest
+{
+  std::string method;
+  std::string path;
+  std::string version;
+  std::map<std::string, std::string> headers;
+  std::string body;
+
+  std::string GetHeader(const std::string & name) const
+  {
+    auto header = headers.find(name);
+    return header == headers.end() ? std::string() : header->second;
+  }
+};
+
+bool LexStandIn::ReadRequest(int fd, std::string & buffer, HttpRequest & request)
+{
+  std::size_t head_end;
+  while (std::string::npos == (head_end = buffer.find("\r\n\r\n"))) {
+    if (buffer.size() > kMaxHeadBytes || !ReadMore(fd, buffer)) {
+      return false;
+    }
+  }
+  std::stringstream head(buffer.substr(0, head_end));
+  std::string line;
+  std::getline(head, line);
+  std::stringstream request_line(line);
+  request_line >> request.method >> request.path >> request.version;
+  request.headers.clear();
+  while (std::getline(head, line)) {
+    std::size_t colon = line.find(':');
+    if (std::string::npos == colon) {
+      continue;
+    }
+    std::size_t value_start = line.find_first_not_of(" \t", colon + 1);
+    std::size_t value_end = line.find_last_not_of(" \t\r");
+    request.headers[ToLower(line.substr(0, colon))] =
+      std::string::npos == value_start ? std::string()
+                                       : line.substr(value_start, value_end - value_start + 1);
+  }
+  std::size_t offset = head_end + 4;
+  if ("100-continue" == ToLower(request.GetHeader("expect")) &&
+      !SendAll(fd, "HTTP/1.1 100 Continue\r\n\r\n")) {
+    return false;
+  }
+  request.body.clear();
+  if ("chunked" == ToLower(request.GetHeader("transfer-encoding"))) {
+    for (;;) {
+      std::size_t line_end = ReadLine(fd, buffer, offset);
+      if (std::string::npos == line_end) {
+        return false;
+      }
+      std::size_t chunk_size = std::strtoul(buffer.c_str() + offset, nullptr, 16);
+      offset = line_end + 2;
+      if (0 == chunk_size) {
+        // skip the trailers up to the empty line
+        while (std::string::npos != (line_end = ReadLine(fd, buffer, offset)) &&
+               line_end != offset) {
+          offset = line_end + 2;
+        }
+        if (std::string::npos == line_end) {
+          return false;
+        }
+        offset = line_end + 2;
+        break;
+      }
+      if (request.body.size() + chunk_size > kMaxBodyBytes) {
+        return false;
+      }
+      while (buffer.size() < offset + chunk_size + 2) {
+        if (!ReadMore(fd, buffer)) {
+          return false;
+        }
+      }
+      request.body.append(buffer, offset, chunk_size);
+      offset += chunk_size + 2;
+    }
+  } else {
+    std::size_t content_length = std::strtoul(request.GetHeader("content-length").c_str(),
+                                              nullptr, 10);
+    if (content_length > kMaxBodyBytes) {
+      return false;
+    }
+    while (buffer.size() < offset + content_length) {
+      if (!ReadMore(fd, buffer)) {
+        return false;
+      }
+    }
+    request.body = buffer.substr(offset, content_length);
+    offset += content_length;
+  }
+  buffer.erase(0, offset);
+  return true;
+}
+
+bool LoadStandInScript(const std::string & path, std::vector<StandInReply> & replies)
+{
+  std::ifstream script(path);
+  if (!script) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(script, line)) {
+    if (!line.empty() && '\r' == line.back()) {
+      line.pop_back();
+    }
+    if (line.empty() || '#' == line[0]) {
+      continue;
+    }
+    auto fields = Split(line, '\t');
+    fields.resize(std::max<std::size_t>(fields.size(), 6));
+    StandInReply reply;
+    reply.match = fields[0];
+    reply.dialog_state = fields[1].empty() ? reply.dialog_state : fields[1];
+    reply.intent_name = fields[2];
+    reply.message = fields[3];
+    for (const auto & slot : Split(fields[4], ';')) {
+      std::size_t equals = slot.find('=');
+      if (std::string::npos != equals) {
+        reply.slots.emplace_back(slot.substr(0, equals), slot.substr(equals + 1));
+      }
+    }
+    reply.slot_to_elicit = fields[5];
+    replies.push_back(std::move(reply));
+  }
+  return true;
+}
+
+LexStandIn::LexStandIn(const LexStandInConfiguration & configuration)
+: configuration_(configuration)
+{
+}
+
+LexStandIn::~LexStandIn() { Stop(); }
+
+bool LexStandIn::Start()
+{
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  int enable = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(configuration_.port));
+  socklen_t address_size = sizeof(address);
+  if (1 != inet_pton(AF_INET, configuration_.address.c_str(), &address.sin_addr) ||
+      0 != bind(listen_fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) ||
+      0 != listen(listen_fd_, SOMAXCONN) ||
+      0 != getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address), &address_size)) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  port_ = ntohs(address.sin_port);
+  accept_thread_ = std::thread([this] { Accept(); });
+  return true;
+}
+
+void LexStandIn::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_stopping_ || listen_fd_ < 0) {
+      return;
+    }
+    is_stopping_ = true;
+    changed_.notify_all();
+    // unblock accept and the connections' reads
+    shutdown(listen_fd_, SHUT_RDWR);
+    for (int fd : connection_fds_) {
+      shutdown(fd, SHUT_RDWR);
+    }
+  }
+  accept_thread_.join();
+  close(listen_fd_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return connection_fds_.empty(); });
+}
+
+LexStandIn::Stats LexStandIn::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void LexStandIn::Accept()
+{
+  for (;;) {
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0 && EINTR == errno) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_stopping_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      return;
+    }
+    if (fd < 0) {
+      continue;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    connection_fds_.insert(fd);
+    stats_.connections++;
+    std::thread([this, fd] { Serve(fd); }).detach();
+  }
+}
+
+void LexStandIn::Serve(int fd)
+{
+  std::mt19937 random(std::random_device{}());
+  std::string buffer;
+  HttpRequest request;
+  while (ReadRequest(fd, buffer, request) && Reply(fd, request, random)) {
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  close(fd);
+  connection_fds_.erase(fd);
+  changed_.notify_all();
+}
+
+bool LexStandIn::Reply(int fd, const HttpRequest & request, std::mt19937 & random)
+{
+  bool keep_alive = "close" != ToLower(request.GetHeader("connection")) &&
+                    "HTTP/1.0" != request.version;
+  // /bot/{botName}/alias/{botAlias}/user/{userId}/{content,text,session}
+  auto path = request.path.substr(0, request.path.find('?'));
+  auto segments = Split(path, '/');
+  std::string operation = segments.size() >= 8 && "bot" == segments[1] &&
+                              "alias" == segments[3] && "user" == segments[5]
+                            ? segments[7]
+                            : std::string();
+  std::uniform_real_distribution<double> percent(0.0, 100.0);
+  double fault = percent(random);
+  bool is_slow_body = percent(random) < configuration_.slow_body_percent;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ("POST" == request.method && "content" == operation) {
+      stats_.post_content++;
+    } else if ("POST" == request.method && "text" == operation) {
+      stats_.post_text++;
+    } else if ("GET" == request.method && "session" == operation) {
+      stats_.get_session++;
+    } else {
+      stats_.unknown++;
+      operation.clear();
+    }
+    if (!operation.empty() && fault < configuration_.error_percent) {
+      stats_.errors++;
+    } else if (!operation.empty() &&
+               fault < configuration_.error_percent + configuration_.throttle_percent) {
+      stats_.throttles++;
+    } else if (!operation.empty() && is_slow_body) {
+      stats_.slow_bodies++;
+    }
+  }
+
+  int latency_ms = configuration_.latency_ms;
+  if (configuration_.jitter_ms > 0) {
+    latency_ms += std::uniform_int_distribution<int>(0, configuration_.jitter_ms)(random);
+  }
+  if (!operation.empty() && !Sleep(latency_ms)) {
+    return false;
+  }
+
+  std::string status = "200 OK";
+  std::string headers;
+  std::string body;
+  if (operation.empty()) {
+    status = "404 Not Found";
+    headers = "x-amzn-ErrorType: NotFoundException\r\nContent-Type: application/json\r\n";
+    body = "{\"message\":\"Unknown lex runtime call\"}";
+  } else if (fault < configuration_.error_percent) {
+    status = "500 Internal Server Error";
+    headers = "x-amzn-ErrorType: InternalFailureException\r\nContent-Type: application/json\r\n";
+    body = "{\"message\":\"Injected internal failure\"}";
+  } else if (fault < configuration_.error_percent + configuration_.throttle_percent) {
+    status = "429 Too Many Requests";
+    headers = "x-amzn-ErrorType: LimitExceededException\r\nContent-Type: application/json\r\n";
+    body = "{\"message\":\"Injected throttling\"}";
+  } else if ("session" == operation) {
+    headers = "Content-Type: application/json\r\n";
+    body = "{\"sessionId\":" + JsonString(segments[6]) +
+           ",\"sessionAttributes\":{},\"recentIntentSummaryView\":[]}";
+  } else if ("text" == operation) {
+    const auto & reply = FindReply(FindJsonString(request.body, "inputText"));
+    headers = "Content-Type: application/json\r\n";
+    body = "{\"dialogState\":" + JsonString(reply.dialog_state) +
+           ",\"message\":" + JsonString(reply.message) +
+           ",\"messageFormat\":\"PlainText\",\"sessionAttributes\":{},\"slots\":" +
+           SlotsJson(reply);
+    if (!reply.intent_name.empty()) {
+      body += ",\"intentName\":" + JsonString(reply.intent_name);
+    }
+    if (!reply.slot_to_elicit.empty()) {
+      body += ",\"slotToElicit\":" + JsonString(reply.slot_to_elicit);
+    }
+    body += "}";
+  } else {
+    bool is_text_request = 0 == request.GetHeader("content-type").compare(0, 5, "text/");
+    const auto & reply = FindReply(is_text_request ? request.body : std::string());
+    std::string accept = request.GetHeader("accept");
+    bool is_audio_reply = 0 == accept.compare(0, 6, "audio/");
+    headers = "Content-Type: " + (is_audio_reply ? accept : "text/plain;charset=utf-8") +
+              "\r\nx-amz-lex-dialog-state: " + reply.dialog_state +
+              "\r\nx-amz-lex-message: " + HeaderValue(reply.message) +
+              "\r\nx-amz-lex-message-format: PlainText\r\nx-amz-lex-slots: " +
+              Base64(SlotsJson(reply)) + "\r\n";
+    if (!reply.intent_name.empty()) {
+      headers += "x-amz-lex-intent-name: " + HeaderValue(reply.intent_name) + "\r\n";
+    }
+    if (!reply.slot_to_elicit.empty()) {
+      headers += "x-amz-lex-slot-to-elicit: " + HeaderValue(reply.slot_to_elicit) + "\r\n";
+    }
+    if (!is_text_request) {
+      headers += "x-amz-lex-input-transcript: stand in\r\n";
+    }
+    if (is_audio_reply) {
+      body.assign(configuration_.audio_bytes, '\0');
+    }
+  }
+
+  std::string head = "HTTP/1.1 " + status + "\r\n" + headers +
+                     "x-amzn-RequestId: stand-in\r\nContent-Length: " +
+                     std::to_string(body.size()) + "\r\n" +
+                     (keep_alive ? "" : "Connection: close\r\n") + "\r\n";
+  if (!is_slow_body || "200 OK" != status) {
+    return SendAll(fd, head + body) && keep_alive;
+  }
+  if (!SendAll(fd, head)) {
+    return false;
+  }
+  std::size_t slice = body.size() / kSlowBodySlices + 1;
+  for (std::size_t offset = 0; offset < body.size(); offset += slice) {
+    if (!Sleep(configuration_.slow_body_ms / kSlowBodySlices) ||
+        !SendAll(fd, body.data() + offset, std::min(slice, body.size() - offset))) {
+      return false;
+    }
+  }
+  return keep_alive;
+}
+
+const StandInReply & LexStandIn::FindReply(const std::string & input_text) const
+{
+  for (const auto & reply : configuration_.replies) {
+    if (reply.match.empty() || std::string::npos != input_text.find(reply.match)) {
+      return reply;
+    }
+  }
+  return default_reply_;
+}
+
+bool LexStandIn::Sleep(int ms)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !changed_.wait_for(lock, std::chrono::milliseconds(ms), [this] { return is_stopping_; });
+}
+
+}  // namespace Lex
+}  // namespace Aws
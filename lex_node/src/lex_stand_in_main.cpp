@@ -0,0 +1,115 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/lex_stand_in.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char kUsage[] =
+  "usage: lex_stand_in [--address=127.0.0.1] [--port=0] [--latency_ms=0] [--jitter_ms=0]\n"
+  "                    [--error_percent=0] [--throttle_percent=0] [--slow_body_percent=0]\n"
+  "                    [--slow_body_ms=1000] [--audio_bytes=16000] [--script=replies.tsv]\n";
+
+/**
+ * Read a --name=value argument.
+ *
+ * @return false if the argument is not the named one
+ */
+bool ParseArgument(const std::string & argument, const std::string & name, std::string & value)
+{
+  std::string prefix = "--" + name + "=";
+  if (0 != argument.compare(0, prefix.size(), prefix)) {
+    return false;
+  }
+  value = argument.substr(prefix.size());
+  return true;
+}
+
+}  // namespace
+
+/**
+ * Serve the lex runtime stand-in until interrupted.
+ *
+ * @param argc
+ * @param argv
+ * @return
+ */
+int main(int argc, char * argv[])
+{
+  Aws::Lex::LexStandInConfiguration configuration;
+  for (int index = 1; index < argc; index++) {
+    std::string argument = argv[index];
+    std::string value;
+    if (ParseArgument(argument, "address", value)) {
+      configuration.address = value;
+    } else if (ParseArgument(argument, "port", value)) {
+      configuration.port = std::atoi(value.c_str());
+    } else if (ParseArgument(argument, "latency_ms", value)) {
+      configuration.latency_ms = std::atoi(value.c_str());
+    } else if (ParseArgument(argument, "jitter_ms", value)) {
+      configuration.jitter_ms = std::atoi(value.c_str());
+    } else if (ParseArgument(argument, "error_percent", value)) {
+      configuration.error_percent = std::atof(value.c_str());
+    } else if (ParseArgument(argument, "throttle_percent", value)) {
+      configuration.throttle_percent = std::atof(value.c_str());
+    } else if (ParseArgument(argument, "slow_body_percent", value)) {
+      configuration.slow_body_percent = std::atof(value.c_str());
+    } else if (ParseArgument(argument, "slow_body_ms", value)) {
+      configuration.slow_body_ms = std::atoi(value.c_str());
+    } else if (ParseArgument(argument, "audio_bytes", value)) {
+      configuration.audio_bytes = std::strtoul(value.c_str(), nullptr, 10);
+    } else if (ParseArgument(argument, "script", value)) {
+      if (!Aws::Lex::LoadStandInScript(value, configuration.replies)) {
+        std::cerr << "Cannot read the script " << value << std::endl;
+        return 1;
+      }
+    } else {
+      std::cerr << kUsage;
+      return 1;
+    }
+  }
+
+  // the signals are waited for below, block them before the server threads inherit the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  Aws::Lex::LexStandIn stand_in(configuration);
+  if (!stand_in.Start()) {
+    std::cerr << "Cannot listen on " << configuration.address << ":" << configuration.port
+              << std::endl;
+    return 1;
+  }
+  std::cout << "Lex runtime stand-in listening on http://" << configuration.address << ":"
+            << stand_in.GetPort() << std::endl;
+  int signal = 0;
+  sigwait(&signals, &signal);
+  stand_in.Stop();
+
+  auto stats = stand_in.GetStats();
+  std::cout << stats.post_content << " PostContent, " << stats.post_text << " PostText, "
+            << stats.get_session << " GetSession, " << stats.unknown << " unknown calls on "
+            << stats.connections << " connections; " << stats.errors << " errors, "
+            << stats.throttles << " throttles, " << stats.slow_bodies << " slow bodies injected"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/load_generator.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr char kAudioContentType[] = "audio/l16; rate=16000; channels=1";
+constexpr char kTextContentType[] = "text/plain; charset=utf-8";
+
+/**
+ * Percentiles reported.
+ */
+constexpr double kPercentiles[] = {50, 90, 99, 99.9, 99.99, 100};
+
+/**
+ * Width of the longest histogram bar.
+ */
+constexpr int kBarWidth = 50;
+
+uint64_t GetMicros(Clock::duration duration)
+{
+  return std::max<int64_t>(
+    0, std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+/**
+ * Add the calls a closed loop caller did not send while its call stalled: a call taking n times
+ * the expected interval hides the n - 1 calls that would have been sent meanwhile, each waiting one
+ * interval less than the previous one.
+ */
+void CorrectCoordinatedOmission(const LatencyHistogram::Counts & counts, double interval_micros,
+                                LatencyHistogram::Counts & corrected)
+{
+  corrected = counts;
+  if (interval_micros <= 0) {
+    return;
+  }
+  for (std::size_t bucket = 0; bucket < counts.size(); bucket++) {
+    if (0 == counts[bucket]) {
+      continue;
+    }
+    double value = LatencyHistogram::GetBucketValue(bucket);
+    for (double missing = value - interval_micros; missing >= interval_micros;
+         missing -= interval_micros) {
+      corrected[LatencyHistogram::GetBucket(static_cast<uint64_t>(missing))] += counts[bucket];
+    }
+  }
+}
+
+double GetMeanMicros(const LatencyHistogram::Counts & counts)
+{
+  double sum = 0;
+  uint64_t total = 0;
+  for (std::size_t bucket = 0; bucket < counts.size(); bucket++) {
+    sum += counts[bucket] * LatencyHistogram::GetBucketValue(bucket);
+    total += counts[bucket];
+  }
+  return 0 == total ? 0.0 : sum / total;
+}
+
+void AppendPercentiles(const char * name, const LatencyHistogram::Counts & counts,
+                       std::string & text)
+{
+  char line[128];
+  int length = std::snprintf(line, sizeof(line), "  %-10s", name);
+  for (double percentile : kPercentiles) {
+    length += std::snprintf(line + length, sizeof(line) - length, " %9.3f",
+                            LatencyHistogram::GetPercentile(counts, percentile) / 1000);
+  }
+  text += line;
+  text += "\n";
+}
+
+}  // namespace
+
+bool LoadTextCorpus(const std::string & path, std::vector<LoadTurn> & turns)
+{
+  std::ifstream corpus(path);
+  if (!corpus) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(corpus, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    LoadTurn turn;
+    turn.content_type = kTextContentType;
+    turn.accept_type = kTextContentType;
+    turn.text_request = line;
+    turns.push_back(std::move(turn));
+  }
+  return true;
+}
+
+bool LoadAudioCorpus(const std::string & path, const std::string & accept_type,
+                     std::vector<LoadTurn> & turns)
+{
+  std::ifstream list(path);
+  if (!list) {
+    return false;
+  }
+  auto directory_end = path.rfind('/');
+  std::string directory =
+    std::string::npos == directory_end ? std::string() : path.substr(0, directory_end + 1);
+  std::string line;
+  while (std::getline(list, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::ifstream audio('/' == line[0] ? line : directory + line, std::ios::binary);
+    if (!audio) {
+      return false;
+    }
+    LoadTurn turn;
+    turn.content_type = kAudioContentType;
+    turn.accept_type = accept_type;
+    turn.audio_request.assign(std::istreambuf_iterator<char>(audio),
+                              std::istreambuf_iterator<char>());
+    turns.push_back(std::move(turn));
+  }
+  return true;
+}
+
+std::string FormatLoadReport(const LoadReport & report)
+{
+  char line[128];
+  std::string text;
+  std::snprintf(line, sizeof(line), "Calls: %llu in %.1f s, %.1f calls/s\n",
+                static_cast<unsigned long long>(report.calls), report.elapsed_s,
+                report.elapsed_s > 0 ? report.calls / report.elapsed_s : 0.0);
+  text += line;
+  std::snprintf(line, sizeof(line), "Errors: %llu (%.2f%%)\n",
+                static_cast<unsigned long long>(report.errors),
+                report.calls > 0 ? 100.0 * report.errors / report.calls : 0.0);
+  text += line;
+  for (const auto & error : report.error_counts) {
+    text += "  " + error.first + ": " + std::to_string(error.second) + "\n";
+  }
+
+  text += "Latency (ms)       p50       p90       p99     p99.9    p99.99       max\n";
+  AppendPercentiles("service", report.service_time, text);
+  AppendPercentiles("corrected", report.response_time, text);
+
+  // one row per power of two of the corrected latencies
+  constexpr std::size_t kSubBuckets = 1 << LatencyHistogram::kSubBucketBits;
+  std::vector<uint64_t> rows(report.response_time.size() / kSubBuckets);
+  for (std::size_t bucket = 0; bucket < report.response_time.size(); bucket++) {
+    rows[bucket / kSubBuckets] += report.response_time[bucket];
+  }
+  auto first = std::find_if(rows.begin(), rows.end(), [](uint64_t count) { return count > 0; });
+  auto last = std::find_if(rows.rbegin(), rows.rend(), [](uint64_t count) { return count > 0; });
+  if (rows.end() == first) {
+    return text;
+  }
+  uint64_t largest = *std::max_element(rows.begin(), rows.end());
+  text += "Corrected latency histogram (ms):\n";
+  for (auto row = first; row != last.base(); row++) {
+    std::size_t index = row - rows.begin();
+    double lower = 0 == index ? 0.0 : static_cast<double>(kSubBuckets << (index - 1));
+    double upper = static_cast<double>(kSubBuckets << index);
+    std::snprintf(line, sizeof(line), "  [%10.3f, %10.3f) %10llu ", lower / 1000, upper / 1000,
+                  static_cast<unsigned long long>(*row));
+    text += line;
+    text += std::string((*row * kBarWidth + largest - 1) / largest, '#') + "\n";
+  }
+  return text;
+}
+
+LoadGenerator::LoadGenerator(const LoadGeneratorConfiguration & configuration,
+                             std::vector<LoadTurn> turns, Call call)
+: configuration_(configuration), turns_(std::move(turns)), call_(std::move(call))
+{
+}
+
+LoadReport LoadGenerator::Run()
+{
+  LoadReport report;
+  if (turns_.empty() || configuration_.concurrency < 1) {
+    return report;
+  }
+  bool is_open_loop = configuration_.rate_per_s > 0;
+  auto start = Clock::now();
+  auto measure_start = start + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(configuration_.warmup_s));
+  auto end = measure_start + std::chrono::duration_cast<Clock::duration>(
+                               std::chrono::duration<double>(configuration_.duration_s));
+  std::chrono::duration<double> interval(is_open_loop ? 1.0 / configuration_.rate_per_s : 0.0);
+
+  LatencyHistogram service_time;
+  LatencyHistogram response_time;
+  std::atomic<uint64_t> next_call{0};
+  std::atomic<uint64_t> calls{0};
+  std::mutex errors_mutex;
+
+  auto run_caller = [&](int caller) {
+    for (;;) {
+      uint64_t index = next_call.fetch_add(1, std::memory_order_relaxed);
+      Clock::time_point scheduled;
+      if (is_open_loop) {
+        // late calls are sent at once, the time they waited counts in their response time
+        scheduled = start + std::chrono::duration_cast<Clock::duration>(interval * index);
+        if (scheduled >= end) {
+          return;
+        }
+        std::this_thread::sleep_until(scheduled);
+      }
+      auto sent = Clock::now();
+      if (!is_open_loop) {
+        if (sent >= end) {
+          return;
+        }
+        scheduled = sent;
+      }
+      auto error = call_(caller, turns_[index % turns_.size()]);
+      auto done = Clock::now();
+      if (scheduled < measure_start) {
+        continue;
+      }
+      service_time.Record(GetMicros(done - sent));
+      if (is_open_loop) {
+        response_time.Record(GetMicros(done - scheduled));
+      }
+      calls.fetch_add(1, std::memory_order_relaxed);
+      if (!error.empty()) {
+        std::lock_guard<std::mutex> lock(errors_mutex);
+        report.errors++;
+        report.error_counts[error]++;
+      }
+    }
+  };
+  std::vector<std::thread> callers;
+  for (int caller = 0; caller < configuration_.concurrency; caller++) {
+    callers.emplace_back(run_caller, caller);
+  }
+  for (auto & caller : callers) {
+    caller.join();
+  }
+
+  report.calls = calls.load();
+  report.elapsed_s = std::chrono::duration<double>(Clock::now() - measure_start).count();
+  service_time.Load(report.service_time);
+  if (is_open_loop) {
+    response_time.Load(report.response_time);
+  } else {
+    double interval_micros = configuration_.expected_interval_ms > 0
+                               ? configuration_.expected_interval_ms * 1000
+                               : GetMeanMicros(report.service_time);
+    CorrectCoordinatedOmission(report.service_time, interval_micros, report.response_time);
+  }
+  return report;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -18,9 +18,67 @@
 #include <aws/core/utils/logging/AWSLogging.h>
 #include <aws/core/utils/logging/LogMacros.h>
 #include <aws_ros1_common/sdk_utils/logging/aws_ros_logger.h>
+#include <aws_ros1_common/sdk_utils/ros1_node_parameter_reader.h>
+#include <lex_node/async_log_system.h>
 #include <lex_node/lex_node.h>
+#include <lex_node/lex_param_helper.h>
+#include <lex_node/tagged_memory_system.h>
+#include <lex_node/tls_session_cache.h>
 #include <ros/ros.h>
 
+#include <memory>
+
+/**
+ * Seconds between two saves of the tls sessions negotiated since the previous one.
+ */
+constexpr double kTlsSessionSaveIntervalS = 5.0;
+
+/**
+ * Log the counters of the sdk memory system, largest live bytes first.
+ *
+ * @param memory_system to report
+ */
+void ReportAwsMemory(const Aws::Lex::TaggedMemorySystem & memory_system)
+{
+  auto total = memory_system.GetTotalStats();
+  AWS_LOGSTREAM_INFO(__func__, "AWS SDK memory: live " << total.live_bytes << " bytes, peak "
+                                                       << total.peak_bytes << " bytes, "
+                                                       << total.allocations << " allocations");
+  for (const auto & stats : memory_system.GetTagStats()) {
+    AWS_LOGSTREAM_INFO(__func__, "  " << stats.tag << ": live " << stats.live_bytes
+                                      << " bytes, peak " << stats.peak_bytes << " bytes, "
+                                      << stats.allocations << " allocations");
+  }
+}
+
+/**
+ * Log the handshake counters of the tls session cache.
+ *
+ * @param tls_session_cache to report
+ */
+void ReportTlsSessions(Aws::Lex::TlsSessionCache & tls_session_cache)
+{
+  auto stats = tls_session_cache.GetStats();
+  AWS_LOGSTREAM_INFO(__func__, "TLS handshakes: " << stats.resumed_handshakes << " resumed, "
+                                                  << stats.full_handshakes << " full, "
+                                                  << stats.sessions_loaded
+                                                  << " sessions loaded at startup");
+}
+
+/**
+ * Log the counters of the asynchronous log system.
+ *
+ * @param async_log_system to report
+ */
+void ReportLogging(const Aws::Lex::AsyncLogSystem & async_log_system)
+{
+  auto stats = async_log_system.GetStats();
+  AWS_LOGSTREAM_INFO(__func__, "Log lines: " << stats.forwarded << " forwarded in "
+                                             << stats.batches << " batches, " << stats.dropped
+                                             << " dropped, " << stats.blocked
+                                             << " waited for room in the buffer");
+}
+
 /**
  * Start the lex node program.
  *
@@ -32,18 +90,91 @@ int main(int argc, char * argv[])
 {
   ros::init(argc, argv, "lex_node");
 
-  Aws::Utils::Logging::InitializeAWSLogging(
-    Aws::MakeShared<Aws::Utils::Logging::AWSROSLogger>("lex_node"));
+  // the memory system has to be installed before the sdk allocates anything, logging included
+  auto aws_memory_configuration =
+    Aws::Lex::LoadAwsMemoryParameters(Aws::Client::Ros1NodeParameterReader());
+  std::unique_ptr<Aws::Lex::TaggedMemorySystem> memory_system;
   Aws::SDKOptions options;
+  if (aws_memory_configuration.enabled) {
+    memory_system.reset(
+      new Aws::Lex::TaggedMemorySystem(aws_memory_configuration.thread_cache_blocks));
+    options.memoryManagementOptions.memoryManager = memory_system.get();
+  }
+  // the http client factory has to be installed before the sdk creates its default one
+  auto tls_session_cache_configuration =
+    Aws::Lex::LoadTlsSessionCacheParameters(Aws::Client::Ros1NodeParameterReader());
+  std::shared_ptr<Aws::Lex::TlsSessionCache> tls_session_cache;
+  if (tls_session_cache_configuration.enabled && Aws::Lex::IsTlsSessionCacheAvailable()) {
+    tls_session_cache =
+      std::make_shared<Aws::Lex::TlsSessionCache>(tls_session_cache_configuration);
+    options.httpOptions.httpClientFactory_create_fn = [tls_session_cache]() {
+      return Aws::Lex::MakeTlsSessionHttpClientFactory(tls_session_cache);
+    };
+  }
   Aws::InitAPI(options);
+  auto logging_configuration =
+    Aws::Lex::LoadLoggingParameters(Aws::Client::Ros1NodeParameterReader());
+  std::shared_ptr<Aws::Utils::Logging::LogSystemInterface> ros_logger =
+    Aws::MakeShared<Aws::Utils::Logging::AWSROSLogger>("lex_node");
+  std::shared_ptr<Aws::Lex::AsyncLogSystem> async_log_system;
+  if (logging_configuration.async) {
+    async_log_system =
+      Aws::MakeShared<Aws::Lex::AsyncLogSystem>("lex_node", logging_configuration, ros_logger);
+    Aws::Utils::Logging::InitializeAWSLogging(async_log_system);
+  } else {
+    Aws::Utils::Logging::InitializeAWSLogging(ros_logger);
+  }
+  if (memory_system && 0 == memory_system->GetTotalStats().allocations) {
+    AWS_LOG_WARN(__func__, "The AWS SDK was built without custom memory management, "
+                           "aws_memory has no effect");
+  }
+  if (tls_session_cache_configuration.enabled && !tls_session_cache) {
+    AWS_LOG_WARN(__func__, "lex_node was built without curl and openssl, or curl does not use "
+                           "openssl, tls_session_cache has no effect");
+  }
+  if (tls_session_cache) {
+    AWS_LOGSTREAM_INFO(__func__, "Loaded " << tls_session_cache->Load() << " tls sessions from "
+                                           << tls_session_cache_configuration.file);
+  }
 
-  auto lex_node = Aws::Lex::BuildLexNode();
-  AWS_LOG_INFO(__func__, "Starting Lex Node...");
+  {
+    auto lex_node = Aws::Lex::BuildLexNode();
+    ros::NodeHandle node_handle;
+    ros::WallTimer report_timer;
+    if (memory_system && aws_memory_configuration.report_interval_s > 0) {
+      report_timer = node_handle.createWallTimer(
+        ros::WallDuration(aws_memory_configuration.report_interval_s),
+        [&memory_system](const ros::WallTimerEvent &) { ReportAwsMemory(*memory_system); });
+    }
+    ros::WallTimer tls_session_timer;
+    if (tls_session_cache) {
+      // new sessions are saved here rather than from the tls callback of a lex call
+      tls_session_timer = node_handle.createWallTimer(
+        ros::WallDuration(kTlsSessionSaveIntervalS),
+        [&tls_session_cache](const ros::WallTimerEvent &) { tls_session_cache->Save(); });
+    }
+    AWS_LOG_INFO(__func__, "Starting Lex Node...");
 
-  // blocking here, waiting until shutdown.
-  ros::spin();
+    // blocking here, waiting until shutdown.
+    ros::spin();
 
-  AWS_LOG_INFO(__func__, "Shutting down Lex Node...");
+    AWS_LOG_INFO(__func__, "Shutting down Lex Node...");
+    // the lex client has to be freed before the sdk and its memory system are shut down
+  }
+  if (tls_session_cache) {
+    tls_session_cache->Save();
+    ReportTlsSessions(*tls_session_cache);
+  }
+  if (memory_system) {
+    ReportAwsMemory(*memory_system);
+  }
+  if (async_log_system) {
+    ReportLogging(*async_log_system);
+  }
+  // the loggers were allocated by the sdk memory system, the last references have to be released
+  // by ShutdownAWSLogging, before the sdk removes it. The lines left are forwarded then
+  async_log_system.reset();
+  ros_logger.reset();
   Aws::Utils::Logging::ShutdownAWSLogging();
   Aws::ShutdownAPI(options);
   return 0;
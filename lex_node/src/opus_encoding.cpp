@@ -0,0 +1,297 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/core/utils/logging/LogMacros.h>
+#include <lex_node/opus_encoding.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+#ifdef LEX_NODE_HAVE_OPUS
+#include <opus.h>
+#endif
+
+namespace Aws {
+namespace Lex {
+
+OpusEncodeJob::OpusEncodeJob(const int16_t * samples, std::size_t sample_count, int sample_rate,
+                             const OpusConfiguration & configuration)
+: samples_(samples),
+  sample_count_(sample_count),
+  sample_rate_(sample_rate),
+  configuration_(configuration),
+  frame_samples_(static_cast<std::size_t>(sample_rate) * configuration.frame_ms / 1000),
+  frame_bytes_(static_cast<std::size_t>(configuration.bit_rate) * configuration.frame_ms / 8000),
+  cancelled_(false),
+  encode_ms_(0.0)
+{
+  std::size_t frame_count = (sample_count + frame_samples_ - 1) / frame_samples_;
+  encoded_.resize(frame_count * frame_bytes_);
+}
+
+std::size_t OpusEncodeJob::WaitForBytes(std::size_t size)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [this, size] { return done_ || encoded_bytes_ >= size; });
+  return encoded_bytes_;
+}
+
+void OpusEncodeJob::Cancel()
+{
+  cancelled_ = true;
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!started_) {
+    // still queued, the worker will skip it
+    done_ = true;
+    condition_.notify_all();
+    return;
+  }
+  condition_.wait(lock, [this] { return done_; });
+}
+
+std::string OpusEncodeJob::ContentType() const
+{
+  std::ostringstream content_type;
+  content_type << "audio/x-cbr-opus-with-preamble; preamble-size=0; bit-rate="
+               << configuration_.bit_rate << "; frame-size-milliseconds=" << configuration_.frame_ms;
+  return content_type.str();
+}
+
+bool OpusEncodeJob::Succeeded() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_ && succeeded_;
+}
+
+void OpusEncodeJob::Finish(bool succeeded)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  done_ = true;
+  succeeded_ = succeeded;
+  condition_.notify_all();
+}
+
+void OpusEncodeJob::Run(::OpusEncoder * encoder)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (done_) {
+      return;
+    }
+    started_ = true;
+  }
+#ifdef LEX_NODE_HAVE_OPUS
+  if (!encoder) {
+    Finish(false);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  opus_encoder_ctl(encoder, OPUS_RESET_STATE);
+  std::vector<opus_int16> last_frame;
+  std::size_t frame_count = encoded_.size() / frame_bytes_;
+  for (std::size_t frame = 0; frame < frame_count; frame++) {
+    if (cancelled_) {
+      Finish(false);
+      return;
+    }
+    const opus_int16 * frame_samples = samples_ + frame * frame_samples_;
+    std::size_t available = sample_count_ - frame * frame_samples_;
+    if (available < frame_samples_) {
+      // zero pad the end of the audio to a whole frame
+      last_frame.assign(frame_samples_, 0);
+      std::copy(frame_samples, frame_samples + available, last_frame.begin());
+      frame_samples = last_frame.data();
+    }
+    unsigned char * packet = encoded_.data() + frame * frame_bytes_;
+    opus_int32 length = opus_encode(encoder, frame_samples, static_cast<int>(frame_samples_),
+                                    packet, static_cast<opus_int32>(frame_bytes_));
+    // constant bit rate packets have the frame size already, padding guarantees it
+    int error = length < 0 ? length : OPUS_OK;
+    if (length >= 0 && static_cast<std::size_t>(length) < frame_bytes_) {
+      error = opus_packet_pad(packet, length, static_cast<opus_int32>(frame_bytes_));
+    }
+    if (OPUS_OK != error) {
+      AWS_LOGSTREAM_ERROR(__func__, "Opus encoding failed: " << opus_strerror(error));
+      Finish(false);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    encoded_bytes_ += frame_bytes_;
+    condition_.notify_all();
+  }
+  encode_ms_ =
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  Finish(true);
+#else
+  (void)encoder;
+  Finish(false);
+#endif
+}
+
+std::size_t OpusEncodedBuffer::ReadOffset() const
+{
+  return eback() ? static_cast<std::size_t>(gptr() - eback()) : position_;
+}
+
+OpusEncodedBuffer::int_type OpusEncodedBuffer::underflow()
+{
+  position_ = ReadOffset();
+  std::size_t available = job_->WaitForBytes(position_ + 1);
+  if (available <= position_) {
+    return traits_type::eof();
+  }
+  // the encoded buffer is allocated up front, only the readable range grows
+  char * begin = reinterpret_cast<char *>(const_cast<uint8_t *>(job_->Data()));
+  setg(begin, begin + position_, begin + available);
+  return traits_type::to_int_type(*gptr());
+}
+
+OpusEncodedBuffer::pos_type OpusEncodedBuffer::seekoff(off_type offset,
+                                                       std::ios_base::seekdir direction,
+                                                       std::ios_base::openmode which)
+{
+  if (!(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+  off_type size = static_cast<off_type>(job_->EncodedSize());
+  off_type base = 0;
+  if (direction == std::ios_base::cur) {
+    base = static_cast<off_type>(ReadOffset());
+  } else if (direction == std::ios_base::end) {
+    base = size;
+  }
+  off_type position = base + offset;
+  if (position < 0 || position > size) {
+    return pos_type(off_type(-1));
+  }
+  // seeking does not wait for the encoder, the next read does
+  position_ = static_cast<std::size_t>(position);
+  setg(nullptr, nullptr, nullptr);
+  return pos_type(position);
+}
+
+OpusEncodedBuffer::pos_type OpusEncodedBuffer::seekpos(pos_type position,
+                                                       std::ios_base::openmode which)
+{
+  return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+std::streamsize OpusEncodedBuffer::showmanyc()
+{
+  std::size_t position = ReadOffset();
+  std::size_t size = job_->EncodedSize();
+  return position < size ? static_cast<std::streamsize>(size - position) : -1;
+}
+
+OpusEncodedStream::OpusEncodedStream(std::shared_ptr<OpusEncodeJob> job)
+: Aws::IOStream(nullptr), buffer_(std::move(job))
+{
+  rdbuf(&buffer_);
+}
+
+OpusEncoderWorker::OpusEncoderWorker(const OpusConfiguration & configuration)
+: configuration_(configuration), thread_(&OpusEncoderWorker::Run, this)
+{
+}
+
+OpusEncoderWorker::~OpusEncoderWorker()
+{
+  std::deque<std::shared_ptr<OpusEncodeJob>> jobs;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    jobs.swap(jobs_);
+  }
+  condition_.notify_all();
+  for (auto & job : jobs) {
+    job->Cancel();
+  }
+  thread_.join();
+}
+
+bool OpusEncoderWorker::IsAvailable()
+{
+#ifdef LEX_NODE_HAVE_OPUS
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool OpusEncoderWorker::IsSupportedRate(int sample_rate)
+{
+  return 8000 == sample_rate || 12000 == sample_rate || 16000 == sample_rate ||
+         24000 == sample_rate || 48000 == sample_rate;
+}
+
+std::shared_ptr<OpusEncodeJob> OpusEncoderWorker::Start(const int16_t * samples,
+                                                        std::size_t sample_count, int sample_rate)
+{
+  auto job = std::make_shared<OpusEncodeJob>(samples, sample_count, sample_rate, configuration_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(job);
+  }
+  condition_.notify_one();
+  return job;
+}
+
+void OpusEncoderWorker::Run()
+{
+  // encoders are kept per sample rate, reset before each job
+  std::map<int, ::OpusEncoder *> encoders;
+  while (true) {
+    std::shared_ptr<OpusEncodeJob> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+      if (stopping_) {
+        break;
+      }
+      job = jobs_.front();
+      jobs_.pop_front();
+    }
+    ::OpusEncoder *& encoder = encoders[job->SampleRate()];
+#ifdef LEX_NODE_HAVE_OPUS
+    if (!encoder) {
+      int error = OPUS_OK;
+      encoder = opus_encoder_create(job->SampleRate(), 1, OPUS_APPLICATION_VOIP, &error);
+      if (OPUS_OK != error) {
+        AWS_LOGSTREAM_ERROR(__func__, "Unable to create an opus encoder: " << opus_strerror(error));
+        encoder = nullptr;
+      } else {
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE(configuration_.bit_rate));
+        opus_encoder_ctl(encoder, OPUS_SET_VBR(0));
+        opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(configuration_.complexity));
+        opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+      }
+    }
+#endif
+    job->Run(encoder);
+  }
+#ifdef LEX_NODE_HAVE_OPUS
+  for (auto & encoder : encoders) {
+    if (encoder.second) {
+      opus_encoder_destroy(encoder.second);
+    }
+  }
+#endif
+}
+
+}  // namespace Lex
+}  // namespace Aws
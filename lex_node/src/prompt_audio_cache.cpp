@@ -0,0 +1,523 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/core/utils/logging/LogMacros.h>
+#include <lex_node/prompt_audio_cache.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/*
+ * Data file: a FileHeader, then records. A record is a RecordHeader, the key and the audio, padded
+ * to 8 bytes. The header of a record is written last, a record without it was never completed.
+ *
+ * Index file: a FileHeader with the generation of the data file it describes, then IndexEntry
+ * records in the order the records were appended.
+ */
+const char kDataMagic[8] = {'L', 'E', 'X', 'P', 'A', 'U', 'D', '1'};
+const char kIndexMagic[8] = {'L', 'E', 'X', 'P', 'I', 'D', 'X', '1'};
+constexpr uint32_t kRecordMagic = 0x50524f4d;
+const char kDataFileName[] = "prompt_audio.data";
+const char kIndexFileName[] = "prompt_audio.index";
+
+struct FileHeader
+{
+  char magic[8];
+  uint64_t generation;
+};
+
+struct RecordHeader
+{
+  uint32_t magic;
+  uint32_t key_size;
+  uint64_t audio_size;
+  uint64_t key_hash;
+};
+
+struct IndexEntry
+{
+  uint64_t key_hash;
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(sizeof(FileHeader) == 16, "unexpected file header padding");
+static_assert(sizeof(RecordHeader) == 24, "unexpected record header padding");
+static_assert(sizeof(IndexEntry) == 24, "unexpected index entry padding");
+
+uint64_t HashKey(const std::string & key)
+{
+  // fnv-1a
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char character : key) {
+    hash = (hash ^ static_cast<uint8_t>(character)) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t RecordSize(uint64_t key_size, uint64_t audio_size)
+{
+  return (sizeof(RecordHeader) + key_size + audio_size + 7) & ~static_cast<uint64_t>(7);
+}
+
+bool WriteAll(int fd, const void * data, std::size_t size, uint64_t offset)
+{
+  const char * bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t written = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+    if (written < 0 && EINTR == errno) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, void * data, std::size_t size, uint64_t offset)
+{
+  char * bytes = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t bytes_read = pread(fd, bytes, size, static_cast<off_t>(offset));
+    if (bytes_read < 0 && EINTR == errno) {
+      continue;
+    }
+    if (bytes_read <= 0) {
+      return false;
+    }
+    bytes += bytes_read;
+    size -= bytes_read;
+    offset += bytes_read;
+  }
+  return true;
+}
+
+bool MakeDirectories(const std::string & path)
+{
+  for (std::size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+    std::string prefix = path.substr(0, slash);
+    if (!prefix.empty() && 0 != mkdir(prefix.c_str(), 0755) && EEXIST != errno) {
+      return false;
+    }
+    if (std::string::npos == slash) {
+      return true;
+    }
+  }
+}
+
+uint64_t NewGeneration()
+{
+  std::random_device random;
+  return (static_cast<uint64_t>(random()) << 32) ^ random();
+}
+
+/**
+ * Open a file with the close on exec flag and an exclusive lock, -1 if either fails.
+ */
+int OpenLocked(const std::string & path, int flags)
+{
+  int fd = open(path.c_str(), flags | O_CLOEXEC, 0644);
+  if (fd >= 0 && 0 != flock(fd, LOCK_EX | LOCK_NB)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+}  // namespace
+
+/**
+ * A read only mapping of the data file, unmapped once the last PromptAudio using it is gone.
+ */
+class PromptAudioMapping
+{
+public:
+  PromptAudioMapping(void * address, std::size_t size) : address_(address), size_(size) {}
+  ~PromptAudioMapping() { munmap(address_, size_); }
+
+  const uint8_t * Data() const { return static_cast<const uint8_t *>(address_); }
+  std::size_t Size() const { return size_; }
+
+private:
+  void * address_;
+  std::size_t size_;
+};
+
+std::string MakePromptAudioKey(const std::string & bot_name, const std::string & bot_alias,
+                               const std::string & text_response,
+                               const std::string & message_format_type,
+                               const std::string & accept_type)
+{
+  // nul never appears in bot names, aliases, format names or content types
+  std::string key;
+  key.reserve(bot_name.size() + bot_alias.size() + message_format_type.size() +
+              accept_type.size() + text_response.size() + 4);
+  key.append(bot_name).push_back('\0');
+  key.append(bot_alias).push_back('\0');
+  key.append(message_format_type).push_back('\0');
+  key.append(accept_type).push_back('\0');
+  key.append(text_response);
+  return key;
+}
+
+PromptAudioCache::PromptAudioCache(const PromptAudioCacheConfiguration & configuration)
+: directory_(configuration.directory),
+  data_path_(configuration.directory + "/" + kDataFileName),
+  index_path_(configuration.directory + "/" + kIndexFileName),
+  max_bytes_(static_cast<uint64_t>(std::max(0, configuration.max_bytes)))
+{
+  if (!Open()) {
+    AWS_LOGSTREAM_WARN(__func__, "Unable to open the prompt audio cache in "
+                                   << directory_ << ": " << std::strerror(errno));
+    Close();
+  }
+}
+
+PromptAudioCache::~PromptAudioCache() { Close(); }
+
+bool PromptAudioCache::Open()
+{
+  if (!MakeDirectories(directory_)) {
+    return false;
+  }
+  data_fd_ = OpenLocked(data_path_, O_RDWR | O_CREAT);
+  if (data_fd_ < 0) {
+    return false;
+  }
+  struct stat data_stat;
+  if (0 != fstat(data_fd_, &data_stat)) {
+    return false;
+  }
+  data_size_ = static_cast<uint64_t>(data_stat.st_size);
+  FileHeader header;
+  if (data_size_ < sizeof(FileHeader) || !ReadAll(data_fd_, &header, sizeof(header), 0) ||
+      0 != std::memcmp(header.magic, kDataMagic, sizeof(kDataMagic))) {
+    // a new or unreadable cache starts empty
+    std::memcpy(header.magic, kDataMagic, sizeof(kDataMagic));
+    header.generation = NewGeneration();
+    if (0 != ftruncate(data_fd_, 0) || !WriteAll(data_fd_, &header, sizeof(header), 0)) {
+      return false;
+    }
+    data_size_ = sizeof(FileHeader);
+  }
+  generation_ = header.generation;
+  if (!LoadIndex() || !RefreshMapping()) {
+    return false;
+  }
+  stats_.entries = entries_.size();
+  stats_.data_bytes = data_size_;
+  AWS_LOGSTREAM_INFO(__func__, "Opened the prompt audio cache in "
+                                 << directory_ << " with " << entries_.size() << " prompts, "
+                                 << data_size_ << " bytes");
+  return true;
+}
+
+void PromptAudioCache::Close()
+{
+  if (index_fd_ >= 0) {
+    close(index_fd_);
+    index_fd_ = -1;
+  }
+  if (data_fd_ >= 0) {
+    close(data_fd_);
+    data_fd_ = -1;
+  }
+  mapping_.reset();
+  entries_.clear();
+}
+
+bool PromptAudioCache::LoadIndex()
+{
+  entries_.clear();
+  int index_fd = open(index_path_.c_str(), O_RDONLY | O_CLOEXEC);
+  bool is_valid = false;
+  uint64_t scanned_to = sizeof(FileHeader);
+  if (index_fd >= 0) {
+    FileHeader header;
+    struct stat index_stat;
+    is_valid = 0 == fstat(index_fd, &index_stat) &&
+               ReadAll(index_fd, &header, sizeof(header), 0) &&
+               0 == std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) &&
+               header.generation == generation_;
+    std::vector<IndexEntry> index;
+    if (is_valid) {
+      // an entry cut short by a crash is ignored, its record is recovered from the data file
+      index.resize((index_stat.st_size - sizeof(FileHeader)) / sizeof(IndexEntry));
+      is_valid = index.empty() || ReadAll(index_fd, index.data(), index.size() * sizeof(IndexEntry),
+                                          sizeof(FileHeader));
+    }
+    close(index_fd);
+    for (std::size_t position = 0; is_valid && position < index.size(); position++) {
+      const IndexEntry & entry = index[position];
+      RecordHeader record;
+      is_valid = entry.offset >= sizeof(FileHeader) && entry.offset + entry.size <= data_size_ &&
+                 ReadAll(data_fd_, &record, sizeof(record), entry.offset) &&
+                 kRecordMagic == record.magic && record.key_hash == entry.key_hash &&
+                 RecordSize(record.key_size, record.audio_size) == entry.size;
+      entries_[entry.key_hash] = Entry{entry.offset, entry.size, ++use_count_};
+      scanned_to = std::max(scanned_to, entry.offset + entry.size);
+    }
+  }
+  if (!is_valid) {
+    entries_.clear();
+    use_count_ = 0;
+    scanned_to = sizeof(FileHeader);
+  }
+  // rewriting the index adds the recovered records and drops a partial entry at its end
+  return ScanRecords(scanned_to) && WriteIndex();
+}
+
+bool PromptAudioCache::ScanRecords(uint64_t offset)
+{
+  while (offset + sizeof(RecordHeader) <= data_size_) {
+    RecordHeader record;
+    if (!ReadAll(data_fd_, &record, sizeof(record), offset) || kRecordMagic != record.magic) {
+      break;
+    }
+    uint64_t size = RecordSize(record.key_size, record.audio_size);
+    if (offset + size > data_size_) {
+      break;
+    }
+    entries_[record.key_hash] = Entry{offset, size, ++use_count_};
+    offset += size;
+  }
+  if (offset < data_size_) {
+    AWS_LOGSTREAM_WARN(__func__, "Dropping " << data_size_ - offset
+                                             << " bytes of incomplete prompt audio records");
+    if (0 != ftruncate(data_fd_, static_cast<off_t>(offset))) {
+      return false;
+    }
+    data_size_ = offset;
+  }
+  return true;
+}
+
+bool PromptAudioCache::WriteIndex()
+{
+  std::string temporary_path = index_path_ + ".tmp";
+  int index_fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (index_fd < 0) {
+    return false;
+  }
+  std::vector<std::pair<uint64_t, Entry>> entries(entries_.begin(), entries_.end());
+  // oldest first, the order records are loaded in sets their initial recency
+  std::sort(entries.begin(), entries.end(),
+            [](const std::pair<uint64_t, Entry> & a, const std::pair<uint64_t, Entry> & b) {
+              return a.second.last_used < b.second.last_used;
+            });
+  std::vector<char> contents(sizeof(FileHeader) + entries.size() * sizeof(IndexEntry));
+  FileHeader header;
+  std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+  header.generation = generation_;
+  std::memcpy(contents.data(), &header, sizeof(header));
+  char * position = contents.data() + sizeof(header);
+  for (auto & entry : entries) {
+    IndexEntry index_entry{entry.first, entry.second.offset, entry.second.size};
+    std::memcpy(position, &index_entry, sizeof(index_entry));
+    position += sizeof(index_entry);
+  }
+  bool is_written = WriteAll(index_fd, contents.data(), contents.size(), 0);
+  close(index_fd);
+  if (!is_written || 0 != rename(temporary_path.c_str(), index_path_.c_str())) {
+    return false;
+  }
+  if (index_fd_ >= 0) {
+    close(index_fd_);
+  }
+  index_fd_ = open(index_path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  return index_fd_ >= 0;
+}
+
+bool PromptAudioCache::AppendIndexEntry(uint64_t key_hash, const Entry & entry)
+{
+  IndexEntry index_entry{key_hash, entry.offset, entry.size};
+  return sizeof(index_entry) == write(index_fd_, &index_entry, sizeof(index_entry));
+}
+
+bool PromptAudioCache::RefreshMapping()
+{
+  if (mapping_ && mapping_->Size() == data_size_) {
+    return true;
+  }
+  void * address = mmap(nullptr, data_size_, PROT_READ, MAP_SHARED, data_fd_, 0);
+  if (MAP_FAILED == address) {
+    return false;
+  }
+  mapping_ = std::make_shared<PromptAudioMapping>(address, data_size_);
+  return true;
+}
+
+std::shared_ptr<const PromptAudio> PromptAudioCache::Lookup(const std::string & key)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = entries_.find(HashKey(key));
+  if (found == entries_.end() ||
+      (found->second.offset + found->second.size > mapping_->Size() && !RefreshMapping())) {
+    stats_.misses++;
+    return nullptr;
+  }
+  const uint8_t * record_data = mapping_->Data() + found->second.offset;
+  RecordHeader record;
+  std::memcpy(&record, record_data, sizeof(record));
+  const uint8_t * key_data = record_data + sizeof(RecordHeader);
+  if (record.key_size != key.size() || 0 != std::memcmp(key_data, key.data(), key.size())) {
+    stats_.misses++;
+    return nullptr;
+  }
+  found->second.last_used = ++use_count_;
+  stats_.hits++;
+  return std::make_shared<PromptAudio>(mapping_, key_data + record.key_size, record.audio_size);
+}
+
+bool PromptAudioCache::Insert(const std::string & key, const uint8_t * data, std::size_t size)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!IsOpen()) {
+    return false;
+  }
+  uint64_t key_hash = HashKey(key);
+  uint64_t record_size = RecordSize(key.size(), size);
+  if (sizeof(FileHeader) + record_size > max_bytes_) {
+    return false;
+  }
+  auto found = entries_.find(key_hash);
+  if (found != entries_.end()) {
+    RecordHeader record;
+    std::string cached_key(key.size(), '\0');
+    if (ReadAll(data_fd_, &record, sizeof(record), found->second.offset) &&
+        record.key_size == key.size() &&
+        ReadAll(data_fd_, &cached_key[0], key.size(), found->second.offset + sizeof(record)) &&
+        cached_key == key) {
+      found->second.last_used = ++use_count_;
+      return true;
+    }
+  }
+  // compacting to three quarters of the cap leaves room for the next prompts
+  uint64_t target_bytes = (max_bytes_ / 4) * 3;
+  target_bytes = target_bytes > record_size ? target_bytes - record_size : sizeof(FileHeader);
+  if (data_size_ + record_size > max_bytes_ && !Compact(target_bytes)) {
+    AWS_LOGSTREAM_WARN(__func__, "Unable to compact the prompt audio cache: "
+                                   << std::strerror(errno));
+    return false;
+  }
+
+  uint64_t offset = data_size_;
+  RecordHeader record{kRecordMagic, static_cast<uint32_t>(key.size()), size, key_hash};
+  const uint64_t padding = 0;
+  uint64_t audio_offset = offset + sizeof(RecordHeader) + key.size();
+  uint64_t padding_size = offset + record_size - audio_offset - size;
+  // the header goes last, a record cut short by a crash is not mistaken for a complete one
+  if (!WriteAll(data_fd_, key.data(), key.size(), offset + sizeof(RecordHeader)) ||
+      !WriteAll(data_fd_, data, size, audio_offset) ||
+      !WriteAll(data_fd_, &padding, padding_size, audio_offset + size) ||
+      !WriteAll(data_fd_, &record, sizeof(record), offset)) {
+    AWS_LOGSTREAM_WARN(__func__, "Unable to append to the prompt audio cache: "
+                                   << std::strerror(errno));
+    if (0 != ftruncate(data_fd_, static_cast<off_t>(offset))) {
+      Close();
+    }
+    return false;
+  }
+  data_size_ += record_size;
+  Entry entry{offset, record_size, ++use_count_};
+  entries_[key_hash] = entry;
+  AppendIndexEntry(key_hash, entry);
+  stats_.insertions++;
+  stats_.entries = entries_.size();
+  stats_.data_bytes = data_size_;
+  return true;
+}
+
+bool PromptAudioCache::Compact(uint64_t target_bytes)
+{
+  if (!RefreshMapping()) {
+    return false;
+  }
+  std::vector<std::pair<uint64_t, Entry>> entries(entries_.begin(), entries_.end());
+  std::sort(entries.begin(), entries.end(),
+            [](const std::pair<uint64_t, Entry> & a, const std::pair<uint64_t, Entry> & b) {
+              return a.second.last_used > b.second.last_used;
+            });
+
+  std::string temporary_path = data_path_ + ".tmp";
+  int data_fd = OpenLocked(temporary_path, O_RDWR | O_CREAT | O_TRUNC);
+  if (data_fd < 0) {
+    return false;
+  }
+  FileHeader header;
+  std::memcpy(header.magic, kDataMagic, sizeof(kDataMagic));
+  header.generation = NewGeneration();
+  uint64_t data_size = sizeof(FileHeader);
+  bool is_written = WriteAll(data_fd, &header, sizeof(header), 0);
+  std::unordered_map<uint64_t, Entry> kept;
+  for (auto & entry : entries) {
+    if (!is_written || data_size + entry.second.size > target_bytes) {
+      break;
+    }
+    is_written =
+      WriteAll(data_fd, mapping_->Data() + entry.second.offset, entry.second.size, data_size);
+    kept[entry.first] = Entry{data_size, entry.second.size, entry.second.last_used};
+    data_size += entry.second.size;
+  }
+  // the new file must be complete before it replaces the old one
+  if (!is_written || 0 != fdatasync(data_fd) ||
+      0 != rename(temporary_path.c_str(), data_path_.c_str())) {
+    close(data_fd);
+    unlink(temporary_path.c_str());
+    return false;
+  }
+  close(data_fd_);
+  data_fd_ = data_fd;
+  generation_ = header.generation;
+  data_size_ = data_size;
+  stats_.evictions += entries_.size() - kept.size();
+  entries_.swap(kept);
+  // lookups in flight keep reading the old file through the old mapping
+  mapping_.reset();
+  if (!WriteIndex() || !RefreshMapping()) {
+    Close();
+    return false;
+  }
+  stats_.entries = entries_.size();
+  stats_.data_bytes = data_size_;
+  return true;
+}
+
+PromptAudioCache::Stats PromptAudioCache::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace Lex
+}  // namespace Aws
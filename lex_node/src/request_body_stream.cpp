@@ -0,0 +1,74 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/request_body_stream.h>
+
+namespace Aws {
+namespace Lex {
+
+ReadOnlyStreamBuf::ReadOnlyStreamBuf(const char * data, std::size_t size)
+{
+  // the get area is never written to, the const_cast only satisfies the streambuf interface
+  char * begin = const_cast<char *>(data);
+  setg(begin, begin, begin + size);
+}
+
+ReadOnlyStreamBuf::pos_type ReadOnlyStreamBuf::seekoff(off_type offset,
+                                                       std::ios_base::seekdir direction,
+                                                       std::ios_base::openmode which)
+{
+  if (!(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+  off_type base = 0;
+  if (direction == std::ios_base::cur) {
+    base = gptr() - eback();
+  } else if (direction == std::ios_base::end) {
+    base = egptr() - eback();
+  }
+  off_type position = base + offset;
+  if (position < 0 || position > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + position, egptr());
+  return pos_type(position);
+}
+
+ReadOnlyStreamBuf::pos_type ReadOnlyStreamBuf::seekpos(pos_type position,
+                                                       std::ios_base::openmode which)
+{
+  return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+std::streamsize ReadOnlyStreamBuf::showmanyc()
+{
+  std::streamsize remaining = egptr() - gptr();
+  return remaining > 0 ? remaining : -1;
+}
+
+RequestBodyStream::RequestBodyStream(const uint8_t * data, std::size_t size)
+: Aws::IOStream(nullptr), buffer_(reinterpret_cast<const char *>(data), size)
+{
+  rdbuf(&buffer_);
+}
+
+RequestBodyStream::RequestBodyStream(const std::string & text)
+: Aws::IOStream(nullptr), buffer_(text.data(), text.size())
+{
+  rdbuf(&buffer_);
+}
+
+}  // namespace Lex
+}  // namespace Aws
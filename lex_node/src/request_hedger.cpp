@@ -0,0 +1,201 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/request_hedger.h>
+
+#include <algorithm>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Number of successful calls the hedge delay percentile is taken over.
+ */
+constexpr std::size_t kLatencyWindow = 200;
+
+/**
+ * Calls timed before the percentile is trusted.
+ */
+constexpr std::size_t kMinLatencySamples = 20;
+
+/**
+ * Most hedges saved up while calls are fast, sent in a burst when lex slows down.
+ */
+constexpr double kMaxBudget = 10.0;
+
+/**
+ * Most texts remembered as hedgeable, the least recently used are forgotten first.
+ */
+constexpr std::size_t kMaxHedgeableTexts = 1024;
+
+/**
+ * Duplicate calls in flight at once, more wait for a hedge thread.
+ */
+constexpr std::size_t kHedgeThreads = 4;
+
+}  // namespace
+
+RequestHedger::RequestHedger(const HedgingConfiguration & configuration)
+: configuration_(configuration),
+  hedgeable_intents_(configuration.intents.begin(), configuration.intents.end())
+{
+  latencies_.reserve(kLatencyWindow);
+  for (std::size_t thread = 0; thread < kHedgeThreads; thread++) {
+    hedge_threads_.emplace_back(&RequestHedger::RunHedges, this);
+  }
+}
+
+RequestHedger::~RequestHedger()
+{
+  {
+    std::lock_guard<std::mutex> lock(hedge_mutex_);
+    is_stopping_ = true;
+  }
+  hedge_scheduled_.notify_all();
+  // the calls of the duplicates still pending have replied, they are dropped
+  for (auto & hedge_thread : hedge_threads_) {
+    hedge_thread.join();
+  }
+}
+
+bool RequestHedger::IsHedgeable(const std::string & text_key, bool is_dialog_open)
+{
+  if (is_dialog_open) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = by_text_.find(text_key);
+  if (found == by_text_.end()) {
+    return false;
+  }
+  hedgeable_texts_.splice(hedgeable_texts_.begin(), hedgeable_texts_, found->second);
+  return true;
+}
+
+void RequestHedger::RecordIntent(const std::string & text_key, const std::string & intent_name,
+                                 bool is_dialog_open)
+{
+  bool is_hedgeable = !is_dialog_open && hedgeable_intents_.count(intent_name) > 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = by_text_.find(text_key);
+  if (found != by_text_.end()) {
+    if (is_hedgeable) {
+      hedgeable_texts_.splice(hedgeable_texts_.begin(), hedgeable_texts_, found->second);
+    } else {
+      // the bot changed, the text now starts another intent or a dialog
+      hedgeable_texts_.erase(found->second);
+      by_text_.erase(found);
+    }
+    return;
+  }
+  if (!is_hedgeable) {
+    return;
+  }
+  hedgeable_texts_.push_front(text_key);
+  by_text_[text_key] = hedgeable_texts_.begin();
+  if (hedgeable_texts_.size() > kMaxHedgeableTexts) {
+    by_text_.erase(hedgeable_texts_.back());
+    hedgeable_texts_.pop_back();
+  }
+}
+
+RequestHedger::Stats RequestHedger::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+RequestHedger::Clock::duration RequestHedger::HedgeDelay()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.calls++;
+  budget_ = std::min(kMaxBudget, budget_ + configuration_.budget_percent / 100.0);
+  Clock::duration delay = Clock::duration::zero();
+  if (configuration_.delay_ms > 0) {
+    delay = std::chrono::milliseconds(configuration_.delay_ms);
+  } else if (latencies_.size() >= kMinLatencySamples) {
+    std::vector<Clock::duration> latencies(latencies_);
+    auto rank = static_cast<std::size_t>(configuration_.percentile / 100.0 * latencies.size());
+    auto percentile = latencies.begin() + std::min(rank, latencies.size() - 1);
+    std::nth_element(latencies.begin(), percentile, latencies.end());
+    delay = std::max<Clock::duration>(*percentile,
+                                      std::chrono::milliseconds(configuration_.min_delay_ms));
+  }
+  stats_.delay_ms = std::chrono::duration<double, std::milli>(delay).count();
+  return delay;
+}
+
+bool RequestHedger::AcquireHedge()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (budget_ < 1.0) {
+    stats_.budget_denials++;
+    return false;
+  }
+  budget_ -= 1.0;
+  stats_.hedges++;
+  return true;
+}
+
+void RequestHedger::RecordLatency(Clock::duration latency, bool is_hedge_win)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (is_hedge_win) {
+    stats_.hedge_wins++;
+  }
+  if (latencies_.size() < kLatencyWindow) {
+    latencies_.push_back(latency);
+  } else {
+    latencies_[next_latency_] = latency;
+    next_latency_ = (next_latency_ + 1) % kLatencyWindow;
+  }
+}
+
+void RequestHedger::ScheduleHedge(Clock::time_point due, std::function<void()> hedge)
+{
+  {
+    std::lock_guard<std::mutex> lock(hedge_mutex_);
+    pending_hedges_.emplace(due, std::move(hedge));
+  }
+  hedge_scheduled_.notify_one();
+}
+
+void RequestHedger::RunHedges()
+{
+  std::unique_lock<std::mutex> lock(hedge_mutex_);
+  while (!is_stopping_) {
+    if (pending_hedges_.empty()) {
+      hedge_scheduled_.wait(lock);
+      continue;
+    }
+    auto next = pending_hedges_.begin();
+    const Clock::time_point due = next->first;
+    if (Clock::now() < due) {
+      // an earlier duplicate may be scheduled meanwhile, or another hedge thread run this one
+      hedge_scheduled_.wait_until(lock, due);
+      continue;
+    }
+    auto hedge = std::move(next->second);
+    pending_hedges_.erase(next);
+    lock.unlock();
+    hedge();
+    lock.lock();
+  }
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/request_trace.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+bool WriteAll(int fd, const char * data, std::size_t size)
+{
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0 && EINTR == errno) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+}  // namespace
+
+uint32_t HashPayload(const uint8_t * data, std::size_t size)
+{
+  uint32_t hash = 2166136261u;
+  for (std::size_t index = 0; index < size; index++) {
+    hash = (hash ^ data[index]) * 16777619u;
+  }
+  return hash;
+}
+
+std::ostream & operator<<(std::ostream & os, const RequestTrace & trace)
+{
+  char hash[9];
+  std::snprintf(hash, sizeof(hash), "%08x", HashPayload(trace.payload, trace.payload_size));
+  return os << "bot=" << trace.bot_name << " alias=" << trace.bot_alias
+            << " user=" << trace.user_id << " content_type=\"" << trace.content_type
+            << "\" accept=\"" << trace.accept_type << "\" payload_bytes=" << trace.payload_size
+            << " body_bytes=" << trace.body_size << " hash=" << hash;
+}
+
+PayloadSampler::PayloadSampler(const TraceConfiguration & configuration)
+: samples_per_s_(configuration.samples_per_minute / 60),
+  max_file_bytes_(std::max(configuration.max_file_bytes, 0)),
+  fd_(open(configuration.payload_file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600)),
+  refilled_(Clock::now())
+{
+  struct stat file_stat;
+  if (fd_ >= 0 && 0 == fstat(fd_, &file_stat)) {
+    stats_.file_bytes = file_stat.st_size;
+  }
+}
+
+PayloadSampler::~PayloadSampler()
+{
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool PayloadSampler::Sample(const RequestTrace & trace)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto now = Clock::now();
+  tokens_ = std::min(1.0, tokens_ + std::chrono::duration<double>(now - refilled_).count() *
+                                      samples_per_s_);
+  refilled_ = now;
+  if (fd_ < 0 || tokens_ < 1.0) {
+    stats_.skipped++;
+    return false;
+  }
+  std::ostringstream header;
+  header << std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::system_clock::now().time_since_epoch())
+              .count()
+         << ' ' << trace << '\n';
+  std::string record = header.str();
+  uint64_t record_bytes = record.size() + trace.payload_size + 1;
+  if (stats_.file_bytes + record_bytes > max_file_bytes_) {
+    stats_.skipped++;
+    return false;
+  }
+  tokens_ -= 1.0;
+  // one write per record, appended whole
+  record.append(reinterpret_cast<const char *>(trace.payload), trace.payload_size);
+  record += '\n';
+  if (!WriteAll(fd_, record.data(), record.size())) {
+    close(fd_);
+    fd_ = -1;
+    stats_.skipped++;
+    return false;
+  }
+  stats_.samples++;
+  stats_.file_bytes += record_bytes;
+  return true;
+}
+
+PayloadSampler::Stats PayloadSampler::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/response_audio_stream.h>
+
+#include <utility>
+
+namespace Aws {
+namespace Lex {
+
+/**
+ * Capacity of the first buffer when the body size is not known.
+ */
+constexpr std::size_t kInitialCapacity = 16 * 1024;
+
+ResponseAudioBuffer::~ResponseAudioBuffer()
+{
+  if (pool_) {
+    pool_->Release(std::move(data_));
+  }
+}
+
+void ResponseAudioBuffer::Reserve(std::size_t size)
+{
+  if (size > data_.capacity()) {
+    Grow(size);
+  }
+}
+
+void ResponseAudioBuffer::MoveTo(std::vector<uint8_t> & destination)
+{
+  destination.swap(data_);
+  data_.clear();
+  setg(nullptr, nullptr, nullptr);
+}
+
+void ResponseAudioBuffer::Discard()
+{
+  is_discarding_ = true;
+  bytes_discarded_ += data_.size();
+  if (pool_) {
+    pool_->Release(std::move(data_));
+  }
+  std::vector<uint8_t>().swap(data_);
+  setg(nullptr, nullptr, nullptr);
+}
+
+void ResponseAudioBuffer::Grow(std::size_t capacity)
+{
+  std::size_t read_offset = ReadOffset();
+  // moving what was received so far
+  bytes_copied_ += data_.size();
+  if (pool_) {
+    std::vector<uint8_t> buffer = pool_->Acquire(capacity);
+    buffer.insert(buffer.end(), data_.begin(), data_.end());
+    data_.swap(buffer);
+    pool_->Release(std::move(buffer));
+  } else {
+    data_.reserve(capacity);
+  }
+  ResetGetArea(read_offset);
+}
+
+std::streamsize ResponseAudioBuffer::xsputn(const char * data, std::streamsize size)
+{
+  if (is_discarding_) {
+    bytes_discarded_ += size;
+    return size;
+  }
+  std::size_t read_offset = ReadOffset();
+  std::size_t required = data_.size() + size;
+  if (required > data_.capacity()) {
+    std::size_t capacity = data_.capacity() ? 2 * data_.capacity() : kInitialCapacity;
+    Grow(capacity > required ? capacity : required);
+  }
+  // inserting a range copies straight into the spare capacity, unlike resize() which zero fills it
+  const uint8_t * begin = reinterpret_cast<const uint8_t *>(data);
+  data_.insert(data_.end(), begin, begin + size);
+  bytes_copied_ += size;
+  ResetGetArea(read_offset);
+  return size;
+}
+
+ResponseAudioBuffer::int_type ResponseAudioBuffer::overflow(int_type character)
+{
+  if (traits_type::eq_int_type(character, traits_type::eof())) {
+    return traits_type::not_eof(character);
+  }
+  char byte = traits_type::to_char_type(character);
+  xsputn(&byte, 1);
+  return character;
+}
+
+ResponseAudioBuffer::int_type ResponseAudioBuffer::underflow()
+{
+  ResetGetArea(ReadOffset());
+  if (gptr() == egptr()) {
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(*gptr());
+}
+
+ResponseAudioBuffer::pos_type ResponseAudioBuffer::seekoff(off_type offset,
+                                                          std::ios_base::seekdir direction,
+                                                          std::ios_base::openmode which)
+{
+  off_type size = static_cast<off_type>(data_.size());
+  if (which & std::ios_base::out) {
+    // writes always append, only report the end of the data
+    return (0 == offset && direction != std::ios_base::beg) ? pos_type(size)
+                                                             : pos_type(off_type(-1));
+  }
+  off_type base = 0;
+  if (direction == std::ios_base::cur) {
+    base = static_cast<off_type>(ReadOffset());
+  } else if (direction == std::ios_base::end) {
+    base = size;
+  }
+  off_type position = base + offset;
+  if (position < 0 || position > size) {
+    return pos_type(off_type(-1));
+  }
+  ResetGetArea(static_cast<std::size_t>(position));
+  return pos_type(position);
+}
+
+ResponseAudioBuffer::pos_type ResponseAudioBuffer::seekpos(pos_type position,
+                                                          std::ios_base::openmode which)
+{
+  return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+void ResponseAudioBuffer::ResetGetArea(std::size_t read_offset)
+{
+  if (data_.empty()) {
+    setg(nullptr, nullptr, nullptr);
+    return;
+  }
+  char * begin = reinterpret_cast<char *>(data_.data());
+  setg(begin, begin + read_offset, begin + data_.size());
+}
+
+std::size_t ResponseAudioBuffer::ReadOffset() const
+{
+  return eback() ? static_cast<std::size_t>(gptr() - eback()) : 0;
+}
+
+ResponseAudioStream::ResponseAudioStream(AudioBufferPool * pool)
+: Aws::IOStream(nullptr), buffer_(pool)
+{
+  rdbuf(&buffer_);
+}
+
+}  // namespace Lex
+}  // namespace Aws
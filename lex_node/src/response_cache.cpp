@@ -0,0 +1,170 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/response_cache.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace Aws {
+namespace Lex {
+
+std::size_t CachedResponse::ByteSize() const
+{
+  std::size_t size = sizeof(CachedResponse) + text_response.size() +
+                     message_format_type.size() + intent_name.size() + dialog_state.size() +
+                     audio_response.size();
+  for (auto & slot : slots) {
+    size += sizeof(slot) + slot.first.size() + slot.second.size();
+  }
+  return size;
+}
+
+std::string NormalizeCacheText(const std::string & text)
+{
+  std::string normalized;
+  normalized.reserve(text.size());
+  bool pending_space = false;
+  for (char character : text) {
+    auto byte = static_cast<unsigned char>(character);
+    if (std::isspace(byte)) {
+      pending_space = !normalized.empty();
+      continue;
+    }
+    if (pending_space) {
+      normalized.push_back(' ');
+      pending_space = false;
+    }
+    // only ascii letters are folded, utf-8 sequences are kept as they are
+    normalized.push_back(byte < 0x80 ? static_cast<char>(std::tolower(byte)) : character);
+  }
+  auto is_punctuation = [](char character) {
+    auto byte = static_cast<unsigned char>(character);
+    return byte < 0x80 && std::ispunct(byte);
+  };
+  while (!normalized.empty() && is_punctuation(normalized.back())) {
+    normalized.pop_back();
+  }
+  while (!normalized.empty() && ' ' == normalized.back()) {
+    normalized.pop_back();
+  }
+  std::size_t begin = 0;
+  while (begin < normalized.size() && is_punctuation(normalized[begin])) {
+    begin++;
+  }
+  if (begin < normalized.size() && ' ' == normalized[begin]) {
+    begin++;
+  }
+  return normalized.substr(begin);
+}
+
+std::string MakeResponseCacheKey(const std::string & bot_name, const std::string & bot_alias,
+                                 const std::string & text_request, const std::string & accept_type)
+{
+  // nul never appears in bot names, aliases or content types
+  std::string key;
+  key.reserve(bot_name.size() + bot_alias.size() + text_request.size() + accept_type.size() + 3);
+  key.append(bot_name).push_back('\0');
+  key.append(bot_alias).push_back('\0');
+  key.append(accept_type).push_back('\0');
+  key.append(NormalizeCacheText(text_request));
+  return key;
+}
+
+ResponseCache::ResponseCache(const ResponseCacheConfiguration & configuration)
+: max_entries_(static_cast<std::size_t>(std::max(0, configuration.max_entries))),
+  max_bytes_(static_cast<std::size_t>(std::max(0, configuration.max_bytes))),
+  ttl_(std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(configuration.ttl_s))),
+  cacheable_intents_(configuration.intents.begin(), configuration.intents.end())
+{
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::Lookup(const std::string & key,
+                                                            bool is_dialog_open,
+                                                            Clock::time_point now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = by_key_.find(key);
+  if (found == by_key_.end() || is_dialog_open) {
+    stats_.misses++;
+    return nullptr;
+  }
+  auto entry = found->second;
+  if (entry->expiry <= now) {
+    EraseLocked(entry);
+    stats_.expirations++;
+    stats_.misses++;
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, entry);
+  stats_.hits++;
+  return entry->response;
+}
+
+bool ResponseCache::Insert(const std::string & key, CachedResponse response,
+                           bool has_session_attributes, Clock::time_point now)
+{
+  bool ends_dialog =
+    "ReadyForFulfillment" == response.dialog_state || "Fulfilled" == response.dialog_state;
+  if (has_session_attributes || !ends_dialog ||
+      0 == cacheable_intents_.count(response.intent_name)) {
+    return false;
+  }
+  std::size_t bytes = key.size() + response.ByteSize();
+  if (bytes > max_bytes_ || 0 == max_entries_) {
+    return false;
+  }
+  Entry entry{key, std::make_shared<const CachedResponse>(std::move(response)), bytes, now + ttl_};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = by_key_.find(key);
+  if (found != by_key_.end()) {
+    EraseLocked(found->second);
+  }
+  entries_.push_front(std::move(entry));
+  by_key_[key] = entries_.begin();
+  stats_.bytes += bytes;
+  stats_.entries++;
+  stats_.insertions++;
+  EvictLocked();
+  return true;
+}
+
+ResponseCache::Stats ResponseCache::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void ResponseCache::EvictLocked()
+{
+  while (stats_.entries > max_entries_ || stats_.bytes > max_bytes_) {
+    EraseLocked(std::prev(entries_.end()));
+    stats_.evictions++;
+  }
+}
+
+void ResponseCache::EraseLocked(std::list<Entry>::iterator entry)
+{
+  stats_.bytes -= entry->bytes;
+  stats_.entries--;
+  by_key_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/session_serializer.h>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace Aws {
+namespace Lex {
+
+std::string MakeSessionKey(const std::string & bot_name, const std::string & bot_alias,
+                           const std::string & user_id)
+{
+  std::string session_key;
+  session_key.reserve(bot_name.size() + bot_alias.size() + user_id.size() + 2);
+  session_key.append(bot_name).append(1, '/').append(bot_alias).append(1, '/').append(user_id);
+  return session_key;
+}
+
+bool IsDialogOpen(const std::string & dialog_state)
+{
+  return "ElicitSlot" == dialog_state || "ConfirmIntent" == dialog_state;
+}
+
+SessionSerializer::Turn::Turn(SessionSerializer * serializer, Shard * shard,
+                              std::string session_key, std::shared_ptr<Session> session)
+: serializer_(serializer),
+  shard_(shard),
+  session_key_(std::move(session_key)),
+  session_(std::move(session))
+{
+}
+
+SessionSerializer::Turn::Turn(Turn && other)
+: serializer_(other.serializer_),
+  shard_(other.shard_),
+  session_key_(std::move(other.session_key_)),
+  session_(std::move(other.session_))
+{
+  other.serializer_ = nullptr;
+}
+
+SessionSerializer::Turn::~Turn()
+{
+  if (serializer_ && session_) {
+    serializer_->Leave(*shard_, session_key_, *session_);
+  }
+}
+
+std::string SessionSerializer::Turn::GetDialogState() const
+{
+  if (!serializer_ || !session_) {
+    return std::string();
+  }
+  std::lock_guard<std::mutex> lock(shard_->mutex);
+  return session_->info.dialog_state;
+}
+
+void SessionSerializer::Turn::SetDialogState(const std::string & dialog_state)
+{
+  if (serializer_ && session_) {
+    std::lock_guard<std::mutex> lock(shard_->mutex);
+    session_->info.dialog_state = dialog_state;
+  }
+}
+
+std::shared_ptr<const SessionAttributes> SessionSerializer::Turn::GetSessionAttributes() const
+{
+  if (!serializer_ || !session_) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(shard_->mutex);
+  return session_->info.session_attributes;
+}
+
+void SessionSerializer::Turn::SetSessionAttributes(
+  std::shared_ptr<const SessionAttributes> session_attributes)
+{
+  if (serializer_ && session_) {
+    std::lock_guard<std::mutex> lock(shard_->mutex);
+    session_->info.session_attributes = std::move(session_attributes);
+  }
+}
+
+SessionSerializer::SessionSerializer(std::size_t max_sessions, std::size_t shards)
+{
+  shards = std::max<std::size_t>(shards, 1);
+  max_sessions_per_shard_ = std::max<std::size_t>((max_sessions + shards - 1) / shards, 1);
+  shards_.reserve(shards);
+  for (std::size_t shard = 0; shard < shards; shard++) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+SessionSerializer::Shard & SessionSerializer::GetShard(const std::string & session_key)
+{
+  return *shards_[std::hash<std::string>()(session_key) % shards_.size()];
+}
+
+SessionSerializer::Turn SessionSerializer::Enter(const std::string & session_key)
+{
+  auto & shard = GetShard(session_key);
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  auto now = std::chrono::steady_clock::now();
+  auto & session = shard.sessions[session_key];
+  if (!session) {
+    session = std::make_shared<Session>();
+    session->info.created = now;
+    Evict(shard, max_sessions_per_shard_);
+  } else if (session->now_serving == session->next_ticket) {
+    // the session was idle
+    shard.idle_sessions.erase(session->idle_position);
+  }
+  auto owned_session = session;
+  owned_session->info.last_used = now;
+  const uint64_t ticket = owned_session->next_ticket++;
+  owned_session->turn_done.wait(
+    lock, [&owned_session, ticket] { return owned_session->now_serving == ticket; });
+  return Turn(this, &shard, session_key, owned_session);
+}
+
+void SessionSerializer::Leave(Shard & shard, const std::string & session_key, Session & session)
+{
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  session.now_serving++;
+  session.info.turns++;
+  session.info.last_used = std::chrono::steady_clock::now();
+  if (session.now_serving == session.next_ticket) {
+    // nobody is waiting, the session stays in the table until it is evicted
+    shard.idle_sessions.push_front(session_key);
+    session.idle_position = shard.idle_sessions.begin();
+    Evict(shard, max_sessions_per_shard_);
+  } else {
+    session.turn_done.notify_all();
+  }
+}
+
+void SessionSerializer::Evict(Shard & shard, std::size_t max_sessions)
+{
+  while (shard.sessions.size() > max_sessions && !shard.idle_sessions.empty()) {
+    shard.sessions.erase(shard.idle_sessions.back());
+    shard.idle_sessions.pop_back();
+    shard.evictions++;
+  }
+}
+
+bool SessionSerializer::GetSession(const std::string & session_key, SessionInfo & info)
+{
+  auto & shard = GetShard(session_key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto session = shard.sessions.find(session_key);
+  if (session == shard.sessions.end()) {
+    return false;
+  }
+  info = session->second->info;
+  info.turns_in_flight = session->second->next_ticket - session->second->now_serving;
+  return true;
+}
+
+size_t SessionSerializer::ActiveSessions()
+{
+  size_t active_sessions = 0;
+  for (auto & shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    active_sessions += shard->sessions.size() - shard->idle_sessions.size();
+  }
+  return active_sessions;
+}
+
+size_t SessionSerializer::Sessions()
+{
+  size_t sessions = 0;
+  for (auto & shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    sessions += shard->sessions.size();
+  }
+  return sessions;
+}
+
+uint64_t SessionSerializer::Evictions()
+{
+  uint64_t evictions = 0;
+  for (auto & shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    evictions += shard->evictions;
+  }
+  return evictions;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,366 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/slot_decoder.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Value of each base64 digit, -1 for the other characters.
+ */
+std::array<int8_t, 256> MakeBase64Digits()
+{
+  std::array<int8_t, 256> digits;
+  digits.fill(-1);
+  const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (int digit = 0; digit < 64; digit++) {
+    digits[static_cast<unsigned char>(alphabet[digit])] = static_cast<int8_t>(digit);
+  }
+  return digits;
+}
+
+/**
+ * Decode base64, padded or not.
+ *
+ * @param encoded base64 text
+ * @param size of encoded
+ * @param decoded [out] decoded bytes, its capacity reused
+ * @return false if encoded is not base64
+ */
+bool DecodeBase64(const char * encoded, std::size_t size, std::string & decoded)
+{
+  static const std::array<int8_t, 256> kDigits = MakeBase64Digits();
+  for (int padding = 0; padding < 2 && size > 0 && '=' == encoded[size - 1]; padding++) {
+    size--;
+  }
+  if (1 == size % 4) {
+    return false;
+  }
+  decoded.resize(size / 4 * 3 + (0 == size % 4 ? 0 : size % 4 - 1));
+  char * out = &decoded[0];
+  uint32_t bits = 0;
+  int digits = 0;
+  for (std::size_t index = 0; index < size; index++) {
+    int8_t digit = kDigits[static_cast<unsigned char>(encoded[index])];
+    if (digit < 0) {
+      return false;
+    }
+    bits = bits << 6 | static_cast<uint32_t>(digit);
+    if (4 == ++digits) {
+      *out++ = static_cast<char>(bits >> 16);
+      *out++ = static_cast<char>(bits >> 8);
+      *out++ = static_cast<char>(bits);
+      bits = 0;
+      digits = 0;
+    }
+  }
+  if (2 == digits) {
+    *out++ = static_cast<char>(bits >> 4);
+  } else if (3 == digits) {
+    *out++ = static_cast<char>(bits >> 10);
+    *out++ = static_cast<char>(bits >> 2);
+  }
+  return true;
+}
+
+bool IsWhitespace(char c) { return ' ' == c || '\t' == c || '\n' == c || '\r' == c; }
+
+void SkipWhitespace(const char * data, std::size_t size, std::size_t & position)
+{
+  while (position < size && IsWhitespace(data[position])) {
+    position++;
+  }
+}
+
+bool ParseHex4(const char * data, std::size_t size, std::size_t & position, uint32_t & value)
+{
+  if (position + 4 > size) {
+    return false;
+  }
+  value = 0;
+  for (int digit = 0; digit < 4; digit++) {
+    char c = data[position++];
+    value <<= 4;
+    if ('0' <= c && c <= '9') {
+      value |= c - '0';
+    } else if ('a' <= c && c <= 'f') {
+      value |= c - 'a' + 10;
+    } else if ('A' <= c && c <= 'F') {
+      value |= c - 'A' + 10;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @return the number of bytes of the utf-8 encoding of the code point written to out
+ */
+std::size_t EncodeUtf8(uint32_t code_point, char * out)
+{
+  if (code_point < 0x80) {
+    out[0] = static_cast<char>(code_point);
+    return 1;
+  }
+  if (code_point < 0x800) {
+    out[0] = static_cast<char>(0xC0 | code_point >> 6);
+    out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 2;
+  }
+  if (code_point < 0x10000) {
+    out[0] = static_cast<char>(0xE0 | code_point >> 12);
+    out[1] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+    out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 3;
+  }
+  out[0] = static_cast<char>(0xF0 | code_point >> 18);
+  out[1] = static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+  out[2] = static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+  out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+  return 4;
+}
+
+/**
+ * Unescape a json string in place. The unescaped string is never longer than its json text, it is
+ * written over it.
+ *
+ * @param data json text
+ * @param size of data
+ * @param position [in,out] of the opening quote, after the closing quote on success
+ * @param string [out] start of the unescaped string
+ * @param string_size [out] size of the unescaped string
+ * @return false if the string is not valid json
+ */
+bool ParseString(char * data, std::size_t size, std::size_t & position, const char *& string,
+                 std::size_t & string_size)
+{
+  std::size_t read = position + 1;
+  std::size_t write = read;
+  string = data + write;
+  while (read < size) {
+    char c = data[read++];
+    if ('"' == c) {
+      string_size = data + write - string;
+      position = read;
+      return true;
+    }
+    if (static_cast<unsigned char>(c) < 0x20) {
+      return false;
+    }
+    if ('\\' != c) {
+      data[write++] = c;
+      continue;
+    }
+    if (read >= size) {
+      return false;
+    }
+    char escape = data[read++];
+    switch (escape) {
+      case '"':
+      case '\\':
+      case '/':
+        data[write++] = escape;
+        break;
+      case 'b':
+        data[write++] = '\b';
+        break;
+      case 'f':
+        data[write++] = '\f';
+        break;
+      case 'n':
+        data[write++] = '\n';
+        break;
+      case 'r':
+        data[write++] = '\r';
+        break;
+      case 't':
+        data[write++] = '\t';
+        break;
+      case 'u': {
+        uint32_t code_point;
+        if (!ParseHex4(data, size, read, code_point)) {
+          return false;
+        }
+        if (0xD800 <= code_point && code_point < 0xDC00) {
+          // a high surrogate pairs with the low surrogate escaped next
+          std::size_t next = read + 2;
+          uint32_t low = 0;
+          if (read + 1 < size && '\\' == data[read] && 'u' == data[read + 1] &&
+              ParseHex4(data, size, next, low) && 0xDC00 <= low && low < 0xE000) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+            read = next;
+          } else {
+            code_point = 0xFFFD;
+          }
+        } else if (0xDC00 <= code_point && code_point < 0xE000) {
+          code_point = 0xFFFD;
+        }
+        write += EncodeUtf8(code_point, data + write);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return false;
+}
+
+/**
+ * Skip a json number, boolean, object or array, keeping its text.
+ *
+ * @param data json text
+ * @param size of data
+ * @param position [in,out] of the value, after it on success
+ * @return false if the value is not valid json
+ */
+bool SkipValue(const char * data, std::size_t size, std::size_t & position)
+{
+  char first = data[position];
+  if ('{' == first || '[' == first) {
+    int depth = 0;
+    do {
+      char c = data[position++];
+      if ('"' == c) {
+        while (position < size && '"' != data[position]) {
+          position += '\\' == data[position] ? 2 : 1;
+        }
+        if (position >= size) {
+          return false;
+        }
+        position++;
+      } else if ('{' == c || '[' == c) {
+        depth++;
+      } else if ('}' == c || ']' == c) {
+        depth--;
+      }
+    } while (depth > 0 && position < size);
+    return 0 == depth;
+  }
+  for (const char * literal : {"true", "false"}) {
+    std::size_t length = std::strlen(literal);
+    if (size - position >= length && 0 == std::memcmp(data + position, literal, length)) {
+      position += length;
+      return true;
+    }
+  }
+  std::size_t start = position;
+  while (position < size && (('0' <= data[position] && data[position] <= '9') ||
+                             std::strchr("+-.eE", data[position]) != nullptr)) {
+    position++;
+  }
+  return position > start && ('-' == data[start] || ('0' <= data[start] && data[start] <= '9'));
+}
+
+/**
+ * Parse a flat json object in place.
+ *
+ * @param data json text, the strings are unescaped over it
+ * @param size of data
+ * @param views [out] members of the object
+ * @return false if data is not a json object
+ */
+bool ParseObject(char * data, std::size_t size, std::vector<SlotView> & views)
+{
+  // decoded headers may end with the NUL of a c string
+  while (size > 0 && '\0' == data[size - 1]) {
+    size--;
+  }
+  std::size_t position = 0;
+  SkipWhitespace(data, size, position);
+  if (position >= size || '{' != data[position++]) {
+    return false;
+  }
+  SkipWhitespace(data, size, position);
+  if (position < size && '}' == data[position]) {
+    position++;
+  } else {
+    for (;;) {
+      SlotView view;
+      if (position >= size || '"' != data[position] ||
+          !ParseString(data, size, position, view.key, view.key_size)) {
+        return false;
+      }
+      SkipWhitespace(data, size, position);
+      if (position >= size || ':' != data[position++]) {
+        return false;
+      }
+      SkipWhitespace(data, size, position);
+      if (position >= size) {
+        return false;
+      }
+      if ('"' == data[position]) {
+        if (!ParseString(data, size, position, view.value, view.value_size)) {
+          return false;
+        }
+      } else if (size - position >= 4 && 0 == std::memcmp(data + position, "null", 4)) {
+        view.value = data + position;
+        view.value_size = 0;
+        position += 4;
+      } else {
+        std::size_t start = position;
+        if (!SkipValue(data, size, position)) {
+          return false;
+        }
+        view.value = data + start;
+        view.value_size = position - start;
+      }
+      views.push_back(view);
+      SkipWhitespace(data, size, position);
+      if (position >= size) {
+        return false;
+      }
+      char separator = data[position++];
+      if ('}' == separator) {
+        break;
+      }
+      if (',' != separator) {
+        return false;
+      }
+      SkipWhitespace(data, size, position);
+    }
+  }
+  SkipWhitespace(data, size, position);
+  return position == size;
+}
+
+}  // namespace
+
+const std::vector<SlotView> * DecodeSlotViews(const char * encoded, std::size_t size)
+{
+  thread_local std::string decoded;
+  thread_local std::vector<SlotView> views;
+  views.clear();
+  if (0 == size) {
+    // lex leaves the header out when there are none
+    return &views;
+  }
+  if (!DecodeBase64(encoded, size, decoded) || decoded.empty() ||
+      !ParseObject(&decoded[0], decoded.size(), views)) {
+    return nullptr;
+  }
+  return &views;
+}
+
+}  // namespace Lex
+}  // namespace Aws
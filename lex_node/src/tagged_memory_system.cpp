@@ -0,0 +1,306 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/tagged_memory_system.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Raise a peak counter to a live value.
+ */
+void RaisePeak(std::atomic<int64_t> & peak_bytes, int64_t live_bytes)
+{
+  int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+  while (live_bytes > peak &&
+         !peak_bytes.compare_exchange_weak(peak, live_bytes, std::memory_order_relaxed)) {
+  }
+}
+
+/**
+ * @return the slot to start probing for a tag address at
+ */
+uint32_t FirstProbe(const char * allocation_tag, std::size_t slot_count)
+{
+  uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(allocation_tag) >> 3) *
+                  0x9e3779b97f4a7c15ull;
+  return static_cast<uint32_t>(hash >> 56) % slot_count;
+}
+
+/**
+ * Every block starts with a header, keeping the user memory 16 byte aligned.
+ */
+struct BlockHeader
+{
+  uint64_t size;
+  uint32_t tag_slot;
+  uint16_t size_class;
+  /**
+   * Distance from the start of the malloc'd block to the header, non zero for over aligned blocks.
+   */
+  uint16_t offset;
+};
+static_assert(sizeof(BlockHeader) == 16, "block header must keep 16 byte alignment");
+
+constexpr std::size_t kHeaderSize = sizeof(BlockHeader);
+constexpr std::size_t kSmallestBlock = 32;
+constexpr std::size_t kSizeClassCount = 6;  // 32 to 1024 bytes, header included
+constexpr uint16_t kUncached = 0xffff;
+constexpr std::size_t kDefaultAlignment = 16;
+
+const char kUntaggedTag[] = "untagged";
+
+/**
+ * Free blocks of the current thread, by size class.
+ */
+struct ThreadCache
+{
+  std::vector<void *> free_blocks[kSizeClassCount];
+  ThreadCache();
+  ~ThreadCache();
+};
+
+enum ThreadCacheState : int
+{
+  kCacheUnused = 0,
+  kCacheAlive,
+  kCacheDestroyed,
+};
+
+// trivially destructible, stays readable while the thread's other thread_locals are destroyed
+thread_local int t_cache_state = kCacheUnused;
+
+ThreadCache::ThreadCache() { t_cache_state = kCacheAlive; }
+
+ThreadCache::~ThreadCache()
+{
+  t_cache_state = kCacheDestroyed;
+  for (auto & blocks : free_blocks) {
+    for (void * block : blocks) {
+      std::free(block);
+    }
+  }
+}
+
+/**
+ * @return the cache of the current thread, null once it has been destroyed at thread exit
+ */
+ThreadCache * GetThreadCache()
+{
+  if (kCacheDestroyed == t_cache_state) {
+    return nullptr;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
+/**
+ * @return the size class of a block holding size bytes and its header, kUncached if too large
+ */
+uint16_t SizeClassOf(std::size_t size)
+{
+  std::size_t block = kSmallestBlock;
+  for (uint16_t size_class = 0; size_class < kSizeClassCount; size_class++, block <<= 1) {
+    if (size + kHeaderSize <= block) {
+      return size_class;
+    }
+  }
+  return kUncached;
+}
+
+}  // namespace
+
+constexpr std::size_t TaggedMemorySystem::kTagSlotCount;
+constexpr std::size_t TaggedMemorySystem::kTagNameSize;
+
+TaggedMemorySystem::TaggedMemorySystem(std::size_t thread_cache_blocks)
+: thread_cache_blocks_(thread_cache_blocks)
+{
+  for (auto & slot : tag_slots_) {
+    slot.tag.store(nullptr);
+    slot.counter_slot = 0;
+    slot.live_bytes.store(0);
+    slot.peak_bytes.store(0);
+    slot.allocations.store(0);
+  }
+  std::memset(tag_names_, 0, sizeof(tag_names_));
+  // slot 0 counts untagged allocations, and every tag once the table is full
+  std::strncpy(tag_names_[0], kUntaggedTag, kTagNameSize - 1);
+  tag_slots_[0].tag.store(kUntaggedTag);
+}
+
+uint32_t TaggedMemorySystem::FindTagSlot(const char * allocation_tag)
+{
+  if (nullptr == allocation_tag) {
+    return 0;
+  }
+  // the address identifies a tag, its name is only read when a slot is claimed for it
+  uint32_t start = FirstProbe(allocation_tag, kTagSlotCount);
+  for (uint32_t probe = 0; probe < kTagSlotCount; probe++) {
+    uint32_t index = (start + probe) % kTagSlotCount;
+    const char * tag = tag_slots_[index].tag.load(std::memory_order_acquire);
+    if (tag == allocation_tag) {
+      return tag_slots_[index].counter_slot;
+    }
+    if (nullptr == tag) {
+      return ClaimTagSlot(allocation_tag);
+    }
+  }
+  return 0;
+}
+
+uint32_t TaggedMemorySystem::ClaimTagSlot(const char * allocation_tag)
+{
+  std::lock_guard<std::mutex> lock(claim_mutex_);
+  // the same tag may have several addresses, one per translation unit using it, they share the
+  // counters of the first one seen so that its peak is exact
+  char name[kTagNameSize] = {};
+  std::strncpy(name, allocation_tag, kTagNameSize - 1);
+  uint32_t counter_slot = kTagSlotCount;
+  for (uint32_t index = 0; index < kTagSlotCount; index++) {
+    const char * tag = tag_slots_[index].tag.load(std::memory_order_relaxed);
+    if (tag && index == tag_slots_[index].counter_slot &&
+        0 == std::strcmp(tag_names_[index], name)) {
+      counter_slot = index;
+      break;
+    }
+  }
+  uint32_t start = FirstProbe(allocation_tag, kTagSlotCount);
+  for (uint32_t probe = 0; probe < kTagSlotCount; probe++) {
+    uint32_t index = (start + probe) % kTagSlotCount;
+    TagSlot & slot = tag_slots_[index];
+    const char * tag = slot.tag.load(std::memory_order_relaxed);
+    if (tag == allocation_tag) {
+      // claimed by another thread meanwhile
+      return slot.counter_slot;
+    }
+    if (nullptr == tag) {
+      slot.counter_slot = kTagSlotCount == counter_slot ? index : counter_slot;
+      std::memcpy(tag_names_[index], name, kTagNameSize);
+      slot.tag.store(allocation_tag, std::memory_order_release);
+      return slot.counter_slot;
+    }
+  }
+  return 0;
+}
+
+void * TaggedMemorySystem::AllocateMemory(std::size_t block_size, std::size_t alignment,
+                                          const char * allocation_tag)
+{
+  uint16_t size_class = alignment <= kDefaultAlignment ? SizeClassOf(block_size) : kUncached;
+  void * block = nullptr;
+  std::size_t offset = 0;
+  if (kUncached != size_class) {
+    ThreadCache * cache = GetThreadCache();
+    if (cache && !cache->free_blocks[size_class].empty()) {
+      block = cache->free_blocks[size_class].back();
+      cache->free_blocks[size_class].pop_back();
+    } else {
+      block = std::malloc(kSmallestBlock << size_class);
+    }
+  } else if (alignment <= kDefaultAlignment) {
+    block = std::malloc(kHeaderSize + block_size);
+  } else {
+    block = std::malloc(kHeaderSize + block_size + alignment);
+    if (block) {
+      uintptr_t user = reinterpret_cast<uintptr_t>(block) + kHeaderSize;
+      user = (user + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+      offset = user - kHeaderSize - reinterpret_cast<uintptr_t>(block);
+    }
+  }
+  if (!block) {
+    throw std::bad_alloc();
+  }
+
+  uint32_t tag_slot = FindTagSlot(allocation_tag);
+  auto * header = reinterpret_cast<BlockHeader *>(static_cast<char *>(block) + offset);
+  header->size = block_size;
+  header->tag_slot = tag_slot;
+  header->size_class = size_class;
+  header->offset = static_cast<uint16_t>(offset);
+
+  TagSlot & slot = tag_slots_[tag_slot];
+  slot.allocations.fetch_add(1, std::memory_order_relaxed);
+  int64_t size = static_cast<int64_t>(block_size);
+  RaisePeak(slot.peak_bytes, slot.live_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+  RaisePeak(total_bytes_.peak_bytes,
+            total_bytes_.live_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+  return reinterpret_cast<char *>(header) + kHeaderSize;
+}
+
+void TaggedMemorySystem::FreeMemory(void * memory_ptr)
+{
+  if (!memory_ptr) {
+    return;
+  }
+  auto * header = reinterpret_cast<BlockHeader *>(static_cast<char *>(memory_ptr) - kHeaderSize);
+  tag_slots_[header->tag_slot].live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+  total_bytes_.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+  void * block = reinterpret_cast<char *>(header) - header->offset;
+  if (kUncached != header->size_class) {
+    ThreadCache * cache = GetThreadCache();
+    if (cache && cache->free_blocks[header->size_class].size() < thread_cache_blocks_) {
+      cache->free_blocks[header->size_class].push_back(block);
+      return;
+    }
+  }
+  std::free(block);
+}
+
+std::vector<TaggedMemorySystem::TagStats> TaggedMemorySystem::GetTagStats() const
+{
+  std::vector<TagStats> tag_stats;
+  for (uint32_t index = 0; index < kTagSlotCount; index++) {
+    const TagSlot & slot = tag_slots_[index];
+    const char * tag = slot.tag.load(std::memory_order_acquire);
+    if (!tag || index != slot.counter_slot) {
+      continue;
+    }
+    TagStats stats;
+    stats.tag = tag_names_[index];
+    stats.live_bytes = slot.live_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = slot.peak_bytes.load(std::memory_order_relaxed);
+    stats.allocations = slot.allocations.load(std::memory_order_relaxed);
+    if (stats.allocations > 0) {
+      tag_stats.push_back(stats);
+    }
+  }
+  std::sort(tag_stats.begin(), tag_stats.end(), [](const TagStats & a, const TagStats & b) {
+    return a.live_bytes > b.live_bytes;
+  });
+  return tag_stats;
+}
+
+TaggedMemorySystem::TagStats TaggedMemorySystem::GetTotalStats() const
+{
+  TagStats total;
+  total.tag = "total";
+  for (auto & slot : tag_slots_) {
+    total.allocations += slot.allocations.load(std::memory_order_relaxed);
+  }
+  total.live_bytes = total_bytes_.live_bytes.load(std::memory_order_relaxed);
+  total.peak_bytes = total_bytes_.peak_bytes.load(std::memory_order_relaxed);
+  return total;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,266 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/core/utils/logging/LogMacros.h>
+#include <lex_node/tls_session_cache.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/*
+ * Session file: the magic, then one record per host. A record is a RecordHeader, the host name and
+ * the serialized session.
+ */
+const char kSessionMagic[8] = {'L', 'E', 'X', 'T', 'L', 'S', 'S', '1'};
+
+/**
+ * Most hosts kept, lex is called on one endpoint per region.
+ */
+constexpr std::size_t kMaxHosts = 16;
+
+/**
+ * Largest serialized session read back, tickets are a few kilobytes at most.
+ */
+constexpr uint32_t kMaxSessionSize = 64 * 1024;
+
+struct RecordHeader
+{
+  uint32_t host_size;
+  uint32_t session_size;
+  int64_t expires_at;
+};
+
+static_assert(sizeof(RecordHeader) == 16, "unexpected record header padding");
+
+bool WriteAll(int fd, const char * data, std::size_t size)
+{
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0 && EINTR == errno) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool ReadFile(int fd, std::vector<char> & contents)
+{
+  char buffer[4096];
+  for (;;) {
+    ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+    if (bytes_read < 0 && EINTR == errno) {
+      continue;
+    }
+    if (bytes_read < 0) {
+      return false;
+    }
+    if (0 == bytes_read) {
+      return true;
+    }
+    contents.insert(contents.end(), buffer, buffer + bytes_read);
+  }
+}
+
+bool MakeDirectories(const std::string & path)
+{
+  for (std::size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+    std::string prefix = path.substr(0, slash);
+    if (!prefix.empty() && 0 != mkdir(prefix.c_str(), 0700) && EEXIST != errno) {
+      return false;
+    }
+    if (std::string::npos == slash) {
+      return true;
+    }
+  }
+}
+
+/**
+ * Replace the file with the contents, written to a temporary file first so a crash never leaves a
+ * partial file.
+ */
+bool WriteFile(const std::string & path, const std::string & contents)
+{
+  std::size_t slash = path.rfind('/');
+  if (std::string::npos != slash && slash > 0 && !MakeDirectories(path.substr(0, slash))) {
+    return false;
+  }
+  std::string temporary_path = path + ".tmp";
+  unlink(temporary_path.c_str());
+  int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  bool is_written = WriteAll(fd, contents.data(), contents.size());
+  close(fd);
+  if (!is_written || 0 != rename(temporary_path.c_str(), path.c_str())) {
+    unlink(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TlsSessionCache::TlsSessionCache(const TlsSessionCacheConfiguration & configuration)
+: path_(configuration.file)
+{
+}
+
+std::size_t TlsSessionCache::Load(std::time_t now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0) {
+    if (ENOENT != errno) {
+      AWS_LOGSTREAM_WARN(__func__, "Unable to open tls session file " << path_ << ": "
+                                                                     << std::strerror(errno));
+    }
+    return 0;
+  }
+  struct stat file_stat;
+  std::vector<char> contents;
+  bool is_private = 0 == fstat(fd, &file_stat) && S_ISREG(file_stat.st_mode) &&
+                    geteuid() == file_stat.st_uid && 0 == (file_stat.st_mode & 077);
+  bool is_read = is_private && ReadFile(fd, contents);
+  close(fd);
+  if (!is_private) {
+    AWS_LOGSTREAM_WARN(__func__, "Ignoring tls session file "
+                                   << path_ << ", it is not private to its owner");
+    return 0;
+  }
+  if (!is_read || contents.size() < sizeof(kSessionMagic) ||
+      0 != std::memcmp(contents.data(), kSessionMagic, sizeof(kSessionMagic))) {
+    AWS_LOGSTREAM_WARN(__func__, "Ignoring unreadable tls session file " << path_);
+    return 0;
+  }
+  std::size_t loaded = 0;
+  std::size_t offset = sizeof(kSessionMagic);
+  while (contents.size() - offset >= sizeof(RecordHeader)) {
+    RecordHeader header;
+    std::memcpy(&header, contents.data() + offset, sizeof(header));
+    offset += sizeof(header);
+    std::size_t record_size = static_cast<std::size_t>(header.host_size) + header.session_size;
+    if (header.session_size > kMaxSessionSize || contents.size() - offset < record_size) {
+      break;
+    }
+    std::string host(contents.data() + offset, header.host_size);
+    offset += header.host_size;
+    std::string session(contents.data() + offset, header.session_size);
+    offset += header.session_size;
+    if (header.expires_at > now && !session.empty() && entries_.size() < kMaxHosts) {
+      entries_[host] = Entry{std::move(session), static_cast<std::time_t>(header.expires_at)};
+      loaded++;
+    }
+  }
+  stats_.sessions_loaded += loaded;
+  return loaded;
+}
+
+std::string TlsSessionCache::Find(const std::string & host, std::time_t now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry = entries_.find(host);
+  if (entry == entries_.end()) {
+    return std::string();
+  }
+  if (entry->second.expires_at <= now) {
+    entries_.erase(entry);
+    return std::string();
+  }
+  return entry->second.session;
+}
+
+void TlsSessionCache::Store(const std::string & host, std::string session, std::time_t expires_at)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.sessions_stored++;
+  if (entries_.size() >= kMaxHosts && entries_.end() == entries_.find(host)) {
+    // drop the session closest to expiring
+    entries_.erase(std::min_element(
+      entries_.begin(), entries_.end(),
+      [](const std::pair<const std::string, Entry> & a,
+         const std::pair<const std::string, Entry> & b) {
+        return a.second.expires_at < b.second.expires_at;
+      }));
+  }
+  entries_[host] = Entry{std::move(session), expires_at};
+  is_dirty_ = true;
+}
+
+bool TlsSessionCache::Save()
+{
+  std::lock_guard<std::mutex> save_lock(save_mutex_);
+  std::string contents(kSessionMagic, sizeof(kSessionMagic));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_dirty_) {
+      return true;
+    }
+    for (const auto & entry : entries_) {
+      RecordHeader header{static_cast<uint32_t>(entry.first.size()),
+                          static_cast<uint32_t>(entry.second.session.size()),
+                          static_cast<int64_t>(entry.second.expires_at)};
+      contents.append(reinterpret_cast<const char *>(&header), sizeof(header));
+      contents += entry.first;
+      contents += entry.second.session;
+    }
+    is_dirty_ = false;
+  }
+  if (!WriteFile(path_, contents)) {
+    AWS_LOGSTREAM_WARN(__func__, "Unable to save tls sessions to " << path_ << ": "
+                                                                   << std::strerror(errno));
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_dirty_ = true;
+    return false;
+  }
+  return true;
+}
+
+void TlsSessionCache::RecordHandshake(bool is_resumed)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (is_resumed) {
+    stats_.resumed_handshakes++;
+  } else {
+    stats_.full_handshakes++;
+  }
+}
+
+TlsSessionCache::Stats TlsSessionCache::GetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  stats.entries = entries_.size();
+  return stats;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/tls_session_cache.h>
+
+#ifdef LEX_NODE_HAVE_TLS_SESSION_CACHE
+#include <aws/core/client/ClientConfiguration.h>
+#include <aws/core/http/HttpClientFactory.h>
+#include <aws/core/http/curl/CurlHttpClient.h>
+#include <aws/core/http/standard/StandardHttpRequest.h>
+#include <curl/curl.h>
+#include <openssl/ssl.h>
+
+#include <cstring>
+#endif
+
+namespace Aws {
+namespace Lex {
+
+#ifdef LEX_NODE_HAVE_TLS_SESSION_CACHE
+namespace {
+
+constexpr char kAllocationTag[] = "TlsSessionHttpClientFactory";
+
+using NewSessionCallback = int (*)(SSL *, SSL_SESSION *);
+
+/**
+ * State attached to the openssl context curl creates for each connection.
+ */
+struct SslContextHooks
+{
+  TlsSessionCache * cache;
+  /**
+   * Callback curl installed to keep sessions for the connections of its own handle.
+   */
+  NewSessionCallback curl_new_session;
+};
+
+void FreeSslContextHooks(void *, void * hooks, CRYPTO_EX_DATA *, int, long, void *)
+{
+  delete static_cast<SslContextHooks *>(hooks);
+}
+
+int SslContextHooksIndex()
+{
+  static int index =
+    SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, &FreeSslContextHooks);
+  return index;
+}
+
+/**
+ * Index of the flag marking a connection whose handshake was counted.
+ */
+int HandshakeCountedIndex()
+{
+  static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+SslContextHooks * GetHooks(const SSL * ssl)
+{
+  return static_cast<SslContextHooks *>(
+    SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), SslContextHooksIndex()));
+}
+
+std::string GetHost(const SSL * ssl)
+{
+  const char * host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  return host ? host : "";
+}
+
+int OnNewSession(SSL * ssl, SSL_SESSION * session)
+{
+  auto hooks = GetHooks(ssl);
+  if (!hooks) {
+    return 0;
+  }
+  std::string host = GetHost(ssl);
+  int size = i2d_SSL_SESSION(session, nullptr);
+  if (!host.empty() && size > 0) {
+    std::string serialized(static_cast<std::size_t>(size), '\0');
+    auto position = reinterpret_cast<unsigned char *>(&serialized[0]);
+    i2d_SSL_SESSION(session, &position);
+    hooks->cache->Store(host, std::move(serialized),
+                        SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session));
+  }
+  // curl takes a reference on the session if it keeps it
+  return hooks->curl_new_session ? hooks->curl_new_session(ssl, session) : 0;
+}
+
+void OnHandshakeState(const SSL * ssl, int where, int)
+{
+  auto hooks = GetHooks(ssl);
+  if (!hooks) {
+    return;
+  }
+  SSL * connection = const_cast<SSL *>(ssl);
+  if ((where & SSL_CB_HANDSHAKE_START) && !SSL_get_session(ssl)) {
+    // curl has no session of its own for the host, the client hello is not written yet
+    std::string serialized = hooks->cache->Find(GetHost(ssl));
+    auto data = reinterpret_cast<const unsigned char *>(serialized.data());
+    SSL_SESSION * session =
+      serialized.empty() ? nullptr
+                         : d2i_SSL_SESSION(nullptr, &data, static_cast<long>(serialized.size()));
+    if (session) {
+      SSL_set_session(connection, session);
+      SSL_SESSION_free(session);
+    }
+  }
+  // tls 1.3 signals the end of a handshake again for the session tickets that follow it
+  if ((where & SSL_CB_HANDSHAKE_DONE) && !SSL_get_ex_data(ssl, HandshakeCountedIndex())) {
+    SSL_set_ex_data(connection, HandshakeCountedIndex(), connection);
+    hooks->cache->RecordHandshake(1 == SSL_session_reused(connection));
+  }
+}
+
+CURLcode ConfigureSslContext(CURL *, void * ssl_context, void * cache)
+{
+  auto context = static_cast<SSL_CTX *>(ssl_context);
+  if (SSL_CTX_get_ex_data(context, SslContextHooksIndex())) {
+    return CURLE_OK;
+  }
+  auto hooks = new SslContextHooks{static_cast<TlsSessionCache *>(cache),
+                                   SSL_CTX_sess_get_new_cb(context)};
+  if (!SSL_CTX_set_ex_data(context, SslContextHooksIndex(), hooks)) {
+    delete hooks;
+    return CURLE_OK;
+  }
+  SSL_CTX_set_session_cache_mode(context, SSL_CTX_get_session_cache_mode(context) |
+                                            SSL_SESS_CACHE_CLIENT |
+                                            SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(context, &OnNewSession);
+  SSL_CTX_set_info_callback(context, &OnHandshakeState);
+  return CURLE_OK;
+}
+
+/**
+ * Curl client hooking the tls session cache into the openssl context of each connection.
+ */
+class TlsSessionCurlHttpClient : public Aws::Http::CurlHttpClient
+{
+public:
+  TlsSessionCurlHttpClient(const Aws::Client::ClientConfiguration & client_configuration,
+                           std::shared_ptr<TlsSessionCache> tls_session_cache)
+  : CurlHttpClient(client_configuration), tls_session_cache_(std::move(tls_session_cache))
+  {
+  }
+
+protected:
+  void OverrideOptionsOnConnectionHandle(CURL * connection_handle) const override
+  {
+    curl_easy_setopt(connection_handle, CURLOPT_SSL_CTX_FUNCTION, &ConfigureSslContext);
+    curl_easy_setopt(connection_handle, CURLOPT_SSL_CTX_DATA, tls_session_cache_.get());
+  }
+
+private:
+  std::shared_ptr<TlsSessionCache> tls_session_cache_;
+};
+
+/**
+ * Same as the default factory of the sdk on linux, with TlsSessionCurlHttpClient clients.
+ */
+class TlsSessionHttpClientFactory : public Aws::Http::HttpClientFactory
+{
+public:
+  explicit TlsSessionHttpClientFactory(std::shared_ptr<TlsSessionCache> tls_session_cache)
+  : tls_session_cache_(std::move(tls_session_cache))
+  {
+  }
+
+  std::shared_ptr<Aws::Http::HttpClient> CreateHttpClient(
+    const Aws::Client::ClientConfiguration & client_configuration) const override
+  {
+    return Aws::MakeShared<TlsSessionCurlHttpClient>(kAllocationTag, client_configuration,
+                                                     tls_session_cache_);
+  }
+
+  std::shared_ptr<Aws::Http::HttpRequest> CreateHttpRequest(
+    const Aws::String & uri, Aws::Http::HttpMethod method,
+    const Aws::IOStreamFactory & stream_factory) const override
+  {
+    return CreateHttpRequest(Aws::Http::URI(uri), method, stream_factory);
+  }
+
+  std::shared_ptr<Aws::Http::HttpRequest> CreateHttpRequest(
+    const Aws::Http::URI & uri, Aws::Http::HttpMethod method,
+    const Aws::IOStreamFactory & stream_factory) const override
+  {
+    auto request =
+      Aws::MakeShared<Aws::Http::Standard::StandardHttpRequest>(kAllocationTag, uri, method);
+    request->SetResponseStreamFactory(stream_factory);
+    return request;
+  }
+
+  void InitStaticState() override { Aws::Http::CurlHttpClient::InitGlobalState(); }
+
+  void CleanupStaticState() override { Aws::Http::CurlHttpClient::CleanupGlobalState(); }
+
+private:
+  std::shared_ptr<TlsSessionCache> tls_session_cache_;
+};
+
+}  // namespace
+#endif
+
+bool IsTlsSessionCacheAvailable()
+{
+#ifdef LEX_NODE_HAVE_TLS_SESSION_CACHE
+  // the sessions are handed to curl's tls library, which has to be the openssl built against
+  const char * ssl_version = curl_version_info(CURLVERSION_NOW)->ssl_version;
+  return ssl_version && 0 == std::strncmp(ssl_version, "OpenSSL", 7);
+#else
+  return false;
+#endif
+}
+
+std::shared_ptr<Aws::Http::HttpClientFactory> MakeTlsSessionHttpClientFactory(
+  std::shared_ptr<TlsSessionCache> tls_session_cache)
+{
+#ifdef LEX_NODE_HAVE_TLS_SESSION_CACHE
+  if (IsTlsSessionCacheAvailable()) {
+    return Aws::MakeShared<TlsSessionHttpClientFactory>(kAllocationTag,
+                                                        std::move(tls_session_cache));
+  }
+#else
+  (void)tls_session_cache;
+#endif
+  return nullptr;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <lex_node/voice_activity.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace Aws {
+namespace Lex {
+
+namespace {
+
+/**
+ * Zero crossing rate above which a quiet frame is taken for an unvoiced consonant.
+ */
+constexpr double kUnvoicedZeroCrossingRate = 0.25;
+
+/**
+ * Vector iterations before the 16 bit zero crossing counters are widened, well below overflow.
+ */
+constexpr std::size_t kCounterFlushInterval = 4096;
+
+}  // namespace
+
+FrameFeatures ComputeFrameFeaturesScalar(const int16_t * samples, std::size_t count)
+{
+  FrameFeatures features;
+  for (std::size_t index = 0; index < count; index++) {
+    int32_t sample = samples[index];
+    features.energy += static_cast<uint64_t>(sample * sample);
+    if (index + 1 < count && ((samples[index] ^ samples[index + 1]) < 0)) {
+      features.zero_crossings++;
+    }
+  }
+  return features;
+}
+
+#if defined(__SSE2__)
+
+FrameFeatures ComputeFrameFeatures(const int16_t * samples, std::size_t count)
+{
+  FrameFeatures features;
+  if (count < 9) {
+    return ComputeFrameFeaturesScalar(samples, count);
+  }
+  const __m128i zero = _mm_setzero_si128();
+  __m128i energy = zero;
+  __m128i crossings = zero;
+  __m128i crossings_wide = zero;
+  std::size_t index = 0;
+  std::size_t iterations = 0;
+  // each iteration reads samples [index, index + 9), the last sample only for its crossing
+  for (; index + 9 <= count; index += 8) {
+    __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + index));
+    __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + index + 1));
+    // pairs of squares fit in 32 unsigned bits, widen them to 64 bits before adding
+    __m128i squares = _mm_madd_epi16(current, current);
+    energy = _mm_add_epi64(energy, _mm_unpacklo_epi32(squares, zero));
+    energy = _mm_add_epi64(energy, _mm_unpackhi_epi32(squares, zero));
+    // sign differs: -1, subtracting it counts the crossing
+    crossings = _mm_sub_epi16(crossings, _mm_srai_epi16(_mm_xor_si128(current, next), 15));
+    if (++iterations == kCounterFlushInterval) {
+      crossings_wide = _mm_add_epi32(crossings_wide, _mm_madd_epi16(crossings, _mm_set1_epi16(1)));
+      crossings = zero;
+      iterations = 0;
+    }
+  }
+  crossings_wide = _mm_add_epi32(crossings_wide, _mm_madd_epi16(crossings, _mm_set1_epi16(1)));
+
+  uint64_t energy_lanes[2];
+  uint32_t crossing_lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(energy_lanes), energy);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(crossing_lanes), crossings_wide);
+  features.energy = energy_lanes[0] + energy_lanes[1];
+  features.zero_crossings =
+    crossing_lanes[0] + crossing_lanes[1] + crossing_lanes[2] + crossing_lanes[3];
+
+  FrameFeatures tail = ComputeFrameFeaturesScalar(samples + index, count - index);
+  features.energy += tail.energy;
+  features.zero_crossings += tail.zero_crossings;
+  return features;
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+FrameFeatures ComputeFrameFeatures(const int16_t * samples, std::size_t count)
+{
+  FrameFeatures features;
+  if (count < 9) {
+    return ComputeFrameFeaturesScalar(samples, count);
+  }
+  uint64x2_t energy = vdupq_n_u64(0);
+  int16x8_t crossings = vdupq_n_s16(0);
+  uint32x4_t crossings_wide = vdupq_n_u32(0);
+  std::size_t index = 0;
+  std::size_t iterations = 0;
+  // each iteration reads samples [index, index + 9), the last sample only for its crossing
+  for (; index + 9 <= count; index += 8) {
+    int16x8_t current = vld1q_s16(samples + index);
+    int16x8_t next = vld1q_s16(samples + index + 1);
+    // squares fit in 31 bits, accumulate pairs of them in 64 bit lanes
+    uint32x4_t low = vreinterpretq_u32_s32(vmull_s16(vget_low_s16(current), vget_low_s16(current)));
+    uint32x4_t high =
+      vreinterpretq_u32_s32(vmull_s16(vget_high_s16(current), vget_high_s16(current)));
+    energy = vpadalq_u32(energy, low);
+    energy = vpadalq_u32(energy, high);
+    // sign differs: -1, subtracting it counts the crossing
+    crossings = vsubq_s16(crossings, vshrq_n_s16(veorq_s16(current, next), 15));
+    if (++iterations == kCounterFlushInterval) {
+      crossings_wide = vpadalq_u16(crossings_wide, vreinterpretq_u16_s16(crossings));
+      crossings = vdupq_n_s16(0);
+      iterations = 0;
+    }
+  }
+  crossings_wide = vpadalq_u16(crossings_wide, vreinterpretq_u16_s16(crossings));
+
+  features.energy = vgetq_lane_u64(energy, 0) + vgetq_lane_u64(energy, 1);
+  features.zero_crossings = vgetq_lane_u32(crossings_wide, 0) + vgetq_lane_u32(crossings_wide, 1) +
+                            vgetq_lane_u32(crossings_wide, 2) + vgetq_lane_u32(crossings_wide, 3);
+
+  FrameFeatures tail = ComputeFrameFeaturesScalar(samples + index, count - index);
+  features.energy += tail.energy;
+  features.zero_crossings += tail.zero_crossings;
+  return features;
+}
+
+#else
+
+FrameFeatures ComputeFrameFeatures(const int16_t * samples, std::size_t count)
+{
+  return ComputeFrameFeaturesScalar(samples, count);
+}
+
+#endif
+
+SpeechSpan VoiceActivityDetector::FindSpeech(const int16_t * samples, std::size_t count,
+                                             int channels, int sample_rate) const
+{
+  SpeechSpan span;
+  span.end = count;
+  std::size_t channel_count = channels > 0 ? channels : 1;
+  std::size_t frame_samples =
+    channel_count * std::max<std::size_t>(1, static_cast<std::size_t>(sample_rate) *
+                                                configuration_.frame_ms / 1000);
+  std::size_t frame_count = count / frame_samples;
+  if (0 == frame_count) {
+    return span;
+  }
+
+  std::vector<double> frame_energy(frame_count);
+  std::vector<double> frame_crossing_rate(frame_count);
+  for (std::size_t frame = 0; frame < frame_count; frame++) {
+    auto features = ComputeFrameFeatures(samples + frame * frame_samples, frame_samples);
+    frame_energy[frame] = static_cast<double>(features.energy) / frame_samples;
+    // crossings between interleaved channels mean nothing, only use them on mono audio
+    frame_crossing_rate[frame] =
+      1 == channel_count ? static_cast<double>(features.zero_crossings) / frame_samples : 0.0;
+  }
+
+  // the quietest tenth of the clip gives the noise floor
+  std::vector<double> sorted_energy(frame_energy);
+  auto percentile = sorted_energy.begin() + frame_count / 10;
+  std::nth_element(sorted_energy.begin(), percentile, sorted_energy.end());
+  double threshold = std::max(*percentile * configuration_.energy_ratio,
+                              configuration_.min_rms * configuration_.min_rms);
+
+  std::size_t min_speech_frames = std::max(
+    1, (configuration_.min_speech_ms + configuration_.frame_ms - 1) / configuration_.frame_ms);
+  std::size_t first_frame = frame_count;
+  std::size_t last_frame = 0;
+  std::size_t run = 0;
+  for (std::size_t frame = 0; frame < frame_count; frame++) {
+    bool is_voiced = frame_energy[frame] > threshold ||
+                     (frame_energy[frame] > threshold / 2 &&
+                      frame_crossing_rate[frame] > kUnvoicedZeroCrossingRate);
+    run = is_voiced ? run + 1 : 0;
+    if (run >= min_speech_frames) {
+      first_frame = std::min(first_frame, frame + 1 - run);
+      last_frame = frame + 1;
+    }
+  }
+  if (first_frame == frame_count) {
+    return span;
+  }
+
+  std::size_t pad = channel_count * static_cast<std::size_t>(sample_rate) *
+                    configuration_.pad_ms / 1000;
+  std::size_t begin = first_frame * frame_samples;
+  std::size_t end = last_frame == frame_count ? count : last_frame * frame_samples;
+  span.begin = begin > pad ? begin - pad : 0;
+  span.end = std::min(count - count % channel_count, end + pad);
+  span.has_speech = true;
+  return span;
+}
+
+}  // namespace Lex
+}  // namespace Aws
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/async_log_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Aws::Lex;
+
+namespace {
+
+/**
+ * Keeps the lines forwarded, optionally holding the background thread until released.
+ */
+class TestSink
+{
+public:
+  AsyncLogQueue::Forward MakeForward()
+  {
+    return [this](const LogRecord * records, std::size_t count, uint64_t dropped) {
+      calls_++;
+      while (is_held_.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t index = 0; index < count; index++) {
+        lines_.push_back(records[index].tag + ": " + records[index].message);
+      }
+      dropped_ += dropped;
+    };
+  }
+
+  std::vector<std::string> Lines()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lines_;
+  }
+
+  uint64_t Dropped()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+  }
+
+  std::atomic<bool> is_held_{false};
+  std::atomic<int> calls_{0};
+
+private:
+  std::mutex mutex_;
+  std::vector<std::string> lines_;
+  uint64_t dropped_ = 0;
+};
+
+void Push(AsyncLogQueue & queue, const std::string & message)
+{
+  queue.Push(3, "test", message.data(), message.size());
+}
+
+}  // namespace
+
+/**
+ * Lines are forwarded in order, flushed on demand and when the queue is destroyed.
+ */
+TEST(AsyncLogQueueTest, ForwardsInOrder)
+{
+  TestSink sink;
+  LoggingConfiguration configuration;
+  configuration.capacity = 100;
+  configuration.flush_interval_ms = 1000;
+  {
+    AsyncLogQueue queue(configuration, sink.MakeForward());
+    EXPECT_EQ(128u, queue.Capacity());
+    Push(queue, "first");
+    Push(queue, std::string("binary\0line", 11));
+    queue.Flush();
+    auto lines = sink.Lines();
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ("test: first", lines[0]);
+    EXPECT_EQ(std::string("test: binary\0line", 17), lines[1]);
+    Push(queue, "last");
+  }
+  EXPECT_EQ(3u, sink.Lines().size());
+}
+
+/**
+ * A full buffer drops its oldest lines and reports how many.
+ */
+TEST(AsyncLogQueueTest, DropOldest)
+{
+  TestSink sink;
+  LoggingConfiguration configuration;
+  configuration.capacity = 4;
+  AsyncLogQueue queue(configuration, sink.MakeForward());
+  sink.is_held_ = true;
+  // the background thread takes this line and is held forwarding it
+  Push(queue, "held");
+  while (0 == sink.calls_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (int line = 0; line < 10; line++) {
+    Push(queue, std::to_string(line));
+  }
+  sink.is_held_ = false;
+  queue.Flush();
+
+  auto lines = sink.Lines();
+  ASSERT_EQ(5u, lines.size());
+  EXPECT_EQ("test: held", lines[0]);
+  EXPECT_EQ("test: 6", lines[1]);
+  EXPECT_EQ("test: 9", lines[4]);
+  EXPECT_EQ(6u, sink.Dropped());
+  auto stats = queue.GetStats();
+  EXPECT_EQ(11u, stats.pushed);
+  EXPECT_EQ(6u, stats.dropped);
+  EXPECT_EQ(5u, stats.forwarded);
+  EXPECT_EQ(0u, stats.blocked);
+}
+
+/**
+ * With the block policy a full buffer makes the logging threads wait, no line is lost.
+ */
+TEST(AsyncLogQueueTest, Block)
+{
+  TestSink sink;
+  LoggingConfiguration configuration;
+  configuration.capacity = 8;
+  configuration.overflow_policy = "block";
+  constexpr int kThreads = 4;
+  constexpr int kLines = 2000;
+  {
+    AsyncLogQueue queue(configuration, sink.MakeForward());
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < kThreads; thread++) {
+      threads.emplace_back([&queue, thread]() {
+        for (int line = 0; line < kLines; line++) {
+          Push(queue, std::to_string(thread) + " " + std::to_string(line));
+        }
+      });
+    }
+    for (auto & thread : threads) {
+      thread.join();
+    }
+    queue.Flush();
+    auto stats = queue.GetStats();
+    EXPECT_EQ(0u, stats.dropped);
+    EXPECT_GT(stats.blocked, 0u);
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kLines), stats.forwarded);
+  }
+
+  // the lines of each thread keep their order
+  std::vector<int> next_line(kThreads);
+  for (const auto & line : sink.Lines()) {
+    int thread = line[6] - '0';
+    ASSERT_EQ("test: " + std::to_string(thread) + " " + std::to_string(next_line[thread]), line);
+    next_line[thread]++;
+  }
+  for (int lines : next_line) {
+    EXPECT_EQ(kLines, lines);
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/audio_buffer_pool.h>
+#include <lex_node/message_pool.h>
+#include <lex_node/response_audio_stream.h>
+#include <lex_node/slot_decoder.h>
+
+#include <string>
+#include <vector>
+
+using namespace Aws::Lex;
+
+/**
+ * Released buffers are handed out again for requests of their size class or smaller.
+ */
+TEST(AudioBufferPoolSuite, RecycleBySizeClass)
+{
+  AudioBufferPool pool(1024 * 1024, 2);
+  auto buffer = pool.Acquire(100000);
+  EXPECT_GE(buffer.capacity(), 100000u);
+  buffer.assign(100000, 1);
+  const uint8_t * memory = buffer.data();
+  pool.Release(std::move(buffer));
+  EXPECT_TRUE(buffer.empty());
+
+  auto reused = pool.Acquire(50000);
+  EXPECT_EQ(reused.data(), memory);
+  EXPECT_TRUE(reused.empty());
+  auto stats = pool.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+
+  // the pooled buffer is too small for a larger size class
+  pool.Release(std::move(reused));
+  auto larger = pool.Acquire(300000);
+  EXPECT_NE(larger.data(), memory);
+  EXPECT_GE(larger.capacity(), 300000u);
+}
+
+/**
+ * The pool keeps a bounded number of buffers and ignores buffers outside of its size classes.
+ */
+TEST(AudioBufferPoolSuite, Bounded)
+{
+  AudioBufferPool pool(64 * 1024, 1);
+  std::vector<uint8_t> first, second, small, huge;
+  first.reserve(8192);
+  second.reserve(8192);
+  small.reserve(100);
+  huge.reserve(1024 * 1024);
+  pool.Release(std::move(first));
+  pool.Release(std::move(second));
+  pool.Release(std::move(small));
+  pool.Release(std::move(huge));
+  EXPECT_EQ(pool.GetStats().pooled_bytes, 8192u);
+}
+
+/**
+ * The response stream takes its buffer from the pool and gives it back.
+ */
+TEST(AudioBufferPoolSuite, ResponseStreamUsesPool)
+{
+  AudioBufferPool pool(1024 * 1024, 2);
+  std::vector<uint8_t> response_audio;
+  {
+    ResponseAudioStream stream(&pool);
+    stream.GetBuffer().Reserve(200000);
+    stream << std::string(200000, 'a');
+    stream.GetBuffer().MoveTo(response_audio);
+  }
+  EXPECT_EQ(response_audio.size(), 200000u);
+  const uint8_t * memory = response_audio.data();
+  pool.Release(std::move(response_audio));
+  {
+    ResponseAudioStream stream(&pool);
+    stream.GetBuffer().Reserve(150000);
+    stream << std::string(150000, 'b');
+    stream.GetBuffer().MoveTo(response_audio);
+  }
+  EXPECT_EQ(response_audio.data(), memory);
+  EXPECT_EQ(pool.GetStats().hits, 1u);
+}
+
+struct TestKeyValue
+{
+  std::string key;
+  std::string value;
+};
+
+struct TestMessage
+{
+  std::string text;
+  std::vector<uint8_t> data;
+  std::vector<TestKeyValue> slots;
+};
+
+/**
+ * Messages are reset and recycled with their capacity once released.
+ */
+TEST(MessagePoolSuite, RecycleMessages)
+{
+  MessagePool<TestMessage> pool(1, [](TestMessage & message) {
+    message.text.clear();
+    message.data.clear();
+  });
+  const uint8_t * memory = nullptr;
+  {
+    auto message = pool.Acquire();
+    message->text = "stop";
+    message->data.assign(50000, 3);
+    memory = message->data.data();
+  }
+  EXPECT_EQ(pool.IdleCount(), 1u);
+  {
+    auto message = pool.Acquire();
+    auto other = pool.Acquire();
+    EXPECT_TRUE(message->text.empty());
+    EXPECT_TRUE(message->data.empty());
+    EXPECT_EQ(message->data.data(), memory);
+    EXPECT_EQ(pool.IdleCount(), 0u);
+  }
+  // only one idle message is kept
+  EXPECT_EQ(pool.IdleCount(), 1u);
+}
+
+/**
+ * The slots of a recycled message keep their strings for the next reply decoded into them.
+ */
+TEST(MessagePoolSuite, RecycleSlots)
+{
+  MessagePool<TestMessage> pool(1, [](TestMessage & message) { ClearSlots(message.slots); });
+  // {"Location": "a value longer than a short string buffer", "CheckInDate": null}
+  const std::string two_slots =
+    "eyJMb2NhdGlvbiI6ICJhIHZhbHVlIGxvbmdlciB0aGFuIGEgc2hvcnQgc3RyaW5nIGJ1ZmZlciIsICJDaGVja0lu"
+    "RGF0ZSI6IG51bGx9";
+  // {"Location": "Seattle"}
+  const std::string one_slot = "eyJMb2NhdGlvbiI6ICJTZWF0dGxlIn0=";
+  const char * value = nullptr;
+  std::size_t capacity = 0;
+  {
+    auto message = pool.Acquire();
+    ASSERT_TRUE(DecodeSlots(two_slots.data(), two_slots.size(), message->slots));
+    ASSERT_EQ(2u, message->slots.size());
+    value = message->slots[0].value.data();
+    capacity = message->slots[0].value.capacity();
+  }
+  auto message = pool.Acquire();
+  ASSERT_EQ(2u, message->slots.size());
+  EXPECT_TRUE(message->slots[0].value.empty());
+  EXPECT_EQ(capacity, message->slots[0].value.capacity());
+  ASSERT_TRUE(DecodeSlots(one_slot.data(), one_slot.size(), message->slots));
+  ASSERT_EQ(1u, message->slots.size());
+  EXPECT_EQ("Seattle", message->slots[0].value);
+  EXPECT_EQ(value, message->slots[0].value.data());
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/audio_normalizer.h>
+#include <lex_node/audio_pipeline.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Aws::Lex;
+
+static std::vector<float> MakeTone(int sample_rate, double frequency, std::size_t count)
+{
+  std::vector<float> tone(count);
+  for (std::size_t index = 0; index < count; index++) {
+    tone[index] = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * frequency * index / sample_rate));
+  }
+  return tone;
+}
+
+static double Rms(const float * samples, std::size_t count)
+{
+  double sum = 0.0;
+  for (std::size_t index = 0; index < count; index++) {
+    sum += samples[index] * samples[index];
+  }
+  return std::sqrt(sum / count);
+}
+
+/**
+ * The vectorized kernels match the scalar ones.
+ */
+TEST(AudioNormalizerSuite, KernelsMatchScalar)
+{
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> data(4 * 1003);
+  for (auto & value : data) {
+    value = static_cast<uint8_t>(byte(generator));
+  }
+  std::vector<float> expected(data.size() / 2), actual(data.size() / 2);
+  for (int channels : {1, 2}) {
+    PcmFormat format;
+    format.channels = channels;
+    std::size_t frames = data.size() / format.FrameBytes();
+    DownmixToFloatScalar(data.data(), frames, format, expected.data());
+    DownmixToFloat(data.data(), frames, format, actual.data());
+    for (std::size_t frame = 0; frame < frames; frame++) {
+      ASSERT_FLOAT_EQ(actual[frame], expected[frame]) << channels << " channels, frame " << frame;
+    }
+  }
+  std::uniform_real_distribution<float> real(-1.0f, 1.0f);
+  std::vector<float> floats(2 * 1003);
+  for (auto & value : floats) {
+    value = real(generator);
+  }
+  PcmFormat float_format;
+  float_format.channels = 2;
+  float_format.sample_bits = 32;
+  float_format.is_float = true;
+  DownmixToFloatScalar(reinterpret_cast<uint8_t *>(floats.data()), 1003, float_format,
+                       expected.data());
+  DownmixToFloat(reinterpret_cast<uint8_t *>(floats.data()), 1003, float_format, actual.data());
+  for (std::size_t frame = 0; frame < 1003; frame++) {
+    ASSERT_FLOAT_EQ(actual[frame], expected[frame]);
+  }
+
+  floats[0] = 1.5f;
+  floats[1] = -1.5f;
+  std::vector<int16_t> expected_samples(floats.size()), actual_samples(floats.size());
+  FloatToInt16Scalar(floats.data(), floats.size(), expected_samples.data());
+  FloatToInt16(floats.data(), floats.size(), actual_samples.data());
+  EXPECT_EQ(actual_samples[0], 32767);
+  EXPECT_EQ(actual_samples[1], -32768);
+  for (std::size_t index = 0; index < floats.size(); index++) {
+    ASSERT_NEAR(actual_samples[index], expected_samples[index], 1);
+  }
+
+  EXPECT_NEAR(DotProduct(floats.data(), floats.data() + 1003, 1003),
+              DotProductScalar(floats.data(), floats.data() + 1003, 1003), 1e-3);
+}
+
+/**
+ * The kernels round halves to even, like the scalar conversion, except on 32 bit arm.
+ */
+TEST(AudioNormalizerSuite, FloatToInt16RoundsHalfToEven)
+{
+  std::vector<float> halves;
+  for (float half : {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f, 100.5f, -100.5f}) {
+    halves.push_back(half / 32768.0f);
+  }
+  std::vector<int16_t> expected = {0, 2, 2, 0, -2, -2, 100, -100};
+  std::vector<int16_t> scalar(halves.size()), actual(halves.size());
+  FloatToInt16Scalar(halves.data(), halves.size(), scalar.data());
+  EXPECT_EQ(scalar, expected);
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__aarch64__)
+  expected = {1, 2, 3, -1, -2, -3, 101, -101};
+#endif
+  FloatToInt16(halves.data(), halves.size(), actual.data());
+  EXPECT_EQ(actual, expected);
+}
+
+/**
+ * Samples of every declared layout decode to the same value.
+ */
+TEST(AudioNormalizerSuite, DecodeLayouts)
+{
+  float output[1];
+  PcmFormat format;
+  const uint8_t little16[] = {0x00, 0xc0};
+  DownmixToFloat(little16, 1, format, output);
+  EXPECT_FLOAT_EQ(output[0], -0.5f);
+
+  format.big_endian = true;
+  const uint8_t big16[] = {0xc0, 0x00};
+  DownmixToFloat(big16, 1, format, output);
+  EXPECT_FLOAT_EQ(output[0], -0.5f);
+
+  format.big_endian = false;
+  format.sample_bits = 24;
+  const uint8_t little24[] = {0x00, 0x00, 0xc0};
+  DownmixToFloat(little24, 1, format, output);
+  EXPECT_FLOAT_EQ(output[0], -0.5f);
+
+  format.sample_bits = 8;
+  const uint8_t unsigned8[] = {64};
+  DownmixToFloat(unsigned8, 1, format, output);
+  EXPECT_FLOAT_EQ(output[0], -0.5f);
+}
+
+/**
+ * Tones in the pass band keep their level through the resampler, tones above the output Nyquist
+ * frequency are removed.
+ */
+TEST(AudioNormalizerSuite, ResamplerResponse)
+{
+  for (int input_rate : {8000, 44100, 48000}) {
+    PolyphaseResampler resampler(input_rate, 16000);
+    std::size_t count = input_rate / 2;
+    auto tone = MakeTone(input_rate, 1000.0, count);
+    std::vector<float> output(resampler.OutputCount(count));
+    EXPECT_NEAR(output.size(), 8000u, 1u);
+    resampler.Process(tone.data(), count, output.data());
+    // skip the edges where the filter reads zeros around the clip
+    double expected = 0.5 / std::sqrt(2.0);
+    EXPECT_NEAR(Rms(output.data() + 500, output.size() - 1000), expected, 0.01) << input_rate;
+
+    // the output follows the input in time: compare with the ideal tone at the output rate
+    auto ideal = MakeTone(16000, 1000.0, output.size());
+    double error = 0.0;
+    for (std::size_t index = 500; index < output.size() - 500; index++) {
+      error += (output[index] - ideal[index]) * (output[index] - ideal[index]);
+    }
+    EXPECT_LT(std::sqrt(error / (output.size() - 1000)), 0.02) << input_rate;
+  }
+  PolyphaseResampler resampler(48000, 16000);
+  auto tone = MakeTone(48000, 12000.0, 24000);
+  std::vector<float> output(resampler.OutputCount(tone.size()));
+  resampler.Process(tone.data(), tone.size(), output.data());
+  EXPECT_LT(Rms(output.data() + 500, output.size() - 1000), 0.5 / std::sqrt(2.0) * 0.001);
+}
+
+/**
+ * The pipeline converts declared layouts to 16 bit mono pcm at the configured rate.
+ */
+TEST(AudioNormalizerSuite, PipelineNormalizes)
+{
+  NormalizationConfiguration configuration;
+  configuration.enabled = true;
+  AudioPipeline pipeline(VoiceActivityConfiguration(), OpusConfiguration(), configuration);
+
+  auto tone = MakeTone(48000, 440.0, 48000);
+  std::vector<float> stereo(2 * tone.size());
+  for (std::size_t index = 0; index < tone.size(); index++) {
+    stereo[2 * index] = tone[index];
+    stereo[2 * index + 1] = tone[index];
+  }
+  std::vector<uint8_t> audio(stereo.size() * sizeof(float));
+  std::memcpy(audio.data(), stereo.data(), audio.size());
+  auto processed = pipeline.Process(
+    "audio/lpcm; sample-rate=48000; sample-size-bits=32; channel-count=2; sample-format=float",
+    audio);
+  EXPECT_EQ(processed.content_type, "audio/l16; rate=16000; channels=1");
+  ASSERT_TRUE(processed.normalized);
+  EXPECT_EQ(processed.data, processed.normalized->data());
+  EXPECT_EQ(processed.size, 16000u * sizeof(int16_t));
+
+  // lex formats are uploaded as they are
+  std::vector<uint8_t> lex_audio(3200);
+  processed = pipeline.Process("audio/l16; rate=8000; channels=1", lex_audio);
+  EXPECT_FALSE(processed.normalized);
+  EXPECT_EQ(processed.data, lex_audio.data());
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/latency_stats.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace Aws::Lex;
+
+/**
+ * A bucket's value is within 1/16th of the latencies counted in it.
+ */
+TEST(LatencyHistogramTest, BucketError)
+{
+  for (uint64_t micros = 0; micros < 10000000; micros = micros * 9 / 8 + 1) {
+    auto bucket = LatencyHistogram::GetBucket(micros);
+    ASSERT_LT(bucket, LatencyHistogram::kBucketCount);
+    double value = LatencyHistogram::GetBucketValue(bucket);
+    EXPECT_LE(std::abs(value - micros), micros / 16.0 + 0.5) << micros;
+  }
+  EXPECT_EQ(LatencyHistogram::GetBucket(uint64_t(1) << 40), LatencyHistogram::kBucketCount - 1);
+}
+
+TEST(LatencyHistogramTest, Percentiles)
+{
+  LatencyHistogram histogram;
+  LatencyHistogram::Counts counts;
+  histogram.Load(counts);
+  EXPECT_EQ(LatencyHistogram::GetPercentile(counts, 50), 0.0);
+  for (uint64_t micros = 1; micros <= 1000; micros++) {
+    histogram.Record(micros * 1000);
+  }
+  histogram.Load(counts);
+  EXPECT_NEAR(LatencyHistogram::GetPercentile(counts, 50), 500000, 500000 / 16.0);
+  EXPECT_NEAR(LatencyHistogram::GetPercentile(counts, 90), 900000, 900000 / 16.0);
+  EXPECT_NEAR(LatencyHistogram::GetPercentile(counts, 99), 990000, 990000 / 16.0);
+}
+
+/**
+ * Stages are timed between their marks, stages the call did not go through are skipped.
+ */
+TEST(LatencyStatsTest, StageTimer)
+{
+  StageTimer timer;
+  uint64_t micros = 0;
+  EXPECT_FALSE(timer.GetStageMicros(LatencyStage::kTotal, micros));
+  timer.Mark(StageMark::kStart);
+  timer.Mark(StageMark::kCallStarted);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  timer.Mark(StageMark::kCallReturned);
+  timer.Mark(StageMark::kDecoded);
+  EXPECT_TRUE(timer.GetStageMicros(LatencyStage::kTotal, micros));
+  EXPECT_GE(micros, 5000u);
+  EXPECT_TRUE(timer.GetStageMicros(LatencyStage::kBuild, micros));
+  EXPECT_LT(micros, 5000u);
+  EXPECT_FALSE(timer.GetStageMicros(LatencyStage::kUpload, micros));
+  EXPECT_FALSE(timer.GetStageMicros(LatencyStage::kDownload, micros));
+}
+
+/**
+ * Each collection summarizes the calls since the previous one, per bot and per intent.
+ */
+TEST(LatencyStatsTest, CollectPerIntent)
+{
+  LatencyStats stats;
+  StageTimer timer;
+  timer.Mark(StageMark::kStart);
+  timer.Mark(StageMark::kDecoded);
+  stats.Record("bot", "OrderFlowers", timer);
+  stats.Record("bot", "OrderFlowers", timer);
+  stats.Record("bot", "", timer);
+  stats.Record("other_bot", "BookHotel", timer);
+
+  auto summaries = stats.Collect();
+  ASSERT_EQ(summaries.size(), 4u);
+  EXPECT_EQ(summaries[0].bot_name, "bot");
+  EXPECT_EQ(summaries[0].intent_name, "");
+  EXPECT_EQ(summaries[0].stage, LatencyStage::kTotal);
+  EXPECT_EQ(summaries[0].count, 3u);
+  EXPECT_EQ(summaries[1].intent_name, "OrderFlowers");
+  EXPECT_EQ(summaries[1].count, 2u);
+  EXPECT_EQ(summaries[2].bot_name, "other_bot");
+  EXPECT_EQ(summaries[2].intent_name, "");
+  EXPECT_EQ(summaries[3].intent_name, "BookHotel");
+  EXPECT_LE(summaries[0].p50_ms, summaries[0].p99_ms);
+
+  EXPECT_TRUE(stats.Collect().empty());
+  stats.Record("bot", "OrderFlowers", timer);
+  summaries = stats.Collect();
+  ASSERT_EQ(summaries.size(), 2u);
+  EXPECT_EQ(summaries[0].count, 1u);
+}
+
+/**
+ * Calls recorded from several threads are all counted, further intents count towards the bot.
+ */
+TEST(LatencyStatsTest, ConcurrentRecord)
+{
+  LatencyStats stats;
+  StageTimer timer;
+  timer.Mark(StageMark::kStart);
+  timer.Mark(StageMark::kDecoded);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; thread++) {
+    threads.emplace_back([&stats, &timer]() {
+      for (std::size_t intent = 0; intent < 2 * LatencyStats::kMaxSeries; intent++) {
+        stats.Record("bot", "intent" + std::to_string(intent), timer);
+      }
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  auto summaries = stats.Collect();
+  ASSERT_EQ(summaries.size(), LatencyStats::kMaxSeries);
+  EXPECT_EQ(summaries[0].intent_name, "");
+  EXPECT_EQ(summaries[0].count, 8 * LatencyStats::kMaxSeries);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
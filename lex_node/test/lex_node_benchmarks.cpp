@@ -0,0 +1,544 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <aws/core/Aws.h>
+#include <aws/core/utils/HashingUtils.h>
+#include <aws/core/utils/json/JsonSerializer.h>
+#include <aws/lex/model/PostContentRequest.h>
+#include <aws/lex/model/PostContentResult.h>
+#include <benchmark/benchmark.h>
+#include <lex_node/async_log_system.h>
+#include <lex_node/audio_normalizer.h>
+#include <lex_node/lex_node.h>
+#include <lex_node/request_body_stream.h>
+#include <lex_node/response_audio_stream.h>
+#include <lex_node/response_cache.h>
+#include <lex_node/voice_activity.h>
+#include <ros/ros.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mock_lex_client.h"
+
+namespace Aws {
+namespace Lex {
+
+int CopyResult(LexRuntimeService::Model::PostContentResult & result,
+               lex_common_msgs::AudioTextConversationResponse & response);
+
+bool DecodeSlots(const Aws::String & encoded_slots, std::vector<lex_common_msgs::KeyValue> & slots);
+
+}  // namespace Lex
+}  // namespace Aws
+
+namespace {
+
+/**
+ * Heap allocations of the process, counted by the malloc wrappers below.
+ */
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+}  // namespace
+
+#ifdef __GLIBC__
+// the sdk allocates with malloc unless it is built with custom memory management, and operator new
+// allocates with malloc, counting malloc counts both
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * pointer, size_t size);
+
+void * malloc(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(count * size, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void * realloc(void * pointer, size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  return __libc_realloc(pointer, size);
+}
+}
+#endif
+
+namespace {
+
+/**
+ * Reports the allocations made while a benchmark runs, per iteration.
+ */
+class AllocationCounter
+{
+public:
+  explicit AllocationCounter(benchmark::State & state)
+  : state_(state),
+    allocations_(g_allocations.load()),
+    allocated_bytes_(g_allocated_bytes.load())
+  {
+  }
+
+  ~AllocationCounter()
+  {
+    state_.counters["allocs_per_op"] = benchmark::Counter(
+      static_cast<double>(g_allocations.load() - allocations_), benchmark::Counter::kAvgIterations);
+    state_.counters["alloc_bytes_per_op"] =
+      benchmark::Counter(static_cast<double>(g_allocated_bytes.load() - allocated_bytes_),
+                         benchmark::Counter::kAvgIterations);
+  }
+
+private:
+  benchmark::State & state_;
+  uint64_t allocations_;
+  uint64_t allocated_bytes_;
+};
+
+/**
+ * @return the slots header of a PostContent reply with a number of slots
+ */
+Aws::String MakeEncodedSlots(int slot_count)
+{
+  std::string json = "{";
+  for (int slot = 0; slot < slot_count; slot++) {
+    json += (slot > 0 ? ", \"slot" : "\"slot") + std::to_string(slot) + "\": \"value " +
+            std::to_string(slot) + "\"";
+  }
+  json += "}";
+  Aws::Utils::ByteBuffer buffer(reinterpret_cast<const unsigned char *>(json.data()),
+                                json.size());
+  return Aws::Utils::HashingUtils::Base64Encode(buffer);
+}
+
+/**
+ * Fill a PostContent reply eliciting a slot, with a number of slots.
+ */
+void SetElicitSlotReply(Aws::LexRuntimeService::Model::PostContentResult & result, int slot_count)
+{
+  result.SetIntentName("BookHotel");
+  result.SetMessage("What city will you be staying in?");
+  result.SetMessageFormat(Aws::LexRuntimeService::Model::MessageFormatType::PlainText);
+  result.SetDialogState(Aws::LexRuntimeService::Model::DialogState::ElicitSlot);
+  result.SetSlots(MakeEncodedSlots(slot_count));
+}
+
+/**
+ * Applies the sizes of the CopyResult benchmarks, reply audio bytes and slot count.
+ */
+void CopyResultArguments(benchmark::internal::Benchmark * benchmark)
+{
+  for (int audio_bytes : {0, 16 << 10, 256 << 10}) {
+    for (int slot_count : {0, 4, 16}) {
+      benchmark->Args({audio_bytes, slot_count});
+    }
+  }
+}
+
+/**
+ * CopyResult of a PostContent reply received by the response audio stream, by reply audio bytes
+ * and slot count. The audio is moved into the response, the stream is refilled outside of the
+ * timing for each reply, as the http client does.
+ */
+void BM_CopyResult(benchmark::State & state)
+{
+  std::string audio(state.range(0), 'a');
+  Aws::LexRuntimeService::Model::PostContentResult result;
+  SetElicitSlotReply(result, static_cast<int>(state.range(1)));
+  auto * audio_stream = Aws::New<Aws::Lex::ResponseAudioStream>("benchmark");
+  result.ReplaceBody(audio_stream);
+  lex_common_msgs::AudioTextConversationResponse response;
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    audio_stream->GetBuffer().Reserve(audio.size());
+    audio_stream->write(audio.data(), audio.size());
+    state.ResumeTiming();
+    Aws::Lex::CopyResult(result, response);
+    benchmark::DoNotOptimize(response.audio_response.data.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CopyResult)->Apply(CopyResultArguments);
+
+/**
+ * CopyResult of a PostContent reply received by a string stream, the sdk default, as a baseline.
+ * The audio is copied out of the stream, which is left as it is.
+ */
+void BM_CopyResultStringStream(benchmark::State & state)
+{
+  std::string audio(state.range(0), 'a');
+  Aws::LexRuntimeService::Model::PostContentResult result;
+  SetElicitSlotReply(result, static_cast<int>(state.range(1)));
+  auto * audio_stream = Aws::New<std::stringstream>("benchmark");
+  *audio_stream << audio;
+  result.ReplaceBody(audio_stream);
+  lex_common_msgs::AudioTextConversationResponse response;
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    Aws::Lex::CopyResult(result, response);
+    benchmark::DoNotOptimize(response.audio_response.data.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CopyResultStringStream)->Apply(CopyResultArguments);
+
+/**
+ * Building a PostContent request around the request audio and reading its body, as the http
+ * client sends it.
+ */
+void BM_RequestBody(benchmark::State & state)
+{
+  std::vector<uint8_t> audio(state.range(0), 1);
+  char chunk[16 << 10];
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    Aws::LexRuntimeService::Model::PostContentRequest request;
+    request.WithBotAlias("superbot").WithBotName("test_bot").WithUserId("test_user");
+    request.WithAccept("audio/pcm").SetContentType("audio/l16; rate=16000; channels=1");
+    request.SetBody(Aws::MakeShared<Aws::Lex::RequestBodyStream>("benchmark", audio.data(),
+                                                                 audio.size()));
+    auto body = request.GetBody();
+    while (body->read(chunk, sizeof(chunk)) || body->gcount() > 0) {
+      benchmark::DoNotOptimize(chunk);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RequestBody)->Arg(16 << 10)->Arg(256 << 10)->Arg(1 << 20);
+
+/**
+ * Name of the vectorized audio kernels built, labelling their benchmarks.
+ */
+#if defined(__SSE2__)
+constexpr char kAudioKernels[] = "sse2";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+constexpr char kAudioKernels[] = "neon";
+#else
+constexpr char kAudioKernels[] = "scalar";
+#endif
+
+/**
+ * One second of 48 kHz 16 bit pcm with a number of channels.
+ */
+std::vector<int16_t> MakePcm(int channels)
+{
+  std::vector<int16_t> pcm(48000 * channels);
+  for (std::size_t index = 0; index < pcm.size(); index++) {
+    pcm[index] = static_cast<int16_t>(static_cast<int>(index * 7919 % 40000) - 20000);
+  }
+  return pcm;
+}
+
+/**
+ * Downmixing a second of 48 kHz pcm to mono float, scalar (0) or vectorized (1), by channels.
+ */
+void BM_DownmixToFloat(benchmark::State & state)
+{
+  Aws::Lex::PcmFormat format;
+  format.sample_rate = 48000;
+  format.channels = static_cast<int>(state.range(1));
+  auto pcm = MakePcm(format.channels);
+  auto data = reinterpret_cast<const uint8_t *>(pcm.data());
+  std::vector<float> mono(48000);
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    if (1 == state.range(0)) {
+      Aws::Lex::DownmixToFloat(data, mono.size(), format, mono.data());
+    } else {
+      Aws::Lex::DownmixToFloatScalar(data, mono.size(), format, mono.data());
+    }
+    benchmark::DoNotOptimize(mono.data());
+  }
+  state.SetBytesProcessed(state.iterations() * pcm.size() * sizeof(int16_t));
+  state.SetLabel(1 == state.range(0) ? kAudioKernels : "scalar");
+}
+BENCHMARK(BM_DownmixToFloat)->Args({0, 1})->Args({1, 1})->Args({0, 2})->Args({1, 2});
+
+/**
+ * Resampling a second of mono float audio to 16 kHz, by input rate.
+ */
+void BM_Resample(benchmark::State & state)
+{
+  const int input_rate = static_cast<int>(state.range(0));
+  std::vector<float> input(input_rate);
+  for (std::size_t index = 0; index < input.size(); index++) {
+    input[index] = std::sin(0.05f * index) * 0.5f;
+  }
+  Aws::Lex::PolyphaseResampler resampler(input_rate, 16000);
+  std::vector<float> output(resampler.OutputCount(input.size()));
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    resampler.Process(input.data(), input.size(), output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+  state.SetLabel(kAudioKernels);
+}
+BENCHMARK(BM_Resample)->Arg(8000)->Arg(44100)->Arg(48000);
+
+/**
+ * Converting a second of 16 kHz float audio to 16 bit pcm, scalar (0) or vectorized (1).
+ */
+void BM_FloatToInt16(benchmark::State & state)
+{
+  std::vector<float> samples(16000);
+  for (std::size_t index = 0; index < samples.size(); index++) {
+    samples[index] = std::sin(0.05f * index) * 0.9f;
+  }
+  std::vector<int16_t> output(samples.size());
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    if (1 == state.range(0)) {
+      Aws::Lex::FloatToInt16(samples.data(), samples.size(), output.data());
+    } else {
+      Aws::Lex::FloatToInt16Scalar(samples.data(), samples.size(), output.data());
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+  state.SetLabel(1 == state.range(0) ? kAudioKernels : "scalar");
+}
+BENCHMARK(BM_FloatToInt16)->Arg(0)->Arg(1);
+
+/**
+ * Voice activity features of a second of 16 kHz pcm in 10 ms frames, scalar (0) or vectorized (1).
+ */
+void BM_FrameFeatures(benchmark::State & state)
+{
+  constexpr std::size_t kFrameSamples = 160;
+  std::vector<int16_t> pcm(16000);
+  for (std::size_t index = 0; index < pcm.size(); index++) {
+    pcm[index] = static_cast<int16_t>(std::sin(0.05f * index) * 8000.0f);
+  }
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    for (std::size_t frame = 0; frame + kFrameSamples <= pcm.size(); frame += kFrameSamples) {
+      auto features =
+        1 == state.range(0)
+          ? Aws::Lex::ComputeFrameFeatures(pcm.data() + frame, kFrameSamples)
+          : Aws::Lex::ComputeFrameFeaturesScalar(pcm.data() + frame, kFrameSamples);
+      benchmark::DoNotOptimize(features);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * pcm.size());
+  state.SetLabel(1 == state.range(0) ? kAudioKernels : "scalar");
+}
+BENCHMARK(BM_FrameFeatures)->Arg(0)->Arg(1);
+
+/**
+ * Decoding the base64 json slots of a PostContent reply, by slot count.
+ */
+void BM_DecodeSlots(benchmark::State & state)
+{
+  auto encoded_slots = MakeEncodedSlots(static_cast<int>(state.range(0)));
+  std::vector<lex_common_msgs::KeyValue> slots;
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    Aws::Lex::DecodeSlots(encoded_slots, slots);
+    benchmark::DoNotOptimize(slots.data());
+  }
+  state.SetBytesProcessed(state.iterations() * encoded_slots.size());
+}
+BENCHMARK(BM_DecodeSlots)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * The slot decoding the node used before the slot decoder, base64 decoded to a byte buffer, copied
+ * to a string, parsed to a json document and copied to the slots, as a baseline.
+ */
+void BM_DecodeSlotsJsonDocument(benchmark::State & state)
+{
+  auto encoded_slots = MakeEncodedSlots(static_cast<int>(state.range(0)));
+  std::vector<lex_common_msgs::KeyValue> slots;
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    auto slot_byte_buffer = Aws::Utils::HashingUtils::Base64Decode(encoded_slots);
+    Aws::String slot_string(reinterpret_cast<char *>(slot_byte_buffer.GetUnderlyingData()),
+                            slot_byte_buffer.GetLength());
+    auto slot_json = Aws::Utils::Json::JsonValue(slot_string);
+    auto view = slot_json.GetAllObjects();
+    slots = std::vector<lex_common_msgs::KeyValue>(view.size());
+    auto slot_it = slots.begin();
+    for (auto & element : view) {
+      slot_it->key = element.first.c_str();
+      slot_it->value = element.second.AsString().c_str();
+      slot_it++;
+    }
+    benchmark::DoNotOptimize(slots.data());
+  }
+  state.SetBytesProcessed(state.iterations() * encoded_slots.size());
+}
+BENCHMARK(BM_DecodeSlotsJsonDocument)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * A response cache hit, by the number of replies cached.
+ */
+void BM_ResponseCacheLookup(benchmark::State & state)
+{
+  Aws::Lex::ResponseCacheConfiguration configuration;
+  configuration.enabled = true;
+  configuration.max_entries = static_cast<int>(state.range(0));
+  configuration.intents = {"Stop"};
+  Aws::Lex::ResponseCache cache(configuration);
+  for (int64_t index = 0; index < state.range(0); index++) {
+    Aws::Lex::CachedResponse response;
+    response.text_response = "ok";
+    response.intent_name = "Stop";
+    response.dialog_state = "Fulfilled";
+    cache.Insert(Aws::Lex::MakeResponseCacheKey("test_bot", "superbot",
+                                                "stop " + std::to_string(index), "text/plain"),
+                 std::move(response), false);
+  }
+  auto key = Aws::Lex::MakeResponseCacheKey("test_bot", "superbot",
+                                            "stop " + std::to_string(state.range(0) / 2),
+                                            "text/plain");
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    auto response = cache.Lookup(key, false);
+    benchmark::DoNotOptimize(response.get());
+  }
+}
+BENCHMARK(BM_ResponseCacheLookup)->Arg(16)->Arg(1024);
+
+/**
+ * A lex_conversation request served by LexServerCallback against a lex client replying at once,
+ * text (0) or audio (1), with the stage latencies timed (1) or not (0).
+ */
+void BM_LexServerCallback(benchmark::State & state)
+{
+  bool is_audio = 1 == state.range(0);
+  Aws::Lex::LexConfiguration lex_configuration;
+  lex_configuration.user_id = "test_user";
+  lex_configuration.bot_name = "test_bot";
+  lex_configuration.bot_alias = "superbot";
+  Aws::Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(lex_configuration, std::make_shared<MockLexClient>(true));
+  Aws::Lex::LatencyStatsConfiguration latency_stats_configuration;
+  latency_stats_configuration.enabled = 1 == state.range(1);
+  lex_node.ConfigureLatencyStats(latency_stats_configuration);
+
+  lex_common_msgs::AudioTextConversationRequest request;
+  if (is_audio) {
+    request.content_type = "audio/l16; rate=16000; channels=1";
+    request.accept_type = "audio/pcm";
+    request.audio_request.data.assign(32000, 1);
+  } else {
+    request.content_type = "text/plain; charset=utf-8";
+    request.accept_type = "text/plain; charset=utf-8";
+    request.text_request = "make a reservation";
+  }
+  lex_common_msgs::AudioTextConversationResponse response;
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    lex_node.LexServerCallback(request, response);
+    benchmark::DoNotOptimize(response.text_response.data());
+  }
+  state.SetBytesProcessed(state.iterations() * request.audio_request.data.size());
+}
+BENCHMARK(BM_LexServerCallback)->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1});
+
+/**
+ * Log system writing each line to /dev/null and flushing it, as a console or rosout appender does
+ * on the logging thread.
+ */
+class DevNullLogSystem : public Aws::Utils::Logging::LogSystemInterface
+{
+public:
+  DevNullLogSystem() : file_(std::fopen("/dev/null", "w")) {}
+  ~DevNullLogSystem() override { std::fclose(file_); }
+
+  Aws::Utils::Logging::LogLevel GetLogLevel() const override
+  {
+    return Aws::Utils::Logging::LogLevel::Debug;
+  }
+
+  void Log(Aws::Utils::Logging::LogLevel, const char * tag, const char * format, ...) override
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    std::fprintf(file_, "[%s] ", tag);
+    std::vfprintf(file_, format, arguments);
+    std::fputc('\n', file_);
+    std::fflush(file_);
+    va_end(arguments);
+  }
+
+  void LogStream(Aws::Utils::Logging::LogLevel, const char * tag,
+                 const Aws::OStringStream & message_stream) override
+  {
+    std::fprintf(file_, "[%s] %s\n", tag, message_stream.str().c_str());
+    std::fflush(file_);
+  }
+
+private:
+  std::FILE * file_;
+};
+
+/**
+ * A debug line logged on the calling thread (0) or handed to the asynchronous log system (1).
+ */
+void BM_LogLine(benchmark::State & state)
+{
+  std::shared_ptr<Aws::Utils::Logging::LogSystemInterface> log_system =
+    std::make_shared<DevNullLogSystem>();
+  std::shared_ptr<Aws::Lex::AsyncLogSystem> async_log_system;
+  if (1 == state.range(0)) {
+    async_log_system =
+      std::make_shared<Aws::Lex::AsyncLogSystem>(Aws::Lex::LoggingConfiguration(), log_system);
+    log_system = async_log_system;
+  }
+  Aws::OStringStream message_stream;
+  message_stream << "Request bot=test_bot alias=superbot user=test_user content_type=\"audio/l16; "
+                    "rate=16000; channels=1\" payload_bytes=32000 hash=0123abcd";
+  AllocationCounter allocation_counter(state);
+  for (auto _ : state) {
+    log_system->LogStream(Aws::Utils::Logging::LogLevel::Debug, "benchmark", message_stream);
+  }
+  if (async_log_system) {
+    async_log_system->Flush();
+    state.counters["dropped"] = static_cast<double>(async_log_system->GetStats().dropped);
+  }
+}
+BENCHMARK(BM_LogLine)->Arg(0)->Arg(1);
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  // the lex node needs ros initialized, but no master: nothing is advertised
+  ros::init(argc, argv, "lex_node_benchmarks",
+            ros::init_options::AnonymousName | ros::init_options::NoRosout);
+  Aws::SDKOptions options;
+  Aws::InitAPI(options);
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  Aws::ShutdownAPI(options);
+  return 0;
+}
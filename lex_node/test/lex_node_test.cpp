@@ -13,6 +13,7 @@
  * permissions and limitations under the License.
  */
 
+#include <actionlib/client/action_client.h>
 #include <aws/core/Aws.h>
 #include <aws/core/config/AWSProfileConfigLoader.h>
 #include <aws/core/utils/HashingUtils.h>
@@ -20,12 +21,26 @@
 #include <aws/core/utils/logging/AWSLogging.h>
 #include <aws/core/utils/logging/DefaultLogSystem.h>
 #include <aws/lex/LexRuntimeServiceClient.h>
+#include <aws/lex/model/GetSessionRequest.h>
 #include <aws_common/sdk_utils/aws_error.h>
 #include <gtest/gtest.h>
 #include <lex_node/lex_configuration.h>
 #include <lex_node/lex_node.h>
 #include <ros/ros.h>
 
+#include "mock_lex_client.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 using namespace Aws;
 
 namespace Aws {
@@ -38,7 +53,7 @@ namespace Lex {
  * @param response [out] result copy
  * @return error code
  */
-int CopyResult(const LexRuntimeService::Model::PostContentResult & result,
+int CopyResult(LexRuntimeService::Model::PostContentResult & result,
                lex_common_msgs::AudioTextConversationResponse & response);
 
 /**
@@ -147,60 +162,18 @@ public:
   }
   AwsError ReadList(const char * name, std::vector<std::string> & out) const
   {
-    return AWS_ERR_NOT_FOUND;
+    AwsError result = AWS_ERR_NOT_FOUND;
+    if (list_map_.count(name) > 0) {
+      out = list_map_.at(name);
+      result = AWS_ERR_OK;
+    }
+    return result;
   }
   AwsError ReadDouble(const char * name, double & out) const { return AWS_ERR_NOT_FOUND; }
 
   std::map<std::string, int> int_map_;
   std::map<std::string, std::string> string_map_;
-};
-
-class MockLexClient : public LexRuntimeService::LexRuntimeServiceClient
-{
-public:
-  MockLexClient(bool succeed = false) : succeed_(succeed) {}
-
-  // MockLexClient(LexRuntimeService::Model::PostContentOutcome outcome) : outcome_(outcome) {}
-
-  virtual LexRuntimeService::Model::PostContentOutcome PostContent(
-    const LexRuntimeService::Model::PostContentRequest & request) const override
-  {
-    if (succeed_) {
-      LexRuntimeService::Model::PostContentResult result;
-
-      result.SetContentType("test_content_type");
-
-      result.SetIntentName("test_intent_name");
-
-      constexpr unsigned char slot_string[] =
-        "{\"test_slots_key1\": \"test_slots_value1\", \"test_slots_key2\": \"test_slots_value2\"}";
-      Utils::ByteBuffer slot_buffer(slot_string, sizeof(slot_string));
-      auto slot_stdstring = Utils::HashingUtils::Base64Encode(slot_buffer);
-      result.SetSlots(slot_stdstring);
-
-      result.SetSessionAttributes("test_session_attributes");
-
-      result.SetMessage("test_message");
-
-      result.SetMessageFormat(LexRuntimeService::Model::MessageFormatType::CustomPayload);
-
-      result.SetDialogState(LexRuntimeService::Model::DialogState::Failed);
-
-      result.SetSlotToElicit("test_active_slot");
-
-      std::stringstream * audio_data = New<std::stringstream>("test");
-      *audio_data << "blah blah blah";
-      result.ReplaceBody(audio_data);
-
-      return LexRuntimeService::Model::PostContentOutcome(std::move(result));
-    } else {
-      return LexRuntimeService::Model::PostContentOutcome(
-        Client::AWSError<LexRuntimeService::LexRuntimeServiceErrors>());
-    }
-  }
-
-private:
-  bool succeed_;
+  std::map<std::string, std::vector<std::string>> list_map_;
 };
 
 /**
@@ -274,6 +247,8 @@ TEST_F(LexNodeSuite, LexNodePostContentSucceed)
   ASSERT_TRUE(lex_node.IsServiceValid());
 
   auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  // an audio reply needs PostContent
+  request_.accept_type = "audio/pcm";
 
   lex_common_msgs::AudioTextConversationResponse response;
   bool success = PostContent(request_, response, configuration_, lex_runtime_client);
@@ -292,6 +267,501 @@ TEST_F(LexNodeSuite, LexNodePostContentSucceed)
   EXPECT_EQ(response.dialog_state, "Failed");
 }
 
+/**
+ * Test that PostContent() sends the request audio, or the request text when there is no audio
+ */
+TEST_F(LexNodeSuite, LexNodePostContentBody)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  lex_common_msgs::AudioTextConversationResponse response;
+
+  request_.accept_type = "audio/pcm";
+  EXPECT_TRUE(PostContent(request_, response, configuration_, lex_runtime_client));
+  EXPECT_EQ(lex_runtime_client->last_body_, "make a reservation");
+
+  request_.content_type = "audio/l16; rate=16000; channels=1";
+  request_.audio_request.data = {0x00, 0x01, 0x7f, 0x80, 0xff, 0x00};
+  EXPECT_TRUE(PostContent(request_, response, configuration_, lex_runtime_client));
+  EXPECT_EQ(lex_runtime_client->last_body_,
+            std::string(request_.audio_request.data.begin(), request_.audio_request.data.end()));
+}
+
+/**
+ * Test that text only requests expecting a text reply are sent with PostText
+ */
+TEST_F(LexNodeSuite, LexNodePostTextRoute)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  lex_common_msgs::AudioTextConversationResponse response;
+
+  EXPECT_TRUE(PostContent(request_, response, configuration_, lex_runtime_client));
+  EXPECT_EQ(lex_runtime_client->last_input_text_, "make a reservation");
+  EXPECT_TRUE(lex_runtime_client->last_body_.empty());
+  EXPECT_EQ(response.text_response, "test_message");
+  EXPECT_TRUE(response.audio_response.data.empty());
+  ASSERT_EQ(response.slots.size(), 2u);
+  EXPECT_EQ(response.slots[0].key, "test_slots_key1");
+  EXPECT_EQ(response.slots[0].value, "test_slots_value1");
+  EXPECT_EQ(response.slots[1].key, "test_slots_key2");
+  EXPECT_EQ(response.slots[1].value, "test_slots_value2");
+  EXPECT_EQ(response.intent_name, "test_intent_name");
+  EXPECT_EQ(response.message_format_type, "CustomPayload");
+  EXPECT_EQ(response.dialog_state, "Failed");
+
+  auto failing_client = std::make_shared<MockLexClient>(false);
+  lex_common_msgs::AudioTextConversationResponse failed_response;
+  EXPECT_FALSE(PostContent(request_, failed_response, configuration_, failing_client));
+  EXPECT_TRUE(failed_response.text_response.empty());
+}
+
+/**
+ * Test that a repeated text command of a cacheable intent is answered without calling lex
+ */
+TEST_F(LexNodeSuite, LexNodeResponseCache)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  lex_runtime_client->text_dialog_state_ = LexRuntimeService::Model::DialogState::Fulfilled;
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  Lex::ResponseCacheConfiguration response_cache_configuration;
+  response_cache_configuration.enabled = true;
+  response_cache_configuration.intents = {"test_intent_name"};
+  lex_node.ConfigureResponseCache(response_cache_configuration);
+
+  lex_common_msgs::AudioTextConversationResponse first_response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, first_response));
+  request_.text_request = "Make a reservation.";
+  lex_common_msgs::AudioTextConversationResponse cached_response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, cached_response));
+
+  EXPECT_EQ(lex_runtime_client->post_text_calls_.load(), 1);
+  EXPECT_EQ(cached_response.text_response, "test_message");
+  EXPECT_EQ(cached_response.intent_name, "test_intent_name");
+  EXPECT_EQ(cached_response.dialog_state, "Fulfilled");
+  ASSERT_EQ(cached_response.slots.size(), 2u);
+  EXPECT_EQ(cached_response.slots[1].value, "test_slots_value2");
+  auto stats = lex_node.GetResponseCacheStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+
+  // replies that leave the dialog open are not cached
+  lex_runtime_client->text_dialog_state_ = LexRuntimeService::Model::DialogState::ElicitSlot;
+  request_.text_request = "book a hotel";
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, first_response));
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, first_response));
+  EXPECT_EQ(lex_runtime_client->post_text_calls_.load(), 3);
+}
+
+/**
+ * Test that a cached reply is not used once the session holds attributes lex has to see
+ */
+TEST_F(LexNodeSuite, LexNodeResponseCacheSessionAttributes)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  lex_runtime_client->text_dialog_state_ = LexRuntimeService::Model::DialogState::Fulfilled;
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  Lex::ResponseCacheConfiguration response_cache_configuration;
+  response_cache_configuration.enabled = true;
+  response_cache_configuration.intents = {"test_intent_name"};
+  lex_node.ConfigureResponseCache(response_cache_configuration);
+
+  lex_common_msgs::AudioTextConversationResponse response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  lex_common_msgs::KeyValue attribute;
+  attribute.key = "city";
+  attribute.value = "Seattle";
+  request_.session_attributes = {attribute};
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->post_text_calls_.load(), 2);
+
+  // the stored attribute forces a miss, the cached reply was made without it
+  request_.session_attributes.clear();
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->post_text_calls_.load(), 3);
+  EXPECT_EQ(lex_runtime_client->last_session_attributes_,
+            (std::map<std::string, std::string>{{"city", "Seattle"}}));
+  EXPECT_EQ(lex_node.GetResponseCacheStats().hits, 0u);
+}
+
+/**
+ * Test that the audio of a prompt is added to the prompt audio cache
+ */
+TEST_F(LexNodeSuite, LexNodePromptAudioCache)
+{
+  char directory[] = "/tmp/lex_node_prompt_audioXXXXXX";
+  ASSERT_TRUE(nullptr != mkdtemp(directory));
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  Lex::PromptAudioCacheConfiguration prompt_audio_cache_configuration;
+  prompt_audio_cache_configuration.enabled = true;
+  prompt_audio_cache_configuration.directory = directory;
+  lex_node.ConfigurePromptAudioCache(prompt_audio_cache_configuration);
+
+  request_.accept_type = "audio/pcm";
+  lex_common_msgs::AudioTextConversationResponse response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_node.GetPromptAudioCacheStats().insertions, 1u);
+
+  // close the node's cache, a directory is used by one cache at a time
+  lex_node.ConfigurePromptAudioCache(Lex::PromptAudioCacheConfiguration());
+  {
+    Lex::PromptAudioCache cache(prompt_audio_cache_configuration);
+    ASSERT_TRUE(cache.IsOpen());
+    auto audio = cache.Lookup(Lex::MakePromptAudioKey(configuration_.bot_name,
+                                                      configuration_.bot_alias, "test_message",
+                                                      "CustomPayload", "audio/pcm"));
+    ASSERT_TRUE(audio != nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char *>(audio->Data()), audio->Size()),
+              "blah blah blah");
+  }
+  std::remove((std::string(directory) + "/prompt_audio.data").c_str());
+  std::remove((std::string(directory) + "/prompt_audio.index").c_str());
+  rmdir(directory);
+}
+
+/**
+ * Test that the connections to lex are warmed up at Init() and kept alive while idle
+ */
+TEST_F(LexNodeSuite, LexNodeConnectionWarmUp)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true, std::chrono::milliseconds(20));
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  Lex::ConnectionConfiguration connection_configuration;
+  connection_configuration.warm_up = true;
+  connection_configuration.connections = 2;
+  connection_configuration.keepalive_interval_s = 0.1;
+  connection_configuration.idle_timeout_s = 1.0;
+  lex_node.ConfigureConnection(connection_configuration);
+  EXPECT_EQ(lex_node.GetConnectionStats().state, Lex::ConnectionState::kCold);
+  lex_node.Init();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (lex_node.GetConnectionStats().keepalives < 1 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto stats = lex_node.GetConnectionStats();
+  EXPECT_EQ(stats.warm_ups, 1u);
+  EXPECT_GE(stats.keepalives, 1u);
+  EXPECT_EQ(stats.failures, 0u);
+  EXPECT_EQ(stats.state, Lex::ConnectionState::kWarm);
+  // one call per connection and one on an open connection, then one per connection per keepalive
+  EXPECT_GE(lex_runtime_client->get_session_calls_.load(), 5);
+
+  lex_common_msgs::AudioTextConversationResponse response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_node.GetConnectionStats().state, Lex::ConnectionState::kWarm);
+}
+
+/**
+ * Test that the stages of a lex call are timed per bot and per intent
+ */
+TEST_F(LexNodeSuite, LexNodeLatencyStats)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true, std::chrono::milliseconds(20));
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  lex_node.ConfigureLatencyStats(Lex::LatencyStatsConfiguration());
+
+  lex_common_msgs::AudioTextConversationResponse response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  auto summaries = lex_node.CollectLatencyStats();
+  // the mock sends and receives no bytes, the call is timed as a whole
+  ASSERT_EQ(summaries.size(), 6u);
+  EXPECT_EQ(summaries[0].bot_name, configuration_.bot_name);
+  EXPECT_EQ(summaries[0].intent_name, "");
+  EXPECT_EQ(summaries[0].stage, Lex::LatencyStage::kBuild);
+  EXPECT_EQ(summaries[2].stage, Lex::LatencyStage::kTotal);
+  EXPECT_EQ(summaries[2].count, 1u);
+  EXPECT_GE(summaries[2].p50_ms, 18.0);
+  EXPECT_EQ(summaries[3].intent_name, "test_intent_name");
+
+  // failed calls are not timed
+  auto failing_client = std::make_shared<MockLexClient>(false);
+  lex_node.ConfigureAwsLex(configuration_, failing_client);
+  EXPECT_FALSE(lex_node.LexServerCallback(request_, response));
+  EXPECT_TRUE(lex_node.CollectLatencyStats().empty());
+}
+
+/**
+ * Test that bot profiles are loaded with the default user id, the first one standing for a
+ * missing default bot
+ */
+TEST_F(LexNodeSuite, LoadBotProfiles)
+{
+  TestParameterReader param_reader(configuration_.user_id, "", "");
+  param_reader.list_map_[Lex::kBotProfilesKey] = {"booking", "small_talk", "incomplete"};
+  param_reader.string_map_[LEX_BOTS_PATH "booking/bot_name"] = "BookTrip";
+  param_reader.string_map_[LEX_BOTS_PATH "booking/bot_alias"] = "prod";
+  param_reader.int_map_[LEX_BOTS_PATH "booking/max_connections"] = 4;
+  param_reader.string_map_[LEX_BOTS_PATH "small_talk/bot_name"] = "SmallTalk";
+  param_reader.string_map_[LEX_BOTS_PATH "small_talk/bot_alias"] = "beta";
+  param_reader.string_map_[LEX_BOTS_PATH "small_talk/user_id"] = "talker";
+  param_reader.string_map_[LEX_BOTS_PATH "incomplete/bot_name"] = "Incomplete";
+
+  auto lex_configuration = Lex::LoadLexParameters(param_reader);
+  EXPECT_EQ(lex_configuration.bot_name, "BookTrip");
+  EXPECT_EQ(lex_configuration.bot_alias, "prod");
+  EXPECT_EQ(lex_configuration.max_connections, 4);
+
+  auto bot_profiles = Lex::LoadBotProfiles(param_reader, lex_configuration);
+  ASSERT_EQ(bot_profiles.size(), 2u);
+  EXPECT_EQ(bot_profiles[0].name, "booking");
+  EXPECT_EQ(bot_profiles[0].lex_configuration.user_id, configuration_.user_id);
+  EXPECT_EQ(bot_profiles[1].name, "small_talk");
+  EXPECT_EQ(bot_profiles[1].lex_configuration.bot_name, "SmallTalk");
+  EXPECT_EQ(bot_profiles[1].lex_configuration.user_id, "talker");
+  EXPECT_EQ(bot_profiles[1].lex_configuration.max_connections, 0);
+}
+
+/**
+ * Test that requests are routed to the client of their bot profile, with calls and errors counted
+ * per bot
+ */
+TEST_F(LexNodeSuite, LexNodeBotProfiles)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  auto small_talk_client = std::make_shared<MockLexClient>(false);
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  Lex::BotProfile small_talk;
+  small_talk.name = "small_talk";
+  small_talk.lex_configuration = configuration_;
+  small_talk.lex_configuration.bot_name = "SmallTalk";
+  lex_node.ConfigureBotProfile(small_talk, small_talk_client);
+  // a profile of the default bot shares its client
+  Lex::BotProfile booking;
+  booking.name = "booking";
+  booking.lex_configuration = configuration_;
+  lex_node.ConfigureBotProfile(booking, std::make_shared<MockLexClient>(true));
+
+  lex_common_msgs::AudioTextConversationResponse response;
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  request_.bot = "booking";
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  request_.bot = "small_talk";
+  EXPECT_FALSE(lex_node.LexServerCallback(request_, response));
+  request_.bot = "weather";
+  EXPECT_FALSE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->post_text_calls_.load(), 2);
+  EXPECT_EQ(small_talk_client->post_text_calls_.load(), 1);
+
+  auto bot_stats = lex_node.GetBotStats();
+  ASSERT_EQ(bot_stats.size(), 2u);
+  auto & default_stats = bot_stats[0].bot_name == configuration_.bot_name ? bot_stats[0]
+                                                                           : bot_stats[1];
+  auto & small_talk_stats = bot_stats[0].bot_name == "SmallTalk" ? bot_stats[0] : bot_stats[1];
+  EXPECT_EQ(default_stats.profiles, std::vector<std::string>({"", "booking"}));
+  EXPECT_EQ(default_stats.calls, 2u);
+  EXPECT_EQ(default_stats.errors, 0u);
+  EXPECT_EQ(small_talk_stats.profiles, std::vector<std::string>({"small_talk"}));
+  EXPECT_EQ(small_talk_stats.bot_name, "SmallTalk");
+  EXPECT_EQ(small_talk_stats.calls, 1u);
+  EXPECT_EQ(small_talk_stats.errors, 1u);
+}
+
+/**
+ * Test that requests with a user id call lex in their own session, tracked in the session table
+ */
+TEST_F(LexNodeSuite, LexNodeUserSessions)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  lex_runtime_client->text_dialog_state_ = LexRuntimeService::Model::DialogState::ElicitSlot;
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+
+  lex_common_msgs::AudioTextConversationResponse response;
+  request_.user_id = "guest";
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->last_user_id_, "guest");
+  lex_runtime_client->text_dialog_state_ = LexRuntimeService::Model::DialogState::Fulfilled;
+  request_.user_id.clear();
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->last_user_id_, configuration_.user_id);
+
+  Lex::SessionInfo info;
+  ASSERT_TRUE(lex_node.GetSession(
+    Lex::MakeSessionKey(configuration_.bot_name, configuration_.bot_alias, "guest"), info));
+  EXPECT_EQ(info.dialog_state, "ElicitSlot");
+  EXPECT_EQ(info.turns, 1u);
+  ASSERT_TRUE(lex_node.GetSession(Lex::MakeSessionKey(configuration_.bot_name,
+                                                      configuration_.bot_alias,
+                                                      configuration_.user_id),
+                                  info));
+  EXPECT_EQ(info.dialog_state, "Fulfilled");
+}
+
+/**
+ * Test that session attributes set by a request are carried to the next turns of its session,
+ * over PostText and PostContent, until a request removes them
+ */
+TEST_F(LexNodeSuite, LexNodeSessionAttributes)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  Lex::LexNode lex_node;
+  lex_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+
+  lex_common_msgs::AudioTextConversationResponse response;
+  lex_common_msgs::KeyValue attribute;
+  attribute.key = "city";
+  attribute.value = "Seattle";
+  request_.session_attributes = {attribute};
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->last_session_attributes_,
+            (std::map<std::string, std::string>{{"city", "Seattle"}}));
+  ASSERT_EQ(response.session_attributes.size(), 1u);
+  EXPECT_EQ(response.session_attributes[0].key, "city");
+  EXPECT_EQ(response.session_attributes[0].value, "Seattle");
+
+  request_.session_attributes.clear();
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_EQ(lex_runtime_client->last_session_attributes_.size(), 1u);
+
+  // an audio reply needs PostContent, the attributes are sent as a header
+  request_.accept_type = "audio/pcm";
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  auto encoded = Aws::Utils::HashingUtils::Base64Encode(
+    Aws::Utils::ByteBuffer(reinterpret_cast<const unsigned char *>("{\"city\":\"Seattle\"}"), 18));
+  EXPECT_EQ(lex_runtime_client->last_encoded_session_attributes_, encoded.c_str());
+  ASSERT_EQ(response.session_attributes.size(), 1u);
+  EXPECT_EQ(response.session_attributes[0].value, "Seattle");
+
+  attribute.value.clear();
+  request_.session_attributes = {attribute};
+  request_.accept_type = "text/plain; charset=utf-8";
+  EXPECT_TRUE(lex_node.LexServerCallback(request_, response));
+  EXPECT_TRUE(lex_runtime_client->last_session_attributes_.empty());
+  EXPECT_TRUE(response.session_attributes.empty());
+}
+
+/**
+ * Test that slow text turns of a read only intent are hedged within the hedge budget, the
+ * duplicates going to another lex session than the turns they hedge and replying first
+ */
+TEST_F(LexNodeSuite, LexNodeHedgedText)
+{
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true);
+  auto calls = std::make_shared<std::atomic<int>>(0);
+  const std::string user_id = configuration_.user_id;
+  // one turn in 25 is slow in the session of the user, the hedge session always replies at once.
+  // A slow turn is only timed out by its duplicate
+  lex_runtime_client->latency_distribution_ = [calls, user_id](const std::string & call_user_id) {
+    if (call_user_id != user_id) {
+      return std::chrono::milliseconds(0);
+    }
+    return std::chrono::milliseconds(0 == ++*calls % 25 ? 10000 : 0);
+  };
+  Lex::LexNode hedged_node;
+  hedged_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  Lex::HedgingConfiguration hedging_configuration;
+  hedging_configuration.enabled = true;
+  hedging_configuration.delay_ms = 100;
+  hedging_configuration.intents = {"test_intent_name"};
+  hedged_node.ConfigureHedging(hedging_configuration);
+  for (int turn = 0; turn < 100; turn++) {
+    lex_common_msgs::AudioTextConversationResponse response;
+    EXPECT_TRUE(hedged_node.LexServerCallback(request_, response));
+  }
+
+  auto stats = hedged_node.GetHedgingStats();
+  // the first turn tells the intent of the text, the turns after it are hedgeable
+  EXPECT_EQ(stats.calls, 99u);
+  // the budget saved up 1 plus 5 per 100 calls, enough for the 4 slow turns
+  EXPECT_EQ(stats.hedges, 4u);
+  EXPECT_EQ(stats.hedge_wins, 4u);
+  EXPECT_EQ(stats.budget_denials, 0u);
+  // lex rejects a call for a session with one in flight, the mock too
+  EXPECT_EQ(lex_runtime_client->conflicts_.load(), 0);
+
+  // texts of other intents are never hedged, a duplicate would fulfill them twice
+  Lex::LexNode unlisted_node;
+  unlisted_node.ConfigureAwsLex(configuration_, lex_runtime_client);
+  hedging_configuration.intents = {"read_only_intent"};
+  unlisted_node.ConfigureHedging(hedging_configuration);
+  lex_common_msgs::AudioTextConversationResponse response;
+  EXPECT_TRUE(unlisted_node.LexServerCallback(request_, response));
+  EXPECT_TRUE(unlisted_node.LexServerCallback(request_, response));
+  EXPECT_EQ(unlisted_node.GetHedgingStats().calls, 0u);
+}
+
+/**
+ * Wait for an action goal to reach a communication state.
+ */
+static bool WaitForCommState(
+  actionlib::ClientGoalHandle<lex_common_msgs::LexConversationAction> & goal_handle,
+  actionlib::CommState::StateEnum state, ros::WallDuration timeout = ros::WallDuration(10))
+{
+  auto deadline = ros::WallTime::now() + timeout;
+  while (goal_handle.getCommState() != state && ros::WallTime::now() < deadline) {
+    ros::WallDuration(0.01).sleep();
+  }
+  return goal_handle.getCommState() == state;
+}
+
+/**
+ * Check that a newer conversation goal for the same lex session preempts the goal in flight.
+ *
+ * @param param_reader to build the node with
+ * @param configuration of the bot
+ * @param request whose text the goals send
+ */
+static void ExpectGoalSuperseded(std::shared_ptr<TestParameterReader> param_reader,
+                                 const Lex::LexConfiguration & configuration,
+                                 const lex_common_msgs::AudioTextConversationRequest & request)
+{
+  auto lex_node = Lex::BuildLexNode(param_reader);
+  auto lex_runtime_client = std::make_shared<MockLexClient>(true, std::chrono::milliseconds(500));
+  lex_node.ConfigureAwsLex(configuration, lex_runtime_client);
+
+  // a single thread spins the global queue, as ros::spin does
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+  ros::NodeHandle private_handle("~");
+  actionlib::ActionClient<lex_common_msgs::LexConversationAction> client(
+    private_handle, "lex_conversation_action");
+  ASSERT_TRUE(client.waitForActionServerToStart(ros::Duration(10)));
+
+  lex_common_msgs::LexConversationGoal goal;
+  goal.content_type = request.content_type;
+  goal.accept_type = request.accept_type;
+  goal.text_request = request.text_request;
+
+  auto stale_goal = client.sendGoal(goal);
+  ASSERT_TRUE(WaitForCommState(stale_goal, actionlib::CommState::ACTIVE));
+  auto goal_handle = client.sendGoal(goal);
+
+  ASSERT_TRUE(WaitForCommState(stale_goal, actionlib::CommState::DONE));
+  EXPECT_EQ(stale_goal.getTerminalState(), actionlib::TerminalState::PREEMPTED);
+  ASSERT_TRUE(WaitForCommState(goal_handle, actionlib::CommState::DONE));
+  EXPECT_EQ(goal_handle.getTerminalState(), actionlib::TerminalState::SUCCEEDED);
+  EXPECT_EQ(goal_handle.getResult()->text_response, "test_message");
+  EXPECT_EQ(goal_handle.getResult()->dialog_state, "Failed");
+}
+
+/**
+ * Test that a newer conversation goal for the same lex session preempts the goal in flight
+ */
+TEST_F(LexNodeSuite, LexNodeConversationGoalSuperseded)
+{
+  ExpectGoalSuperseded(std::make_shared<TestParameterReader>(
+                         configuration_.user_id, configuration_.bot_name, configuration_.bot_alias),
+                       configuration_, request_);
+}
+
+/**
+ * Test that goals are preempted without dispatch threads, lex requests then use the global queue
+ */
+TEST_F(LexNodeSuite, LexNodeConversationGoalSupersededWithoutDispatchThreads)
+{
+  auto param_reader = std::make_shared<TestParameterReader>(
+    configuration_.user_id, configuration_.bot_name, configuration_.bot_alias);
+  param_reader->int_map_[Lex::kDispatchThreadsKey] = 0;
+  ExpectGoalSuperseded(param_reader, configuration_, request_);
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <lex_node/lex_stand_in.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace Aws::Lex;
+
+namespace {
+
+/**
+ * A blocking http client over one connection to the stand-in.
+ */
+class TestConnection
+{
+public:
+  explicit TestConnection(int port)
+  {
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    is_connected_ = 0 == connect(fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+  }
+
+  ~TestConnection() { close(fd_); }
+
+  bool IsConnected() const { return is_connected_; }
+
+  bool Send(const std::string & data)
+  {
+    return static_cast<ssize_t>(data.size()) == send(fd_, data.data(), data.size(), 0);
+  }
+
+  /**
+   * Read a response with a content-length body.
+   *
+   * @param[out] head status line and headers
+   * @param[out] body
+   * @return false if the connection closed first
+   */
+  bool Receive(std::string & head, std::string & body)
+  {
+    std::size_t head_end;
+    while (std::string::npos == (head_end = buffer_.find("\r\n\r\n"))) {
+      if (!ReadMore()) {
+        return false;
+      }
+    }
+    head = buffer_.substr(0, head_end + 2);
+    auto length_start = head.find("Content-Length: ");
+    std::size_t length =
+      std::string::npos == length_start ? 0 : std::stoul(head.substr(length_start + 16));
+    while (buffer_.size() < head_end + 4 + length) {
+      if (!ReadMore()) {
+        return false;
+      }
+    }
+    body = buffer_.substr(head_end + 4, length);
+    buffer_.erase(0, head_end + 4 + length);
+    return true;
+  }
+
+private:
+  bool ReadMore()
+  {
+    char chunk[4096];
+    ssize_t bytes_read = recv(fd_, chunk, sizeof(chunk), 0);
+    if (bytes_read <= 0) {
+      return false;
+    }
+    buffer_.append(chunk, bytes_read);
+    return true;
+  }
+
+  int fd_ = -1;
+  bool is_connected_ = false;
+  std::string buffer_;
+};
+
+std::string PostTextRequest(const std::string & input_text)
+{
+  std::string body = "{\"inputText\":\"" + input_text + "\",\"sessionAttributes\":{}}";
+  return "POST /bot/test_bot/alias/superbot/user/test_user/text HTTP/1.1\r\n"
+         "Host: 127.0.0.1\r\nContent-Type: application/json\r\nContent-Length: " +
+         std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+}  // namespace
+
+class LexStandInSuite : public ::testing::Test
+{
+protected:
+  void Start()
+  {
+    stand_in_.reset(new LexStandIn(configuration_));
+    ASSERT_TRUE(stand_in_->Start());
+    connection_.reset(new TestConnection(stand_in_->GetPort()));
+    ASSERT_TRUE(connection_->IsConnected());
+  }
+
+  LexStandInConfiguration configuration_;
+  std::unique_ptr<LexStandIn> stand_in_;
+  std::unique_ptr<TestConnection> connection_;
+  std::string head_;
+  std::string body_;
+};
+
+/**
+ * PostText turns get the first matching scripted reply as json, on a kept alive connection.
+ */
+TEST_F(LexStandInSuite, PostTextScriptedReplies)
+{
+  StandInReply reply;
+  reply.match = "flowers";
+  reply.intent_name = "OrderFlowers";
+  reply.dialog_state = "ElicitSlot";
+  reply.message = "What type of flowers?";
+  reply.slot_to_elicit = "FlowerType";
+  reply.slots = {{"FlowerType", "roses"}};
+  configuration_.replies.push_back(reply);
+  Start();
+
+  ASSERT_TRUE(connection_->Send(PostTextRequest("order some flowers")));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_EQ(0u, head_.find("HTTP/1.1 200 OK"));
+  EXPECT_NE(std::string::npos, body_.find("\"intentName\":\"OrderFlowers\""));
+  EXPECT_NE(std::string::npos, body_.find("\"dialogState\":\"ElicitSlot\""));
+  EXPECT_NE(std::string::npos, body_.find("\"slotToElicit\":\"FlowerType\""));
+  EXPECT_NE(std::string::npos, body_.find("\"slots\":{\"FlowerType\":\"roses\"}"));
+
+  ASSERT_TRUE(connection_->Send(PostTextRequest("hello")));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_NE(std::string::npos, body_.find("\"intentName\":\"StandIn\""));
+  EXPECT_NE(std::string::npos, body_.find("\"dialogState\":\"Fulfilled\""));
+
+  auto stats = stand_in_->GetStats();
+  EXPECT_EQ(2u, stats.post_text);
+  EXPECT_EQ(1u, stats.connections);
+}
+
+/**
+ * PostContent replies in headers, with silence of the accepted audio type as the body. Chunked
+ * request bodies are read.
+ */
+TEST_F(LexStandInSuite, PostContentAudio)
+{
+  configuration_.audio_bytes = 3200;
+  Start();
+  ASSERT_TRUE(connection_->Send(
+    "POST /bot/test_bot/alias/superbot/user/test_user/content HTTP/1.1\r\n"
+    "Content-Type: audio/l16; rate=16000; channels=1\r\nAccept: audio/pcm\r\n"
+    "Transfer-Encoding: chunked\r\nExpect: 100-continue\r\n\r\n"
+    "4\r\nabcd\r\n2\r\nef\r\n0\r\n\r\n"));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_EQ(0u, head_.find("HTTP/1.1 100 Continue"));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_EQ(0u, head_.find("HTTP/1.1 200 OK"));
+  EXPECT_NE(std::string::npos, head_.find("Content-Type: audio/pcm\r\n"));
+  EXPECT_NE(std::string::npos, head_.find("x-amz-lex-intent-name: StandIn\r\n"));
+  EXPECT_NE(std::string::npos, head_.find("x-amz-lex-dialog-state: Fulfilled\r\n"));
+  EXPECT_NE(std::string::npos, head_.find("x-amz-lex-slots: e30=\r\n"));
+  EXPECT_EQ(std::string(3200, '\0'), body_);
+  EXPECT_EQ(1u, stand_in_->GetStats().post_content);
+}
+
+/**
+ * Injected faults reply with the error types of the lex runtime, unknown calls with 404.
+ */
+TEST_F(LexStandInSuite, Faults)
+{
+  configuration_.error_percent = 100;
+  Start();
+  ASSERT_TRUE(connection_->Send(PostTextRequest("hello")));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_EQ(0u, head_.find("HTTP/1.1 500"));
+  EXPECT_NE(std::string::npos, head_.find("x-amzn-ErrorType: InternalFailureException"));
+
+  ASSERT_TRUE(connection_->Send("GET /ping HTTP/1.1\r\n\r\n"));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_EQ(0u, head_.find("HTTP/1.1 404"));
+
+  configuration_.error_percent = 0;
+  configuration_.throttle_percent = 100;
+  Start();
+  ASSERT_TRUE(connection_->Send(PostTextRequest("hello")));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_EQ(0u, head_.find("HTTP/1.1 429"));
+  EXPECT_NE(std::string::npos, head_.find("x-amzn-ErrorType: LimitExceededException"));
+  EXPECT_EQ(1u, stand_in_->GetStats().throttles);
+}
+
+/**
+ * Replies wait for the latency, slow bodies trickle over slow_body_ms.
+ */
+TEST_F(LexStandInSuite, LatencyAndSlowBody)
+{
+  configuration_.latency_ms = 50;
+  configuration_.slow_body_percent = 100;
+  configuration_.slow_body_ms = 100;
+  Start();
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(connection_->Send(PostTextRequest("hello")));
+  ASSERT_TRUE(connection_->Receive(head_, body_));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(140));
+  EXPECT_NE(std::string::npos, body_.find("\"intentName\":\"StandIn\""));
+  EXPECT_EQ(1u, stand_in_->GetStats().slow_bodies);
+}
+
+/**
+ * Stopping does not wait for the latency of the calls in flight.
+ */
+TEST_F(LexStandInSuite, StopInterruptsCalls)
+{
+  configuration_.latency_ms = 60000;
+  Start();
+  ASSERT_TRUE(connection_->Send(PostTextRequest("hello")));
+  while (0 == stand_in_->GetStats().post_text) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto start = std::chrono::steady_clock::now();
+  stand_in_->Stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_FALSE(connection_->Receive(head_, body_));
+}
+
+TEST(LexStandInTest, LoadScript)
+{
+  std::string path = ::testing::TempDir() + "lex_stand_in_script.tsv";
+  {
+    std::ofstream script(path);
+    script << "# match\tdialog state\tintent\tmessage\tslots\tslot to elicit\n"
+           << "\n"
+           << "flowers\tElicitSlot\tOrderFlowers\tWhat type?\t"
+           << "FlowerType=roses;Count=2\tPickupDate\n"
+           << "\t\tFallback\tSorry?\n";
+  }
+  std::vector<StandInReply> replies;
+  ASSERT_TRUE(LoadStandInScript(path, replies));
+  std::remove(path.c_str());
+  ASSERT_EQ(2u, replies.size());
+  EXPECT_EQ("flowers", replies[0].match);
+  EXPECT_EQ("ElicitSlot", replies[0].dialog_state);
+  EXPECT_EQ("OrderFlowers", replies[0].intent_name);
+  EXPECT_EQ("What type?", replies[0].message);
+  ASSERT_EQ(2u, replies[0].slots.size());
+  EXPECT_EQ("Count", replies[0].slots[1].first);
+  EXPECT_EQ("2", replies[0].slots[1].second);
+  EXPECT_EQ("PickupDate", replies[0].slot_to_elicit);
+  EXPECT_EQ("", replies[1].match);
+  EXPECT_EQ("Fulfilled", replies[1].dialog_state);
+  EXPECT_EQ("Fallback", replies[1].intent_name);
+
+  EXPECT_FALSE(LoadStandInScript(path, replies));
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
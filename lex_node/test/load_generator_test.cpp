@@ -0,0 +1,159 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/load_generator.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+using namespace Aws::Lex;
+
+namespace {
+
+std::vector<LoadTurn> MakeTurns()
+{
+  LoadTurn turn;
+  turn.text_request = "make a reservation";
+  return {turn};
+}
+
+}  // namespace
+
+/**
+ * A closed loop keeps the concurrency busy and counts the errors by name.
+ */
+TEST(LoadGeneratorTest, ClosedLoop)
+{
+  LoadGeneratorConfiguration configuration;
+  configuration.concurrency = 4;
+  configuration.duration_s = 0.5;
+  std::atomic<int> calls{0};
+  LoadGenerator generator(configuration, MakeTurns(), [&calls](int caller, const LoadTurn &) {
+    EXPECT_LT(caller, 4);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return 0 == calls++ % 10 ? std::string("call_failed") : std::string();
+  });
+  auto report = generator.Run();
+  // 4 callers making 10 ms calls for 500 ms
+  EXPECT_GT(report.calls, 100u);
+  EXPECT_LE(report.calls, 200u);
+  EXPECT_EQ(static_cast<int>(report.calls), calls.load());
+  EXPECT_EQ(report.errors, report.error_counts["call_failed"]);
+  EXPECT_NEAR(report.errors, report.calls / 10.0, 1.0);
+  EXPECT_NEAR(LatencyHistogram::GetPercentile(report.service_time, 50), 10000, 3000);
+
+  auto text = FormatLoadReport(report);
+  EXPECT_NE(std::string::npos, text.find("calls/s"));
+  EXPECT_NE(std::string::npos, text.find("call_failed: "));
+  EXPECT_NE(std::string::npos, text.find("Corrected latency histogram"));
+}
+
+/**
+ * A stall of an open loop delays the calls scheduled meanwhile, their corrected latencies count it
+ * while the service time of each call does not.
+ */
+TEST(LoadGeneratorTest, OpenLoopCorrectsStalls)
+{
+  LoadGeneratorConfiguration configuration;
+  configuration.concurrency = 1;
+  configuration.rate_per_s = 200;
+  configuration.duration_s = 1.0;
+  std::atomic<int> calls{0};
+  LoadGenerator generator(configuration, MakeTurns(), [&calls](int, const LoadTurn &) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(0 == calls++ ? 300 : 1));
+    return std::string();
+  });
+  auto report = generator.Run();
+  EXPECT_GT(report.calls, 150u);
+  EXPECT_LE(report.calls, 200u);
+  // a single call of the run stalled
+  EXPECT_LT(LatencyHistogram::GetPercentile(report.service_time, 99), 100000);
+  // the 60 calls scheduled during the stall waited up to 300 ms
+  EXPECT_GT(LatencyHistogram::GetPercentile(report.response_time, 90), 100000);
+}
+
+/**
+ * A stall of a closed loop hides the calls it did not send, the correction adds them back.
+ */
+TEST(LoadGeneratorTest, ClosedLoopCorrectsStalls)
+{
+  LoadGeneratorConfiguration configuration;
+  configuration.duration_s = 0.6;
+  configuration.expected_interval_ms = 2;
+  std::atomic<int> calls{0};
+  LoadGenerator generator(configuration, MakeTurns(), [&calls](int, const LoadTurn &) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(0 == calls++ ? 300 : 1));
+    return std::string();
+  });
+  auto report = generator.Run();
+  EXPECT_LT(LatencyHistogram::GetPercentile(report.service_time, 99), 100000);
+  EXPECT_GT(LatencyHistogram::GetPercentile(report.response_time, 90), 50000);
+}
+
+/**
+ * Calls scheduled during the warmup are made but not measured.
+ */
+TEST(LoadGeneratorTest, Warmup)
+{
+  LoadGeneratorConfiguration configuration;
+  configuration.rate_per_s = 100;
+  configuration.warmup_s = 0.2;
+  configuration.duration_s = 0.3;
+  std::atomic<int> calls{0};
+  LoadGenerator generator(configuration, MakeTurns(), [&calls](int, const LoadTurn &) {
+    calls++;
+    return std::string();
+  });
+  auto report = generator.Run();
+  EXPECT_EQ(50, calls.load());
+  EXPECT_EQ(30u, report.calls);
+}
+
+TEST(LoadGeneratorTest, LoadCorpora)
+{
+  std::string directory = ::testing::TempDir();
+  std::string text_path = directory + "load_generator_text.txt";
+  std::string audio_path = directory + "load_generator_audio.pcm";
+  std::string list_path = directory + "load_generator_audio.txt";
+  std::ofstream(text_path) << "make a reservation\n\nSeattle, WA\n";
+  std::ofstream(audio_path, std::ios::binary) << std::string("\x01\x02\x03\x04", 4);
+  std::ofstream(list_path) << "load_generator_audio.pcm\n";
+
+  std::vector<LoadTurn> turns;
+  EXPECT_TRUE(LoadTextCorpus(text_path, turns));
+  EXPECT_TRUE(LoadAudioCorpus(list_path, "audio/pcm", turns));
+  ASSERT_EQ(3u, turns.size());
+  EXPECT_EQ("Seattle, WA", turns[1].text_request);
+  EXPECT_EQ("text/plain; charset=utf-8", turns[1].content_type);
+  EXPECT_EQ(4u, turns[2].audio_request.size());
+  EXPECT_EQ("audio/l16; rate=16000; channels=1", turns[2].content_type);
+  EXPECT_EQ("audio/pcm", turns[2].accept_type);
+
+  std::remove(audio_path.c_str());
+  EXPECT_FALSE(LoadAudioCorpus(list_path, "audio/pcm", turns));
+  std::remove(text_path.c_str());
+  std::remove(list_path.c_str());
+  EXPECT_FALSE(LoadTextCorpus(text_path, turns));
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
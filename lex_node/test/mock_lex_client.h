@@ -0,0 +1,270 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <aws/core/utils/HashingUtils.h>
+#include <aws/core/utils/Outcome.h>
+#include <aws/lex/LexRuntimeServiceClient.h>
+#include <aws/lex/LexRuntimeServiceErrors.h>
+#include <aws/lex/model/GetSessionRequest.h>
+#include <aws/lex/model/PostContentRequest.h>
+#include <aws/lex/model/PostTextRequest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/**
+ * Lex runtime client replying to PostContent, PostText and GetSession without calling lex, shared
+ * by the tests and the benchmarks. Like lex, it rejects a PostContent or PostText call for a user
+ * that has one in flight.
+ */
+class MockLexClient : public Aws::LexRuntimeService::LexRuntimeServiceClient
+{
+public:
+  MockLexClient(bool succeed = false,
+                std::chrono::milliseconds latency = std::chrono::milliseconds(0))
+  : succeed_(succeed), latency_(latency)
+  {
+  }
+
+  // MockLexClient(Aws::LexRuntimeService::Model::PostContentOutcome outcome) : outcome_(outcome) {}
+
+  virtual Aws::LexRuntimeService::Model::PostContentOutcome PostContent(
+    const Aws::LexRuntimeService::Model::PostContentRequest & request) const override
+  {
+    if (request.GetBody()) {
+      std::stringstream body;
+      body << request.GetBody()->rdbuf();
+      last_body_ = body.str();
+    }
+    last_encoded_session_attributes_ = request.GetSessionAttributes().c_str();
+    SessionCall session_call(*this, request.GetUserId());
+    if (session_call.IsConflict()) {
+      return Aws::LexRuntimeService::Model::PostContentOutcome(MakeConflictError());
+    }
+    if (!SimulateRoundTrip(request)) {
+      return Aws::LexRuntimeService::Model::PostContentOutcome(
+        Aws::Client::AWSError<Aws::LexRuntimeService::LexRuntimeServiceErrors>());
+    }
+    if (succeed_) {
+      Aws::LexRuntimeService::Model::PostContentResult result;
+
+      result.SetContentType("test_content_type");
+
+      result.SetIntentName("test_intent_name");
+
+      constexpr unsigned char slot_string[] =
+        "{\"test_slots_key1\": \"test_slots_value1\", \"test_slots_key2\": \"test_slots_value2\"}";
+      Aws::Utils::ByteBuffer slot_buffer(slot_string, sizeof(slot_string));
+      auto slot_stdstring = Aws::Utils::HashingUtils::Base64Encode(slot_buffer);
+      result.SetSlots(slot_stdstring);
+
+      // lex replies with the session attributes it was sent when the bot leaves them unchanged
+      result.SetSessionAttributes(request.GetSessionAttributes().empty()
+                                    ? Aws::String("test_session_attributes")
+                                    : request.GetSessionAttributes());
+
+      result.SetMessage("test_message");
+
+      result.SetMessageFormat(Aws::LexRuntimeService::Model::MessageFormatType::CustomPayload);
+
+      result.SetDialogState(Aws::LexRuntimeService::Model::DialogState::Failed);
+
+      result.SetSlotToElicit("test_active_slot");
+
+      std::stringstream * audio_data = Aws::New<std::stringstream>("test");
+      *audio_data << "blah blah blah";
+      result.ReplaceBody(audio_data);
+
+      return Aws::LexRuntimeService::Model::PostContentOutcome(std::move(result));
+    } else {
+      return Aws::LexRuntimeService::Model::PostContentOutcome(
+        Aws::Client::AWSError<Aws::LexRuntimeService::LexRuntimeServiceErrors>());
+    }
+  }
+
+  virtual Aws::LexRuntimeService::Model::PostTextOutcome PostText(
+    const Aws::LexRuntimeService::Model::PostTextRequest & request) const override
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last_input_text_ = request.GetInputText().c_str();
+      last_user_id_ = request.GetUserId().c_str();
+      last_session_attributes_.clear();
+      for (const auto & attribute : request.GetSessionAttributes()) {
+        last_session_attributes_[attribute.first.c_str()] = attribute.second.c_str();
+      }
+    }
+    post_text_calls_++;
+    SessionCall session_call(*this, request.GetUserId());
+    if (session_call.IsConflict()) {
+      return Aws::LexRuntimeService::Model::PostTextOutcome(MakeConflictError());
+    }
+    if (!SimulateRoundTrip(request) || !succeed_) {
+      return Aws::LexRuntimeService::Model::PostTextOutcome(
+        Aws::Client::AWSError<Aws::LexRuntimeService::LexRuntimeServiceErrors>());
+    }
+    Aws::LexRuntimeService::Model::PostTextResult result;
+    result.SetIntentName("test_intent_name");
+    result.AddSlots("test_slots_key1", "test_slots_value1");
+    result.AddSlots("test_slots_key2", "test_slots_value2");
+    result.SetMessage("test_message");
+    result.SetMessageFormat(Aws::LexRuntimeService::Model::MessageFormatType::CustomPayload);
+    result.SetDialogState(text_dialog_state_);
+    result.SetSlotToElicit("test_active_slot");
+    result.SetSessionAttributes(request.GetSessionAttributes());
+    return Aws::LexRuntimeService::Model::PostTextOutcome(std::move(result));
+  }
+
+  virtual Aws::LexRuntimeService::Model::GetSessionOutcome GetSession(
+    const Aws::LexRuntimeService::Model::GetSessionRequest & request) const override
+  {
+    get_session_calls_++;
+    if (!SimulateRoundTrip(request)) {
+      return Aws::LexRuntimeService::Model::GetSessionOutcome(
+        Aws::Client::AWSError<Aws::LexRuntimeService::LexRuntimeServiceErrors>());
+    }
+    return Aws::LexRuntimeService::Model::GetSessionOutcome(
+      Aws::LexRuntimeService::Model::GetSessionResult());
+  }
+
+  /**
+   * Body of the last PostContent request received.
+   */
+  mutable std::string last_body_;
+
+  /**
+   * Input text of the last PostText request received.
+   */
+  mutable std::string last_input_text_;
+
+  /**
+   * User id of the last PostText request received.
+   */
+  mutable std::string last_user_id_;
+
+  /**
+   * Session attributes of the last PostText request received.
+   */
+  mutable std::map<std::string, std::string> last_session_attributes_;
+
+  /**
+   * Session attributes header of the last PostContent request received.
+   */
+  mutable std::string last_encoded_session_attributes_;
+
+  /**
+   * Number of PostText requests received, they may be concurrent.
+   */
+  mutable std::atomic<int> post_text_calls_{0};
+
+  /**
+   * Number of GetSession requests received, they may be concurrent.
+   */
+  mutable std::atomic<int> get_session_calls_{0};
+
+  /**
+   * Number of PostContent and PostText requests rejected because their user had one in flight.
+   */
+  mutable std::atomic<int> conflicts_{0};
+
+  /**
+   * Dialog state of the PostText replies.
+   */
+  Aws::LexRuntimeService::Model::DialogState text_dialog_state_ =
+    Aws::LexRuntimeService::Model::DialogState::Failed;
+
+  /**
+   * Latency of each call by the user id of the call when set, replacing the fixed latency. Called
+   * concurrently.
+   */
+  std::function<std::chrono::milliseconds(const std::string & user_id)> latency_distribution_;
+
+private:
+  /**
+   * Holds the session of a user for the duration of a call.
+   */
+  class SessionCall
+  {
+  public:
+    SessionCall(const MockLexClient & client, const Aws::String & user_id)
+    : client_(client), user_id_(user_id.c_str())
+    {
+      std::lock_guard<std::mutex> lock(client_.mutex_);
+      is_conflict_ = !client_.users_in_flight_.insert(user_id_).second;
+      if (is_conflict_) {
+        client_.conflicts_++;
+      }
+    }
+
+    ~SessionCall()
+    {
+      if (!is_conflict_) {
+        std::lock_guard<std::mutex> lock(client_.mutex_);
+        client_.users_in_flight_.erase(user_id_);
+      }
+    }
+
+    bool IsConflict() const { return is_conflict_; }
+
+  private:
+    const MockLexClient & client_;
+    std::string user_id_;
+    bool is_conflict_;
+  };
+
+  /**
+   * @return the error lex replies with to a call for a session that has one in flight
+   */
+  static Aws::Client::AWSError<Aws::LexRuntimeService::LexRuntimeServiceErrors> MakeConflictError()
+  {
+    return Aws::Client::AWSError<Aws::LexRuntimeService::LexRuntimeServiceErrors>(
+      Aws::LexRuntimeService::LexRuntimeServiceErrors::CONFLICT, "ConflictException",
+      "Another request for the session is in flight", false);
+  }
+
+  /**
+   * Simulate the round trip, giving up like the http client does when the request is cancelled.
+   *
+   * @return false if the request was cancelled
+   */
+  template <typename Request>
+  bool SimulateRoundTrip(const Request & request) const
+  {
+    auto latency =
+      latency_distribution_ ? latency_distribution_(request.GetUserId().c_str()) : latency_;
+    auto deadline = std::chrono::steady_clock::now() + latency;
+    while (std::chrono::steady_clock::now() < deadline) {
+      if (request.GetContinueRequestHandler() && !request.GetContinueRequestHandler()(nullptr)) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+  }
+
+  bool succeed_;
+  std::chrono::milliseconds latency_;
+  mutable std::mutex mutex_;
+  mutable std::set<std::string> users_in_flight_;
+};
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/audio_pipeline.h>
+#include <lex_node/opus_encoding.h>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace Aws::Lex;
+
+static std::vector<int16_t> MakeTone(int sample_rate, int length_ms)
+{
+  std::vector<int16_t> tone(sample_rate * length_ms / 1000);
+  for (size_t index = 0; index < tone.size(); index++) {
+    tone[index] = static_cast<int16_t>(8000.0 * std::sin(2.0 * M_PI * 300.0 * index / sample_rate));
+  }
+  return tone;
+}
+
+/**
+ * The encoded size is known before encoding, the body length is available right away.
+ */
+TEST(OpusEncodingSuite, EncodedSizeUpFront)
+{
+  OpusConfiguration configuration;
+  auto tone = MakeTone(16000, 1010);
+  auto job = std::make_shared<OpusEncodeJob>(tone.data(), tone.size(), 16000, configuration);
+  // 51 frames of 20 ms at 32 kbit/s, the last one zero padded
+  EXPECT_EQ(job->EncodedSize(), 51u * 80u);
+  EXPECT_EQ(job->ContentType(),
+            "audio/x-cbr-opus-with-preamble; preamble-size=0; bit-rate=32000; "
+            "frame-size-milliseconds=20");
+
+  OpusEncodedStream stream(job);
+  EXPECT_EQ(stream.seekg(0, std::ios_base::end).tellg(), std::streampos(51 * 80));
+  EXPECT_EQ(stream.seekg(0, std::ios_base::beg).tellg(), std::streampos(0));
+  // never queued, cancelling ends it and readers see no data
+  job->Cancel();
+  EXPECT_EQ(job->WaitForBytes(1), 0u);
+  EXPECT_FALSE(job->Succeeded());
+}
+
+/**
+ * The worker encodes constant size frames while the stream reads them.
+ */
+TEST(OpusEncodingSuite, StreamEncodedAudio)
+{
+  OpusConfiguration configuration;
+  OpusEncoderWorker worker(configuration);
+  auto tone = MakeTone(16000, 2000);
+  auto job = worker.Start(tone.data(), tone.size(), 16000);
+  OpusEncodedStream stream(job);
+  std::string body((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  if (!OpusEncoderWorker::IsAvailable()) {
+    EXPECT_TRUE(body.empty());
+    EXPECT_FALSE(job->Succeeded());
+    return;
+  }
+  EXPECT_TRUE(job->Succeeded());
+  ASSERT_EQ(body.size(), job->EncodedSize());
+  EXPECT_NEAR(static_cast<double>(job->PcmSize()) / job->EncodedSize(), 8.0, 0.01);
+  std::cout << "Encoded 2 s of audio in " << job->EncodeMs() << " ms" << std::endl;
+
+  // a retried request reads the body again
+  stream.clear();
+  stream.seekg(0, std::ios_base::beg);
+  std::string again((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(again, body);
+}
+
+/**
+ * The pipeline encodes mono 16 bit pcm at opus rates and rewrites the content type.
+ */
+TEST(OpusEncodingSuite, PipelineEncodes)
+{
+  OpusConfiguration configuration;
+  configuration.enabled = true;
+  AudioPipeline pipeline(VoiceActivityConfiguration(), configuration);
+  auto tone = MakeTone(16000, 500);
+  std::vector<uint8_t> audio(tone.size() * sizeof(int16_t));
+  std::memcpy(audio.data(), tone.data(), audio.size());
+
+  auto processed = pipeline.Process("audio/l16; rate=16000; channels=1", audio);
+  if (!OpusEncoderWorker::IsAvailable()) {
+    EXPECT_FALSE(processed.encode_job);
+    EXPECT_EQ(processed.content_type, "audio/l16; rate=16000; channels=1");
+    return;
+  }
+  ASSERT_TRUE(processed.encode_job);
+  EXPECT_EQ(processed.content_type, processed.encode_job->ContentType());
+  processed.encode_job->Cancel();
+
+  // 44.1 kHz is not an opus rate, stereo is not supported
+  EXPECT_FALSE(pipeline.Process("audio/l16; rate=44100; channels=1", audio).encode_job);
+  EXPECT_FALSE(pipeline.Process("audio/l16; rate=16000; channels=2", audio).encode_job);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/prompt_audio_cache.h>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Aws::Lex;
+
+class PromptAudioCacheSuite : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char directory[] = "/tmp/prompt_audio_cache_testXXXXXX";
+    ASSERT_TRUE(nullptr != mkdtemp(directory));
+    configuration_.enabled = true;
+    configuration_.directory = std::string(directory) + "/cache";
+  }
+
+  void TearDown() override
+  {
+    std::remove((configuration_.directory + "/prompt_audio.data").c_str());
+    std::remove((configuration_.directory + "/prompt_audio.index").c_str());
+    rmdir(configuration_.directory.c_str());
+    rmdir(configuration_.directory.substr(0, configuration_.directory.rfind('/')).c_str());
+  }
+
+  static std::string Key(const std::string & text)
+  {
+    return MakePromptAudioKey("bot", "alias", text, "PlainText", "audio/pcm");
+  }
+
+  static std::vector<uint8_t> Audio(std::size_t size, uint8_t seed)
+  {
+    std::vector<uint8_t> audio(size);
+    for (std::size_t index = 0; index < size; index++) {
+      audio[index] = static_cast<uint8_t>(seed + index * 7);
+    }
+    return audio;
+  }
+
+  static bool Matches(const std::shared_ptr<const PromptAudio> & prompt,
+                      const std::vector<uint8_t> & audio)
+  {
+    return prompt && prompt->Size() == audio.size() &&
+           std::equal(audio.begin(), audio.end(), prompt->Data());
+  }
+
+  PromptAudioCacheConfiguration configuration_;
+};
+
+/**
+ * Prompts are served from the data file after the node restarts.
+ */
+TEST_F(PromptAudioCacheSuite, PersistAcrossRestart)
+{
+  auto time_prompt = Audio(30001, 1);
+  auto city_prompt = Audio(12345, 2);
+  {
+    PromptAudioCache cache(configuration_);
+    ASSERT_TRUE(cache.IsOpen());
+    EXPECT_TRUE(cache.Lookup(Key("What time would you like?")) == nullptr);
+    EXPECT_TRUE(cache.Insert(Key("What time would you like?"), time_prompt.data(),
+                             time_prompt.size()));
+    EXPECT_TRUE(cache.Insert(Key("Which city?"), city_prompt.data(), city_prompt.size()));
+    EXPECT_TRUE(Matches(cache.Lookup(Key("Which city?")), city_prompt));
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+  }
+  PromptAudioCache cache(configuration_);
+  ASSERT_TRUE(cache.IsOpen());
+  EXPECT_EQ(cache.GetStats().entries, 2u);
+  EXPECT_TRUE(Matches(cache.Lookup(Key("What time would you like?")), time_prompt));
+  EXPECT_TRUE(Matches(cache.Lookup(Key("Which city?")), city_prompt));
+  EXPECT_TRUE(cache.Lookup(MakePromptAudioKey("bot", "alias", "Which city?", "PlainText",
+                                              "audio/mpeg")) == nullptr);
+}
+
+/**
+ * The least recently used prompts are dropped under the cap, audio handed out stays readable.
+ */
+TEST_F(PromptAudioCacheSuite, EvictUnderCap)
+{
+  configuration_.max_bytes = 64 * 1024;
+  PromptAudioCache cache(configuration_);
+  ASSERT_TRUE(cache.IsOpen());
+  auto first = Audio(10000, 3);
+  cache.Insert(Key("prompt 0"), first.data(), first.size());
+  auto held = cache.Lookup(Key("prompt 0"));
+  for (int index = 1; index < 20; index++) {
+    auto audio = Audio(10000, index);
+    EXPECT_TRUE(cache.Insert(Key("prompt " + std::to_string(index)), audio.data(), audio.size()));
+    // keep prompt 1 recently used
+    cache.Lookup(Key("prompt 1"));
+    EXPECT_LE(cache.GetStats().data_bytes, 64u * 1024u);
+  }
+  EXPECT_GT(cache.GetStats().evictions, 0u);
+  EXPECT_TRUE(cache.Lookup(Key("prompt 0")) == nullptr);
+  EXPECT_TRUE(Matches(cache.Lookup(Key("prompt 1")), Audio(10000, 1)));
+  EXPECT_TRUE(Matches(cache.Lookup(Key("prompt 19")), Audio(10000, 19)));
+  EXPECT_TRUE(Matches(held, first));
+
+  auto too_large = Audio(70000, 0);
+  EXPECT_FALSE(cache.Insert(Key("too large"), too_large.data(), too_large.size()));
+}
+
+/**
+ * Records appended after the index was written are recovered, an incomplete record is dropped.
+ */
+TEST_F(PromptAudioCacheSuite, RecoverAfterCrash)
+{
+  auto audio = Audio(5000, 4);
+  {
+    PromptAudioCache cache(configuration_);
+    ASSERT_TRUE(cache.IsOpen());
+    cache.Insert(Key("first"), audio.data(), audio.size());
+    cache.Insert(Key("second"), audio.data(), audio.size());
+  }
+  // lose the index entry of the second record, and leave half a record behind
+  std::string index_path = configuration_.directory + "/prompt_audio.index";
+  struct stat index_stat;
+  ASSERT_EQ(0, stat(index_path.c_str(), &index_stat));
+  ASSERT_EQ(0, truncate(index_path.c_str(), index_stat.st_size - 24));
+  std::string data_path = configuration_.directory + "/prompt_audio.data";
+  struct stat data_stat;
+  ASSERT_EQ(0, stat(data_path.c_str(), &data_stat));
+  {
+    std::ofstream data(data_path, std::ios::binary | std::ios::app);
+    data << std::string(100, '\0');
+  }
+
+  PromptAudioCache cache(configuration_);
+  ASSERT_TRUE(cache.IsOpen());
+  EXPECT_TRUE(Matches(cache.Lookup(Key("first")), audio));
+  EXPECT_TRUE(Matches(cache.Lookup(Key("second")), audio));
+  EXPECT_EQ(cache.GetStats().data_bytes, static_cast<std::size_t>(data_stat.st_size));
+}
+
+/**
+ * A second cache on the same directory stays closed.
+ */
+TEST_F(PromptAudioCacheSuite, ExclusiveDirectory)
+{
+  PromptAudioCache cache(configuration_);
+  ASSERT_TRUE(cache.IsOpen());
+  PromptAudioCache other(configuration_);
+  EXPECT_FALSE(other.IsOpen());
+  auto audio = Audio(100, 5);
+  EXPECT_FALSE(other.Insert(Key("prompt"), audio.data(), audio.size()));
+  EXPECT_TRUE(other.Lookup(Key("prompt")) == nullptr);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
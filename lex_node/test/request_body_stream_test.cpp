@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/request_body_stream.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace Aws::Lex;
+
+/**
+ * The body is read in place and can be read again after seeking back, the way the sdk computes the
+ * content length before sending it.
+ */
+TEST(RequestBodyStreamSuite, ReadAndSeek)
+{
+  std::vector<uint8_t> audio = {0, 1, 2, 3, 250, 251, 252, 253};
+  RequestBodyStream body(audio.data(), audio.size());
+
+  body.seekg(0, std::ios_base::end);
+  EXPECT_EQ(static_cast<std::streamoff>(body.tellg()), 8);
+  body.seekg(0, std::ios_base::beg);
+
+  std::vector<uint8_t> read(audio.size());
+  body.read(reinterpret_cast<char *>(read.data()), read.size());
+  EXPECT_EQ(body.gcount(), 8);
+  EXPECT_EQ(read, audio);
+  EXPECT_EQ(body.get(), std::char_traits<char>::eof());
+  EXPECT_TRUE(body.eof());
+
+  body.clear();
+  body.seekg(4);
+  EXPECT_EQ(body.get(), 250);
+  body.seekg(-2, std::ios_base::end);
+  EXPECT_EQ(body.get(), 252);
+  body.seekg(-1, std::ios_base::cur);
+  EXPECT_EQ(body.get(), 252);
+}
+
+/**
+ * Seeking outside of the body fails without moving the read position.
+ */
+TEST(RequestBodyStreamSuite, SeekOutOfRange)
+{
+  std::string text = "make a reservation";
+  RequestBodyStream body(text);
+  body.seekg(5);
+  body.seekg(100);
+  EXPECT_TRUE(body.fail());
+  body.clear();
+  EXPECT_EQ(static_cast<std::streamoff>(body.tellg()), 5);
+}
+
+/**
+ * The body does not accept writes.
+ */
+TEST(RequestBodyStreamSuite, ReadOnly)
+{
+  std::string text = "stop";
+  RequestBodyStream body(text);
+  body << "go";
+  EXPECT_TRUE(body.bad());
+  EXPECT_EQ(text, "stop");
+
+  body.clear();
+  std::stringstream copy;
+  copy << body.rdbuf();
+  EXPECT_EQ(copy.str(), "stop");
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
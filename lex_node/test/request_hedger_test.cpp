@@ -0,0 +1,235 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/request_hedger.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Aws::Lex;
+
+namespace {
+
+struct TestOutcome
+{
+  bool is_success = false;
+  /**
+   * 1 for the primary call, 2 for the duplicate.
+   */
+  int source = 0;
+
+  bool IsSuccess() const { return is_success; }
+};
+
+using TestCall = std::function<TestOutcome(const std::function<bool()> &)>;
+
+/**
+ * A call replying after a latency unless it is cancelled first.
+ */
+TestCall MakeCall(int source, std::chrono::milliseconds latency, bool is_success = true)
+{
+  return [source, latency, is_success](const std::function<bool()> & is_cancelled) {
+    auto deadline = std::chrono::steady_clock::now() + latency;
+    while (std::chrono::steady_clock::now() < deadline) {
+      if (is_cancelled()) {
+        return TestOutcome();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    TestOutcome outcome;
+    outcome.is_success = is_success;
+    outcome.source = source;
+    return outcome;
+  };
+}
+
+}  // namespace
+
+class RequestHedgerSuite : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    configuration_.enabled = true;
+    configuration_.delay_ms = 20;
+  }
+
+  HedgingConfiguration configuration_;
+};
+
+/**
+ * A slow call is hedged, the duplicate replies first and the slow call is cancelled.
+ */
+TEST_F(RequestHedgerSuite, HedgeSlowCall)
+{
+  RequestHedger hedger(configuration_);
+  auto start = std::chrono::steady_clock::now();
+  bool is_hedge_used = false;
+  auto outcome = hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(2000)),
+                                          MakeCall(2, std::chrono::milliseconds(5)), nullptr,
+                                          &is_hedge_used);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_TRUE(outcome.IsSuccess());
+  EXPECT_EQ(outcome.source, 2);
+  EXPECT_TRUE(is_hedge_used);
+  EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+  auto stats = hedger.GetStats();
+  EXPECT_EQ(stats.calls, 1u);
+  EXPECT_EQ(stats.hedges, 1u);
+  EXPECT_EQ(stats.hedge_wins, 1u);
+}
+
+/**
+ * A call replying before the delay is not hedged.
+ */
+TEST_F(RequestHedgerSuite, FastCallNotHedged)
+{
+  RequestHedger hedger(configuration_);
+  bool is_hedge_used = false;
+  auto outcome = hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(1)),
+                                          MakeCall(2, std::chrono::milliseconds(1)), nullptr,
+                                          &is_hedge_used);
+  EXPECT_EQ(outcome.source, 1);
+  EXPECT_FALSE(is_hedge_used);
+  EXPECT_EQ(hedger.GetStats().hedges, 0u);
+}
+
+/**
+ * When the primary call fails on its own, the duplicate in flight is waited for.
+ */
+TEST_F(RequestHedgerSuite, PrimaryFailureWaitsForHedge)
+{
+  RequestHedger hedger(configuration_);
+  auto outcome = hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(40), false),
+                                          MakeCall(2, std::chrono::milliseconds(60)));
+  EXPECT_TRUE(outcome.IsSuccess());
+  EXPECT_EQ(outcome.source, 2);
+  EXPECT_EQ(hedger.GetStats().hedge_wins, 1u);
+}
+
+/**
+ * Duplicate calls stay within the budget.
+ */
+TEST_F(RequestHedgerSuite, BudgetLimitsHedges)
+{
+  configuration_.delay_ms = 2;
+  configuration_.budget_percent = 5.0;
+  RequestHedger hedger(configuration_);
+  for (int index = 0; index < 100; index++) {
+    hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(5)),
+                             MakeCall(2, std::chrono::milliseconds(1)));
+  }
+  auto stats = hedger.GetStats();
+  EXPECT_EQ(stats.calls, 100u);
+  // one hedge saved up at start, then one per 20 calls
+  EXPECT_GE(stats.hedges, 5u);
+  EXPECT_LE(stats.hedges, 6u);
+  EXPECT_GE(stats.budget_denials, 90u);
+}
+
+/**
+ * Slow calls made at once are all hedged within the budget, their duplicates queueing for the
+ * hedge threads.
+ */
+TEST_F(RequestHedgerSuite, ConcurrentCallsShareHedgeThreads)
+{
+  configuration_.budget_percent = 100.0;
+  RequestHedger hedger(configuration_);
+  std::vector<std::thread> threads;
+  std::atomic<int> hedge_outcomes(0);
+  for (int index = 0; index < 8; index++) {
+    threads.emplace_back([&] {
+      auto outcome = hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(5000)),
+                                              MakeCall(2, std::chrono::milliseconds(5)));
+      if (2 == outcome.source) {
+        hedge_outcomes++;
+      }
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(hedge_outcomes, 8);
+  auto stats = hedger.GetStats();
+  EXPECT_EQ(stats.hedges, 8u);
+  EXPECT_EQ(stats.hedge_wins, 8u);
+}
+
+/**
+ * Without a fixed delay, calls are hedged after the rolling percentile of recent latencies.
+ */
+TEST_F(RequestHedgerSuite, PercentileDelay)
+{
+  configuration_.delay_ms = 0;
+  configuration_.min_delay_ms = 5;
+  RequestHedger hedger(configuration_);
+  for (int index = 0; index < 20; index++) {
+    hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(10)),
+                             MakeCall(2, std::chrono::milliseconds(1)));
+  }
+  // too few calls were timed for the first ones to be hedged
+  EXPECT_EQ(hedger.GetStats().hedges, 0u);
+  EXPECT_EQ(hedger.GetStats().delay_ms, 0.0);
+  auto outcome = hedger.Call<TestOutcome>(MakeCall(1, std::chrono::milliseconds(2000)),
+                                          MakeCall(2, std::chrono::milliseconds(1)));
+  EXPECT_EQ(outcome.source, 2);
+  auto stats = hedger.GetStats();
+  EXPECT_GE(stats.delay_ms, 10.0);
+  EXPECT_LT(stats.delay_ms, 1000.0);
+}
+
+/**
+ * Only texts lex answered with a configured intent are hedged, and not while they may answer a
+ * prompt of an open dialog.
+ */
+TEST_F(RequestHedgerSuite, HedgeableTexts)
+{
+  configuration_.intents = {"GetWeather"};
+  RequestHedger hedger(configuration_);
+  EXPECT_FALSE(hedger.IsHedgeable("weather", false));
+  hedger.RecordIntent("weather", "GetWeather", false);
+  hedger.RecordIntent("book a hotel", "BookHotel", false);
+  EXPECT_TRUE(hedger.IsHedgeable("weather", false));
+  EXPECT_FALSE(hedger.IsHedgeable("weather", true));
+  EXPECT_FALSE(hedger.IsHedgeable("book a hotel", false));
+
+  // a text answered with another intent, or opening a dialog, is forgotten
+  hedger.RecordIntent("weather", "BookHotel", false);
+  EXPECT_FALSE(hedger.IsHedgeable("weather", false));
+  hedger.RecordIntent("weather", "GetWeather", false);
+  hedger.RecordIntent("weather", "GetWeather", true);
+  EXPECT_FALSE(hedger.IsHedgeable("weather", false));
+
+  // the least recently used texts are forgotten first
+  for (int text = 0; text < 2000; text++) {
+    hedger.RecordIntent(std::to_string(text), "GetWeather", false);
+    if (0 == text % 100) {
+      EXPECT_TRUE(hedger.IsHedgeable("0", false));
+    }
+  }
+  EXPECT_TRUE(hedger.IsHedgeable("0", false));
+  EXPECT_FALSE(hedger.IsHedgeable("1", false));
+  EXPECT_TRUE(hedger.IsHedgeable("1999", false));
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
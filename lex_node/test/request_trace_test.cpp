@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/request_trace.h>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace Aws::Lex;
+
+namespace {
+
+RequestTrace MakeTrace(const std::string & payload)
+{
+  RequestTrace trace;
+  trace.bot_name = "OrderFlowers";
+  trace.bot_alias = "prod";
+  trace.user_id = "robot";
+  trace.content_type = "audio/l16; rate=16000; channels=1";
+  trace.accept_type = "text/plain; charset=utf-8";
+  trace.payload = reinterpret_cast<const uint8_t *>(payload.data());
+  trace.payload_size = payload.size();
+  trace.body_size = 3;
+  return trace;
+}
+
+}  // namespace
+
+class PayloadSamplerSuite : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char directory[] = "/tmp/request_trace_testXXXXXX";
+    ASSERT_TRUE(nullptr != mkdtemp(directory));
+    directory_ = directory;
+    configuration_.sample_payloads = true;
+    configuration_.payload_file = directory_ + "/lex_payloads";
+  }
+
+  void TearDown() override
+  {
+    std::remove(configuration_.payload_file.c_str());
+    rmdir(directory_.c_str());
+  }
+
+  std::string ReadFile() const
+  {
+    std::ifstream file(configuration_.payload_file, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  std::string directory_;
+  TraceConfiguration configuration_;
+};
+
+/**
+ * The trace is a single line of the request fields, the payload is only hashed.
+ */
+TEST(RequestTraceTest, Format)
+{
+  EXPECT_EQ(0x811c9dc5u, HashPayload(nullptr, 0));
+  EXPECT_EQ(0xe40c292cu, HashPayload(reinterpret_cast<const uint8_t *>("a"), 1));
+
+  std::ostringstream os;
+  os << MakeTrace("a");
+  EXPECT_EQ("bot=OrderFlowers alias=prod user=robot content_type=\"audio/l16; rate=16000; "
+            "channels=1\" accept=\"text/plain; charset=utf-8\" payload_bytes=1 body_bytes=3 "
+            "hash=e40c292c",
+            os.str());
+}
+
+/**
+ * Records are the time and the trace on a line, then the payload bytes, in a file only the user
+ * reads.
+ */
+TEST_F(PayloadSamplerSuite, AppendsRecords)
+{
+  std::string payload("\0\x01pcm\n", 6);
+  {
+    PayloadSampler sampler(configuration_);
+    EXPECT_TRUE(sampler.Sample(MakeTrace(payload)));
+  }
+  auto contents = ReadFile();
+  auto header_end = contents.find('\n');
+  ASSERT_NE(std::string::npos, header_end);
+  std::ostringstream trace;
+  trace << MakeTrace(payload);
+  EXPECT_NE(std::string::npos, contents.find(" " + trace.str() + "\n"));
+  EXPECT_EQ(payload + "\n", contents.substr(header_end + 1));
+  // the payloads are what the user said, only the user reads them
+  struct stat file_stat;
+  ASSERT_EQ(0, stat(configuration_.payload_file.c_str(), &file_stat));
+  EXPECT_EQ(0600u, file_stat.st_mode & 0777u);
+
+  // a restarted node appends to the file
+  PayloadSampler sampler(configuration_);
+  EXPECT_EQ(contents.size(), sampler.GetStats().file_bytes);
+  EXPECT_TRUE(sampler.Sample(MakeTrace(payload)));
+  EXPECT_EQ(2 * contents.size(), ReadFile().size());
+}
+
+/**
+ * Samples are limited to the configured rate.
+ */
+TEST_F(PayloadSamplerSuite, RateLimit)
+{
+  configuration_.samples_per_minute = 1;
+  PayloadSampler slow_sampler(configuration_);
+  EXPECT_TRUE(slow_sampler.Sample(MakeTrace("first")));
+  EXPECT_FALSE(slow_sampler.Sample(MakeTrace("second")));
+  auto stats = slow_sampler.GetStats();
+  EXPECT_EQ(1u, stats.samples);
+  EXPECT_EQ(1u, stats.skipped);
+
+  configuration_.samples_per_minute = 60 * 1000;
+  PayloadSampler fast_sampler(configuration_);
+  EXPECT_TRUE(fast_sampler.Sample(MakeTrace("first")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_TRUE(fast_sampler.Sample(MakeTrace("second")));
+}
+
+/**
+ * Sampling stops when the file would grow past its cap.
+ */
+TEST_F(PayloadSamplerSuite, FileCap)
+{
+  configuration_.samples_per_minute = 60 * 1000;
+  configuration_.max_file_bytes = 1024;
+  PayloadSampler sampler(configuration_);
+  EXPECT_FALSE(sampler.Sample(MakeTrace(std::string(1024, 'x'))));
+  EXPECT_TRUE(sampler.Sample(MakeTrace(std::string(512, 'x'))));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(sampler.Sample(MakeTrace(std::string(512, 'x'))));
+  auto stats = sampler.GetStats();
+  EXPECT_EQ(1u, stats.samples);
+  EXPECT_EQ(2u, stats.skipped);
+  EXPECT_EQ(stats.file_bytes, ReadFile().size());
+  EXPECT_LE(stats.file_bytes, 1024u);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/response_audio_stream.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace Aws::Lex;
+
+/**
+ * Size of the chunks curl hands to the http client by default.
+ */
+constexpr std::size_t kWriteChunkSize = 16 * 1024;
+
+static std::vector<uint8_t> MakeAudio(std::size_t size)
+{
+  std::vector<uint8_t> audio(size);
+  for (std::size_t i = 0; i < size; i++) {
+    audio[i] = static_cast<uint8_t>(i * 31 + 7);
+  }
+  return audio;
+}
+
+template <typename Stream>
+static void WriteInChunks(Stream & stream, const std::vector<uint8_t> & audio)
+{
+  for (std::size_t offset = 0; offset < audio.size(); offset += kWriteChunkSize) {
+    std::size_t length = std::min(kWriteChunkSize, audio.size() - offset);
+    stream.write(reinterpret_cast<const char *>(audio.data() + offset), length);
+  }
+}
+
+/**
+ * The received bytes are moved out unchanged.
+ */
+TEST(ResponseAudioStreamSuite, MoveReceivedAudio)
+{
+  auto audio = MakeAudio(100000);
+  ResponseAudioStream stream;
+  WriteInChunks(stream, audio);
+  stream.put('x');
+  audio.push_back('x');
+  EXPECT_EQ(stream.GetBuffer().Size(), audio.size());
+
+  std::vector<uint8_t> response_audio = {1, 2, 3};
+  stream.GetBuffer().MoveTo(response_audio);
+  EXPECT_EQ(response_audio, audio);
+  EXPECT_EQ(stream.GetBuffer().Size(), 0u);
+}
+
+/**
+ * The body can be read back and seeked, the sdk does so to parse error responses.
+ */
+TEST(ResponseAudioStreamSuite, ReadBack)
+{
+  ResponseAudioStream stream;
+  stream << "{\"message\": ";
+  EXPECT_EQ(stream.get(), '{');
+  stream << "\"throttled\"}";
+
+  std::string rest;
+  std::getline(stream, rest);
+  EXPECT_EQ(rest, "\"message\": \"throttled\"}");
+
+  stream.clear();
+  stream.seekg(0, std::ios_base::end);
+  EXPECT_EQ(static_cast<std::streamoff>(stream.tellg()), 24);
+  stream.seekg(1, std::ios_base::beg);
+  EXPECT_EQ(stream.get(), '"');
+  EXPECT_EQ(static_cast<std::streamoff>(stream.tellp()), 24);
+}
+
+/**
+ * Reserving the content length up front means the body is copied exactly once.
+ */
+TEST(ResponseAudioStreamSuite, ReserveAvoidsGrowth)
+{
+  auto audio = MakeAudio(256 * 1024);
+  ResponseAudioStream stream;
+  stream.GetBuffer().Reserve(audio.size());
+  WriteInChunks(stream, audio);
+  EXPECT_EQ(stream.GetBuffer().BytesCopied(), audio.size());
+}
+
+/**
+ * Once discarded the body is counted but not kept.
+ */
+TEST(ResponseAudioStreamSuite, DiscardKnownAudio)
+{
+  auto audio = MakeAudio(100000);
+  ResponseAudioStream stream;
+  stream.write(reinterpret_cast<const char *>(audio.data()), kWriteChunkSize);
+  stream.GetBuffer().Discard();
+  WriteInChunks(stream, audio);
+  EXPECT_EQ(stream.GetBuffer().Size(), 0u);
+  EXPECT_EQ(stream.GetBuffer().BytesDiscarded(), kWriteChunkSize + audio.size());
+  EXPECT_EQ(stream.GetBuffer().BytesCopied(), kWriteChunkSize);
+
+  std::vector<uint8_t> response_audio;
+  stream.GetBuffer().MoveTo(response_audio);
+  EXPECT_TRUE(response_audio.empty());
+}
+
+/**
+ * The body is copied once per response, written by the http client to a buffer reserved from the
+ * content length once the first bytes arrive, then moved into the response message. Only the
+ * first chunk, received before the reservation, is copied again when it grows the buffer.
+ */
+TEST(ResponseAudioStreamSuite, BytesCopiedPerResponse)
+{
+  for (std::size_t size : {16 * 1024, 256 * 1024, 1024 * 1024}) {
+    auto audio = MakeAudio(size);
+    ResponseAudioStream body;
+    body.write(reinterpret_cast<const char *>(audio.data()), std::min(kWriteChunkSize, size));
+    body.GetBuffer().Reserve(size);
+    if (size > kWriteChunkSize) {
+      body.write(reinterpret_cast<const char *>(audio.data() + kWriteChunkSize),
+                 size - kWriteChunkSize);
+    }
+    const std::size_t expected_copied = size > kWriteChunkSize ? size + kWriteChunkSize : size;
+    EXPECT_EQ(body.GetBuffer().BytesCopied(), expected_copied);
+    std::vector<uint8_t> response_audio;
+    body.GetBuffer().MoveTo(response_audio);
+    EXPECT_EQ(response_audio, audio);
+    EXPECT_EQ(body.GetBuffer().BytesCopied(), expected_copied);
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
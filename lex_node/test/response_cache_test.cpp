@@ -0,0 +1,158 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/response_cache.h>
+
+#include <string>
+
+using namespace Aws::Lex;
+
+static ResponseCacheConfiguration MakeConfiguration()
+{
+  ResponseCacheConfiguration configuration;
+  configuration.enabled = true;
+  configuration.max_entries = 2;
+  configuration.ttl_s = 10.0;
+  configuration.intents = {"Stop", "GoToDock"};
+  return configuration;
+}
+
+static CachedResponse MakeResponse(const std::string & intent_name,
+                                   const std::string & dialog_state = "Fulfilled")
+{
+  CachedResponse response;
+  response.text_response = "ok";
+  response.message_format_type = "PlainText";
+  response.intent_name = intent_name;
+  response.dialog_state = dialog_state;
+  response.slots = {{"dock", "one"}};
+  return response;
+}
+
+static std::string Key(const std::string & text)
+{
+  return MakeResponseCacheKey("bot", "alias", text, "text/plain; charset=utf-8");
+}
+
+/**
+ * Spelling variants of a command share a key, other bots and reply formats do not.
+ */
+TEST(ResponseCacheSuite, Keys)
+{
+  EXPECT_EQ(NormalizeCacheText("  Go  to\tDock! "), "go to dock");
+  EXPECT_EQ(NormalizeCacheText("\"Stop.\""), "stop");
+  EXPECT_EQ(NormalizeCacheText("..."), "");
+  EXPECT_EQ(NormalizeCacheText("Café"), "café");
+  EXPECT_EQ(Key("Stop!"), Key("stop"));
+  EXPECT_NE(Key("stop"), MakeResponseCacheKey("bot", "alias", "stop", "audio/pcm"));
+  EXPECT_NE(Key("stop"), MakeResponseCacheKey("bot", "prod", "stop", "text/plain; charset=utf-8"));
+}
+
+/**
+ * Only fulfilled replies of opted in intents without session attributes are stored.
+ */
+TEST(ResponseCacheSuite, InsertConditions)
+{
+  ResponseCache cache(MakeConfiguration());
+  EXPECT_FALSE(cache.Insert(Key("hello"), MakeResponse("Greet"), false));
+  EXPECT_FALSE(cache.Insert(Key("stop"), MakeResponse("Stop", "ElicitSlot"), false));
+  EXPECT_FALSE(cache.Insert(Key("stop"), MakeResponse("Stop"), true));
+  EXPECT_TRUE(cache.Insert(Key("stop"), MakeResponse("Stop", "ReadyForFulfillment"), false));
+  EXPECT_TRUE(cache.Insert(Key("go to dock"), MakeResponse("GoToDock"), false));
+
+  auto hit = cache.Lookup(Key("Stop."), false);
+  ASSERT_TRUE(hit != nullptr);
+  EXPECT_EQ(hit->intent_name, "Stop");
+  EXPECT_EQ(hit->slots.size(), 1u);
+  EXPECT_TRUE(cache.Lookup(Key("hello"), false) == nullptr);
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.insertions, 2u);
+  EXPECT_EQ(stats.entries, 2u);
+}
+
+/**
+ * The least recently used reply makes room for new ones, replies expire after the time to live.
+ */
+TEST(ResponseCacheSuite, EvictionAndExpiry)
+{
+  ResponseCache cache(MakeConfiguration());
+  auto start = ResponseCache::Clock::now();
+  cache.Insert(Key("stop"), MakeResponse("Stop"), false, start);
+  cache.Insert(Key("go to dock"), MakeResponse("GoToDock"), false, start);
+  // stop becomes the most recently used
+  EXPECT_TRUE(cache.Lookup(Key("stop"), false, start) != nullptr);
+  cache.Insert(Key("halt"), MakeResponse("Stop"), false, start);
+  EXPECT_TRUE(cache.Lookup(Key("go to dock"), false, start) == nullptr);
+  EXPECT_TRUE(cache.Lookup(Key("halt"), false, start) != nullptr);
+  EXPECT_EQ(cache.GetStats().evictions, 1u);
+
+  auto later = start + std::chrono::seconds(11);
+  EXPECT_TRUE(cache.Lookup(Key("stop"), false, later) == nullptr);
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.expirations, 1u);
+  EXPECT_EQ(stats.entries, 1u);
+
+  // byte limit
+  auto configuration = MakeConfiguration();
+  configuration.max_bytes = 1000;
+  ResponseCache small_cache(configuration);
+  auto response = MakeResponse("Stop");
+  response.audio_response.assign(2000, 0);
+  EXPECT_FALSE(small_cache.Insert(Key("stop"), response, false));
+}
+
+/**
+ * Sessions waiting for a slot value or a confirmation are not answered from the cache.
+ */
+TEST(ResponseCacheSuite, OpenSessions)
+{
+  ResponseCache cache(MakeConfiguration());
+  cache.Insert(Key("stop"), MakeResponse("Stop"), false);
+  EXPECT_TRUE(cache.Lookup(Key("stop"), true) == nullptr);
+  EXPECT_TRUE(cache.Lookup(Key("stop"), false) != nullptr);
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 1u);
+}
+
+/**
+ * A cache holding as many replies as it is configured for answers each of them.
+ */
+TEST(ResponseCacheSuite, FullCache)
+{
+  auto configuration = MakeConfiguration();
+  configuration.max_entries = 1024;
+  ResponseCache cache(configuration);
+  for (int index = 0; index < 1024; index++) {
+    cache.Insert(Key("stop " + std::to_string(index)), MakeResponse("Stop"), false);
+  }
+  for (int index = 0; index < 1024; index++) {
+    EXPECT_TRUE(cache.Lookup(Key("stop " + std::to_string(index)), false) != nullptr);
+  }
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.entries, 1024u);
+  EXPECT_EQ(stats.hits, 1024u);
+  EXPECT_EQ(stats.evictions, 0u);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/session_serializer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Aws::Lex;
+
+/**
+ * Turns of one session run in the order they entered, even when they wait concurrently.
+ */
+TEST(SessionSerializerSuite, SameSessionIsOrdered)
+{
+  SessionSerializer serializer;
+  const auto key = MakeSessionKey("bot", "alias", "user");
+  std::vector<int> order;
+  std::mutex order_mutex;
+
+  std::vector<std::thread> threads;
+  {
+    auto first_turn = serializer.Enter(key);
+    for (int i = 0; i < 4; i++) {
+      threads.emplace_back([&, i] {
+        auto turn = serializer.Enter(key);
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(i);
+      });
+      // the next thread starts once this one took its ticket
+      SessionInfo info;
+      while (serializer.GetSession(key, info) && info.turns_in_flight < 2u + i) {
+        std::this_thread::yield();
+      }
+    }
+    EXPECT_TRUE(order.empty());
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3}));
+  EXPECT_EQ(serializer.ActiveSessions(), 0u);
+}
+
+/**
+ * A running turn does not block turns of other sessions.
+ */
+TEST(SessionSerializerSuite, DifferentSessionsRunInParallel)
+{
+  SessionSerializer serializer;
+  auto turn = serializer.Enter(MakeSessionKey("bot", "alias", "user_a"));
+  std::atomic<bool> entered(false);
+  std::thread other([&] {
+    auto other_turn = serializer.Enter(MakeSessionKey("bot", "alias", "user_b"));
+    entered = true;
+  });
+  other.join();
+  EXPECT_TRUE(entered);
+  EXPECT_EQ(serializer.ActiveSessions(), 1u);
+}
+
+/**
+ * Session keys differ when any of their parts differ.
+ */
+TEST(SessionSerializerSuite, SessionKeyParts)
+{
+  EXPECT_NE(MakeSessionKey("bot", "alias", "user"), MakeSessionKey("bot2", "alias", "user"));
+  EXPECT_NE(MakeSessionKey("bot", "alias", "user"), MakeSessionKey("bot", "alias2", "user"));
+  EXPECT_NE(MakeSessionKey("bot", "alias", "user"), MakeSessionKey("bot", "alias", "user2"));
+}
+
+/**
+ * Idle sessions stay in the table with their last dialog state until it is full, then the least
+ * recently used idle session is evicted. Sessions with a turn in flight are never evicted.
+ */
+TEST(SessionSerializerSuite, BoundedTable)
+{
+  SessionSerializer serializer(2, 1);
+  const auto key_a = MakeSessionKey("bot", "alias", "user_a");
+  const auto key_b = MakeSessionKey("bot", "alias", "user_b");
+  const auto key_c = MakeSessionKey("bot", "alias", "user_c");
+  {
+    auto turn = serializer.Enter(key_a);
+    turn.SetDialogState("ElicitSlot");
+    SessionInfo info;
+    ASSERT_TRUE(serializer.GetSession(key_a, info));
+    EXPECT_EQ(info.turns_in_flight, 1u);
+    EXPECT_EQ(info.turns, 0u);
+  }
+  serializer.Enter(key_b);
+  SessionInfo info;
+  ASSERT_TRUE(serializer.GetSession(key_a, info));
+  EXPECT_EQ(info.turns_in_flight, 0u);
+  EXPECT_EQ(info.turns, 1u);
+  EXPECT_EQ(info.dialog_state, "ElicitSlot");
+  EXPECT_GE(info.last_used, info.created);
+  EXPECT_EQ(serializer.Sessions(), 2u);
+  EXPECT_EQ(serializer.ActiveSessions(), 0u);
+
+  // a is used again, b is now the least recently used
+  serializer.Enter(key_a);
+  serializer.Enter(key_c);
+  EXPECT_EQ(serializer.Sessions(), 2u);
+  EXPECT_EQ(serializer.Evictions(), 1u);
+  EXPECT_FALSE(serializer.GetSession(key_b, info));
+  EXPECT_TRUE(serializer.GetSession(key_a, info));
+
+  // sessions in flight overflow the table until they finish
+  {
+    auto turn_a = serializer.Enter(key_a);
+    auto turn_b = serializer.Enter(key_b);
+    auto turn_c = serializer.Enter(key_c);
+    EXPECT_EQ(serializer.Sessions(), 3u);
+    EXPECT_EQ(serializer.ActiveSessions(), 3u);
+  }
+  EXPECT_EQ(serializer.Sessions(), 2u);
+  EXPECT_EQ(serializer.ActiveSessions(), 0u);
+}
+
+/**
+ * The next turn of a session sees the dialog state of the previous one, which is forgotten with
+ * the session when it is evicted.
+ */
+TEST(SessionSerializerSuite, DialogState)
+{
+  SessionSerializer serializer(1, 1);
+  const auto key_a = MakeSessionKey("bot", "alias", "user_a");
+  const auto key_b = MakeSessionKey("bot", "alias", "user_b");
+  {
+    auto turn = serializer.Enter(key_a);
+    EXPECT_EQ(turn.GetDialogState(), "");
+    turn.SetDialogState("ConfirmIntent");
+  }
+  {
+    auto turn = serializer.Enter(key_a);
+    EXPECT_EQ(turn.GetDialogState(), "ConfirmIntent");
+    EXPECT_TRUE(IsDialogOpen(turn.GetDialogState()));
+    turn.SetDialogState("ElicitSlot");
+  }
+  serializer.Enter(key_b);
+  EXPECT_EQ(serializer.Evictions(), 1u);
+  auto turn = serializer.Enter(key_a);
+  EXPECT_FALSE(IsDialogOpen(turn.GetDialogState()));
+  EXPECT_FALSE(IsDialogOpen("Fulfilled"));
+}
+
+/**
+ * Counts down once per thread, releasing the threads waiting for it at zero.
+ */
+class Latch
+{
+public:
+  explicit Latch(int count) : count_(count) {}
+
+  /**
+   * Count down and wait for the other threads.
+   *
+   * @return false if they did not all arrive in time
+   */
+  bool ArriveAndWait(std::chrono::seconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (--count_ == 0) {
+      all_arrived_.notify_all();
+    }
+    return all_arrived_.wait_for(lock, timeout, [this] { return count_ <= 0; });
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable all_arrived_;
+  int count_;
+};
+
+/**
+ * Raise a maximum to a value.
+ */
+static void RaiseMax(std::atomic<int> & max, int value)
+{
+  int current = max.load();
+  while (current < value && !max.compare_exchange_weak(current, value)) {
+  }
+}
+
+/**
+ * Dispatch threads hold turns of different sessions at the same time, but never two turns of the
+ * same session.
+ */
+TEST(SessionSerializerSuite, HoldersOverlapAcrossSessionsOnly)
+{
+  constexpr int kThreads = 8;
+  constexpr int kSessions = 4;
+  constexpr int kTurns = 200;
+  SessionSerializer serializer;
+  std::atomic<int> holders(0);
+  std::atomic<int> max_holders(0);
+  std::vector<std::atomic<int>> session_holders(kSessions);
+  std::vector<std::atomic<int>> max_session_holders(kSessions);
+  for (int session = 0; session < kSessions; session++) {
+    session_holders[session] = 0;
+    max_session_holders[session] = 0;
+  }
+  auto hold = [&](int session) {
+    RaiseMax(max_holders, ++holders);
+    RaiseMax(max_session_holders[session], ++session_holders[session]);
+    std::this_thread::yield();
+    session_holders[session]--;
+    holders--;
+  };
+
+  // one thread per session holds its first turn until all of them do
+  Latch all_holding(kSessions);
+  std::atomic<int> timeouts(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      const int session = t % kSessions;
+      const auto key = MakeSessionKey("bot", "alias", std::to_string(session));
+      if (t < kSessions) {
+        auto turn = serializer.Enter(key);
+        RaiseMax(max_holders, ++holders);
+        if (!all_holding.ArriveAndWait(std::chrono::seconds(10))) {
+          timeouts++;
+        }
+        holders--;
+      }
+      for (int i = 0; i < kTurns; i++) {
+        auto turn = serializer.Enter(key);
+        hold(session);
+      }
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(timeouts, 0);
+  EXPECT_EQ(max_holders, kSessions);
+  for (int session = 0; session < kSessions; session++) {
+    EXPECT_EQ(max_session_holders[session], 1);
+  }
+  EXPECT_EQ(serializer.ActiveSessions(), 0u);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/slot_decoder.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace Aws::Lex;
+
+namespace {
+
+struct TestKeyValue
+{
+  std::string key;
+  std::string value;
+};
+
+std::string EncodeBase64(const std::string & data, bool is_padded = true)
+{
+  const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string encoded;
+  for (std::size_t index = 0; index < data.size(); index += 3) {
+    uint32_t bits = static_cast<unsigned char>(data[index]) << 16;
+    std::size_t bytes = std::min<std::size_t>(3, data.size() - index);
+    if (bytes > 1) {
+      bits |= static_cast<unsigned char>(data[index + 1]) << 8;
+    }
+    if (bytes > 2) {
+      bits |= static_cast<unsigned char>(data[index + 2]);
+    }
+    for (std::size_t digit = 0; digit < 4; digit++) {
+      if (digit <= bytes) {
+        encoded += alphabet[bits >> (18 - 6 * digit) & 0x3F];
+      } else if (is_padded) {
+        encoded += '=';
+      }
+    }
+  }
+  return encoded;
+}
+
+bool Decode(const std::string & json, std::vector<TestKeyValue> & slots, bool is_padded = true)
+{
+  auto encoded = EncodeBase64(json, is_padded);
+  return DecodeSlots(encoded.data(), encoded.size(), slots);
+}
+
+}  // namespace
+
+TEST(SlotDecoderTest, StringSlots)
+{
+  std::vector<TestKeyValue> slots;
+  ASSERT_TRUE(Decode("{\"FlowerType\": \"roses\", \"PickupCity\":\"Seattle, WA\"}", slots));
+  ASSERT_EQ(2u, slots.size());
+  EXPECT_EQ("FlowerType", slots[0].key);
+  EXPECT_EQ("roses", slots[0].value);
+  EXPECT_EQ("PickupCity", slots[1].key);
+  EXPECT_EQ("Seattle, WA", slots[1].value);
+
+  // unpadded, with the NUL a c string header ends with
+  ASSERT_TRUE(Decode(std::string(" {\"a\" : \"b\"}\n", 14) + '\0', slots, false));
+  ASSERT_EQ(1u, slots.size());
+  EXPECT_EQ("b", slots[0].value);
+
+  ASSERT_TRUE(Decode("{}", slots));
+  EXPECT_TRUE(slots.empty());
+  EXPECT_TRUE(DecodeSlots("", 0, slots));
+  EXPECT_TRUE(slots.empty());
+}
+
+/**
+ * Escapes are unescaped, \u escapes to utf-8, lone surrogates to the replacement character.
+ */
+TEST(SlotDecoderTest, Escapes)
+{
+  std::vector<TestKeyValue> slots;
+  ASSERT_TRUE(Decode("{\"say \\\"hi\\\"\": "
+                     "\"a\\\\b\\/c\\n\\t\\u00e9\\u20ac\\ud83d\\ude00\\udc00\"}",
+                     slots));
+  ASSERT_EQ(1u, slots.size());
+  EXPECT_EQ("say \"hi\"", slots[0].key);
+  EXPECT_EQ("a\\b/c\n\t\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\xEF\xBF\xBD", slots[0].value);
+}
+
+/**
+ * Unfilled slots are empty, other values keep their json text.
+ */
+TEST(SlotDecoderTest, NonStringValues)
+{
+  std::vector<TestKeyValue> slots;
+  ASSERT_TRUE(Decode(
+    "{\"date\": null, \"count\": -2.5e3, \"ok\": true, \"no\": false, "
+    "\"list\": [1, \"]\", {\"x\": null}], \"nested\": {\"a\": \"}\"}}",
+    slots));
+  ASSERT_EQ(6u, slots.size());
+  EXPECT_EQ("", slots[0].value);
+  EXPECT_EQ("-2.5e3", slots[1].value);
+  EXPECT_EQ("true", slots[2].value);
+  EXPECT_EQ("false", slots[3].value);
+  EXPECT_EQ("[1, \"]\", {\"x\": null}]", slots[4].value);
+  EXPECT_EQ("{\"a\": \"}\"}", slots[5].value);
+}
+
+/**
+ * Invalid input leaves the slots unchanged.
+ */
+TEST(SlotDecoderTest, Invalid)
+{
+  std::vector<TestKeyValue> slots = {{"kept", "value"}};
+  for (const char * json :
+       {" ", "[]", "{", "{\"a\"}", "{\"a\": }", "{\"a\": \"b\",}", "{\"a\": \"b\"} x",
+        "{\"a\": \"b\\q\"}", "{\"a\": \"\\u12\"}", "{\"a\": nope}", "{\"a\": [1, 2}",
+        "{\"a\": \"b\" \"c\": \"d\"}"}) {
+    EXPECT_FALSE(Decode(json, slots)) << json;
+  }
+  EXPECT_FALSE(DecodeSlots("e30*", 4, slots));
+  EXPECT_FALSE(DecodeSlots("e", 1, slots));
+  ASSERT_EQ(1u, slots.size());
+  EXPECT_EQ("kept", slots[0].key);
+}
+
+/**
+ * The key value strings are reused across decodes.
+ */
+TEST(SlotDecoderTest, ReusesSlots)
+{
+  std::vector<TestKeyValue> slots;
+  ASSERT_TRUE(Decode("{\"a\": \"a long value that is not stored inline\"}", slots));
+  const char * value = slots[0].value.data();
+  ASSERT_TRUE(Decode("{\"b\": \"a shorter value that fits\"}", slots));
+  EXPECT_EQ(value, slots[0].value.data());
+  EXPECT_EQ("a shorter value that fits", slots[0].value);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/tagged_memory_system.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Aws::Lex;
+
+constexpr char kLexTag[] = "lex";
+constexpr char kHttpTag[] = "http";
+// the same tag at another address, as another translation unit would have it
+constexpr char kOtherLexTag[] = "lex";
+
+/**
+ * Live and peak bytes and allocation counts are kept per tag.
+ */
+TEST(TaggedMemorySystemSuite, CountsPerTag)
+{
+  TaggedMemorySystem memory_system;
+  void * first = memory_system.AllocateMemory(100, 16, kLexTag);
+  void * second = memory_system.AllocateMemory(5000, 16, kLexTag);
+  void * third = memory_system.AllocateMemory(40, 16, kHttpTag);
+  void * untagged = memory_system.AllocateMemory(10, 16);
+  std::memset(second, 1, 5000);
+  memory_system.FreeMemory(second);
+
+  auto tag_stats = memory_system.GetTagStats();
+  ASSERT_EQ(tag_stats.size(), 3u);
+  EXPECT_EQ(tag_stats[0].tag, "lex");
+  EXPECT_EQ(tag_stats[0].live_bytes, 100);
+  EXPECT_EQ(tag_stats[0].peak_bytes, 5100);
+  EXPECT_EQ(tag_stats[0].allocations, 2u);
+  EXPECT_EQ(tag_stats[1].tag, "http");
+  EXPECT_EQ(tag_stats[1].live_bytes, 40);
+  EXPECT_EQ(tag_stats[2].tag, "untagged");
+  EXPECT_EQ(tag_stats[2].live_bytes, 10);
+
+  memory_system.FreeMemory(first);
+  memory_system.FreeMemory(third);
+  memory_system.FreeMemory(untagged);
+  memory_system.FreeMemory(nullptr);
+  auto total = memory_system.GetTotalStats();
+  EXPECT_EQ(total.live_bytes, 0);
+  EXPECT_EQ(total.allocations, 4u);
+}
+
+/**
+ * Peaks are not summed: the total peak is the highest total live bytes, and the addresses of the
+ * same tag share its counters.
+ */
+TEST(TaggedMemorySystemSuite, Peaks)
+{
+  TaggedMemorySystem memory_system;
+  ASSERT_NE(static_cast<const void *>(kLexTag), static_cast<const void *>(kOtherLexTag));
+  memory_system.FreeMemory(memory_system.AllocateMemory(1000, 16, kLexTag));
+  memory_system.FreeMemory(memory_system.AllocateMemory(1000, 16, kOtherLexTag));
+  void * lex = memory_system.AllocateMemory(600, 16, kLexTag);
+  void * other_lex = memory_system.AllocateMemory(600, 16, kOtherLexTag);
+  memory_system.FreeMemory(lex);
+  memory_system.FreeMemory(other_lex);
+  memory_system.FreeMemory(memory_system.AllocateMemory(1000, 16, kHttpTag));
+
+  auto tag_stats = memory_system.GetTagStats();
+  ASSERT_EQ(tag_stats.size(), 2u);
+  for (auto & stats : tag_stats) {
+    EXPECT_EQ(stats.live_bytes, 0);
+  }
+  auto lex_stats = "lex" == tag_stats[0].tag ? tag_stats[0] : tag_stats[1];
+  EXPECT_EQ(lex_stats.tag, "lex");
+  EXPECT_EQ(lex_stats.peak_bytes, 1200);
+  EXPECT_EQ(lex_stats.allocations, 4u);
+  auto total = memory_system.GetTotalStats();
+  EXPECT_EQ(total.peak_bytes, 1200);
+  EXPECT_EQ(total.live_bytes, 0);
+  EXPECT_EQ(total.allocations, 5u);
+}
+
+/**
+ * The tag names are copied, a tag that is not a string literal may be freed after allocating.
+ */
+TEST(TaggedMemorySystemSuite, CopiesTagNames)
+{
+  TaggedMemorySystem memory_system;
+  {
+    std::string tag = "built at runtime";
+    memory_system.FreeMemory(memory_system.AllocateMemory(100, 16, tag.c_str()));
+    std::string long_tag(100, 't');
+    memory_system.FreeMemory(memory_system.AllocateMemory(100, 16, long_tag.c_str()));
+  }
+  auto tag_stats = memory_system.GetTagStats();
+  ASSERT_EQ(tag_stats.size(), 2u);
+  std::vector<std::string> tags = {tag_stats[0].tag, tag_stats[1].tag};
+  std::sort(tags.begin(), tags.end());
+  EXPECT_EQ(tags[0], "built at runtime");
+  // long names are truncated
+  EXPECT_EQ(tags[1], std::string(63, 't'));
+}
+
+/**
+ * Freed small blocks are handed out again by the same thread, large and over aligned ones are not
+ * cached but keep their alignment.
+ */
+TEST(TaggedMemorySystemSuite, ThreadCacheAndAlignment)
+{
+  TaggedMemorySystem memory_system(4);
+  void * small = memory_system.AllocateMemory(200, 16, kLexTag);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(small) % 16, 0u);
+  memory_system.FreeMemory(small);
+  EXPECT_EQ(memory_system.AllocateMemory(150, 16, kLexTag), small);
+  memory_system.FreeMemory(small);
+
+  void * aligned = memory_system.AllocateMemory(100, 256, kLexTag);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 256, 0u);
+  std::memset(aligned, 1, 100);
+  memory_system.FreeMemory(aligned);
+
+  void * large = memory_system.AllocateMemory(64 * 1024, 16, kLexTag);
+  std::memset(large, 1, 64 * 1024);
+  memory_system.FreeMemory(large);
+  EXPECT_EQ(memory_system.GetTotalStats().live_bytes, 0);
+}
+
+/**
+ * Counters stay exact with threads allocating concurrently, and blocks may be freed by another
+ * thread than the one that allocated them.
+ */
+TEST(TaggedMemorySystemSuite, ConcurrentThreads)
+{
+  TaggedMemorySystem memory_system;
+  constexpr int kThreads = 4;
+  constexpr int kAllocations = 10000;
+  std::vector<void *> kept[kThreads];
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kThreads; thread++) {
+    threads.emplace_back([&memory_system, &kept, thread]() {
+      for (int allocation = 0; allocation < kAllocations; allocation++) {
+        void * memory = memory_system.AllocateMemory(16 + allocation % 1500, 16, kLexTag);
+        if (allocation % 10) {
+          memory_system.FreeMemory(memory);
+        } else {
+          kept[thread].push_back(memory);
+        }
+      }
+    });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  auto total = memory_system.GetTotalStats();
+  EXPECT_EQ(total.allocations, static_cast<uint64_t>(kThreads * kAllocations));
+  EXPECT_GT(total.live_bytes, 0);
+  for (auto & memory : kept) {
+    for (void * block : memory) {
+      memory_system.FreeMemory(block);
+    }
+  }
+  EXPECT_EQ(memory_system.GetTotalStats().live_bytes, 0);
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
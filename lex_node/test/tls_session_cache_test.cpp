@@ -0,0 +1,127 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/tls_session_cache.h>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+using namespace Aws::Lex;
+
+class TlsSessionCacheSuite : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char directory[] = "/tmp/tls_session_cache_testXXXXXX";
+    ASSERT_TRUE(nullptr != mkdtemp(directory));
+    directory_ = directory;
+    configuration_.enabled = true;
+    configuration_.file = directory_ + "/ros/lex_tls_sessions";
+  }
+
+  void TearDown() override
+  {
+    std::remove(configuration_.file.c_str());
+    rmdir((directory_ + "/ros").c_str());
+    rmdir(directory_.c_str());
+  }
+
+  std::string directory_;
+  TlsSessionCacheConfiguration configuration_;
+};
+
+/**
+ * Sessions are read back after the node restarts, expired ones are dropped.
+ */
+TEST_F(TlsSessionCacheSuite, PersistAcrossRestart)
+{
+  {
+    TlsSessionCache cache(configuration_);
+    EXPECT_EQ(cache.Load(1000), 0u);
+    EXPECT_TRUE(cache.Find("runtime.lex.us-east-1.amazonaws.com", 1000).empty());
+    cache.Store("runtime.lex.us-east-1.amazonaws.com", std::string("first\0session", 13), 2000);
+    cache.Store("runtime.lex.us-east-1.amazonaws.com", "second session", 8000);
+    cache.Store("runtime.lex.eu-west-1.amazonaws.com", "other session", 3000);
+    cache.RecordHandshake(false);
+    cache.RecordHandshake(true);
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.sessions_stored, 3u);
+    EXPECT_EQ(stats.full_handshakes, 1u);
+    EXPECT_EQ(stats.resumed_handshakes, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+
+    // storing a session does not touch the file, saving does
+    struct stat file_stat;
+    EXPECT_NE(0, stat(configuration_.file.c_str(), &file_stat));
+    EXPECT_TRUE(cache.Save());
+  }
+  struct stat file_stat;
+  ASSERT_EQ(0, stat(configuration_.file.c_str(), &file_stat));
+  EXPECT_EQ(file_stat.st_mode & 0777, 0600u);
+
+  TlsSessionCache cache(configuration_);
+  EXPECT_EQ(cache.Load(4000), 1u);
+  EXPECT_EQ(cache.Find("runtime.lex.us-east-1.amazonaws.com", 4000), "second session");
+  EXPECT_TRUE(cache.Find("runtime.lex.eu-west-1.amazonaws.com", 4000).empty());
+  EXPECT_TRUE(cache.Find("runtime.lex.us-east-1.amazonaws.com", 9000).empty());
+  EXPECT_EQ(cache.GetStats().sessions_loaded, 1u);
+}
+
+/**
+ * A session file other users may read is not trusted.
+ */
+TEST_F(TlsSessionCacheSuite, IgnoreSharedFile)
+{
+  {
+    TlsSessionCache cache(configuration_);
+    cache.Store("runtime.lex.us-east-1.amazonaws.com", "session", 8000);
+    ASSERT_TRUE(cache.Save());
+  }
+  ASSERT_EQ(0, chmod(configuration_.file.c_str(), 0644));
+  TlsSessionCache cache(configuration_);
+  EXPECT_EQ(cache.Load(1000), 0u);
+  EXPECT_TRUE(cache.Find("runtime.lex.us-east-1.amazonaws.com", 1000).empty());
+}
+
+/**
+ * A truncated session file keeps the records written before the cut.
+ */
+TEST_F(TlsSessionCacheSuite, TruncatedFile)
+{
+  {
+    TlsSessionCache cache(configuration_);
+    cache.Store("a.amazonaws.com", "first session", 8000);
+    cache.Store("b.amazonaws.com", "second session", 8000);
+    ASSERT_TRUE(cache.Save());
+  }
+  struct stat file_stat;
+  ASSERT_EQ(0, stat(configuration_.file.c_str(), &file_stat));
+  ASSERT_EQ(0, truncate(configuration_.file.c_str(), file_stat.st_size - 3));
+  TlsSessionCache cache(configuration_);
+  EXPECT_EQ(cache.Load(1000), 1u);
+  EXPECT_EQ(cache.Find("a.amazonaws.com", 1000), "first session");
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <lex_node/audio_format.h>
+#include <lex_node/audio_pipeline.h>
+#include <lex_node/voice_activity.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Aws::Lex;
+
+/**
+ * Build a clip of low noise with a tone between two instants.
+ *
+ * @param sample_rate in hertz
+ * @param length_ms duration of the clip
+ * @param speech_begin_ms start of the tone
+ * @param speech_end_ms end of the tone
+ */
+static std::vector<int16_t> MakeClip(int sample_rate, int length_ms, int speech_begin_ms,
+                                     int speech_end_ms)
+{
+  std::mt19937 generator(7);
+  std::normal_distribution<double> noise(0.0, 20.0);
+  std::vector<int16_t> clip(sample_rate * length_ms / 1000);
+  for (size_t index = 0; index < clip.size(); index++) {
+    double time_ms = 1000.0 * index / sample_rate;
+    double sample = noise(generator);
+    if (time_ms >= speech_begin_ms && time_ms < speech_end_ms) {
+      sample += 8000.0 * std::sin(2.0 * M_PI * 220.0 * index / sample_rate);
+    }
+    clip[index] = static_cast<int16_t>(sample);
+  }
+  return clip;
+}
+
+TEST(AudioFormatSuite, ParsePcmContentType)
+{
+  PcmFormat format;
+  EXPECT_TRUE(ParsePcmContentType("audio/l16; rate=8000; channels=2", format));
+  EXPECT_EQ(format.sample_rate, 8000);
+  EXPECT_EQ(format.channels, 2);
+  EXPECT_EQ(format.sample_bits, 16);
+  EXPECT_EQ(format.FrameBytes(), 4);
+
+  EXPECT_TRUE(ParsePcmContentType(
+    "audio/lpcm; sample-rate=16000; sample-size-bits=16; channel-count=1; is-big-endian=false",
+    format));
+  EXPECT_EQ(format.sample_rate, 16000);
+  EXPECT_EQ(format.channels, 1);
+  EXPECT_FALSE(format.big_endian);
+
+  EXPECT_TRUE(ParsePcmContentType("Audio/L16", format));
+  EXPECT_EQ(format.sample_rate, 16000);
+  EXPECT_FALSE(ParsePcmContentType("audio/x-cbr-opus-with-preamble; bit-rate=256000", format));
+  EXPECT_FALSE(ParsePcmContentType("text/plain; charset=utf-8", format));
+  EXPECT_FALSE(ParsePcmContentType("audio/l16; rate=fast", format));
+}
+
+/**
+ * The vectorized kernel matches the scalar one, including full scale samples and odd lengths.
+ */
+TEST(VoiceActivitySuite, KernelMatchesScalar)
+{
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<int> sample(-32768, 32767);
+  std::vector<int16_t> samples(5000);
+  for (auto & value : samples) {
+    value = static_cast<int16_t>(sample(generator));
+  }
+  samples[10] = -32768;
+  samples[11] = -32768;
+  for (size_t count : {0, 1, 8, 9, 17, 160, 4999, 5000}) {
+    auto expected = ComputeFrameFeaturesScalar(samples.data(), count);
+    auto actual = ComputeFrameFeatures(samples.data(), count);
+    EXPECT_EQ(actual.energy, expected.energy) << count;
+    EXPECT_EQ(actual.zero_crossings, expected.zero_crossings) << count;
+  }
+  // enough samples to widen the zero crossing counters
+  std::vector<int16_t> alternating(8 * 4096 * 3 + 5);
+  for (size_t index = 0; index < alternating.size(); index++) {
+    alternating[index] = index % 2 ? -1 : 1;
+  }
+  auto features = ComputeFrameFeatures(alternating.data(), alternating.size());
+  EXPECT_EQ(features.zero_crossings, alternating.size() - 1);
+}
+
+TEST(VoiceActivitySuite, FindSpeech)
+{
+  VoiceActivityConfiguration configuration;
+  configuration.pad_ms = 100;
+  VoiceActivityDetector detector(configuration);
+  auto clip = MakeClip(16000, 3000, 1000, 2000);
+  auto span = detector.FindSpeech(clip.data(), clip.size(), 1, 16000);
+  ASSERT_TRUE(span.has_speech);
+  EXPECT_NEAR(span.begin, 14400u, 160u);
+  EXPECT_NEAR(span.end, 33600u, 160u);
+
+  // no speech, nothing is trimmed
+  auto silence = MakeClip(16000, 1000, 0, 0);
+  span = detector.FindSpeech(silence.data(), silence.size(), 1, 16000);
+  EXPECT_FALSE(span.has_speech);
+  EXPECT_EQ(span.begin, 0u);
+  EXPECT_EQ(span.end, silence.size());
+}
+
+/**
+ * The pipeline uploads the voiced span of pcm requests and leaves other audio alone.
+ */
+TEST(VoiceActivitySuite, PipelineTrimsPcm)
+{
+  VoiceActivityConfiguration configuration;
+  configuration.enabled = true;
+  configuration.pad_ms = 0;
+  AudioPipeline pipeline(configuration);
+  auto clip = MakeClip(8000, 2000, 500, 1500);
+  std::vector<uint8_t> audio(clip.size() * sizeof(int16_t));
+  std::memcpy(audio.data(), clip.data(), audio.size());
+
+  auto processed = pipeline.Process("audio/l16; rate=8000; channels=1", audio);
+  EXPECT_EQ(processed.content_type, "audio/l16; rate=8000; channels=1");
+  EXPECT_GE(processed.data, audio.data());
+  EXPECT_EQ(processed.size + processed.trimmed_bytes, audio.size());
+  EXPECT_NEAR(processed.trimmed_ms, 1000.0, 40.0);
+
+  processed = pipeline.Process("audio/x-cbr-opus-with-preamble", audio);
+  EXPECT_EQ(processed.size, audio.size());
+  EXPECT_EQ(processed.trimmed_bytes, 0u);
+
+  configuration.enabled = false;
+  processed = AudioPipeline(configuration).Process("audio/l16; rate=8000; channels=1", audio);
+  EXPECT_EQ(processed.size, audio.size());
+}
+
+int main(int argc, char ** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}